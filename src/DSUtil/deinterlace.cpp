@@ -17,1339 +17,78 @@
 
 #include "stdafx.h"
 #include <emmintrin.h>
+#if _MSC_VER >= 1700 // no AVX2 intrinsics in VS2010
+#include <immintrin.h>
+#endif
 #include <vd2/system/memory.h>
 #include <vd2/system/cpuaccel.h>
 #include <vd2/system/vdstl.h>
+#include "vd.h"
 
-#pragma warning(disable: 4799)		// warning C4799: function has no EMMS instruction
+// Every SIMD routine in this file produces exactly the same output as its
+// scalar counterpart, the scalar versions are the reference implementation.
 
 ///////////////////////////////////////////////////////////////////////////
+// scalar
 
-#ifdef _M_IX86
-static void __declspec(naked) asm_blend_row_clipped(void *dst, const void *src, uint32 w, ptrdiff_t srcpitch) {
-	__asm {
-		push	ebp
-		push	edi
-		push	esi
-		push	ebx
-
-		mov		edi,[esp+20]
-		mov		esi,[esp+24]
-		sub		edi,esi
-		mov		ebp,[esp+28]
-		mov		edx,[esp+32]
-
-xloop:
-		mov		ecx,[esi]
-		mov		eax,0fefefefeh
-
-		mov		ebx,[esi+edx]
-		and		eax,ecx
-
-		shr		eax,1
-		and		ebx,0fefefefeh
-
-		shr		ebx,1
-		add		esi,4
-
-		add		eax,ebx
-		dec		ebp
-
-		mov		[edi+esi-4],eax
-		jnz		xloop
-
-		pop		ebx
-		pop		esi
-		pop		edi
-		pop		ebp
-		ret
-	};
-}
-
-static void __declspec(naked) asm_blend_row(void *dst, const void *src, uint32 w, ptrdiff_t srcpitch) {
-	__asm {
-		push	ebp
-		push	edi
-		push	esi
-		push	ebx
-
-		mov		edi,[esp+20]
-		mov		esi,[esp+24]
-		sub		edi,esi
-		mov		ebp,[esp+28]
-		mov		edx,[esp+32]
-
-xloop:
-		mov		ecx,[esi]
-		mov		eax,0fcfcfcfch
-
-		mov		ebx,[esi+edx]
-		and		eax,ecx
-
-		shr		ebx,1
-		mov		ecx,[esi+edx*2]
-
-		shr		ecx,2
-		and		ebx,07f7f7f7fh
-
-		shr		eax,2
-		and		ecx,03f3f3f3fh
-
-		add		eax,ebx
-		add		esi,4
-
-		add		eax,ecx
-		dec		ebp
-
-		mov		[edi+esi-4],eax
-		jnz		xloop
-
-		pop		ebx
-		pop		esi
-		pop		edi
-		pop		ebp
-		ret
-	};
-}
-
-static void __declspec(naked) asm_blend_row_MMX(void *dst, const void *src, uint32 w, ptrdiff_t srcpitch) {
-	static const __declspec(align(8)) __int64 mask0 = 0xfcfcfcfcfcfcfcfci64;
-	static const __declspec(align(8)) __int64 mask1 = 0x7f7f7f7f7f7f7f7fi64;
-	static const __declspec(align(8)) __int64 mask2 = 0x3f3f3f3f3f3f3f3fi64;
-	__asm {
-		push	ebp
-		push	edi
-		push	esi
-		push	ebx
-
-		mov		edi,[esp+20]
-		mov		esi,[esp+24]
-		sub		edi,esi
-		mov		ebp,[esp+28]
-		mov		edx,[esp+32]
-
-		movq	mm5,mask0
-		movq	mm6,mask1
-		movq	mm7,mask2
-		inc		ebp
-		shr		ebp,1
-xloop:
-		movq	mm2,[esi]
-		movq	mm0,mm5
-
-		movq	mm1,[esi+edx]
-		pand	mm0,mm2
-
-		psrlq	mm1,1
-		movq	mm2,[esi+edx*2]
-
-		psrlq	mm2,2
-		pand	mm1,mm6
-
-		psrlq	mm0,2
-		pand	mm2,mm7
-
-		paddb	mm0,mm1
-		add		esi,8
-
-		paddb	mm0,mm2
-		dec		ebp
-
-		movq	[edi+esi-8],mm0
-		jne		xloop
-
-		pop		ebx
-		pop		esi
-		pop		edi
-		pop		ebp
-		ret
-	};
-}
-
-static void __declspec(naked) asm_blend_row_ISSE(void *dst, const void *src, uint32 w, ptrdiff_t srcpitch) {
-	__asm {
-		push	ebp
-		push	edi
-		push	esi
-		push	ebx
-
-		mov		edi,[esp+20]
-		mov		esi,[esp+24]
-		sub		edi,esi
-		mov		ebp,[esp+28]
-		mov		edx,[esp+32]
-
-		inc		ebp
-		shr		ebp,1
-		pcmpeqb	mm7, mm7
-
-		align	16
-xloop:
-		movq	mm0, [esi]
-		movq	mm2, mm7
-		pxor	mm0, mm7
-
-		pxor	mm2, [esi+edx*2]
-		pavgb	mm0, mm2
-		pxor	mm0, mm7
-
-		pavgb	mm0, [esi+edx]
-		add		esi,8
-
-		movq	[edi+esi-8],mm0
-		dec		ebp
-		jne		xloop
-
-		pop		ebx
-		pop		esi
-		pop		edi
-		pop		ebp
-		ret
-	};
-}
-#else
-static void asm_blend_row_clipped(void *dst0, const void *src0, uint32 w, ptrdiff_t srcpitch) {
-	uint32 *dst = (uint32 *)dst0;
-	const uint32 *src = (const uint32 *)src0;
-	const uint32 *src2 = (const uint32 *)((const char *)src + srcpitch);
-
-	do {
-		const uint32 x = *src++;
-		const uint32 y = *src2++;
-
-		*dst++ = (x|y) - (((x^y)&0xfefefefe)>>1);
-	} while(--w);
-}
-
-static void asm_blend_row(void *dst0, const void *src0, uint32 w, ptrdiff_t srcpitch) {
-	uint32 *dst = (uint32 *)dst0;
-	const uint32 *src = (const uint32 *)src0;
-	const uint32 *src2 = (const uint32 *)((const char *)src + srcpitch);
-	const uint32 *src3 = (const uint32 *)((const char *)src2 + srcpitch);
-
-	do {
-		const uint32 a = *src++;
-		const uint32 b = *src2++;
-		const uint32 c = *src3++;
-		const uint32 hi = (a & 0xfcfcfc) + 2*(b & 0xfcfcfc) + (c & 0xfcfcfc);
-		const uint32 lo = (a & 0x030303) + 2*(b & 0x030303) + (c & 0x030303) + 0x020202;
-
-		*dst++ = (hi + (lo & 0x0c0c0c))>>2;
-	} while(--w);
-}
-#endif
-
-#if defined(VD_CPU_X86) || defined(VD_CPU_AMD64)
-	static void asm_blend_row_SSE2(void *dst, const void *src, uint32 w, ptrdiff_t srcpitch) {
-		__m128i zero = _mm_setzero_si128();
-		__m128i inv = _mm_cmpeq_epi8(zero, zero);
-
-		w = (w + 3) >> 2;
-
-		const __m128i *src1 = (const __m128i *)src;
-		const __m128i *src2 = (const __m128i *)((const char *)src + srcpitch);
-		const __m128i *src3 = (const __m128i *)((const char *)src + srcpitch*2);
-		__m128i *dstrow = (__m128i *)dst;
-		do {
-			__m128i a = *src1++;
-			__m128i b = *src2++;
-			__m128i c = *src3++;
-
-			*dstrow++ = _mm_avg_epu8(_mm_xor_si128(_mm_avg_epu8(_mm_xor_si128(a, inv), _mm_xor_si128(c, inv)), inv), b);
-		} while(--w);
-	}
-
-
-	void ela_L8_SSE2(__m128i *dst, const __m128i *srcat, const __m128i *srcab, int w16) {
-		do {
-			__m128i top0 = srcat[0];
-			__m128i top1 = srcat[1];
-			__m128i top2 = srcat[2];
-			__m128i bot0 = srcab[0];
-			__m128i bot1 = srcab[1];
-			__m128i bot2 = srcab[2];
-			++srcat;
-			++srcab;
-
-			__m128i topl2 = _mm_or_si128(_mm_srli_si128(top0, 16 - 3), _mm_slli_si128(top1, 3));
-			__m128i topl1 = _mm_or_si128(_mm_srli_si128(top0, 16 - 2), _mm_slli_si128(top1, 2));
-			__m128i topc0 = _mm_or_si128(_mm_srli_si128(top0, 16 - 1), _mm_slli_si128(top1, 1));
-			__m128i topr1 = top1;
-			__m128i topr2 = _mm_or_si128(_mm_srli_si128(top1, 1), _mm_slli_si128(top2, 16 - 1));
-			__m128i topr3 = _mm_or_si128(_mm_srli_si128(top1, 2), _mm_slli_si128(top2, 16 - 2));
-
-			__m128i botl2 = _mm_or_si128(_mm_srli_si128(bot0, 16 - 3), _mm_slli_si128(bot1, 3));
-			__m128i botl1 = _mm_or_si128(_mm_srli_si128(bot0, 16 - 2), _mm_slli_si128(bot1, 2));
-			__m128i botc0 = _mm_or_si128(_mm_srli_si128(bot0, 16 - 1), _mm_slli_si128(bot1, 1));
-			__m128i botr1 = bot1;
-			__m128i botr2 = _mm_or_si128(_mm_srli_si128(bot1, 1), _mm_slli_si128(bot2, 16 - 1));
-			__m128i botr3 = _mm_or_si128(_mm_srli_si128(bot1, 2), _mm_slli_si128(bot2, 16 - 2));
-
-			__m128i rawscorec0 = _mm_or_si128(_mm_subs_epu8(topc0, botc0), _mm_subs_epu8(botc0, topc0));
-			__m128i rawscorel1 = _mm_or_si128(_mm_subs_epu8(topl1, botr1), _mm_subs_epu8(botr1, topl1));
-			__m128i rawscorel2 = _mm_or_si128(_mm_subs_epu8(topl2, botr2), _mm_subs_epu8(botr2, topl2));
-			__m128i rawscorer1 = _mm_or_si128(_mm_subs_epu8(topr1, botl1), _mm_subs_epu8(botl1, topr1));
-			__m128i rawscorer2 = _mm_or_si128(_mm_subs_epu8(topr2, botl2), _mm_subs_epu8(botl2, topr2));
-
-			dst[0] = rawscorec0;
-			dst[1] = rawscorel1;
-			dst[2] = rawscorel2;
-			dst[3] = rawscorer1;
-			dst[4] = rawscorer2;
-			dst[5] = _mm_avg_epu8(topr1, botr1);
-			dst[6] = _mm_avg_epu8(topc0, botr2);
-			dst[7] = _mm_avg_epu8(topl1, botr3);
-			dst[8] = _mm_avg_epu8(topr2, botc0);
-			dst[9] = _mm_avg_epu8(topr3, botl1);
-			dst += 10;
-		} while(--w16);
+namespace {
+	inline int absdiff(int a, int b) {
+		return a > b ? a - b : b - a;
 	}
 
-	void nela_L8_SSE2(__m128i *dst, const __m128i *elabuf, int w16) {
-		__m128i zero = _mm_setzero_si128();
-		__m128i x80b = _mm_set1_epi8((unsigned char)0x80);
-
-		do {
-			__m128i x0, x1, x2, y;
-
-			x0 = elabuf[0];
-			y = elabuf[10];
-			x1 = _mm_or_si128(_mm_srli_si128(x0, 1), _mm_slli_si128(y, 15));
-			x2 = _mm_or_si128(_mm_srli_si128(x0, 2), _mm_slli_si128(y, 14));
-			__m128i scorec0 = _mm_avg_epu8(_mm_avg_epu8(x0, x2), x1);
-
-			x0 = elabuf[1];
-			y = elabuf[11];
-			x1 = _mm_or_si128(_mm_srli_si128(x0, 1), _mm_slli_si128(y, 15));
-			x2 = _mm_or_si128(_mm_srli_si128(x0, 2), _mm_slli_si128(y, 14));
-			__m128i scorel1 = _mm_avg_epu8(_mm_avg_epu8(x0, x2), x1);
-
-			x0 = elabuf[2];
-			y = elabuf[12];
-			x1 = _mm_or_si128(_mm_srli_si128(x0, 1), _mm_slli_si128(y, 15));
-			x2 = _mm_or_si128(_mm_srli_si128(x0, 2), _mm_slli_si128(y, 14));
-			__m128i scorel2 = _mm_avg_epu8(_mm_avg_epu8(x0, x2), x1);
-
-			x0 = elabuf[3];
-			y = elabuf[13];
-			x1 = _mm_or_si128(_mm_srli_si128(x0, 1), _mm_slli_si128(y, 15));
-			x2 = _mm_or_si128(_mm_srli_si128(x0, 2), _mm_slli_si128(y, 14));
-			__m128i scorer1 = _mm_avg_epu8(_mm_avg_epu8(x0, x2), x1);
-
-			x0 = elabuf[4];
-			y = elabuf[14];
-			x1 = _mm_or_si128(_mm_srli_si128(x0, 1), _mm_slli_si128(y, 15));
-			x2 = _mm_or_si128(_mm_srli_si128(x0, 2), _mm_slli_si128(y, 14));
-			__m128i scorer2 = _mm_avg_epu8(_mm_avg_epu8(x0, x2), x1);
-
-			scorec0 = _mm_xor_si128(scorec0, x80b);
-			scorel1 = _mm_xor_si128(scorel1, x80b);
-			scorel2 = _mm_xor_si128(scorel2, x80b);
-			scorer1 = _mm_xor_si128(scorer1, x80b);
-			scorer2 = _mm_xor_si128(scorer2, x80b);
-
-			// result = (scorel1 < scorec0) ? (scorel2 < scorel1 ? l2 : l1) : (scorer1 < scorec0) ? (scorer2 < scorer1 ? r2 : r1) : c0
-
-			__m128i cmplt_l1_c0 = _mm_cmplt_epi8(scorel1, scorec0);
-			__m128i cmplt_r1_c0 = _mm_cmplt_epi8(scorer1, scorec0);
-			__m128i cmplt_l1_r1 = _mm_cmplt_epi8(scorel1, scorer1);
-
-			__m128i is_l1 = _mm_and_si128(cmplt_l1_r1, cmplt_l1_c0);
-			__m128i is_r1 = _mm_andnot_si128(cmplt_l1_r1, cmplt_r1_c0);
-			__m128i is_c0_inv = _mm_or_si128(cmplt_l1_c0, cmplt_r1_c0);
-			__m128i is_c0 = _mm_andnot_si128(is_c0_inv, _mm_cmpeq_epi8(zero, zero));
-
-			__m128i is_l2 = _mm_and_si128(is_l1, _mm_cmplt_epi8(scorel2, scorel1));
-			__m128i is_r2 = _mm_and_si128(is_r1, _mm_cmplt_epi8(scorer2, scorer1));
-
-			is_l1 = _mm_andnot_si128(is_l2, is_l1);
-			is_r1 = _mm_andnot_si128(is_r2, is_r1);
-
-			__m128i mask_c0 = is_c0;
-			__m128i mask_l1 = is_l1;
-			__m128i mask_l2 = is_l2;
-			__m128i mask_r1 = is_r1;
-			__m128i mask_r2 = is_r2;
-
-			__m128i result_c0 = _mm_and_si128(elabuf[5], mask_c0);
-			__m128i result_l1 = _mm_and_si128(elabuf[6], mask_l1);
-			__m128i result_l2 = _mm_and_si128(elabuf[7], mask_l2);
-			__m128i result_r1 = _mm_and_si128(elabuf[8], mask_r1);
-			__m128i result_r2 = _mm_and_si128(elabuf[9], mask_r2);
-
-			elabuf += 10;
-
-			__m128i pred = _mm_or_si128(_mm_or_si128(_mm_or_si128(result_l1, result_l2), _mm_or_si128(result_r1, result_r2)), result_c0);
-
-			*dst++ = pred;
-		} while(--w16);
+	// rounds up, same as pavgb
+	inline uint8 avg_u8(int a, int b) {
+		return (uint8)((a + b + 1) >> 1);
 	}
-#endif
 
-#if defined(VD_CPU_X86)
-	void __declspec(naked) __stdcall ela_L8_MMX(void *dst, const void *srcat, const void *srcab, int w16) {
-		static const __declspec(align(8)) uint64 xFEb = 0xfefefefefefefefe;
-		__asm {
-			push		ebx
-			mov			ebx, [esp + 4 + 4]
-			mov			ecx, [esp + 8 + 4]
-			mov			edx, [esp + 12 + 4]
-			mov			eax, [esp + 16 + 4]
-			movq		mm7, xFEb
-
-xloop:
-			movq		mm0, [ecx + 15]
-			movq		mm1, [edx + 15]
-			movq		mm4, mm0
-			movq		mm2, [ecx + 15 + 8]
-			psubusb		mm0, mm1
-			movq		mm3, [edx + 15 + 8]
-			movq		mm5, mm2
-			psubusb		mm2, mm3
-			psubusb		mm1, mm4
-			psubusb		mm3, mm5
-			por			mm0, mm1
-			movq		[ebx], mm0
-			por			mm2, mm3
-			movq		[ebx + 8], mm2
-
-			movq		mm0, [ecx + 14]
-			movq		mm1, [edx + 16]
-			movq		mm4, mm0
-			movq		mm2, [ecx + 14 + 8]
-			psubusb		mm0, mm1
-			movq		mm3, [edx + 16 + 8]
-			movq		mm5, mm2
-			psubusb		mm2, mm3
-			psubusb		mm1, mm4
-			psubusb		mm3, mm5
-			por			mm0, mm1
-			movq		[ebx + 16], mm0
-			por			mm2, mm3
-			movq		[ebx + 24], mm2
-
-			movq		mm0, [ecx + 13]
-			movq		mm1, [edx + 17]
-			movq		mm4, mm0
-			movq		mm2, [ecx + 13 + 8]
-			psubusb		mm0, mm1
-			movq		mm3, [edx + 17 + 8]
-			movq		mm5, mm2
-			psubusb		mm2, mm3
-			psubusb		mm1, mm4
-			psubusb		mm3, mm5
-			por			mm0, mm1
-			movq		[ebx + 32], mm0
-			por			mm2, mm3
-			movq		[ebx + 40], mm2
-
-			movq		mm0, [ecx + 16]
-			movq		mm1, [edx + 14]
-			movq		mm4, mm0
-			movq		mm2, [ecx + 16 + 8]
-			psubusb		mm0, mm1
-			movq		mm3, [edx + 14 + 8]
-			movq		mm5, mm2
-			psubusb		mm2, mm3
-			psubusb		mm1, mm4
-			psubusb		mm3, mm5
-			por			mm0, mm1
-			movq		[ebx + 48], mm0
-			por			mm2, mm3
-			movq		[ebx + 56], mm2
-
-			movq		mm0, [ecx + 17]
-			movq		mm1, [edx + 13]
-			movq		mm4, mm0
-			movq		mm2, [ecx + 17 + 8]
-			psubusb		mm0, mm1
-			movq		mm3, [edx + 13 + 8]
-			movq		mm5, mm2
-			psubusb		mm2, mm3
-			psubusb		mm1, mm4
-			psubusb		mm3, mm5
-			por			mm0, mm1
-			movq		[ebx + 64], mm0
-			por			mm2, mm3
-			movq		[ebx + 72], mm2
-
-			movq		mm0, [ecx + 16]
-			movq		mm1, [edx + 16]
-			movq		mm2, [ecx + 16 + 8]
-			movq		mm3, [edx + 16 + 8]
-			movq		mm4, mm0
-			movq		mm5, mm2
-			pxor		mm0, mm1
-			pxor		mm2, mm3
-			por			mm1, mm4
-			por			mm3, mm5
-			pand		mm0, mm7
-			pand		mm2, mm7
-			psrlw		mm0, 1
-			psrlw		mm2, 1
-			psubb		mm1, mm0
-			psubb		mm3, mm2
-			movq		[ebx + 80], mm1
-			movq		[ebx + 88], mm3
-
-			movq		mm0, [ecx + 15]
-			movq		mm1, [edx + 17]
-			movq		mm2, [ecx + 15 + 8]
-			movq		mm3, [edx + 17 + 8]
-			movq		mm4, mm0
-			movq		mm5, mm2
-			pxor		mm0, mm1
-			pxor		mm2, mm3
-			por			mm1, mm4
-			por			mm3, mm5
-			pand		mm0, mm7
-			pand		mm2, mm7
-			psrlw		mm0, 1
-			psrlw		mm2, 1
-			psubb		mm1, mm0
-			psubb		mm3, mm2
-			movq		[ebx + 96], mm1
-			movq		[ebx + 104], mm3
-
-			movq		mm0, [ecx + 14]
-			movq		mm1, [edx + 18]
-			movq		mm2, [ecx + 14 + 8]
-			movq		mm3, [edx + 18 + 8]
-			movq		mm4, mm0
-			movq		mm5, mm2
-			pxor		mm0, mm1
-			pxor		mm2, mm3
-			por			mm1, mm4
-			por			mm3, mm5
-			pand		mm0, mm7
-			pand		mm2, mm7
-			psrlw		mm0, 1
-			psrlw		mm2, 1
-			psubb		mm1, mm0
-			psubb		mm3, mm2
-			movq		[ebx + 112], mm1
-			movq		[ebx + 120], mm3
-
-			movq		mm0, [ecx + 17]
-			movq		mm1, [edx + 15]
-			movq		mm2, [ecx + 17 + 8]
-			movq		mm3, [edx + 15 + 8]
-			movq		mm4, mm0
-			movq		mm5, mm2
-			pxor		mm0, mm1
-			pxor		mm2, mm3
-			por			mm1, mm4
-			por			mm3, mm5
-			pand		mm0, mm7
-			pand		mm2, mm7
-			psrlw		mm0, 1
-			psrlw		mm2, 1
-			psubb		mm1, mm0
-			psubb		mm3, mm2
-			movq		[ebx + 128], mm1
-			movq		[ebx + 136], mm3
-
-			movq		mm0, [ecx + 18]
-			movq		mm1, [edx + 14]
-			movq		mm2, [ecx + 18 + 8]
-			movq		mm3, [edx + 14 + 8]
-			movq		mm4, mm0
-			movq		mm5, mm2
-			pxor		mm0, mm1
-			pxor		mm2, mm3
-			por			mm1, mm4
-			por			mm3, mm5
-			pand		mm0, mm7
-			pand		mm2, mm7
-			psrlw		mm0, 1
-			psrlw		mm2, 1
-			psubb		mm1, mm0
-			psubb		mm3, mm2
-			movq		[ebx + 144], mm1
-			movq		[ebx + 152], mm3
-
-			add			ebx, 160
-			add			ecx, 16
-			add			edx, 16
-			dec			eax
-			jne			xloop
-
-			emms
-			pop			ebx
-			ret			16
-		}
+	// 1-2-1 vertical filter: pavgb(b, ~pavgb(~a, ~c))
+	inline uint8 blend_u8(int a, int b, int c) {
+		return avg_u8((a + c) >> 1, b);
 	}
 
-	void __declspec(naked) __stdcall ela_L8_ISSE(void *dst, const void *srcat, const void *srcab, int w16) {
-		static const __declspec(align(8)) uint64 xFEb = 0xfefefefefefefefe;
-		__asm {
-			push		ebx
-			mov			ebx, [esp + 4 + 4]
-			mov			ecx, [esp + 8 + 4]
-			mov			edx, [esp + 12 + 4]
-			mov			eax, [esp + 16 + 4]
-			movq		mm7, xFEb
-
-xloop:
-			movq		mm0, [ecx + 15]
-			movq		mm1, [edx + 15]
-			movq		mm4, mm0
-			movq		mm2, [ecx + 15 + 8]
-			psubusb		mm0, mm1
-			movq		mm3, [edx + 15 + 8]
-			movq		mm5, mm2
-			psubusb		mm2, mm3
-			psubusb		mm1, mm4
-			psubusb		mm3, mm5
-			por			mm0, mm1
-			movq		[ebx], mm0
-			por			mm2, mm3
-			movq		[ebx + 8], mm2
-
-			movq		mm0, [ecx + 14]
-			movq		mm1, [edx + 16]
-			movq		mm4, mm0
-			movq		mm2, [ecx + 14 + 8]
-			psubusb		mm0, mm1
-			movq		mm3, [edx + 16 + 8]
-			movq		mm5, mm2
-			psubusb		mm2, mm3
-			psubusb		mm1, mm4
-			psubusb		mm3, mm5
-			por			mm0, mm1
-			movq		[ebx + 16], mm0
-			por			mm2, mm3
-			movq		[ebx + 24], mm2
-
-			movq		mm0, [ecx + 13]
-			movq		mm1, [edx + 17]
-			movq		mm4, mm0
-			movq		mm2, [ecx + 13 + 8]
-			psubusb		mm0, mm1
-			movq		mm3, [edx + 17 + 8]
-			movq		mm5, mm2
-			psubusb		mm2, mm3
-			psubusb		mm1, mm4
-			psubusb		mm3, mm5
-			por			mm0, mm1
-			movq		[ebx + 32], mm0
-			por			mm2, mm3
-			movq		[ebx + 40], mm2
-
-			movq		mm0, [ecx + 16]
-			movq		mm1, [edx + 14]
-			movq		mm4, mm0
-			movq		mm2, [ecx + 16 + 8]
-			psubusb		mm0, mm1
-			movq		mm3, [edx + 14 + 8]
-			movq		mm5, mm2
-			psubusb		mm2, mm3
-			psubusb		mm1, mm4
-			psubusb		mm3, mm5
-			por			mm0, mm1
-			movq		[ebx + 48], mm0
-			por			mm2, mm3
-			movq		[ebx + 56], mm2
-
-			movq		mm0, [ecx + 17]
-			movq		mm1, [edx + 13]
-			movq		mm4, mm0
-			movq		mm2, [ecx + 17 + 8]
-			psubusb		mm0, mm1
-			movq		mm3, [edx + 13 + 8]
-			movq		mm5, mm2
-			psubusb		mm2, mm3
-			psubusb		mm1, mm4
-			psubusb		mm3, mm5
-			por			mm0, mm1
-			movq		[ebx + 64], mm0
-			por			mm2, mm3
-			movq		[ebx + 72], mm2
-
-			movq		mm0, [ecx + 16]
-			movq		mm1, [edx + 16]
-			movq		mm2, [ecx + 16 + 8]
-			movq		mm3, [edx + 16 + 8]
-			pavgb		mm1, mm0
-			pavgb		mm3, mm2
-			movq		[ebx + 80], mm1
-			movq		[ebx + 88], mm3
-
-			movq		mm0, [ecx + 15]
-			movq		mm1, [edx + 17]
-			movq		mm2, [ecx + 15 + 8]
-			movq		mm3, [edx + 17 + 8]
-			pavgb		mm1, mm0
-			pavgb		mm3, mm2
-			movq		[ebx + 96], mm1
-			movq		[ebx + 104], mm3
-
-			movq		mm0, [ecx + 14]
-			movq		mm1, [edx + 18]
-			movq		mm2, [ecx + 14 + 8]
-			movq		mm3, [edx + 18 + 8]
-			pavgb		mm1, mm0
-			pavgb		mm3, mm2
-			movq		[ebx + 112], mm1
-			movq		[ebx + 120], mm3
-
-			movq		mm0, [ecx + 17]
-			movq		mm1, [edx + 15]
-			movq		mm2, [ecx + 17 + 8]
-			movq		mm3, [edx + 15 + 8]
-			pavgb		mm1, mm0
-			pavgb		mm3, mm2
-			movq		[ebx + 128], mm1
-			movq		[ebx + 136], mm3
-
-			movq		mm0, [ecx + 18]
-			movq		mm1, [edx + 14]
-			movq		mm2, [ecx + 18 + 8]
-			movq		mm3, [edx + 14 + 8]
-			pavgb		mm1, mm0
-			pavgb		mm3, mm2
-			movq		[ebx + 144], mm1
-			movq		[ebx + 152], mm3
-
-			add			ebx, 160
-			add			ecx, 16
-			add			edx, 16
-			dec			eax
-			jne			xloop
-
-			emms
-			pop			ebx
-			ret			16
-		}
+	void avg_row_scalar(uint8 *dst, const uint8 *src1, const uint8 *src2, uint32 w) {
+		for(uint32 x=0; x<w; ++x)
+			dst[x] = avg_u8(src1[x], src2[x]);
 	}
 
-	void __declspec(naked) __stdcall nela_L8_ISSE(void *dst, const void *elabuf, int w16) {
-		static const __declspec(align(8)) uint64 x7fb = 0x7f7f7f7f7f7f7f7f;
-		__asm {
-			mov		edx, [esp+4]
-			mov		ecx, [esp+8]
-			mov		eax, [esp+12]
-xloop:
-			movq	mm0, [ecx+000h]
-			pavgb	mm0, [ecx+002h]
-			pavgb	mm0, [ecx+001h]
-
-			movq	mm1, [ecx+010h]
-			pavgb	mm1, [ecx+012h]
-			pavgb	mm1, [ecx+011h]
-
-			movq	mm2, [ecx+020h]
-			pavgb	mm2, [ecx+022h]
-			pavgb	mm2, [ecx+021h]
-
-			movq	mm3, [ecx+030h]
-			pavgb	mm3, [ecx+032h]
-			pavgb	mm3, [ecx+031h]
-
-			movq	mm4, [ecx+040h]
-			pavgb	mm4, [ecx+042h]
-			pavgb	mm4, [ecx+041h]
-
-			movq	mm5, x7fb
-			pxor	mm0, mm5
-			pxor	mm1, mm5
-			pxor	mm2, mm5
-			pxor	mm3, mm5
-			pxor	mm4, mm5
-
-			;mm0 = scorec0
-			;mm1 = scorel1
-			;mm2 = scorel2
-			;mm3 = scorer1
-			;mm4 = scorer2
-
-			movq	mm5, mm3
-			pcmpgtb	mm5, mm1		;(scorer1 > scorel1) == (scorel1 < scorer1)
-
-			pcmpgtb	mm4, mm3		;scorer2 > scorer1
-			pcmpgtb	mm2, mm1		;scorel2 > scorel1
-
-			pcmpgtb	mm1, mm0		;scorel1 > scorec0
-			pcmpgtb	mm3, mm0		;scorer1 > scorec0
-
-			movq	mm6, mm1
-			pcmpeqb	mm0, mm0
-			por		mm6, mm3		;scorel1 > scorec0 || scorer1 > scorec0
-			pxor	mm0, mm6		;mask_c0
-
-			pand	mm3, mm5		;scorer1 > scorec0 && scorer1 > scorel1
-			pandn	mm5, mm1		;scorel1 > scorec0 && scorel1 >= scorer1
-
-			pand	mm4, mm3		;mask_r2
-			pand	mm2, mm5		;mask_l2
-
-			pxor	mm3, mm4		;mask_r1
-			pxor	mm5, mm2		;mask_l1
-
-			pand	mm0, [ecx+050h]
-			pand	mm5, [ecx+060h]
-			pand	mm2, [ecx+070h]
-			pand	mm3, [ecx+080h]
-			pand	mm4, [ecx+090h]
-			por		mm0, mm5
-			por		mm2, mm3
-			por		mm0, mm4
-			por		mm0, mm2
-			movq	[edx], mm0
-
-			movq	mm0, [ecx+008h]
-			movq	mm5, [ecx+0a0h]
-			movq	mm6, mm0
-			psrlq	mm0, 16
-			movq	mm7, mm5
-			psllq	mm5, 48
-			por		mm0, mm5
-			psrlq	mm6, 8
-			psllq	mm7, 56
-			por		mm6, mm7
-			pavgb	mm0, [ecx+008h]
-			pavgb	mm0, mm6
-
-			movq	mm1, [ecx+018h]
-			movq	mm5, [ecx+0b0h]
-			movq	mm6, mm1
-			psrlq	mm1, 16
-			movq	mm7, mm5
-			psllq	mm5, 48
-			por		mm1, mm5
-			psrlq	mm6, 8
-			psllq	mm7, 56
-			por		mm6, mm7
-			pavgb	mm1, [ecx+018h]
-			pavgb	mm1, mm6
-
-			movq	mm2, [ecx+028h]
-			movq	mm5, [ecx+0c0h]
-			movq	mm6, mm2
-			psrlq	mm2, 16
-			movq	mm7, mm5
-			psllq	mm5, 48
-			por		mm2, mm5
-			psrlq	mm6, 8
-			psllq	mm7, 56
-			por		mm6, mm7
-			pavgb	mm2, [ecx+028h]
-			pavgb	mm2, mm6
-
-			movq	mm3, [ecx+038h]
-			movq	mm5, [ecx+0d0h]
-			movq	mm6, mm3
-			psrlq	mm3, 16
-			movq	mm7, mm5
-			psllq	mm5, 48
-			por		mm3, mm5
-			psrlq	mm6, 8
-			psllq	mm7, 56
-			por		mm6, mm7
-			pavgb	mm3, [ecx+038h]
-			pavgb	mm3, mm6
-
-			movq	mm4, [ecx+048h]
-			movq	mm5, [ecx+0e0h]
-			movq	mm6, mm4
-			psrlq	mm4, 16
-			movq	mm7, mm5
-			psllq	mm5, 48
-			por		mm4, mm5
-			psrlq	mm6, 8
-			psllq	mm7, 56
-			por		mm6, mm7
-			pavgb	mm4, [ecx+048h]
-			pavgb	mm4, mm6
-
-			movq	mm5, x7fb
-			pxor	mm0, mm5
-			pxor	mm1, mm5
-			pxor	mm2, mm5
-			pxor	mm3, mm5
-			pxor	mm4, mm5
-
-			;mm0 = scorec0
-			;mm1 = scorel1
-			;mm2 = scorel2
-			;mm3 = scorer1
-			;mm4 = scorer2
-
-			movq	mm5, mm3
-			pcmpgtb	mm5, mm1		;(scorer1 > scorel1) == (scorel1 < scorer1)
-
-			pcmpgtb	mm4, mm3		;scorer2 > scorer1
-			pcmpgtb	mm2, mm1		;scorel2 > scorel1
-
-			pcmpgtb	mm1, mm0		;scorel1 > scorec0
-			pcmpgtb	mm3, mm0		;scorer1 > scorec0
-
-			movq	mm6, mm1
-			pcmpeqb	mm0, mm0
-			por		mm6, mm3		;scorel1 > scorec0 || scorer1 > scorec0
-			pxor	mm0, mm6		;mask_c0
-
-			pand	mm3, mm5		;scorer1 > scorec0 && scorer1 > scorel1
-			pandn	mm5, mm1		;scorel1 > scorec0 && scorel1 >= scorer1
-
-			pand	mm4, mm3		;mask_r2
-			pand	mm2, mm5		;mask_l2
-
-			pxor	mm3, mm4		;mask_r1
-			pxor	mm5, mm2		;mask_l1
-
-			pand	mm0, [ecx+058h]
-			pand	mm5, [ecx+068h]
-			pand	mm2, [ecx+078h]
-			pand	mm3, [ecx+088h]
-			pand	mm4, [ecx+098h]
-			por		mm0, mm5
-			por		mm2, mm3
-			por		mm0, mm4
-			por		mm0, mm2
-			movq	[edx+8], mm0
-
-			add		ecx, 0a0h
-			add		edx, 16
-
-			dec		eax
-			jnz		xloop
-
-			emms
-			ret		12
-		}
-	}
+	void blend_row_scalar(uint8 *dst, const uint8 *src, uint32 w, ptrdiff_t srcpitch) {
+		const uint8 *src2 = src + srcpitch;
+		const uint8 *src3 = src2 + srcpitch;
 
-	void __declspec(naked) __stdcall nela_L8_MMX(void *dst, const void *elabuf, int w16) {
-		static const __declspec(align(8)) uint64 x7fb = 0x7f7f7f7f7f7f7f7f;
-
-		__asm {
-			mov		edx, [esp+4]
-			mov		ecx, [esp+8]
-			mov		eax, [esp+12]
-xloop:
-			movq	mm0, [ecx+000h]
-			movq	mm5, [ecx+002h]
-			movq	mm6, mm0
-			pxor	mm0, mm5
-			por		mm6, mm5
-			movq	mm7, [ecx+001h]
-			psrlq	mm0, 1
-			pand	mm0, x7fb
-			psubb	mm6, mm0
-			movq	mm0, mm6
-			pxor	mm6, mm7
-			por		mm0, mm7
-			psrlq	mm6, 1
-			pand	mm6, x7fb
-			psubb	mm0, mm6
-
-			movq	mm1, [ecx+010h]
-			movq	mm5, [ecx+012h]
-			movq	mm6, mm1
-			pxor	mm1, mm5
-			por		mm6, mm5
-			movq	mm7, [ecx+011h]
-			psrlq	mm1, 1
-			pand	mm1, x7fb
-			psubb	mm6, mm1
-			movq	mm1, mm6
-			pxor	mm6, mm7
-			por		mm1, mm7
-			psrlq	mm6, 1
-			pand	mm6, x7fb
-			psubb	mm1, mm6
-
-			movq	mm2, [ecx+020h]
-			movq	mm5, [ecx+022h]
-			movq	mm6, mm2
-			pxor	mm2, mm5
-			por		mm6, mm5
-			movq	mm7, [ecx+021h]
-			psrlq	mm2, 1
-			pand	mm2, x7fb
-			psubb	mm6, mm2
-			movq	mm2, mm6
-			pxor	mm6, mm7
-			por		mm2, mm7
-			psrlq	mm6, 1
-			pand	mm6, x7fb
-			psubb	mm2, mm6
-
-			movq	mm3, [ecx+030h]
-			movq	mm5, [ecx+032h]
-			movq	mm6, mm3
-			pxor	mm3, mm5
-			por		mm6, mm5
-			movq	mm7, [ecx+031h]
-			psrlq	mm3, 1
-			pand	mm3, x7fb
-			psubb	mm6, mm3
-			movq	mm3, mm6
-			pxor	mm6, mm7
-			por		mm3, mm7
-			psrlq	mm6, 1
-			pand	mm6, x7fb
-			psubb	mm3, mm6
-
-			movq	mm4, [ecx+040h]
-			movq	mm5, [ecx+042h]
-			movq	mm6, mm4
-			pxor	mm4, mm5
-			por		mm6, mm5
-			movq	mm7, [ecx+041h]
-			psrlq	mm4, 1
-			pand	mm4, x7fb
-			psubb	mm6, mm4
-			movq	mm4, mm6
-			pxor	mm6, mm7
-			por		mm4, mm7
-			psrlq	mm6, 1
-			pand	mm6, x7fb
-			psubb	mm4, mm6
-
-
-			movq	mm5, x7fb
-			pxor	mm0, mm5
-			pxor	mm1, mm5
-			pxor	mm2, mm5
-			pxor	mm3, mm5
-			pxor	mm4, mm5
-
-			;mm0 = scorec0
-			;mm1 = scorel1
-			;mm2 = scorel2
-			;mm3 = scorer1
-			;mm4 = scorer2
-
-			movq	mm5, mm3
-			pcmpgtb	mm5, mm1		;(scorer1 > scorel1) == (scorel1 < scorer1)
-
-			pcmpgtb	mm4, mm3		;scorer2 > scorer1
-			pcmpgtb	mm2, mm1		;scorel2 > scorel1
-
-			pcmpgtb	mm1, mm0		;scorel1 > scorec0
-			pcmpgtb	mm3, mm0		;scorer1 > scorec0
-
-			movq	mm6, mm1
-			pcmpeqb	mm0, mm0
-			por		mm6, mm3		;scorel1 > scorec0 || scorer1 > scorec0
-			pxor	mm0, mm6		;mask_c0
-
-			pand	mm3, mm5		;scorer1 > scorec0 && scorer1 > scorel1
-			pandn	mm5, mm1		;scorel1 > scorec0 && scorel1 >= scorer1
-
-			pand	mm4, mm3		;mask_r2
-			pand	mm2, mm5		;mask_l2
-
-			pxor	mm3, mm4		;mask_r1
-			pxor	mm5, mm2		;mask_l1
-
-			pand	mm0, [ecx+050h]
-			pand	mm5, [ecx+060h]
-			pand	mm2, [ecx+070h]
-			pand	mm3, [ecx+080h]
-			pand	mm4, [ecx+090h]
-			por		mm0, mm5
-			por		mm2, mm3
-			por		mm0, mm4
-			por		mm0, mm2
-
-			movq	[edx], mm0
-
-			movq	mm0, [ecx+008h]		;mm0 = x0
-			movq	mm5, [ecx+0a0h]		;mm5 = x1
-			psrlq	mm0, 16				;mm0 = (x0 >> 16)
-			movq	mm7, [ecx+008h]		;mm7 = y0 = x0
-			psllq	mm5, 48				;mm5 = (x1 << 48)
-			movq	mm6, mm7			;mm6 = y0 = x0
-			por		mm0, mm5			;mm0 = y2 = (x0 >> 16) | (x1 << 48)
-			pxor	mm6, mm0			;mm6 = y0 ^ y2
-			por		mm7, mm0			;mm7 = y0 | y2
-			movq	mm5, [ecx+008h]		;mm5 = x0
-			psrlq	mm6, 1				;mm6 = (y0 ^ y2) >> 1
-			movq	mm0, [ecx+0a0h]		;mm0 = x1
-			psrlq	mm5, 8				;mm5 = x0 >> 8
-			pand	mm6, x7fb			;mm6 = ((y0 ^ y2) >> 1) & 0x7f7f7f7f7f7f7f7f
-			psllq	mm0, 56				;mm0 = x1 << 56
-			psubb	mm7, mm6			;mm7 = t = (y0 | y2) - (((y0 ^ y2) >> 1) & 0x7f7f7f7f7f7f7f7f) = avgb(y0, y2)
-			por		mm0, mm5			;mm0 = y1 = (x0 >> 8) | (x1 << 56)
-			movq	mm6, mm7			;mm6 = t
-			pxor	mm7, mm0			;mm7 = t ^ y1
-			por		mm0, mm6			;mm0 = t | y1
-			psrlq	mm7, 1				;mm7 = (t ^ y1) >> 1
-			pand	mm7, x7fb			;mm7 = ((t ^ y1) >> 1) & 0x7f7f7f7f7f7f7f7f
-			psubb	mm0, mm7			;mm0 = (t | y1) - (((t ^ y1) >> 1) & 0x7f7f7f7f7f7f7f7f) = avgb(y1, avgb(y0, y2))
-
-			movq	mm1, [ecx+018h]
-			movq	mm5, [ecx+0b0h]
-			psrlq	mm1, 16
-			movq	mm7, [ecx+018h]
-			psllq	mm5, 48
-			movq	mm6, mm7
-			por		mm1, mm5
-			pxor	mm6, mm1
-			por		mm7, mm1
-			movq	mm5, [ecx+018h]
-			psrlq	mm6, 1
-			movq	mm1, [ecx+0b0h]
-			psrlq	mm5, 8
-			pand	mm6, x7fb
-			psllq	mm1, 56
-			psubb	mm7, mm6
-			por		mm1, mm5
-			movq	mm6, mm7
-			pxor	mm7, mm1
-			por		mm1, mm6
-			psrlq	mm7, 1
-			pand	mm7, x7fb
-			psubb	mm1, mm7
-
-			movq	mm2, [ecx+028h]
-			movq	mm5, [ecx+0c0h]
-			psrlq	mm2, 16
-			movq	mm7, [ecx+028h]
-			psllq	mm5, 48
-			movq	mm6, mm7
-			por		mm2, mm5
-			pxor	mm6, mm2
-			por		mm7, mm2
-			movq	mm5, [ecx+028h]
-			psrlq	mm6, 1
-			movq	mm2, [ecx+0c0h]
-			psrlq	mm5, 8
-			pand	mm6, x7fb
-			psllq	mm2, 56
-			psubb	mm7, mm6
-			por		mm2, mm5
-			movq	mm6, mm7
-			pxor	mm7, mm2
-			por		mm2, mm6
-			psrlq	mm7, 1
-			pand	mm7, x7fb
-			psubb	mm2, mm7
-
-			movq	mm3, [ecx+038h]
-			movq	mm5, [ecx+0d0h]
-			psrlq	mm3, 16
-			movq	mm7, [ecx+038h]
-			psllq	mm5, 48
-			movq	mm6, mm7
-			por		mm3, mm5
-			pxor	mm6, mm3
-			por		mm7, mm3
-			movq	mm5, [ecx+038h]
-			psrlq	mm6, 1
-			movq	mm3, [ecx+0d0h]
-			psrlq	mm5, 8
-			pand	mm6, x7fb
-			psllq	mm3, 56
-			psubb	mm7, mm6
-			por		mm3, mm5
-			movq	mm6, mm7
-			pxor	mm7, mm3
-			por		mm3, mm6
-			psrlq	mm7, 1
-			pand	mm7, x7fb
-			psubb	mm3, mm7
-
-			movq	mm4, [ecx+048h]
-			movq	mm5, [ecx+0e0h]
-			psrlq	mm4, 16
-			movq	mm7, [ecx+048h]
-			psllq	mm5, 48
-			movq	mm6, mm7
-			por		mm4, mm5
-			pxor	mm6, mm4
-			por		mm7, mm4
-			movq	mm5, [ecx+048h]
-			psrlq	mm6, 1
-			movq	mm4, [ecx+0e0h]
-			psrlq	mm5, 8
-			pand	mm6, x7fb
-			psllq	mm4, 56
-			psubb	mm7, mm6
-			por		mm4, mm5
-			movq	mm6, mm7
-			pxor	mm7, mm4
-			por		mm4, mm6
-			psrlq	mm7, 1
-			pand	mm7, x7fb
-			psubb	mm4, mm7
-
-			movq	mm5, x7fb
-			pxor	mm0, mm5
-			pxor	mm1, mm5
-			pxor	mm2, mm5
-			pxor	mm3, mm5
-			pxor	mm4, mm5
-
-			;mm0 = scorec0
-			;mm1 = scorel1
-			;mm2 = scorel2
-			;mm3 = scorer1
-			;mm4 = scorer2
-
-			movq	mm5, mm3
-			pcmpgtb	mm5, mm1		;(scorer1 > scorel1) == (scorel1 < scorer1)
-
-			pcmpgtb	mm4, mm3		;scorer2 > scorer1
-			pcmpgtb	mm2, mm1		;scorel2 > scorel1
-
-			pcmpgtb	mm1, mm0		;scorel1 > scorec0
-			pcmpgtb	mm3, mm0		;scorer1 > scorec0
-
-			movq	mm6, mm1
-			pcmpeqb	mm0, mm0
-			por		mm6, mm3		;scorel1 > scorec0 || scorer1 > scorec0
-			pxor	mm0, mm6		;mask_c0
-
-			pand	mm3, mm5		;scorer1 > scorec0 && scorer1 > scorel1
-			pandn	mm5, mm1		;scorel1 > scorec0 && scorel1 >= scorer1
-
-			pand	mm4, mm3		;mask_r2
-			pand	mm2, mm5		;mask_l2
-
-			pxor	mm3, mm4		;mask_r1
-			pxor	mm5, mm2		;mask_l1
-
-			pand	mm0, [ecx+058h]
-			pand	mm5, [ecx+068h]
-			pand	mm2, [ecx+078h]
-			pand	mm3, [ecx+088h]
-			pand	mm4, [ecx+098h]
-			por		mm0, mm5
-			por		mm2, mm3
-			por		mm0, mm4
-			por		mm0, mm2
-			movq	[edx+8], mm0
-
-			add		ecx, 0a0h
-			add		edx, 16
-
-			dec		eax
-			jnz		xloop
-
-			emms
-			ret		12
-		}
+		for(uint32 x=0; x<w; ++x)
+			dst[x] = blend_u8(src[x], src2[x], src3[x]);
 	}
-#endif
 
-namespace {
-	void ela_L8_scalar(uint8 *dst, const uint8 *srcat, const uint8 *srcab, int w16) {
-		int w = w16 << 4;
+	// Edge directed interpolation between two rows of the same field. Both rows
+	// must be padded with replicated edge pixels, at least 3 to the left and
+	// 35 to the right.
+	//
+	// For the slopes s = 0, 1, 2, -1, -2 the raw score at position i is
+	// |T[i-s] - B[i+s]|, smoothed as avg(avg(raw[x-1], raw[x+1]), raw[x]).
+	// The prediction of the best scoring direction is avg(T[x-s], B[x+s]).
 
-		srcat += 16;
-		srcab += 16;
-		do {
-			int topl2 = srcat[-3];
-			int topl1 = srcat[-2];
-			int topc0 = srcat[-1];
-			int topr1 = srcat[0];
-			int topr2 = srcat[1];
-			int topr3 = srcat[2];
-
-			int botl2 = srcab[-3];
-			int botl1 = srcab[-2];
-			int botc0 = srcab[-1];
-			int botr1 = srcab[0];
-			int botr2 = srcab[1];
-			int botr3 = srcab[2];
-			++srcat;
-			++srcab;
-
-			int rawscorec0 = abs(topc0 - botc0);
-			int rawscorel1 = abs(topl1 - botr1);
-			int rawscorel2 = abs(topl2 - botr2);
-			int rawscorer1 = abs(topr1 - botl1);
-			int rawscorer2 = abs(topr2 - botl2);
-
-			dst[0] = (uint8)rawscorec0;
-			dst[1] = (uint8)rawscorel1;
-			dst[2] = (uint8)rawscorel2;
-			dst[3] = (uint8)rawscorer1;
-			dst[4] = (uint8)rawscorer2;
-			dst[5] = (uint8)((topr1 + botr1 + 1) >> 1);
-			dst[6] = (uint8)((topc0 + botr2 + 1) >> 1);
-			dst[7] = (uint8)((topl1 + botr3 + 1) >> 1);
-			dst[8] = (uint8)((topr2 + botc0 + 1) >> 1);
-			dst[9] = (uint8)((topr3 + botl1 + 1) >> 1);
-			dst += 10;
-		} while(--w);
+	inline uint8 ela_score(const uint8 *T, const uint8 *B, int x, int s) {
+		return avg_u8(avg_u8(absdiff(T[x-1-s], B[x-1+s]), absdiff(T[x+1-s], B[x+1+s])), absdiff(T[x-s], B[x+s]));
 	}
 
-	void nela_L8_scalar(uint8 *dst, const uint8 *elabuf, int w16) {
-		int w = w16 << 4;
-
-		do {
-			int scorec0 = elabuf[10]*2 + (elabuf[0] + elabuf[20]);
-			int result = elabuf[5];
-
-			int scorel1 = elabuf[11]*2 + (elabuf[1] + elabuf[21]);
-			if (scorel1 < scorec0) {
-				result = elabuf[6];
-				scorec0 = scorel1;
-
-				int scorel2 = elabuf[12]*2 + (elabuf[2] + elabuf[22]);
-				if (scorel2 < scorec0) {
-					result = elabuf[7];
-					scorec0 = scorel2;
-				}
-			}
-
-			int scorer1 = elabuf[13]*2 + (elabuf[3] + elabuf[23]);
-			if (scorer1 < scorec0) {
-				result = elabuf[8];
-				scorec0 = scorer1;
-
-				int scorer2 = elabuf[14]*2 + (elabuf[4] + elabuf[24]);
-				if (scorer2 < scorec0)
-					result = elabuf[9];
+	void ela_row_L8_scalar(uint8 *dst, const uint8 *T, const uint8 *B, int x, int w) {
+		for(; x<w; ++x) {
+			int sc0 = ela_score(T, B, x, 0);
+			int sl1 = ela_score(T, B, x, 1);
+			int sl2 = ela_score(T, B, x, 2);
+			int sr1 = ela_score(T, B, x, -1);
+			int sr2 = ela_score(T, B, x, -2);
+
+			int s = 0;
+			if (sl1 < sc0 || sr1 < sc0) {
+				if (sl1 < sr1)
+					s = (sl2 < sl1) ? 2 : 1;
+				else
+					s = (sr2 < sr1) ? -2 : -1;
 			}
 
-			elabuf += 10;
-
-			*dst++ = (uint8)result;
-		} while(--w);
-	}
-
-	void BlendScanLine_NELA_scalar(void *dst, const void *srcT, const void *srcB, uint32 w, uint8 *tempBuf) {
-		const uint8 *srcat = (const uint8 *)srcT;
-		const uint8 *srcab = (const uint8 *)srcB;
-		uint32 w16 = (w + 15) >> 4;
-		uint32 wr = w16 << 4;
-
-		uint8 *elabuf = tempBuf;
-		uint8 *topbuf = elabuf + 10*wr;
-		uint8 *botbuf = topbuf + wr + 32;
-
-		uint32 woffset = w & 15;
-		topbuf[13] = topbuf[14] = topbuf[15] = srcat[0];
-		botbuf[13] = botbuf[14] = botbuf[15] = srcab[0];
-
-		for(uint32 x=0; x<wr; ++x) {
-			topbuf[x+16] = srcat[x];
-			botbuf[x+16] = srcab[x];
+			dst[x] = avg_u8(T[x-s], B[x+s]);
 		}
-
-		if (woffset) {
-			uint8 *topfinal = &topbuf[w+16];
-			uint8 *botfinal = &botbuf[w+16];
-			const uint8 tv = topfinal[-1];
-			const uint8 bv = botfinal[-1];
-
-			for(uint32 i = woffset; i < 16; ++i) {
-				*topfinal++ = tv;
-				*botfinal++ = bv;
-			}
-		}
-
-		topbuf[wr+16] = topbuf[wr+17] = topbuf[wr+18] = topbuf[wr+15];
-		topbuf[wr+16] = topbuf[wr+17] = botbuf[wr+18] = botbuf[wr+15];
-
-		ela_L8_scalar(elabuf, topbuf, botbuf, w16);
-		nela_L8_scalar((uint8 *)dst, elabuf, w16);
 	}
 
 	void ela_X8R8G8B8_scalar(uint32 *dst, const uint8 *srcat, const uint8 *srcab, int w4) {
@@ -1373,108 +112,6 @@ namespace {
 		} while(--w4);
 	}
 
-#if defined(VD_CPU_X86)
-	void __declspec(naked) __cdecl ela_X8R8G8B8_MMX(uint32 *dst, const uint8 *srcat, const uint8 *srcab, int w4) {
-		static const __declspec(align(16)) uint64 kCoeff = 0x00003600b70013ull;
-
-		__asm {
-			push		ebp
-				push		edi
-				push		esi
-				push		ebx
-
-				mov			ebx, [esp+4+16]
-			mov			ecx, [esp+8+16]
-			mov			edx, [esp+12+16]
-			add			ecx, 4
-				add			edx, 4
-				mov			esi, [esp+16+16]
-			movq		mm6, qword ptr [kCoeff]
-			pxor		mm7, mm7
-
-				align	16
-xloop:
-			movd		mm0, [ecx]
-			movd		mm2, [edx + 16]
-			movq		mm1, mm0
-				psubusb		mm0, mm2
-				psubusb		mm2, mm1
-				por			mm0, mm2
-				punpcklbw	mm0, mm7
-				pmaddwd		mm0, mm6
-				movq		mm1, mm0
-				psrlq		mm0, 32
-				paddd		mm0, mm1
-				movd		[ebx], mm0
-
-				movd		mm0, [ecx + 4]
-			movd		mm2, [edx + 12]
-			movq		mm1, mm0
-				psubusb		mm0, mm2
-				psubusb		mm2, mm1
-				por			mm0, mm2
-				punpcklbw	mm0, mm7
-				pmaddwd		mm0, mm6
-				movq		mm1, mm0
-				psrlq		mm0, 32
-				paddd		mm0, mm1
-				movd		[ebx + 4], mm0
-
-				movd		mm0, [ecx + 8]
-			movd		mm2, [edx + 8]
-			movq		mm1, mm0
-				psubusb		mm0, mm2
-				psubusb		mm2, mm1
-				por			mm0, mm2
-				punpcklbw	mm0, mm7
-				pmaddwd		mm0, mm6
-				movq		mm1, mm0
-				psrlq		mm0, 32
-				paddd		mm0, mm1
-				movd		[ebx + 8], mm0
-
-				movd		mm0, [ecx + 12]
-			movd		mm2, [edx + 4]
-			movq		mm1, mm0
-				psubusb		mm0, mm2
-				psubusb		mm2, mm1
-				por			mm0, mm2
-				punpcklbw	mm0, mm7
-				pmaddwd		mm0, mm6
-				movq		mm1, mm0
-				psrlq		mm0, 32
-				paddd		mm0, mm1
-				movd		[ebx + 12], mm0
-
-				movd		mm0, [ecx + 16]
-			movd		mm2, [edx]
-			movq		mm1, mm0
-				psubusb		mm0, mm2
-				psubusb		mm2, mm1
-				por			mm0, mm2
-				punpcklbw	mm0, mm7
-				pmaddwd		mm0, mm6
-				movq		mm1, mm0
-				psrlq		mm0, 32
-				paddd		mm0, mm1
-				movd		[ebx + 16], mm0
-
-				add			ebx, 20
-				add			ecx, 4
-				add			edx, 4
-				dec			esi
-				jne			xloop
-
-				emms
-				pop			ebx
-				pop			esi
-				pop			edi
-				pop			ebp
-				ret
-		}
-	}
-#endif
-
 	void nela_X8R8G8B8_scalar(uint32 *dst, const uint32 *elabuf, const uint8 *srca, const uint8 *srcb, int w4) {
 		do {
 			int scorec0 = elabuf[7]*2 + (elabuf[2] + elabuf[12]);
@@ -1512,432 +149,517 @@ xloop:
 		} while(--w4);
 	}
 
-	void BlendScanLine_NELA_X8R8G8B8_scalar(void *dst, const void *srcT, const void *srcB, uint32 w, void *tempBuf) {
-		const uint32 *srcat = (const uint32 *)srcT;
-		const uint32 *srcab = (const uint32 *)srcB;
-		uint32 w4 = (w + 3) >> 2;
-		uint32 *elabuf = (uint32 *)tempBuf;
-		uint32 *topbuf = elabuf + 5*w4;
-		uint32 *botbuf = topbuf + w4 + 8;
+	// Motion adaptive interpolation, after YADIF by Michael Niedermayer.
+	// Only the previous frame is used as temporal reference, so the field
+	// being interpolated is predicted from the other field of the previous
+	// and the current frame.
+
+	struct yadif_rows {
+		const uint8 *cm2, *cm1, *c0, *cp1, *cp2;	// current frame, rows y-2 .. y+2
+		const uint8 *pm2, *pm1, *p0, *pp1, *pp2;	// previous frame, rows y-2 .. y+2
+	};
 
-		topbuf[0] = topbuf[1] = topbuf[2] = topbuf[3] = srcat[0];
-		botbuf[0] = botbuf[1] = botbuf[2] = botbuf[3] = srcab[0];
+	inline int px(const uint8 *row, int x, int w) {
+		return row[x < 0 ? 0 : x >= w ? w - 1 : x];
+	}
 
-		for(uint32 x=0; x<w4; ++x) {
-			topbuf[x+4] = srcat[x];
-			botbuf[x+4] = srcab[x];
+	void yadif_row_scalar(uint8 *dst, const yadif_rows& r, int x, int xend, int w) {
+		for(; x<xend; ++x) {
+			int c = r.cm1[x];
+			int e = r.cp1[x];
+			int d = (r.p0[x] + r.c0[x]) >> 1;
+			int temporal_diff0 = absdiff(r.p0[x], r.c0[x]);
+			int temporal_diff1 = (absdiff(r.pm1[x], c) + absdiff(r.pp1[x], e)) >> 1;
+			int diff = max(temporal_diff0 >> 1, temporal_diff1);
+
+			int spatial_pred = (c + e) >> 1;
+			int spatial_score = absdiff(px(r.cm1, x-1, w), px(r.cp1, x-1, w)) + absdiff(c, e)
+							  + absdiff(px(r.cm1, x+1, w), px(r.cp1, x+1, w)) - 1;
+
+#define YADIF_CHECK(j) \
+			{	int score = absdiff(px(r.cm1, x-1+(j), w), px(r.cp1, x-1-(j), w)) \
+						  + absdiff(px(r.cm1, x+(j), w), px(r.cp1, x-(j), w)) \
+						  + absdiff(px(r.cm1, x+1+(j), w), px(r.cp1, x+1-(j), w)); \
+				if (score < spatial_score) { \
+					spatial_score = score; \
+					spatial_pred = (px(r.cm1, x+(j), w) + px(r.cp1, x-(j), w)) >> 1;
+
+			YADIF_CHECK(-1) YADIF_CHECK(-2) }} }}
+			YADIF_CHECK(1) YADIF_CHECK(2) }} }}
+
+#undef YADIF_CHECK
+
+			int b = (r.pm2[x] + r.cm2[x]) >> 1;
+			int f = (r.pp2[x] + r.cp2[x]) >> 1;
+			int dmax = max(max(d - e, d - c), min(b - c, f - e));
+			int dmin = min(min(d - e, d - c), max(b - c, f - e));
+			diff = max(max(diff, dmin), -dmax);
+
+			if (spatial_pred > d + diff)
+				spatial_pred = d + diff;
+			else if (spatial_pred < d - diff)
+				spatial_pred = d - diff;
+
+			dst[x] = (uint8)spatial_pred;
 		}
+	}
+}
 
-		topbuf[w4+4] = topbuf[w4+5] = topbuf[w4+6] = topbuf[w4+7] = topbuf[w4+3];
-		botbuf[w4+4] = botbuf[w4+5] = botbuf[w4+6] = botbuf[w4+7] = botbuf[w4+3];
+///////////////////////////////////////////////////////////////////////////
+// SSE2
 
-		ela_X8R8G8B8_scalar(elabuf, (const uint8 *)topbuf, (const uint8 *)botbuf, w4);
-		nela_X8R8G8B8_scalar((uint32 *)dst, elabuf, (const uint8 *)(topbuf + 4), (const uint8 *)(botbuf + 4), w4);
+#if defined(VD_CPU_X86) || defined(VD_CPU_AMD64)
+namespace {
+	inline __m128i absdiff_epu8(__m128i a, __m128i b) {
+		return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
 	}
 
-#if defined(VD_CPU_X86)
-	void BlendScanLine_NELA_X8R8G8B8_MMX(void *dst, const void *srcT, const void *srcB, uint32 w, void *tempBuf) {
-		const uint32 *srcat = (const uint32 *)srcT;
-		const uint32 *srcab = (const uint32 *)srcB;
-		uint32 w4 = (w + 3) >> 2;
-		uint32 *elabuf = (uint32 *)tempBuf;
-		uint32 *topbuf = elabuf + 5*w4;
-		uint32 *botbuf = topbuf + w4 + 8;
+	inline __m128i cmplt_epu8(__m128i a, __m128i b) {
+		const __m128i x80b = _mm_set1_epi8((char)0x80);
+		return _mm_cmplt_epi8(_mm_xor_si128(a, x80b), _mm_xor_si128(b, x80b));
+	}
 
-		topbuf[0] = topbuf[1] = topbuf[2] = topbuf[3] = srcat[0];
-		botbuf[0] = botbuf[1] = botbuf[2] = botbuf[3] = srcab[0];
+	inline __m128i select_si128(__m128i mask, __m128i a, __m128i b) {
+		return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+	}
+
+	void avg_row_SSE2(uint8 *dst, const uint8 *src1, const uint8 *src2, uint32 w) {
+		uint32 x = 0;
+		for(; x+16<=w; x+=16)
+			_mm_storeu_si128((__m128i *)(dst+x), _mm_avg_epu8(_mm_loadu_si128((const __m128i *)(src1+x)), _mm_loadu_si128((const __m128i *)(src2+x))));
 
-		for(uint32 x=0; x<w4; ++x) {
-			topbuf[x+4] = srcat[x];
-			botbuf[x+4] = srcab[x];
+		avg_row_scalar(dst+x, src1+x, src2+x, w-x);
+	}
+
+	void blend_row_SSE2(uint8 *dst, const uint8 *src, uint32 w, ptrdiff_t srcpitch) {
+		const __m128i inv = _mm_set1_epi8(-1);
+		const uint8 *src2 = src + srcpitch;
+		const uint8 *src3 = src2 + srcpitch;
+
+		uint32 x = 0;
+		for(; x+16<=w; x+=16) {
+			__m128i a = _mm_loadu_si128((const __m128i *)(src+x));
+			__m128i b = _mm_loadu_si128((const __m128i *)(src2+x));
+			__m128i c = _mm_loadu_si128((const __m128i *)(src3+x));
+
+			_mm_storeu_si128((__m128i *)(dst+x), _mm_avg_epu8(_mm_xor_si128(_mm_avg_epu8(_mm_xor_si128(a, inv), _mm_xor_si128(c, inv)), inv), b));
 		}
 
-		topbuf[w4+4] = topbuf[w4+5] = topbuf[w4+6] = topbuf[w4+7] = topbuf[w4+3];
-		botbuf[w4+4] = botbuf[w4+5] = botbuf[w4+6] = botbuf[w4+7] = botbuf[w4+3];
+		blend_row_scalar(dst+x, src+x, w-x, srcpitch);
+	}
+
+	inline __m128i ela_score_SSE2(const uint8 *T, const uint8 *B, int s) {
+		__m128i rm = absdiff_epu8(_mm_loadu_si128((const __m128i *)(T-1-s)), _mm_loadu_si128((const __m128i *)(B-1+s)));
+		__m128i r0 = absdiff_epu8(_mm_loadu_si128((const __m128i *)(T-s)), _mm_loadu_si128((const __m128i *)(B+s)));
+		__m128i rp = absdiff_epu8(_mm_loadu_si128((const __m128i *)(T+1-s)), _mm_loadu_si128((const __m128i *)(B+1+s)));
 
-		ela_X8R8G8B8_MMX(elabuf, (const uint8 *)topbuf, (const uint8 *)botbuf, w4);
-		nela_X8R8G8B8_scalar((uint32 *)dst, elabuf, (const uint8 *)(topbuf + 4), (const uint8 *)(botbuf + 4), w4);
+		return _mm_avg_epu8(_mm_avg_epu8(rm, rp), r0);
 	}
 
-	void BlendScanLine_NELA_MMX_ISSE(void *dst, const void *srcT, const void *srcB, uint32 w, void *tempBuf) {
-		const uint32 *srcat = (const uint32 *)srcT;
-		const uint32 *srcab = (const uint32 *)srcB;
-		uint32 w16 = (w + 15) >> 4;
-		uint32 w4 = w16 * 4;
-		uint32 *elabuf = (uint32 *)tempBuf;
-		uint32 *topbuf = elabuf + 40*w16;
-		uint32 *botbuf = topbuf + w4 + 8;
+	inline __m128i ela_pred_SSE2(const uint8 *T, const uint8 *B, int s) {
+		return _mm_avg_epu8(_mm_loadu_si128((const __m128i *)(T-s)), _mm_loadu_si128((const __m128i *)(B+s)));
+	}
 
-		uint32 woffset = w & 15;
-		topbuf[0] = topbuf[1] = topbuf[2] = topbuf[3] = (srcat[0] & 0xff) * 0x01010101;
-		botbuf[0] = botbuf[1] = botbuf[2] = botbuf[3] = (srcab[0] & 0xff) * 0x01010101;
+	void ela_row_L8_SSE2(uint8 *dst, const uint8 *T, const uint8 *B, uint32 w) {
+		uint32 x = 0;
+		for(; x+16<=w; x+=16) {
+			__m128i sc0 = ela_score_SSE2(T+x, B+x, 0);
+			__m128i sl1 = ela_score_SSE2(T+x, B+x, 1);
+			__m128i sl2 = ela_score_SSE2(T+x, B+x, 2);
+			__m128i sr1 = ela_score_SSE2(T+x, B+x, -1);
+			__m128i sr2 = ela_score_SSE2(T+x, B+x, -2);
 
-		for(uint32 x=0; x<w4; ++x) {
-			topbuf[x+4] = srcat[x];
-			botbuf[x+4] = srcab[x];
-		}
+			__m128i lt_l1_c0 = cmplt_epu8(sl1, sc0);
+			__m128i lt_r1_c0 = cmplt_epu8(sr1, sc0);
+			__m128i lt_l1_r1 = cmplt_epu8(sl1, sr1);
 
-		if (woffset) {
-			uint8 *topfinal = (uint8 *)&topbuf[w4] + woffset;
-			uint8 *botfinal = (uint8 *)&botbuf[w4] + woffset;
-			const uint8 tv = topfinal[-1];
-			const uint8 bv = botfinal[-1];
+			__m128i is_dir = _mm_or_si128(lt_l1_c0, lt_r1_c0);
+			__m128i is_l = _mm_and_si128(is_dir, lt_l1_r1);
+			__m128i is_r = _mm_andnot_si128(lt_l1_r1, is_dir);
 
-			for(uint32 i = woffset; i < 16; ++i) {
-				*topfinal++ = tv;
-				*botfinal++ = bv;
-			}
+			__m128i pred_l = select_si128(cmplt_epu8(sl2, sl1), ela_pred_SSE2(T+x, B+x, 2), ela_pred_SSE2(T+x, B+x, 1));
+			__m128i pred_r = select_si128(cmplt_epu8(sr2, sr1), ela_pred_SSE2(T+x, B+x, -2), ela_pred_SSE2(T+x, B+x, -1));
+			__m128i pred = select_si128(is_l, pred_l, select_si128(is_r, pred_r, ela_pred_SSE2(T+x, B+x, 0)));
+
+			_mm_storeu_si128((__m128i *)(dst+x), pred);
 		}
 
-		topbuf[w4+4] = topbuf[w4+5] = topbuf[w4+6] = topbuf[w4+7] = topbuf[w4+3];
-		botbuf[w4+4] = topbuf[w4+5] = topbuf[w4+6] = topbuf[w4+7] = botbuf[w4+3];
+		ela_row_L8_scalar(dst, T, B, x, w);
+	}
 
-		if (ISSE_enabled) {
-			ela_L8_ISSE(elabuf, topbuf, botbuf, w16);
-			nela_L8_ISSE(dst, elabuf, w16);
-		} else {
-			ela_L8_MMX(elabuf, topbuf, botbuf, w16);
-			nela_L8_MMX(dst, elabuf, w16);
-		}
+	void ela_X8R8G8B8_SSE2(uint32 *dst, const uint8 *srcat, const uint8 *srcab, int w4) {
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i coeff = _mm_set_epi16(0, 54, 183, 19, 0, 54, 183, 19);
+
+		// same pixel pairs as the scalar version: top[p-3+i] against bottom[p+2-i]
+		const uint8 *src1 = srcat + 4;
+		const uint8 *src2 = srcab + 4;
+		do {
+			__m128i top = _mm_loadu_si128((const __m128i *)src1);
+			__m128i bot = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(src2 + 4)), _MM_SHUFFLE(0, 1, 2, 3));
+			__m128i diff = absdiff_epu8(top, bot);
+
+			__m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(diff, zero), coeff);
+			__m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(diff, zero), coeff);
+			__m128i even = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0)));
+			__m128i odd = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1)));
+			_mm_storeu_si128((__m128i *)dst, _mm_add_epi32(even, odd));
+
+			int er = abs((int)src1[18] - (int)src2[2]);
+			int eg = abs((int)src1[17] - (int)src2[1]);
+			int eb = abs((int)src1[16] - (int)src2[0]);
+			dst[4] = er*54 + eg*183 + eb*19;
+
+			dst += 5;
+			src1 += 4;
+			src2 += 4;
+		} while(--w4);
 	}
-#endif
 
-	void BlendScanLine_NELA_SSE2(void *dst, const void *srcT, const void *srcB, uint32 w, __m128i *tempBuf) {
-		const __m128i *srcat = (const __m128i *)srcT;
-		const __m128i *srcab = (const __m128i *)srcB;
-		uint32 w16 = (w + 15) >> 4;
-		__m128i *elabuf = tempBuf;
-		__m128i *topbuf = elabuf + 10*w16;
-		__m128i *botbuf = topbuf + w16 + 2;
-
-		uint32 woffset = w & 15;
-		topbuf[0] = srcat[0];
-		botbuf[0] = srcab[0];
-
-		for(uint32 x=0; x<w16; ++x) {
-			topbuf[x+1] = srcat[x];
-			botbuf[x+1] = srcab[x];
-		}
+	inline __m128i load_epu8_epi16(const uint8 *p) {
+		return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)p), _mm_setzero_si128());
+	}
 
-		if (woffset) {
-			uint8 *topfinal = (uint8 *)&topbuf[w16] + woffset;
-			uint8 *botfinal = (uint8 *)&botbuf[w16] + woffset;
-			const uint8 tv = topfinal[-1];
-			const uint8 bv = botfinal[-1];
+	inline __m128i absdiff_epi16(__m128i a, __m128i b) {
+		return _mm_max_epi16(_mm_sub_epi16(a, b), _mm_sub_epi16(b, a));
+	}
 
-			for(uint32 i = woffset; i < 16; ++i) {
-				*topfinal++ = tv;
-				*botfinal++ = bv;
-			}
+	inline __m128i yadif_score_SSE2(const yadif_rows& r, int x, int j) {
+		return _mm_add_epi16(_mm_add_epi16(
+			absdiff_epi16(load_epu8_epi16(r.cm1+x-1+j), load_epu8_epi16(r.cp1+x-1-j)),
+			absdiff_epi16(load_epu8_epi16(r.cm1+x+j), load_epu8_epi16(r.cp1+x-j))),
+			absdiff_epi16(load_epu8_epi16(r.cm1+x+1+j), load_epu8_epi16(r.cp1+x+1-j)));
+	}
+
+	inline __m128i yadif_pred_SSE2(const yadif_rows& r, int x, int j) {
+		return _mm_srli_epi16(_mm_add_epi16(load_epu8_epi16(r.cm1+x+j), load_epu8_epi16(r.cp1+x-j)), 1);
+	}
+
+	// processes [x, xend) in steps of 8, reads 3 pixels on both sides of the range
+	// and xend - x must be a multiple of 8
+	void yadif_row_SSE2(uint8 *dst, const yadif_rows& r, int x, int xend) {
+		for(; x+8<=xend; x+=8) {
+			__m128i c = load_epu8_epi16(r.cm1+x);
+			__m128i e = load_epu8_epi16(r.cp1+x);
+			__m128i p0 = load_epu8_epi16(r.p0+x);
+			__m128i c0 = load_epu8_epi16(r.c0+x);
+
+			__m128i d = _mm_srli_epi16(_mm_add_epi16(p0, c0), 1);
+			__m128i temporal_diff0 = absdiff_epi16(p0, c0);
+			__m128i temporal_diff1 = _mm_srli_epi16(_mm_add_epi16(absdiff_epi16(load_epu8_epi16(r.pm1+x), c), absdiff_epi16(load_epu8_epi16(r.pp1+x), e)), 1);
+			__m128i diff = _mm_max_epi16(_mm_srli_epi16(temporal_diff0, 1), temporal_diff1);
+
+			__m128i spatial_pred = _mm_srli_epi16(_mm_add_epi16(c, e), 1);
+			__m128i spatial_score = _mm_sub_epi16(yadif_score_SSE2(r, x, 0), _mm_set1_epi16(1));
+
+			__m128i score, mask;
+
+			score = yadif_score_SSE2(r, x, -1);
+			mask = _mm_cmplt_epi16(score, spatial_score);
+			spatial_score = select_si128(mask, score, spatial_score);
+			spatial_pred = select_si128(mask, yadif_pred_SSE2(r, x, -1), spatial_pred);
+
+			score = yadif_score_SSE2(r, x, -2);
+			mask = _mm_and_si128(mask, _mm_cmplt_epi16(score, spatial_score));
+			spatial_score = select_si128(mask, score, spatial_score);
+			spatial_pred = select_si128(mask, yadif_pred_SSE2(r, x, -2), spatial_pred);
+
+			score = yadif_score_SSE2(r, x, 1);
+			mask = _mm_cmplt_epi16(score, spatial_score);
+			spatial_score = select_si128(mask, score, spatial_score);
+			spatial_pred = select_si128(mask, yadif_pred_SSE2(r, x, 1), spatial_pred);
+
+			score = yadif_score_SSE2(r, x, 2);
+			mask = _mm_and_si128(mask, _mm_cmplt_epi16(score, spatial_score));
+			spatial_pred = select_si128(mask, yadif_pred_SSE2(r, x, 2), spatial_pred);
+
+			__m128i b = _mm_srli_epi16(_mm_add_epi16(load_epu8_epi16(r.pm2+x), load_epu8_epi16(r.cm2+x)), 1);
+			__m128i f = _mm_srli_epi16(_mm_add_epi16(load_epu8_epi16(r.pp2+x), load_epu8_epi16(r.cp2+x)), 1);
+			__m128i de = _mm_sub_epi16(d, e);
+			__m128i dc = _mm_sub_epi16(d, c);
+			__m128i bc = _mm_sub_epi16(b, c);
+			__m128i fe = _mm_sub_epi16(f, e);
+			__m128i dmax = _mm_max_epi16(_mm_max_epi16(de, dc), _mm_min_epi16(bc, fe));
+			__m128i dmin = _mm_min_epi16(_mm_min_epi16(de, dc), _mm_max_epi16(bc, fe));
+			diff = _mm_max_epi16(_mm_max_epi16(diff, dmin), _mm_sub_epi16(_mm_setzero_si128(), dmax));
+
+			spatial_pred = _mm_min_epi16(_mm_max_epi16(spatial_pred, _mm_sub_epi16(d, diff)), _mm_add_epi16(d, diff));
+
+			_mm_storel_epi64((__m128i *)(dst+x), _mm_packus_epi16(spatial_pred, spatial_pred));
 		}
+	}
+}
+#endif
 
-		topbuf[w16+1] = topbuf[w16];
-		botbuf[w16+1] = botbuf[w16];
+///////////////////////////////////////////////////////////////////////////
+// AVX2
 
-		ela_L8_SSE2(elabuf, topbuf, botbuf, w16);
-		nela_L8_SSE2((__m128i *)dst, elabuf, w16);
+#if (defined(VD_CPU_X86) || defined(VD_CPU_AMD64)) && _MSC_VER >= 1700
+namespace {
+	inline __m256i absdiff_epu8_AVX2(__m256i a, __m256i b) {
+		return _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a));
 	}
 
-	void InterpPlane_NELA_X8R8G8B8(void *dst, ptrdiff_t dstpitch, const void *src, ptrdiff_t srcpitch, uint32 w, uint32 h, bool interpField2) {
-		uint32 w16 = (w + 15) >> 4;
-		vdfastvector<uint8, vdaligned_alloc<uint8> > tempbuf((12 * w16 + 4) * 16);
-		void *elabuf = tempbuf.data();
+	inline __m256i cmplt_epu8_AVX2(__m256i a, __m256i b) {
+		const __m256i x80b = _mm256_set1_epi8((char)0x80);
+		return _mm256_cmpgt_epi8(_mm256_xor_si256(b, x80b), _mm256_xor_si256(a, x80b));
+	}
 
-		if (!interpField2)
-			memcpy(dst, src, w16 << 4);
+	void avg_row_AVX2(uint8 *dst, const uint8 *src1, const uint8 *src2, uint32 w) {
+		uint32 x = 0;
+		for(; x+32<=w; x+=32)
+			_mm256_storeu_si256((__m256i *)(dst+x), _mm256_avg_epu8(_mm256_loadu_si256((const __m256i *)(src1+x)), _mm256_loadu_si256((const __m256i *)(src2+x))));
 
-		int y0 = interpField2 ? 1 : 2;
-		for(uint32 y = y0; y < h - 1; y += 2) {
-			const __m128i *srcat = (const __m128i *)((const char *)src + srcpitch * (y-1));
-			const __m128i *srcab = (const __m128i *)((const char *)src + srcpitch * (y+1));
+		_mm256_zeroupper();
+		avg_row_SSE2(dst+x, src1+x, src2+x, w-x);
+	}
 
-#if defined(VD_CPU_X86)
-			if (MMX_enabled)
-				BlendScanLine_NELA_X8R8G8B8_MMX((char *)dst + dstpitch*y, srcat, srcab, w, (uint8 *)elabuf);
-			else
-#endif
-				BlendScanLine_NELA_X8R8G8B8_scalar((char *)dst + dstpitch*y, srcat, srcab, w, (uint8 *)elabuf);
+	void blend_row_AVX2(uint8 *dst, const uint8 *src, uint32 w, ptrdiff_t srcpitch) {
+		const __m256i inv = _mm256_set1_epi8(-1);
+		const uint8 *src2 = src + srcpitch;
+		const uint8 *src3 = src2 + srcpitch;
+
+		uint32 x = 0;
+		for(; x+32<=w; x+=32) {
+			__m256i a = _mm256_loadu_si256((const __m256i *)(src+x));
+			__m256i b = _mm256_loadu_si256((const __m256i *)(src2+x));
+			__m256i c = _mm256_loadu_si256((const __m256i *)(src3+x));
+
+			_mm256_storeu_si256((__m256i *)(dst+x), _mm256_avg_epu8(_mm256_xor_si256(_mm256_avg_epu8(_mm256_xor_si256(a, inv), _mm256_xor_si256(c, inv)), inv), b));
 		}
 
-		if (interpField2)
-			memcpy((char *)dst + dstpitch*(h - 1), (const char *)src + srcpitch*(h - 1), w16 << 4);
+		_mm256_zeroupper();
+		blend_row_SSE2(dst+x, src+x, w-x, srcpitch);
 	}
 
-	void InterpPlane_NELA(void *dst, ptrdiff_t dstpitch, const void *src, ptrdiff_t srcpitch, uint32 w, uint32 h, bool interpField2) {
-		uint32 w16 = (w + 15) >> 4;
-		vdfastvector<uint8, vdaligned_alloc<uint8> > tempbuf((12 * w16 + 4) * 16);
-		void *elabuf = tempbuf.data();
+	inline __m256i ela_score_AVX2(const uint8 *T, const uint8 *B, int s) {
+		__m256i rm = absdiff_epu8_AVX2(_mm256_loadu_si256((const __m256i *)(T-1-s)), _mm256_loadu_si256((const __m256i *)(B-1+s)));
+		__m256i r0 = absdiff_epu8_AVX2(_mm256_loadu_si256((const __m256i *)(T-s)), _mm256_loadu_si256((const __m256i *)(B+s)));
+		__m256i rp = absdiff_epu8_AVX2(_mm256_loadu_si256((const __m256i *)(T+1-s)), _mm256_loadu_si256((const __m256i *)(B+1+s)));
 
-		if (!interpField2)
-			memcpy(dst, src, w16 << 4);
+		return _mm256_avg_epu8(_mm256_avg_epu8(rm, rp), r0);
+	}
 
-		int y0 = interpField2 ? 1 : 2;
-		if (SSE2_enabled) {
-			for(uint32 y = y0; y < h - 1; y += 2) {
-				const __m128i *srcat = (const __m128i *)((const char *)src + srcpitch * (y-1));
-				const __m128i *srcab = (const __m128i *)((const char *)src + srcpitch * (y+1));
+	inline __m256i ela_pred_AVX2(const uint8 *T, const uint8 *B, int s) {
+		return _mm256_avg_epu8(_mm256_loadu_si256((const __m256i *)(T-s)), _mm256_loadu_si256((const __m256i *)(B+s)));
+	}
 
-				BlendScanLine_NELA_SSE2((char *)dst + dstpitch*y, srcat, srcab, w, (__m128i *)elabuf);
-			}
-		}
-#if defined(VD_CPU_X86)
-		else if (MMX_enabled || ISSE_enabled) {
-			for(uint32 y = y0; y < h - 1; y += 2) {
-				const __m128i *srcat = (const __m128i *)((const char *)src + srcpitch * (y-1));
-				const __m128i *srcab = (const __m128i *)((const char *)src + srcpitch * (y+1));
+	void ela_row_L8_AVX2(uint8 *dst, const uint8 *T, const uint8 *B, uint32 w) {
+		uint32 x = 0;
+		for(; x+32<=w; x+=32) {
+			__m256i sc0 = ela_score_AVX2(T+x, B+x, 0);
+			__m256i sl1 = ela_score_AVX2(T+x, B+x, 1);
+			__m256i sl2 = ela_score_AVX2(T+x, B+x, 2);
+			__m256i sr1 = ela_score_AVX2(T+x, B+x, -1);
+			__m256i sr2 = ela_score_AVX2(T+x, B+x, -2);
 
-				BlendScanLine_NELA_MMX_ISSE((char *)dst + dstpitch*y, srcat, srcab, w, (uint8 *)elabuf);
-			}
+			__m256i lt_l1_c0 = cmplt_epu8_AVX2(sl1, sc0);
+			__m256i lt_r1_c0 = cmplt_epu8_AVX2(sr1, sc0);
+			__m256i lt_l1_r1 = cmplt_epu8_AVX2(sl1, sr1);
+
+			__m256i is_dir = _mm256_or_si256(lt_l1_c0, lt_r1_c0);
+			__m256i is_l = _mm256_and_si256(is_dir, lt_l1_r1);
+			__m256i is_r = _mm256_andnot_si256(lt_l1_r1, is_dir);
+
+			__m256i pred_l = _mm256_blendv_epi8(ela_pred_AVX2(T+x, B+x, 1), ela_pred_AVX2(T+x, B+x, 2), cmplt_epu8_AVX2(sl2, sl1));
+			__m256i pred_r = _mm256_blendv_epi8(ela_pred_AVX2(T+x, B+x, -1), ela_pred_AVX2(T+x, B+x, -2), cmplt_epu8_AVX2(sr2, sr1));
+			__m256i pred = _mm256_blendv_epi8(_mm256_blendv_epi8(ela_pred_AVX2(T+x, B+x, 0), pred_r, is_r), pred_l, is_l);
+
+			_mm256_storeu_si256((__m256i *)(dst+x), pred);
 		}
+
+		_mm256_zeroupper();
+		ela_row_L8_scalar(dst, T, B, x, w);
+	}
+}
 #endif
-		else {
-			for(uint32 y = y0; y < h - 1; y += 2) {
-				const __m128i *srcat = (const __m128i *)((const char *)src + srcpitch * (y-1));
-				const __m128i *srcab = (const __m128i *)((const char *)src + srcpitch * (y+1));
 
-				BlendScanLine_NELA_scalar((char *)dst + dstpitch*y, srcat, srcab, w, (uint8 *)elabuf);
-			}
-		}
+///////////////////////////////////////////////////////////////////////////
 
-		if (interpField2)
-			memcpy((char *)dst + dstpitch*(h - 1), (const char *)src + srcpitch*(h - 1), w16 << 4);
+namespace {
+	typedef void (*avg_row_t)(uint8 *dst, const uint8 *src1, const uint8 *src2, uint32 w);
+	typedef void (*blend_row_t)(uint8 *dst, const uint8 *src, uint32 w, ptrdiff_t srcpitch);
+	typedef void (*ela_row_t)(uint8 *dst, const uint8 *T, const uint8 *B, uint32 w);
+
+	void ela_row_L8_C(uint8 *dst, const uint8 *T, const uint8 *B, uint32 w) {
+		ela_row_L8_scalar(dst, T, B, 0, w);
 	}
 
-	void Average_scalar(void *dst, ptrdiff_t dstPitch, const void *src1, const void *src2, ptrdiff_t srcPitch, uint32 w16, uint32 h) {
-		uint32 w4 = w16 << 2;
-		do {
-			uint32 *dstv = (uint32 *)dst;
-			uint32 *src1v = (uint32 *)src1;
-			uint32 *src2v = (uint32 *)src2;
+	avg_row_t get_avg_row() {
+#if defined(VD_CPU_X86) || defined(VD_CPU_AMD64)
+#if _MSC_VER >= 1700
+		if (g_cpuid.m_flags & CCpuID::avx2)
+			return avg_row_AVX2;
+#endif
+		if (SSE2_enabled)
+			return avg_row_SSE2;
+#endif
+		return avg_row_scalar;
+	}
 
-			for(uint32 i=0; i<w4; ++i) {
-				uint32 a = src1v[i];
-				uint32 b = src2v[i];
+	blend_row_t get_blend_row() {
+#if defined(VD_CPU_X86) || defined(VD_CPU_AMD64)
+#if _MSC_VER >= 1700
+		if (g_cpuid.m_flags & CCpuID::avx2)
+			return blend_row_AVX2;
+#endif
+		if (SSE2_enabled)
+			return blend_row_SSE2;
+#endif
+		return blend_row_scalar;
+	}
 
-				dstv[i] = (a|b) - (((a^b) & 0xfefefefe) >> 1);
-			}
+	ela_row_t get_ela_row() {
+#if defined(VD_CPU_X86) || defined(VD_CPU_AMD64)
+#if _MSC_VER >= 1700
+		if (g_cpuid.m_flags & CCpuID::avx2)
+			return ela_row_L8_AVX2;
+#endif
+		if (SSE2_enabled)
+			return ela_row_L8_SSE2;
+#endif
+		return ela_row_L8_C;
+	}
 
-			dst = (char *)dst + dstPitch;
-			src1 = (char *)src1 + srcPitch;
-			src2 = (char *)src2 + srcPitch;
-		} while(--h);
+	// Rows with the parity of interpField2 are interpolated, the others are
+	// copied. Interpolated rows at the top or bottom edge have only one
+	// neighbour and are copied from the source as well.
+	inline bool is_interpolated(uint32 y, uint32 h, bool interpField2) {
+		return (y & 1) == (interpField2 ? 1u : 0u) && y > 0 && y + 1 < h;
 	}
 
-#if defined(VD_CPU_X86)
-	void __declspec(naked) __cdecl Average_MMX(void *dst, ptrdiff_t dstPitch, const void *src1, const void *src2, ptrdiff_t srcPitch, uint32 w16, uint32 h) {
-		static const __declspec(align(8)) uint64 x7fb = 0x7f7f7f7f7f7f7f7f;
-		static const __declspec(align(8)) uint64 xfeb = 0xfefefefefefefefe;
-
-		__asm {
-			push		ebp
-			push		edi
-			push		esi
-			push		ebx
-
-			mov			esi, [esp+24+16]
-			mov			eax, [esp+4+16]
-			shl			esi, 4
-			mov			ecx, [esp+12+16]
-			mov			edx, [esp+16+16]
-			mov			ebp, [esp+20+16]
-			mov			edi, [esp+8+16]
-			sub			edi, esi
-			sub			ebp, esi
-
-			movq		mm6, x7fb
-			movq		mm7, xfeb
-
-			mov			esi, [esp+28+16]
-yloop:
-			mov			ebx, [esp+24+16]
-mainRowLoop:
-			movq		mm0, [ecx]
-			movq		mm3, [ecx + 8]
-			movq		mm1, mm0
-			movq		mm2, [edx]
-			movq		mm4, mm3
-			movq		mm5, [edx + 8]
-			por			mm1, mm2
-			pxor		mm0, mm2
-			por			mm4, mm5
-			pxor		mm3, mm5
-			psrlq		mm0, 1
-			pand		mm3, mm7
-			pand		mm0, mm6
-			psrlq		mm3, 1
-			psubb		mm1, mm0
-			psubb		mm4, mm3
-			add			ecx, 16
-			movq		[eax], mm1
-			movq		[eax+8], mm4
-			add			edx, 16
-			add			eax, 16
-			dec			ebx
-			jne			mainRowLoop
-
-			add			eax, edi
-			add			ecx, ebp
-			add			edx, ebp
-			dec			esi
-			jne			yloop
-
-			emms
-			pop			ebx
-			pop			esi
-			pop			edi
-			pop			ebp
-			ret
+	void copy_rows(void *dst, ptrdiff_t dstpitch, const void *src, ptrdiff_t srcpitch, uint32 w, uint32 h, bool interpField2) {
+		for(uint32 y = 0; y < h; ++y) {
+			if (!is_interpolated(y, h, interpField2))
+				memcpy((char *)dst + dstpitch*y, (const char *)src + srcpitch*y, w);
 		}
 	}
 
-	void __declspec(naked) __cdecl Average_ISSE(void *dst, ptrdiff_t dstPitch, const void *src1, const void *src2, ptrdiff_t srcPitch, uint32 w16, uint32 h) {
-		static const __declspec(align(8)) uint64 x7fb = 0x7f7f7f7f7f7f7f7f;
-		static const __declspec(align(8)) uint64 xfeb = 0xfefefefefefefefe;
-
-		__asm {
-			push		ebp
-			push		edi
-			push		esi
-			push		ebx
-
-			mov			esi, [esp+24+16]
-			mov			eax, [esp+4+16]
-			shl			esi, 4
-			mov			ecx, [esp+12+16]
-			mov			edx, [esp+16+16]
-			mov			ebp, [esp+20+16]
-			mov			edi, [esp+8+16]
-			sub			edi, esi
-			sub			ebp, esi
-
-			movq		mm6, x7fb
-			movq		mm7, xfeb
-
-			mov			esi, [esp+28+16]
-yloop:
-			mov			ebx, [esp+24+16]
-mainRowLoop:
-			movq		mm0, [ecx]
-			movq		mm1, [ecx + 8]
-			movq		mm2, [edx]
-			movq		mm3, [edx + 8]
-			pavgb		mm0, mm2
-			pavgb		mm1, mm3
-			movq		[eax], mm0
-			add			ecx, 16
-			add			edx, 16
-			movq		[eax+8], mm1
-			add			eax, 16
-			dec			ebx
-			jne			mainRowLoop
-
-			add			eax, edi
-			add			ecx, ebp
-			add			edx, ebp
-			dec			esi
-			jne			yloop
-
-			emms
-			pop			ebx
-			pop			esi
-			pop			edi
-			pop			ebp
-			ret
-		}
+	// copies a row with 32 replicated edge pixels on the left and 64 on the right
+	void pad_row(uint8 *dst, const uint8 *src, uint32 w) {
+		memset(dst, src[0], 32);
+		memcpy(dst + 32, src, w);
+		memset(dst + 32 + w, src[w - 1], 64);
 	}
-#endif
+
+	void InterpPlane_NELA_X8R8G8B8(void *dst, ptrdiff_t dstpitch, const void *src, ptrdiff_t srcpitch, uint32 w, uint32 h, bool interpField2) {
+		uint32 w4 = (w + 3) >> 2;
+		vdfastvector<uint32, vdaligned_alloc<uint32> > tempbuf(7 * w4 + 16);
+		uint32 *elabuf = tempbuf.data();
+		uint32 *topbuf = elabuf + 5*w4;
+		uint32 *botbuf = topbuf + w4 + 8;
+
+		copy_rows(dst, dstpitch, src, srcpitch, w, h, interpField2);
+
+		for(uint32 y = 1; y + 1 < h; ++y) {
+			if (!is_interpolated(y, h, interpField2))
+				continue;
+
+			const uint32 *srcat = (const uint32 *)((const char *)src + srcpitch * (y-1));
+			const uint32 *srcab = (const uint32 *)((const char *)src + srcpitch * (y+1));
+
+			topbuf[0] = topbuf[1] = topbuf[2] = topbuf[3] = srcat[0];
+			botbuf[0] = botbuf[1] = botbuf[2] = botbuf[3] = srcab[0];
+
+			memcpy(topbuf + 4, srcat, w4 * 4);
+			memcpy(botbuf + 4, srcab, w4 * 4);
+
+			topbuf[w4+4] = topbuf[w4+5] = topbuf[w4+6] = topbuf[w4+7] = topbuf[w4+3];
+			botbuf[w4+4] = botbuf[w4+5] = botbuf[w4+6] = botbuf[w4+7] = botbuf[w4+3];
 
 #if defined(VD_CPU_X86) || defined(VD_CPU_AMD64)
-	void Average_SSE2(void *dst, ptrdiff_t dstPitch, const void *src1, const void *src2, ptrdiff_t srcPitch, uint32 w16, uint32 h) {
-		do {
-			__m128i *dstv = (__m128i *)dst;
-			__m128i *src1v = (__m128i *)src1;
-			__m128i *src2v = (__m128i *)src2;
+			if (SSE2_enabled)
+				ela_X8R8G8B8_SSE2(elabuf, (const uint8 *)topbuf, (const uint8 *)botbuf, w4);
+			else
+#endif
+				ela_X8R8G8B8_scalar(elabuf, (const uint8 *)topbuf, (const uint8 *)botbuf, w4);
 
-			for(uint32 i=0; i<w16; ++i)
-				dstv[i] = _mm_avg_epu8(src1v[i], src2v[i]);
+			nela_X8R8G8B8_scalar((uint32 *)((char *)dst + dstpitch*y), elabuf, (const uint8 *)(topbuf + 4), (const uint8 *)(botbuf + 4), w4);
+		}
+	}
 
-			dst = (char *)dst + dstPitch;
-			src1 = (char *)src1 + srcPitch;
-			src2 = (char *)src2 + srcPitch;
-		} while(--h);
+	void InterpPlane_NELA(void *dst, ptrdiff_t dstpitch, const void *src, ptrdiff_t srcpitch, uint32 w, uint32 h, bool interpField2) {
+		vdfastvector<uint8, vdaligned_alloc<uint8> > tempbuf(2 * (w + 96));
+		uint8 *topbuf = tempbuf.data();
+		uint8 *botbuf = topbuf + w + 96;
+
+		ela_row_t ela_row = get_ela_row();
+
+		copy_rows(dst, dstpitch, src, srcpitch, w, h, interpField2);
+
+		for(uint32 y = 1; y + 1 < h; ++y) {
+			if (!is_interpolated(y, h, interpField2))
+				continue;
+
+			pad_row(topbuf, (const uint8 *)src + srcpitch * (y-1), w);
+			pad_row(botbuf, (const uint8 *)src + srcpitch * (y+1), w);
+
+			ela_row((uint8 *)dst + dstpitch*y, topbuf + 32, botbuf + 32, w);
+		}
 	}
-#endif
 
 	void InterpPlane_Bob(void *dst, ptrdiff_t dstpitch, const void *src, ptrdiff_t srcpitch, uint32 w, uint32 h, bool interpField2) {
-		void (*blend_func)(void *dst, ptrdiff_t dstPitch, const void *src1, const void *src2, ptrdiff_t srcPitch, uint32 w16, uint32 h);
-#if defined(VD_CPU_X86)
-		if (SSE2_enabled)
-			blend_func = Average_SSE2;
-		else if (ISSE_enabled)
-			blend_func = Average_ISSE;
-		else if (MMX_enabled)
-			blend_func = Average_MMX;
-		else
-			blend_func = Average_scalar;
-#else
-		blend_func = Average_SSE2;
-#endif
+		avg_row_t avg_row = get_avg_row();
 
-		w = (w + 3) >> 2;
-
-		uint32 y0 = interpField2 ? 1 : 2;
-
-		if (!interpField2)
-			memcpy(dst, src, w * 4);
-
-		if (h > y0) {
-			ASSERT(((UINT_PTR)dst & 0xF) == 0);
-			ASSERT((dstpitch & 0xF) == 0);
-			ASSERT(((UINT_PTR)src & 0xF) == 0);
-			ASSERT((srcpitch*(y0 - 1) & 0xF) == 0);
-			blend_func((char *)dst + dstpitch*y0,
-				dstpitch*2,
-				(const char *)src + srcpitch*(y0 - 1),
-				(const char *)src + srcpitch*(y0 + 1),
-				srcpitch*2,
-				(w + 3) >> 2,
-				(h - y0) >> 1);
+		copy_rows(dst, dstpitch, src, srcpitch, w, h, interpField2);
+
+		for(uint32 y = 1; y + 1 < h; ++y) {
+			if (is_interpolated(y, h, interpField2))
+				avg_row((uint8 *)dst + dstpitch*y, (const uint8 *)src + srcpitch*(y-1), (const uint8 *)src + srcpitch*(y+1), w);
 		}
+	}
+
+	void InterpPlane_YADIF(void *dst, ptrdiff_t dstpitch, const void *src, const void *prev, ptrdiff_t srcpitch, uint32 w, uint32 h, bool interpField2) {
+		copy_rows(dst, dstpitch, src, srcpitch, w, h, interpField2);
+
+		for(uint32 y = 1; y + 1 < h; ++y) {
+			if (!is_interpolated(y, h, interpField2))
+				continue;
+
+			// rows y-2 and y+2 fall back to y at the edges
+			ptrdiff_t up2 = (y >= 2) ? -2*srcpitch : 0;
+			ptrdiff_t down2 = (y + 2 < h) ? 2*srcpitch : 0;
 
-		if (interpField2)
-			memcpy((char *)dst + dstpitch*(h - 1), (const char *)src + srcpitch*(h - 1), w*4);
+			const uint8 *c = (const uint8 *)src + srcpitch*y;
+			const uint8 *p = (const uint8 *)prev + srcpitch*y;
 
-#ifdef _M_IX86
-		if (MMX_enabled)
-			__asm emms
+			yadif_rows r = {
+				c + up2, c - srcpitch, c, c + srcpitch, c + down2,
+				p + up2, p - srcpitch, p, p + srcpitch, p + down2,
+			};
+
+			uint8 *d = (uint8 *)dst + dstpitch*y;
+			int x = 0;
+#if defined(VD_CPU_X86) || defined(VD_CPU_AMD64)
+			if (SSE2_enabled && w >= 16) {
+				yadif_row_scalar(d, r, 0, 3, w);
+				x = 3 + ((w - 6) & ~7);
+				yadif_row_SSE2(d, r, 3, x);
+			}
 #endif
+			yadif_row_scalar(d, r, x, w, w);
+		}
 	}
 
 	void BlendPlane(void *dst, ptrdiff_t dstpitch, const void *src, ptrdiff_t srcpitch, uint32 w, uint32 h) {
-		void (*blend_func)(void *, const void *, uint32, ptrdiff_t);
-#if defined(VD_CPU_X86)
-		if (SSE2_enabled && !(srcpitch % 16))
-			blend_func = asm_blend_row_SSE2;
-		else
-			blend_func = ISSE_enabled ? asm_blend_row_ISSE : MMX_enabled ? asm_blend_row_MMX : asm_blend_row;
-#else
-		blend_func = asm_blend_row_SSE2;
-#endif
-
-		w = (w + 3) >> 2;
+		avg_row_t avg_row = get_avg_row();
+		blend_row_t blend_row = get_blend_row();
 
-		asm_blend_row_clipped(dst, src, w, srcpitch);
-		if (h-=2)
-			do {
-				dst = ((char *)dst + dstpitch);
+		const uint8 *s = (const uint8 *)src;
+		uint8 *d = (uint8 *)dst;
 
-				blend_func(dst, src, w, srcpitch);
+		if (h < 2) {
+			if (h)
+				memcpy(d, s, w);
+			return;
+		}
 
-				src = ((char *)src + srcpitch);
-			} while(--h);
+		avg_row(d, s, s + srcpitch, w);
 
-		asm_blend_row_clipped((char *)dst + dstpitch, src, w, srcpitch);
+		for(uint32 y = 1; y + 1 < h; ++y)
+			blend_row(d + dstpitch*y, s + srcpitch*(y-1), w, srcpitch);
 
-#ifdef _M_IX86
-		if (MMX_enabled)
-			__asm emms
-#endif
+		avg_row(d + dstpitch*(h-1), s + srcpitch*(h-2), s + srcpitch*(h-1), w);
 	}
 }
 
@@ -1962,6 +684,13 @@ void DeinterlaceBob(BYTE* dst, BYTE* src, DWORD w, DWORD h, DWORD dstpitch, DWOR
 	InterpPlane_Bob(dst, dstpitch, src, srcpitch, w, h, topfield);
 }
 
+void DeinterlaceYADIF(BYTE* dst, BYTE* src, BYTE* prev, DWORD w, DWORD h, DWORD dstpitch, DWORD srcpitch, bool topfield)
+{
+	topfield = !topfield;
+
+	InterpPlane_YADIF(dst, dstpitch, src, prev, srcpitch, w, h, topfield);
+}
+
 void DeinterlaceBlend(BYTE* dst, BYTE* src, DWORD w, DWORD h, DWORD dstpitch, DWORD srcpitch)
 {
 	BlendPlane(dst, dstpitch, src, srcpitch, w, h);
@@ -70,10 +70,146 @@ CCpuID::CCpuID()
 	flags |= !!(lEnableFlags & CPUF_SUPPORTS_SSE2)			? sse2		: 0;			// SSE2
 	flags |= !!(lEnableFlags & CPUF_SUPPORTS_3DNOW)			? _3dnow	: 0;			// 3DNow
 
+	// AVX2 is unknown to VirtualDub's cpuaccel, check it here (including OS support for the YMM state)
+	int cpuinfo[4];
+	__cpuid(cpuinfo, 0);
+	if (cpuinfo[0] >= 7) {
+		__cpuid(cpuinfo, 1);
+		if ((cpuinfo[2] & ((1 << 27) | (1 << 28))) == ((1 << 27) | (1 << 28))
+				&& (_xgetbv(_XCR_XFEATURE_ENABLED_MASK) & 0x6) == 0x6) {
+			__cpuidex(cpuinfo, 7, 0);
+			flags |= (cpuinfo[1] & (1 << 5))						? avx2		: 0;			// AVX2
+		}
+	}
+
 	// result
 	m_flags = (flag_t)flags;
 }
 
+//
+// YUV to RGB32 with SSE2
+//
+// BT.601 limited range in 16-bit fixed point with 5 fractional bits, for the
+// P010/P016 sources VDPixmapBlt has no conversion for. The fraction is rounded
+// or, with a dither matrix, ordered dithered.
+//
+
+#define YUVRGB_FRAC		5
+
+#define YUVRGB_Y		19071	// 1.164 * 2^14, luma is (Y - 16) << 7
+#define YUVRGB_VR		13074	// 1.596 * 2^13, chroma is (C - 128) << 8
+#define YUVRGB_UG		3203	// 0.391 * 2^13
+#define YUVRGB_VG		6660	// 0.813 * 2^13
+#define YUVRGB_UB		16532	// 2.018 * 2^13
+
+static __forceinline int yuvrgb_clip(int v)
+{
+	return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+static __forceinline DWORD yuvtorgb_c(int ys, int us, int vs, int d)
+{
+	int y = (ys * YUVRGB_Y) >> 16;
+	int r = (y + ((vs * YUVRGB_VR) >> 16) + d) >> YUVRGB_FRAC;
+	int g = (y - ((us * YUVRGB_UG) >> 16) - ((vs * YUVRGB_VG) >> 16) + d) >> YUVRGB_FRAC;
+	int b = (y + ((us * YUVRGB_UB) >> 16) + d) >> YUVRGB_FRAC;
+
+	return 0xff000000 | (yuvrgb_clip(r) << 16) | (yuvrgb_clip(g) << 8) | yuvrgb_clip(b);
+}
+
+// eight pixels of scaled luma and chroma to BGRX
+static __forceinline void yuvtorgb_sse2(BYTE* dst, __m128i ys, __m128i us, __m128i vs, __m128i d)
+{
+	__m128i y = _mm_mulhi_epi16(ys, _mm_set1_epi16(YUVRGB_Y));
+	__m128i r = _mm_add_epi16(y, _mm_mulhi_epi16(vs, _mm_set1_epi16(YUVRGB_VR)));
+	__m128i g = _mm_sub_epi16(y, _mm_add_epi16(_mm_mulhi_epi16(us, _mm_set1_epi16(YUVRGB_UG)), _mm_mulhi_epi16(vs, _mm_set1_epi16(YUVRGB_VG))));
+	__m128i b = _mm_add_epi16(y, _mm_mulhi_epi16(us, _mm_set1_epi16(YUVRGB_UB)));
+
+	r = _mm_srai_epi16(_mm_adds_epi16(r, d), YUVRGB_FRAC);
+	g = _mm_srai_epi16(_mm_adds_epi16(g, d), YUVRGB_FRAC);
+	b = _mm_srai_epi16(_mm_adds_epi16(b, d), YUVRGB_FRAC);
+
+	__m128i zero = _mm_setzero_si128();
+	__m128i bg = _mm_unpacklo_epi8(_mm_packus_epi16(b, zero), _mm_packus_epi16(g, zero));
+	__m128i ra = _mm_unpacklo_epi8(_mm_packus_epi16(r, zero), _mm_cmpeq_epi8(zero, zero));
+
+	_mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi16(bg, ra));
+	_mm_storeu_si128((__m128i*)(dst + 16), _mm_unpackhi_epi16(bg, ra));
+}
+
+// dither thresholds of eight pixels, or the rounding constant without a matrix
+static __forceinline __m128i yuvrgb_dither(const BYTE* dither, int x, int y)
+{
+	if (!dither) {
+		return _mm_set1_epi16(1 << (YUVRGB_FRAC - 1));
+	}
+	__m128i d = _mm_loadl_epi64((const __m128i*)&dither[(y & 31) * 32 + (x & 31)]);
+	return _mm_srli_epi16(_mm_unpacklo_epi8(d, _mm_setzero_si128()), 8 - YUVRGB_FRAC);
+}
+
+static __forceinline int yuvrgb_dither_c(const BYTE* dither, int x, int y)
+{
+	return dither ? dither[(y & 31) * 32 + (x & 31)] >> (8 - YUVRGB_FRAC) : 1 << (YUVRGB_FRAC - 1);
+}
+
+// 32x32 Bayer matrix, the bit reversed interleave of x^y and y
+static BYTE s_OrderedDither[32 * 32];
+
+static struct OrderedDitherInit {
+	OrderedDitherInit() {
+		for (int y = 0; y < 32; y++) {
+			for (int x = 0; x < 32; x++) {
+				int v = 0;
+				for (int i = 0; i < 5; i++) {
+					v |= (((x ^ y) >> i) & 1) << (9 - 2 * i);
+					v |= ((y >> i) & 1) << (8 - 2 * i);
+				}
+				s_OrderedDither[y * 32 + x] = (BYTE)(v >> 2);
+			}
+		}
+	}
+} s_OrderedDitherInit;
+
+const BYTE* GetOrderedDitherMatrix()
+{
+	return s_OrderedDither;
+}
+
+static void p016torgb32row_sse2(BYTE* dst, const WORD* srcy, const WORD* srcuv, int w, const BYTE* dither, int line)
+{
+	const __m128i mask = _mm_set1_epi32(0x0000ffff);
+	const __m128i bias = _mm_set1_epi16(-32768);
+
+	int x = 0;
+	for (; x + 8 <= w; x += 8, dst += 32) {
+		__m128i y = _mm_loadu_si128((const __m128i*)&srcy[x]);
+		__m128i uv = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&srcuv[x]), bias);
+		__m128i u = _mm_and_si128(uv, mask);
+		__m128i v = _mm_srli_epi32(uv, 16);
+		u = _mm_or_si128(u, _mm_slli_epi32(u, 16));
+		v = _mm_or_si128(v, _mm_slli_epi32(v, 16));
+
+		yuvtorgb_sse2(dst,
+					  _mm_sub_epi16(_mm_srli_epi16(y, 1), _mm_set1_epi16(16 << 7)),
+					  u, v,
+					  yuvrgb_dither(dither, x, line));
+	}
+
+	for (DWORD* dstd = (DWORD*)dst; x < w; x++) {
+		const WORD* uv = &srcuv[x & ~1];
+		*dstd++ = yuvtorgb_c((srcy[x] >> 1) - (16 << 7), uv[0] - 32768, uv[1] - 32768, yuvrgb_dither_c(dither, x, line));
+	}
+}
+
+static void p016torgb32row_c(BYTE* dst, const WORD* srcy, const WORD* srcuv, int w, const BYTE* dither, int line)
+{
+	DWORD* dstd = (DWORD*)dst;
+	for (int x = 0; x < w; x++) {
+		const WORD* uv = &srcuv[x & ~1];
+		*dstd++ = yuvtorgb_c((srcy[x] >> 1) - (16 << 7), uv[0] - 32768, uv[1] - 32768, yuvrgb_dither_c(dither, x, line));
+	}
+}
+
 bool BitBltFromI420ToI420(int w, int h, BYTE* dsty, BYTE* dstu, BYTE* dstv, int dstpitch, BYTE* srcy, BYTE* srcu, BYTE* srcv, int srcpitch)
 {
 	VDPixmap srcbm = {0};
@@ -328,6 +464,23 @@ bool BitBltFromYUY2ToRGB(int w, int h, BYTE* dst, int dstpitch, int dbpp, BYTE*
 	return VDPixmapBlt(dstpxm, srcbm);
 }
 
+bool BitBltFromP016ToRGB(int w, int h, BYTE* dst, int dstpitch, int dbpp, BYTE* srcy, BYTE* srcuv, int srcpitch, const BYTE* dither)
+{
+	if (dbpp != 32 || w <= 0 || h <= 0) {
+		return false;
+	}
+
+	void (*p016torgb32row)(BYTE* dst, const WORD* srcy, const WORD* srcuv, int w, const BYTE* dither, int line) =
+		(g_cpuid.m_flags & CCpuID::sse2) ? p016torgb32row_sse2 : p016torgb32row_c;
+
+	dst += dstpitch * (h - 1);
+	for (int y = 0; y < h; y++, dst -= dstpitch) {
+		p016torgb32row(dst, (const WORD*)(srcy + srcpitch * y), (const WORD*)(srcuv + srcpitch * (y >> 1)), w, dither, y);
+	}
+
+	return true;
+}
+
 static void yuvtoyuy2row_c(BYTE* dst, BYTE* srcy, BYTE* srcu, BYTE* srcv, DWORD width)
 {
 	WORD* dstw = (WORD*)dst;
@@ -26,7 +26,7 @@
 class CCpuID {
 public:
 	CCpuID();
-	enum flag_t {mmx=1, ssemmx=2, ssefpu=4, sse2=8, _3dnow=16} m_flags;
+	enum flag_t {mmx=1, ssemmx=2, ssefpu=4, sse2=8, _3dnow=16, avx2=32} m_flags;
 };
 extern CCpuID g_cpuid;
 
@@ -37,9 +37,15 @@ extern bool BitBltFromI420ToYUY2Interlaced(int w, int h, BYTE* dst, int dstpitch
 extern bool BitBltFromI420ToRGB(int w, int h, BYTE* dst, int dstpitch, int dbpp, BYTE* srcy, BYTE* srcu, BYTE* srcv, int srcpitch /* TODO: , bool fInterlaced = false */);
 extern bool BitBltFromYUY2ToYUY2(int w, int h, BYTE* dst, int dstpitch, BYTE* src, int srcpitch);
 extern bool BitBltFromYUY2ToRGB(int w, int h, BYTE* dst, int dstpitch, int dbpp, BYTE* src, int srcpitch);
+// P010/P016 to RGB32, dither is an optional 32x32 matrix of 8-bit thresholds for ordered dithering
+extern bool BitBltFromP016ToRGB(int w, int h, BYTE* dst, int dstpitch, int dbpp, BYTE* srcy, BYTE* srcuv, int srcpitch, const BYTE* dither = NULL);
+// 32x32 ordered dither matrix for BitBltFromP016ToRGB
+extern const BYTE* GetOrderedDitherMatrix();
 extern bool BitBltFromRGBToRGB(int w, int h, BYTE* dst, int dstpitch, int dbpp, BYTE* src, int srcpitch, int sbpp);
 
 extern void DeinterlaceBlend(BYTE* dst, BYTE* src, DWORD rowbytes, DWORD h, DWORD dstpitch, DWORD srcpitch);
 extern void DeinterlaceBob(BYTE* dst, BYTE* src, DWORD rowbytes, DWORD h, DWORD dstpitch, DWORD srcpitch, bool topfield);
 extern void DeinterlaceELA_X8R8G8B8(BYTE* dst, BYTE* src, DWORD w, DWORD h, DWORD dstpitch, DWORD srcpitch, bool topfield);
 extern void DeinterlaceELA(BYTE* dst, BYTE* src, DWORD w, DWORD h, DWORD dstpitch, DWORD srcpitch, bool topfield);
+// prev is the previous source frame, with the same pitch as src
+extern void DeinterlaceYADIF(BYTE* dst, BYTE* src, BYTE* prev, DWORD rowbytes, DWORD h, DWORD dstpitch, DWORD srcpitch, bool topfield);
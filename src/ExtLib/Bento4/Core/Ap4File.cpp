@@ -53,6 +53,11 @@ AP4_File::AP4_File(AP4_ByteStream& stream, AP4_AtomFactory& atom_factory) :
     // get all atoms
     AP4_Atom* atom;
     while (AP4_SUCCEEDED(atom_factory.CreateAtomFromStream(stream, atom))) {
+        if (atom->GetType() == AP4_ATOM_TYPE_MOOF && m_Movie) {
+            // movie fragments are read by the application
+            delete atom;
+            break;
+        }
         switch (atom->GetType()) {
             case AP4_ATOM_TYPE_MOOV:
                 m_Movie = new AP4_Movie(dynamic_cast<AP4_MoovAtom*>(atom),
@@ -40,6 +40,8 @@ LPCTSTR GetMPCCommandName(MPCAPI_COMMAND nCmd)
 			return _T("CMD_LISTAUDIOTRACKS");
 		case CMD_PLAYLIST :
 			return _T("CMD_PLAYLIST");
+		case CMD_UPDATE :
+			return _T("CMD_UPDATE");
 		default :
 			return _T("CMD_UNK");
 	}
@@ -257,6 +259,23 @@ void CRegisterCopyDataDlg::Senddata(MPCAPI_COMMAND nCmd, LPCTSTR strCommand)
 	}
 }
 
+void CRegisterCopyDataDlg::Subscribe(LPCTSTR strCommand)
+{
+	// "fields interval", MPC_UPDATE_ALL every second by default, 0 fields unsubscribes
+	MPC_SUBSCRIPTION sub = {MPC_UPDATE_ALL, 1000};
+	_stscanf_s(strCommand, _T("%i %u"), &sub.nFields, &sub.nIntervalMS);
+
+	if (m_hWndMPC) {
+		COPYDATASTRUCT MyCDS;
+
+		MyCDS.dwData = CMD_SUBSCRIBE;
+		MyCDS.cbData = sizeof(sub);
+		MyCDS.lpData = (LPVOID)&sub;
+
+		::SendMessage(m_hWndMPC, WM_COPYDATA, (WPARAM)GetSafeHwnd(), (LPARAM)&MyCDS);
+	}
+}
+
 BOOL CRegisterCopyDataDlg::OnCopyData(CWnd* pWnd, COPYDATASTRUCT* pCopyDataStruct)
 {
 	CString strMsg;
@@ -265,6 +284,45 @@ BOOL CRegisterCopyDataDlg::OnCopyData(CWnd* pWnd, COPYDATASTRUCT* pCopyDataStruc
 		m_hWndMPC = (HWND)IntToPtr(_ttoi((LPCTSTR)pCopyDataStruct->lpData));
 	}
 
+	if (pCopyDataStruct->dwData == CMD_UPDATE) {
+		if (pCopyDataStruct->cbData < sizeof(MPC_UPDATE)) {
+			return FALSE;
+		}
+
+		// only the members flagged in nFields are valid
+		const MPC_UPDATE* pUpd = (const MPC_UPDATE*)pCopyDataStruct->lpData;
+		strMsg.Format(_T("%s : #%u"), GetMPCCommandName(CMD_UPDATE), pUpd->nSequence);
+
+		CString str;
+		if (pUpd->nFields & MPC_UPDATE_POSITION) {
+			str.Format(_T(", position %I64d ms"), pUpd->llPosition);
+			strMsg += str;
+		}
+		if (pUpd->nFields & MPC_UPDATE_DURATION) {
+			str.Format(_T(", duration %I64d ms"), pUpd->llDuration);
+			strMsg += str;
+		}
+		if (pUpd->nFields & MPC_UPDATE_LOADSTATE) {
+			str.Format(_T(", load state %d"), pUpd->nLoadState);
+			strMsg += str;
+		}
+		if (pUpd->nFields & MPC_UPDATE_PLAYSTATE) {
+			str.Format(_T(", play state %d"), pUpd->nPlayState);
+			strMsg += str;
+		}
+		if (pUpd->nFields & MPC_UPDATE_AUDIOTRACK) {
+			str.Format(_T(", audio track %d"), pUpd->nAudioTrack);
+			strMsg += str;
+		}
+		if (pUpd->nFields & MPC_UPDATE_SUBTITLETRACK) {
+			str.Format(_T(", subtitle track %d"), pUpd->nSubtitleTrack);
+			strMsg += str;
+		}
+
+		m_listBox.InsertString(0, strMsg);
+		return TRUE;
+	}
+
 	strMsg.Format(_T("%s : %s"), GetMPCCommandName((MPCAPI_COMMAND)pCopyDataStruct->dwData), (LPCTSTR)pCopyDataStruct->lpData);
 	m_listBox.InsertString(0, strMsg);
 	return CDialog::OnCopyData(pWnd, pCopyDataStruct);
@@ -345,5 +403,8 @@ void CRegisterCopyDataDlg::OnBnClickedButtonSendcommand()
 		case 22 :
 			Senddata(CMD_CLOSEAPP, m_txtCommand);
 			break;
+		case 23 :
+			Subscribe(m_txtCommand);
+			break;
 	}
 }
@@ -66,4 +66,5 @@ public:
 	int			m_nCommandType;
 	afx_msg		void OnBnClickedButtonSendcommand();
 	void		Senddata(MPCAPI_COMMAND nCmd, LPCTSTR strCommand);
+	void		Subscribe(LPCTSTR strCommand);
 };
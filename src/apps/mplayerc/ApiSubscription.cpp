@@ -0,0 +1,117 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include "ApiSubscription.h"
+
+#define MIN_INTERVAL	50
+#define MAX_INTERVAL	10000
+#define MAX_BACKOFF		5000
+
+CApiSubscription::CApiSubscription()
+	: m_nFields(0)
+	, m_nInterval(0)
+	, m_bSent(false)
+	, m_nNext(0)
+	, m_nBackoff(0)
+{
+	memset(&m_sent, 0, sizeof(m_sent));
+}
+
+void CApiSubscription::Subscribe(UINT nFields, DWORD nIntervalMS, DWORD now)
+{
+	m_nFields	= nFields & MPC_UPDATE_ALL;
+	m_nInterval	= min(max(nIntervalMS, (DWORD)MIN_INTERVAL), (DWORD)MAX_INTERVAL);
+	m_nBackoff	= m_nInterval;
+	m_bSent		= false;
+	m_nNext		= now;
+
+	memset(&m_sent, 0, sizeof(m_sent));
+}
+
+bool CApiSubscription::GetUpdate(const MPC_UPDATE& cur, DWORD now, MPC_UPDATE& upd) const
+{
+	if (!m_nFields || (int)(now - m_nNext) < 0) {
+		return false;
+	}
+
+	upd = cur;
+	upd.nFields		= 0;
+	upd.nSequence	= m_sent.nSequence + 1;
+
+	if (!m_bSent) {
+		upd.nFields = m_nFields;
+		return true;
+	}
+
+	if ((m_nFields & MPC_UPDATE_POSITION) && cur.llPosition != m_sent.llPosition) {
+		upd.nFields |= MPC_UPDATE_POSITION;
+	}
+	if ((m_nFields & MPC_UPDATE_DURATION) && cur.llDuration != m_sent.llDuration) {
+		upd.nFields |= MPC_UPDATE_DURATION;
+	}
+	if ((m_nFields & MPC_UPDATE_LOADSTATE) && cur.nLoadState != m_sent.nLoadState) {
+		upd.nFields |= MPC_UPDATE_LOADSTATE;
+	}
+	if ((m_nFields & MPC_UPDATE_PLAYSTATE) && cur.nPlayState != m_sent.nPlayState) {
+		upd.nFields |= MPC_UPDATE_PLAYSTATE;
+	}
+	if ((m_nFields & MPC_UPDATE_AUDIOTRACK) && cur.nAudioTrack != m_sent.nAudioTrack) {
+		upd.nFields |= MPC_UPDATE_AUDIOTRACK;
+	}
+	if ((m_nFields & MPC_UPDATE_SUBTITLETRACK) && cur.nSubtitleTrack != m_sent.nSubtitleTrack) {
+		upd.nFields |= MPC_UPDATE_SUBTITLETRACK;
+	}
+
+	return upd.nFields != 0;
+}
+
+void CApiSubscription::OnSent(const MPC_UPDATE& upd, DWORD now, bool bDelivered)
+{
+	if (bDelivered) {
+		// only the delivered fields are known to the client
+		if (upd.nFields & MPC_UPDATE_POSITION) {
+			m_sent.llPosition = upd.llPosition;
+		}
+		if (upd.nFields & MPC_UPDATE_DURATION) {
+			m_sent.llDuration = upd.llDuration;
+		}
+		if (upd.nFields & MPC_UPDATE_LOADSTATE) {
+			m_sent.nLoadState = upd.nLoadState;
+		}
+		if (upd.nFields & MPC_UPDATE_PLAYSTATE) {
+			m_sent.nPlayState = upd.nPlayState;
+		}
+		if (upd.nFields & MPC_UPDATE_AUDIOTRACK) {
+			m_sent.nAudioTrack = upd.nAudioTrack;
+		}
+		if (upd.nFields & MPC_UPDATE_SUBTITLETRACK) {
+			m_sent.nSubtitleTrack = upd.nSubtitleTrack;
+		}
+		m_sent.nSequence = upd.nSequence;
+
+		m_bSent		= true;
+		m_nBackoff	= m_nInterval;
+	} else {
+		m_nBackoff	= min(m_nBackoff * 2, max(m_nInterval, (DWORD)MAX_BACKOFF));
+	}
+
+	m_nNext = now + m_nBackoff;
+}
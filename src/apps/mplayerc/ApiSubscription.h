@@ -0,0 +1,52 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include "MpcApi.h"
+
+// State of a CMD_SUBSCRIBE client. The changes are taken against the last update the
+// client received, so updates that fail or are skipped while the client is slow are
+// merged into the next one. No window or clock is used here, the owner passes the
+// time and does the sending.
+
+class CApiSubscription
+{
+	UINT		m_nFields;
+	DWORD		m_nInterval;
+
+	MPC_UPDATE	m_sent;		// the values the client has
+	bool		m_bSent;	// false until the first update was delivered
+	DWORD		m_nNext;	// no update before this time
+	DWORD		m_nBackoff;
+
+public:
+	CApiSubscription();
+
+	void	Subscribe(UINT nFields, DWORD nIntervalMS, DWORD now);
+	bool	IsActive() const { return m_nFields != 0; }
+	UINT	GetFields() const { return m_nFields; }
+	DWORD	GetInterval() const { return m_nInterval; }
+
+	// fills upd with the changed values, returns false if there is nothing to send yet
+	bool	GetUpdate(const MPC_UPDATE& cur, DWORD now, MPC_UPDATE& upd) const;
+	// the result of sending upd, a client that didn't take it in time gets less updates
+	void	OnSent(const MPC_UPDATE& upd, DWORD now, bool bDelivered);
+};
@@ -1884,6 +1884,10 @@ void CAppSettings::ParseCommandLine(CAtlList<CString>& cmdln)
 	iMonitor = 0;
 	hMasterWnd = 0;
 	strPnSPreset.Empty();
+	strThumbnailsDst.Empty();
+	iThumbnailsWorkers = 0;
+	fThumbnailsBench = false;
+	iScanBenchFiles = 0;
 
 	POSITION pos = cmdln.GetHeadPosition();
 	while (pos) {
@@ -1997,6 +2001,20 @@ void CAppSettings::ParseCommandLine(CAtlList<CString>& cmdln)
 				SetAudioRenderer(_ttoi(cmdln.GetNext(pos)));
 			} else if (sw == _T("reset")) {
 				nCLSwitches |= CLSW_RESET;
+			} else if (sw == _T("thumbnails") && pos) {
+				CString dst = cmdln.GetNext(pos);
+				strThumbnailsDst.ReleaseBuffer(GetFullPathName(dst, MAX_PATH, strThumbnailsDst.GetBuffer(MAX_PATH), NULL));
+				if (strThumbnailsDst.IsEmpty()) {
+					strThumbnailsDst = dst;
+				}
+				nCLSwitches |= CLSW_THUMBNAILS;
+			} else if (sw == _T("thumbworkers") && pos) {
+				iThumbnailsWorkers = max(_ttoi(cmdln.GetNext(pos)), 0);
+			} else if (sw == _T("thumbbench")) {
+				fThumbnailsBench = true;
+			} else if (sw == _T("scanbench") && pos) {
+				iScanBenchFiles = min(max(_ttoi(cmdln.GetNext(pos)), 1), 100000);
+				nCLSwitches |= CLSW_SCANBENCH;
 			} else {
 				nCLSwitches |= CLSW_HELP|CLSW_UNRECOGNIZEDSWITCH;
 			}
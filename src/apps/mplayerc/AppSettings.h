@@ -54,11 +54,13 @@
 #define CLSW_CD					(1 << 12)
 #define CLSW_ADD				(1 << 13)
 #define CLSW_MINIMIZED			(1 << 14)
+#define CLSW_THUMBNAILS			(1 << 15)
 
 #define CLSW_REGEXTVID			(1 << 16)
 #define CLSW_REGEXTAUD			(1 << 17)
 #define CLSW_REGEXTPL			(1 << 18)
 #define CLSW_UNREGEXT			(1 << 19)
+#define CLSW_SCANBENCH			(1 << 20)
 
 #define CLSW_STARTVALID			(1 << 21)
 #define CLSW_NOFOCUS			(1 << 22)
@@ -373,6 +375,8 @@ public:
 		iMinQueuePackets = MINQUEUEPACKETS;
 		iMaxQueuePackets = MAXQUEUEPACKETS;
 
+		iTimeShift = 0;
+
 		fDefault = TRUE;
 	};
 
@@ -390,11 +394,14 @@ public:
 		iMinQueuePackets = max(10, min(MAXQUEUEPACKETS, AfxGetApp()->GetProfileInt(IDS_R_SETTINGS IDS_R_PERFOMANCE, IDS_RS_PERFOMANCE_MINQUEUEPACKETS, MINQUEUEPACKETS)));
 		iMaxQueuePackets = max(iMinQueuePackets*2, min(MAXQUEUEPACKETS*10, AfxGetApp()->GetProfileInt(IDS_R_SETTINGS IDS_R_PERFOMANCE, IDS_RS_PERFOMANCE_MAXQUEUEPACKETS, MAXQUEUEPACKETS)));
 
+		iTimeShift = min(MAXTIMESHIFT, AfxGetApp()->GetProfileInt(IDS_R_SETTINGS IDS_R_PERFOMANCE, IDS_RS_PERFOMANCE_TIMESHIFT, 0));
+
 		fDefault = (iCacheLen == DEFAULT_CACHE_LENGTH
 					&& iMinQueueSize == MINQUEUESIZE
 					&& iMaxQueueSize == MAXQUEUESIZE
 					&& iMinQueuePackets == MINQUEUEPACKETS
-					&& iMaxQueuePackets == MAXQUEUEPACKETS);
+					&& iMaxQueuePackets == MAXQUEUEPACKETS
+					&& iTimeShift == 0);
 	};
 
 	void SaveSettings() {
@@ -403,6 +410,7 @@ public:
 		AfxGetApp()->WriteProfileInt(IDS_R_SETTINGS IDS_R_PERFOMANCE, IDS_RS_PERFOMANCE_MAXQUEUESIZE, iMaxQueueSize);
 		AfxGetApp()->WriteProfileInt(IDS_R_SETTINGS IDS_R_PERFOMANCE, IDS_RS_PERFOMANCE_MINQUEUEPACKETS, iMinQueuePackets);
 		AfxGetApp()->WriteProfileInt(IDS_R_SETTINGS IDS_R_PERFOMANCE, IDS_RS_PERFOMANCE_MAXQUEUEPACKETS, iMaxQueuePackets);
+		AfxGetApp()->WriteProfileInt(IDS_R_SETTINGS IDS_R_PERFOMANCE, IDS_RS_PERFOMANCE_TIMESHIFT, iTimeShift);
 	};
 
 	void UpdateStatus() {
@@ -410,12 +418,14 @@ public:
 					&& iMinQueueSize == MINQUEUESIZE
 					&& iMaxQueueSize == MAXQUEUESIZE
 					&& iMinQueuePackets == MINQUEUEPACKETS
-					&& iMaxQueuePackets == MAXQUEUEPACKETS);
+					&& iMaxQueuePackets == MAXQUEUEPACKETS
+					&& iTimeShift == 0);
 	}
 
 	DWORD iCacheLen;
 	DWORD iMinQueueSize, iMaxQueueSize;
 	DWORD iMinQueuePackets, iMaxQueuePackets;
+	DWORD iTimeShift;
 
 	BOOL fDefault;
 };
@@ -471,6 +481,14 @@ public:
 	int				iAdminOption;
 	int				iDXVer;
 
+	// /thumbnails output file, worker graphs (0 - one per core) and the benchmark run
+	CString			strThumbnailsDst;
+	int				iThumbnailsWorkers;
+	bool			fThumbnailsBench;
+
+	// /scanbench, the number of generated files
+	int				iScanBenchFiles;
+
 
 	// Player
 	int				iMultipleInst;
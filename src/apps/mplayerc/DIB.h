@@ -25,6 +25,9 @@
 
 using namespace Gdiplus;
 
+// DIB rows are DWORD aligned
+#define DIBPITCH(bih) (((bih)->biWidth * (bih)->biBitCount + 31) / 32 * 4)
+
 static int GetEncoderClsid(CStringW format, CLSID* pClsid)
 {
 	UINT num = 0, size = 0;
@@ -85,14 +88,15 @@ static bool BMPDIB(LPCTSTR fn, BYTE* pData, CStringW format, ULONG quality, bool
 	BITMAPINFOHEADER* bih = (BITMAPINFOHEADER*)pData;
 
 	int bit = 24, width = bih->biWidth, height = abs(bih->biHeight), bpp = bih->biBitCount / 8;
-	int stride = (width * bit + 31) / 32 * bpp, sih = sizeof(BITMAPINFOHEADER);
+	int stride = (width * bit + 31) / 32 * 4, sih = sizeof(BITMAPINFOHEADER);
+	int pitch = DIBPITCH(bih);
 	DWORD len = stride * height;
 
 	BYTE *src = pData + sih, *rgb = (BYTE*)malloc(len);
 
 	for (int y = 0; y < height; y++) {
 		for (int x = 0; x < width; x++) {
-			memcpy(rgb + (3 * x) + (stride * y), src + (width * bpp * y) + (bpp * x), 3);
+			memcpy(rgb + (3 * x) + (stride * y), src + (pitch * y) + (bpp * x), 3);
 		}
 	}
 
@@ -151,6 +155,7 @@ static void PNGDIB(LPCTSTR fn, BYTE* pData, int level)
 		BITMAPINFOHEADER* bih = (BITMAPINFOHEADER*)pData;
 
 		int line, width = bih->biWidth, height = abs(bih->biHeight), bpp = bih->biBitCount / 8;
+		int pitch = DIBPITCH(bih);
 
 		png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, 0, 0, 0);
 		png_infop info_ptr = png_create_info_struct(png_ptr);
@@ -166,7 +171,7 @@ static void PNGDIB(LPCTSTR fn, BYTE* pData, int level)
 		for (int y = height - 1; y >= 0; y--) {
 			for (int x = 0; x < width; x++) {
 				line = (3 * x);
-				p = src + (width * bpp * y) + (bpp * x);
+				p = src + (pitch * y) + (bpp * x);
 				row_ptr[line] = (png_byte)p[2];
 				row_ptr[line + 1] = (png_byte)p[1];
 				row_ptr[line + 2] = (png_byte)p[0];
@@ -194,6 +199,7 @@ static void WebPDIB(LPCTSTR fn, BYTE* pData, float quality)
 		BITMAPINFOHEADER* bih = (BITMAPINFOHEADER*)pData;
 
 		int width = bih->biWidth, height = abs(bih->biHeight), bpp = bih->biBitCount / 8;
+		int pitch = DIBPITCH(bih);
 		DWORD line, stride = width * 3 * sizeof(uint8_t);
 
 		uint8_t* rgb = (uint8_t*)malloc(stride * height);
@@ -202,7 +208,7 @@ static void WebPDIB(LPCTSTR fn, BYTE* pData, float quality)
 		for (int y = 0, j = height - 1; y < height; y++, j--) {
 			for (int x = 0; x < width; x++) {
 				line = (3 * x) + (stride * j);
-				p = src + (width * bpp * y) + (bpp * x);
+				p = src + (pitch * y) + (bpp * x);
 				rgb[line] = (uint8_t)p[2];
 				rgb[line + 1] = (uint8_t)p[1];
 				rgb[line + 2] = (uint8_t)p[0];
@@ -235,3 +241,23 @@ static void WebPDIB(LPCTSTR fn, BYTE* pData, float quality)
 		WebPPictureFree(&picture);
 	}
 }
+
+// the format is chosen by the extension of fn
+static void SaveDIBFile(LPCTSTR fn, BYTE* pData, ULONG quality, int level)
+{
+	CString ext = CString(PathFindExtension(fn)).MakeLower();
+
+	if (ext == _T(".bmp")) {
+		BMPDIB(fn, pData, L"", 0, 0, 0, 0);
+	} else if (ext == _T(".png")) {
+		PNGDIB(fn, pData, max(1, min(9, level)));
+	} else if (ext == _T(".jpg")) {
+		BMPDIB(fn, pData, L"image/jpeg", quality, 0, 0, 0);
+	} else if (ext == _T(".webp")) {
+		WebPDIB(fn, pData, (float)quality);
+	} else if (ext == _T(".webpll")) {
+		WebPDIB(fn, pData, 0);
+	} else if (ext == _T(".tif")) {
+		BMPDIB(fn, pData, L"image/tiff", quality, 0, 0, 0);
+	}
+}
@@ -28,6 +28,7 @@
 #include <SyncAllocatorPresenter.h>
 #include <madVRAllocatorPresenter.h>
 #include "DeinterlacerFilter.h"
+#include "KeyFrameGrabber.h"
 #include "../../DSUtil/SysVersion.h"
 #include "../../DSUtil/FileVersionInfo.h"
 #include "../../filters/transform/DeCSSFilter/VobFile.h"
@@ -2838,6 +2839,10 @@ CFGManagerPlayer::CFGManagerPlayer(LPCTSTR pName, LPUNKNOWN pUnk, HWND hWnd, boo
 				m_transform.AddTail(pFGF);
 				break;
 		}
+	} else if (!m_hWnd) {
+		pFGF = DNew CFGFilterInternal<CFrameGrabberRenderer>(L"Frame Grabber", MERIT64_ABOVE_DSHOW+2);
+		pFGF->AddType(MEDIATYPE_Video, MEDIASUBTYPE_RGB32);
+		m_transform.AddTail(pFGF);
 	} else {
 		if (IsWinVistaOrLater()) {
 			m_transform.AddTail(DNew CFGFilterVideoRenderer(m_hWnd, CLSID_EnhancedVideoRenderer, L"EVR - Preview Window", MERIT64_ABOVE_DSHOW+2));
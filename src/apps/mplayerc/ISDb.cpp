@@ -23,12 +23,90 @@
 #include <atlpath.h>
 #include "ISDb.h"
 
-bool mpc_filehash(LPCTSTR fn, filehash& fh)
+#define HASH_CHUNK		65536
+#define HASH_MEMO_MAX	4096
+
+// sums the 8 byte words like the former CFile::Read() loop did,
+// a short last read only overwrites the low bytes of the previous word
+static UINT64 SumWords(const BYTE* data, DWORD len)
 {
-	CFile f;
-	CFileException fe;
+	UINT64 sum = 0, tmp = 0;
+	for (DWORD pos = 0; pos < len; pos += sizeof(tmp)) {
+		memcpy(&tmp, data + pos, min(sizeof(tmp), len - pos));
+		sum += tmp;
+	}
+	return sum;
+}
+
+// reads the head and the tail of the file with two overlapped requests
+static bool ComputeFileHash(LPCTSTR fn, UINT64& size, UINT64& hash)
+{
+	HANDLE hFile = CreateFile(fn, GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED|FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
 
-	if (!f.Open(fn, CFile::modeRead|CFile::osSequentialScan|CFile::shareDenyNone, &fe)) {
+	LARGE_INTEGER li;
+	CAutoVectorPtr<BYTE> buff;
+	if (!GetFileSizeEx(hFile, &li) || !buff.Allocate(2 * HASH_CHUNK)) {
+		CloseHandle(hFile);
+		return false;
+	}
+
+	size = li.QuadPart;
+	const UINT64 tail = size > HASH_CHUNK ? size - HASH_CHUNK : 0;
+
+	OVERLAPPED ov[2];
+	memset(ov, 0, sizeof(ov));
+	ov[1].Offset		= (DWORD)tail;
+	ov[1].OffsetHigh	= (DWORD)(tail >> 32);
+
+	bool bPending[2] = {false, false};
+	bool bResult = true;
+	DWORD len[2] = {0, 0};
+
+	for (int i = 0; i < 2; i++) {
+		ov[i].hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+		if (!ov[i].hEvent) {
+			bResult = false;
+			break;
+		}
+		if (ReadFile(hFile, buff + i * HASH_CHUNK, HASH_CHUNK, NULL, &ov[i]) || GetLastError() == ERROR_IO_PENDING) {
+			bPending[i] = true;
+		} else if (GetLastError() != ERROR_HANDLE_EOF) {
+			bResult = false;
+		}
+	}
+
+	for (int i = 0; i < 2; i++) {
+		if (bPending[i] && !GetOverlappedResult(hFile, &ov[i], &len[i], TRUE) && GetLastError() != ERROR_HANDLE_EOF) {
+			bResult = false;
+		}
+		if (ov[i].hEvent) {
+			CloseHandle(ov[i].hEvent);
+		}
+	}
+
+	CloseHandle(hFile);
+
+	if (bResult) {
+		hash = size + SumWords(buff, len[0]) + SumWords(buff + HASH_CHUNK, len[1]);
+	}
+
+	return bResult;
+}
+
+struct hashentry {
+	UINT64 size, mtime, hash;
+};
+
+static CCritSec s_csHashes;
+static CAtlMap<CString, hashentry, CStringElementTraitsI<CString> > s_hashes;
+
+bool mpc_filehash(LPCTSTR fn, filehash& fh)
+{
+	WIN32_FILE_ATTRIBUTE_DATA fad;
+	if (!GetFileAttributesEx(fn, GetFileExInfoStandard, &fad) || (fad.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
 		return false;
 	}
 
@@ -36,27 +114,68 @@ bool mpc_filehash(LPCTSTR fn, filehash& fh)
 	p.StripPath();
 	fh.name = (LPCTSTR)p;
 
-	fh.size = f.GetLength();
+	hashentry he;
+	he.size		= ((UINT64)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
+	he.mtime	= ((UINT64)fad.ftLastWriteTime.dwHighDateTime << 32) | fad.ftLastWriteTime.dwLowDateTime;
 
-	fh.mpc_filehash = fh.size;
+	{
+		CAutoLock cAutoLock(&s_csHashes);
 
-	for (UINT64 tmp = 0, i = 0; i < 65536/sizeof(tmp) && f.Read(&tmp, sizeof(tmp)); fh.mpc_filehash += tmp, i++) {
-		;
+		const CAtlMap<CString, hashentry, CStringElementTraitsI<CString> >::CPair* pPair = s_hashes.Lookup(fn);
+		if (pPair && pPair->m_value.size == he.size && pPair->m_value.mtime == he.mtime) {
+			fh.size			= pPair->m_value.size;
+			fh.mpc_filehash	= pPair->m_value.hash;
+			return true;
+		}
+	}
+
+	if (!ComputeFileHash(fn, fh.size, fh.mpc_filehash)) {
+		return false;
 	}
 
-	f.Seek(max(0, (INT64)fh.size - 65536), CFile::begin);
+	if (fh.size == he.size) {
+		he.hash = fh.mpc_filehash;
 
-	for (UINT64 tmp = 0, i = 0; i < 65536/sizeof(tmp) && f.Read(&tmp, sizeof(tmp)); fh.mpc_filehash += tmp, i++) {
-		;
+		CAutoLock cAutoLock(&s_csHashes);
+
+		if (s_hashes.GetCount() >= HASH_MEMO_MAX) {
+			s_hashes.RemoveAll();
+		}
+		s_hashes[fn] = he;
 	}
 
 	return true;
 }
 
+struct hashjob_t {
+	CAtlArray<CString>	fns;
+	CAtlArray<filehash>	fhs;
+	CAtlArray<bool>		results;
+	volatile LONG		next;
+};
+
+static DWORD WINAPI HashThread(LPVOID lpParameter)
+{
+	hashjob_t* p = (hashjob_t*)lpParameter;
+
+	for (;;) {
+		const LONG i = InterlockedIncrement(&p->next) - 1;
+		if (i >= (LONG)p->fns.GetCount()) {
+			break;
+		}
+		p->results[i] = mpc_filehash(p->fns[i], p->fhs[i]);
+	}
+
+	return 0;
+}
+
 void mpc_filehash(CPlaylist& pl, CList<filehash>& fhs)
 {
 	fhs.RemoveAll();
 
+	hashjob_t job;
+	job.next = 0;
+
 	POSITION pos = pl.GetHeadPosition();
 
 	while (pos) {
@@ -66,13 +185,37 @@ void mpc_filehash(CPlaylist& pl, CList<filehash>& fhs)
 			continue;
 		}
 
-		filehash fh;
+		job.fns.Add(fn);
+	}
 
-		if (!mpc_filehash(fn, fh)) {
-			continue;
+	job.fhs.SetCount(job.fns.GetCount());
+	job.results.SetCount(job.fns.GetCount());
+
+	// the files are hashed concurrently, the list keeps the playlist order
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	const DWORD nThreads = min(max(si.dwNumberOfProcessors, 1UL), min(8UL, (DWORD)job.fns.GetCount()));
+
+	CAtlArray<HANDLE> threads;
+	for (DWORD i = 1; i < nThreads; i++) {
+		HANDLE hThread = ::CreateThread(NULL, 0, HashThread, &job, 0, NULL);
+		if (hThread) {
+			threads.Add(hThread);
+		}
+	}
+	HashThread(&job);
+
+	if (threads.GetCount()) {
+		WaitForMultipleObjects((DWORD)threads.GetCount(), threads.GetData(), TRUE, INFINITE);
+		for (size_t i = 0; i < threads.GetCount(); i++) {
+			CloseHandle(threads[i]);
 		}
+	}
 
-		fhs.AddTail(fh);
+	for (size_t i = 0; i < job.fns.GetCount(); i++) {
+		if (job.results[i]) {
+			fhs.AddTail(job.fhs[i]);
+		}
 	}
 }
 
@@ -0,0 +1,287 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include "KeyFrameGrabber.h"
+#include "../../DSUtil/DSUtil.h"
+#include <IKeyFrameInfo.h>
+#include <moreuuids.h>
+
+//
+// CFrameGrabberRenderer
+//
+
+CFrameGrabberRenderer::CFrameGrabberRenderer(LPUNKNOWN pUnk, HRESULT* phr)
+	: CBaseRenderer(__uuidof(this), NAME("CFrameGrabberRenderer"), pUnk, phr)
+	, m_nFrameSize(0)
+	, m_evFrame(TRUE)
+{
+	memset(&m_bih, 0, sizeof(m_bih));
+}
+
+HRESULT CFrameGrabberRenderer::CheckMediaType(const CMediaType* pmt)
+{
+	return pmt->majortype == MEDIATYPE_Video && pmt->subtype == MEDIASUBTYPE_RGB32
+		   && (pmt->formattype == FORMAT_VideoInfo || pmt->formattype == FORMAT_VideoInfo2)
+		   ? S_OK
+		   : E_FAIL;
+}
+
+HRESULT CFrameGrabberRenderer::SetMediaType(const CMediaType* pmt)
+{
+	CAutoLock cAutoLock(&m_csFrame);
+
+	BITMAPINFOHEADER bih;
+	if (!ExtractBIH(pmt, &bih) || bih.biWidth <= 0 || bih.biHeight == 0) {
+		return E_FAIL;
+	}
+
+	// the decoder may pad the width, the picture is in rcTarget then
+	const RECT* rcTarget = pmt->formattype == FORMAT_VideoInfo2
+						   ? &((VIDEOINFOHEADER2*)pmt->pbFormat)->rcTarget
+						   : &((VIDEOINFOHEADER*)pmt->pbFormat)->rcTarget;
+	m_bih = bih;
+	if (rcTarget->right > rcTarget->left && rcTarget->right <= bih.biWidth) {
+		m_bih.biWidth = rcTarget->right - rcTarget->left;
+	}
+	m_dar.SetSize(m_bih.biWidth, abs(m_bih.biHeight));
+	if (pmt->formattype == FORMAT_VideoInfo2) {
+		const VIDEOINFOHEADER2* vih2 = (VIDEOINFOHEADER2*)pmt->pbFormat;
+		if (vih2->dwPictAspectRatioX && vih2->dwPictAspectRatioY) {
+			m_dar.SetSize(vih2->dwPictAspectRatioX, vih2->dwPictAspectRatioY);
+		}
+	}
+	m_nFrameSize = bih.biWidth * abs(bih.biHeight) * 4;
+	m_pFrame.Free();
+
+	return __super::SetMediaType(pmt);
+}
+
+void CFrameGrabberRenderer::Grab(IMediaSample* pSample)
+{
+	CAutoLock cAutoLock(&m_csFrame);
+
+	BYTE* src = NULL;
+	if (!m_nFrameSize || FAILED(pSample->GetPointer(&src)) || pSample->GetActualDataLength() < m_nFrameSize) {
+		return;
+	}
+
+	const int w		= m_bih.biWidth;
+	const int h		= abs(m_bih.biHeight);
+	const int pitch	= m_nFrameSize / h;
+
+	if (!m_pFrame) {
+		if (!m_pFrame.Allocate(sizeof(BITMAPINFOHEADER) + w * h * 4)) {
+			return;
+		}
+	}
+
+	BITMAPINFOHEADER* bih = (BITMAPINFOHEADER*)(BYTE*)m_pFrame;
+	memset(bih, 0, sizeof(BITMAPINFOHEADER));
+	bih->biSize			= sizeof(BITMAPINFOHEADER);
+	bih->biWidth		= w;
+	bih->biHeight		= h;
+	bih->biPlanes		= 1;
+	bih->biBitCount		= 32;
+	bih->biCompression	= BI_RGB;
+	bih->biSizeImage	= w * h * 4;
+
+	// bottom-up like the DIBs of the renderers
+	BYTE* dst = (BYTE*)(bih + 1);
+	for (int y = 0; y < h; y++, dst += w * 4) {
+		const int row = m_bih.biHeight > 0 ? y : h - 1 - y;
+		memcpy(dst, src + pitch * row, w * 4);
+	}
+
+	m_evFrame.Set();
+}
+
+HRESULT CFrameGrabberRenderer::DoRenderSample(IMediaSample* pSample)
+{
+	Grab(pSample);
+	return S_OK;
+}
+
+void CFrameGrabberRenderer::OnReceiveFirstSample(IMediaSample* pSample)
+{
+	Grab(pSample);
+}
+
+HRESULT CFrameGrabberRenderer::BeginFlush()
+{
+	m_evFrame.Reset();
+	return __super::BeginFlush();
+}
+
+bool CFrameGrabberRenderer::GetFrame(BYTE** ppDIB, DWORD dwTimeout, HANDLE hAbort)
+{
+	CheckPointer(ppDIB, false);
+
+	HANDLE hEvents[] = {m_evFrame, hAbort};
+	if (WaitForMultipleObjects(hAbort ? 2 : 1, hEvents, FALSE, dwTimeout) != WAIT_OBJECT_0) {
+		return false;
+	}
+
+	CAutoLock cAutoLock(&m_csFrame);
+
+	if (!m_pFrame) {
+		return false;
+	}
+
+	const BITMAPINFOHEADER* bih = (BITMAPINFOHEADER*)(BYTE*)m_pFrame;
+	const size_t size = sizeof(BITMAPINFOHEADER) + bih->biSizeImage;
+	*ppDIB = DNew BYTE[size];
+	memcpy(*ppDIB, m_pFrame, size);
+
+	return true;
+}
+
+bool CFrameGrabberRenderer::GetVideoSize(CSize& size, CSize& dar)
+{
+	CAutoLock cAutoLock(&m_csFrame);
+
+	if (!m_nFrameSize) {
+		return false;
+	}
+
+	size.SetSize(m_bih.biWidth, abs(m_bih.biHeight));
+	dar = m_dar;
+
+	return true;
+}
+
+//
+// CKeyFrameGrabber
+//
+
+CKeyFrameGrabber::CKeyFrameGrabber()
+	: m_pGrabber(NULL)
+{
+}
+
+CKeyFrameGrabber::~CKeyFrameGrabber()
+{
+	Close();
+}
+
+HRESULT CKeyFrameGrabber::Open(LPCTSTR fn)
+{
+	Close();
+
+	// without a window the preview graph renders into CFrameGrabberRenderer
+	m_pGB = DNew CFGManagerPlayer(_T("CFGManagerPlayer"), NULL, NULL, true);
+
+	HRESULT hr = m_pGB->RenderFile(CStringW(fn), NULL);
+	if (FAILED(hr)) {
+		Close();
+		return hr;
+	}
+
+	BeginEnumFilters(m_pGB, pEF, pBF) {
+		if (GetCLSID(pBF) == __uuidof(CFrameGrabberRenderer)) {
+			m_pGrabberBF	= pBF;
+			m_pGrabber		= static_cast<CFrameGrabberRenderer*>((IBaseFilter*)pBF);
+			break;
+		}
+	}
+	EndEnumFilters;
+
+	m_pMC = m_pGB;
+	m_pMS = m_pGB;
+
+	if (!m_pGrabber || !m_pMC || !m_pMS || FAILED(m_pMC->Pause())) {
+		Close();
+		return VFW_E_CANNOT_RENDER;
+	}
+
+	return S_OK;
+}
+
+void CKeyFrameGrabber::Close()
+{
+	if (m_pMC) {
+		m_pMC->Stop();
+	}
+
+	m_pGrabber = NULL;
+	m_pGrabberBF.Release();
+	m_pMS.Release();
+	m_pMC.Release();
+	m_pGB.Release();
+}
+
+REFERENCE_TIME CKeyFrameGrabber::GetDuration()
+{
+	REFERENCE_TIME rtDur = 0;
+	if (!m_pMS || FAILED(m_pMS->GetDuration(&rtDur))) {
+		return 0;
+	}
+
+	return rtDur;
+}
+
+bool CKeyFrameGrabber::GetVideoSize(CSize& size, CSize& dar)
+{
+	return m_pGrabber && m_pGrabber->GetVideoSize(size, dar);
+}
+
+bool CKeyFrameGrabber::GetKeyFrames(CAtlArray<REFERENCE_TIME>& kfs)
+{
+	kfs.RemoveAll();
+
+	if (!m_pGB) {
+		return false;
+	}
+
+	CComQIPtr<IKeyFrameInfo> pKFI;
+	BeginEnumFilters(m_pGB, pEF, pBF) {
+		if (pKFI = pBF) {
+			break;
+		}
+	}
+	EndEnumFilters;
+
+	UINT nKFs = 0;
+	if (!pKFI || S_OK != pKFI->GetKeyFrameCount(nKFs) || nKFs == 0) {
+		return false;
+	}
+
+	UINT k = nKFs;
+	if (!kfs.SetCount(k) || S_OK != pKFI->GetKeyFrames(&TIME_FORMAT_MEDIA_TIME, kfs.GetData(), k) || k != nKFs) {
+		kfs.RemoveAll();
+		return false;
+	}
+
+	return true;
+}
+
+bool CKeyFrameGrabber::GetFrame(REFERENCE_TIME rt, BYTE** ppDIB, DWORD dwTimeout, HANDLE hAbort)
+{
+	if (!m_pGrabber) {
+		return false;
+	}
+
+	// seeking flushes the renderer, the paused graph delivers the new frame after that
+	if (FAILED(m_pMS->SetPositions(&rt, AM_SEEKING_AbsolutePositioning, NULL, AM_SEEKING_NoPositioning))) {
+		return false;
+	}
+
+	return m_pGrabber->GetFrame(ppDIB, dwTimeout, hAbort);
+}
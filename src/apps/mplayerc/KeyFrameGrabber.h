@@ -0,0 +1,80 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <atlcoll.h>
+#include "FGManager.h"
+
+// Video renderer of headless preview graphs, keeps a copy of the last 32 bit frame.
+// In a paused graph that is the frame shown after a seek.
+
+class __declspec(uuid("A77877AC-4F63-4269-8A64-AD8610FF1F4F"))
+	CFrameGrabberRenderer : public CBaseRenderer
+{
+	CCritSec				m_csFrame;
+	BITMAPINFOHEADER		m_bih;
+	CSize					m_dar;
+	CAutoVectorPtr<BYTE>	m_pFrame;
+	long					m_nFrameSize;
+	CAMEvent				m_evFrame;
+
+	void Grab(IMediaSample* pSample);
+
+protected:
+	HRESULT CheckMediaType(const CMediaType* pmt);
+	HRESULT SetMediaType(const CMediaType* pmt);
+	HRESULT DoRenderSample(IMediaSample* pSample);
+	void OnReceiveFirstSample(IMediaSample* pSample);
+	HRESULT BeginFlush();
+
+public:
+	CFrameGrabberRenderer(LPUNKNOWN pUnk, HRESULT* phr);
+
+	// waits for the first frame after the last flush, returns a DIB allocated with new []
+	bool GetFrame(BYTE** ppDIB, DWORD dwTimeout, HANDLE hAbort = NULL);
+	bool GetVideoSize(CSize& size, CSize& dar);
+};
+
+// Opens a file in its own preview graph to grab frames independent of playback.
+// All calls have to come from the thread that called Open, with COM initialized.
+
+class CKeyFrameGrabber
+{
+	CComPtr<IGraphBuilder2>		m_pGB;
+	CComQIPtr<IMediaControl>	m_pMC;
+	CComQIPtr<IMediaSeeking>	m_pMS;
+	CComPtr<IBaseFilter>		m_pGrabberBF;
+	CFrameGrabberRenderer*		m_pGrabber;
+
+public:
+	CKeyFrameGrabber();
+	~CKeyFrameGrabber();
+
+	HRESULT Open(LPCTSTR fn);
+	void Close();
+
+	REFERENCE_TIME GetDuration();
+	bool GetVideoSize(CSize& size, CSize& dar);
+	bool GetKeyFrames(CAtlArray<REFERENCE_TIME>& kfs);
+
+	// the frame at rt, or after the keyframe before it, as a DIB allocated with new []
+	bool GetFrame(REFERENCE_TIME rt, BYTE** ppDIB, DWORD dwTimeout = 5000, HANDLE hAbort = NULL);
+};
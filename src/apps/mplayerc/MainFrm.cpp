@@ -211,6 +211,7 @@ BEGIN_MESSAGE_MAP(CMainFrame, CFrameWnd)
 	ON_MESSAGE(WM_REARRANGERENDERLESS, OnRepaintRenderLess)
 
 	ON_MESSAGE(WM_POSTOPEN, OnPostOpen)
+	ON_MESSAGE(WM_THUMBNAILS_SAVED, OnThumbnailsSaved)
 
 	ON_WM_LBUTTONDOWN()
 	ON_WM_NCLBUTTONDOWN()
@@ -698,6 +699,9 @@ CMainFrame::CMainFrame() :
 	m_bIsBDPlay(FALSE),
 	m_fClosingState(false),
 	b_UseSmartSeek(false),
+	m_nPreviewPos(-1),
+	m_rtPreviewStep(0),
+	m_pPreviewTile(NULL),
 	m_flastnID(0),
 	bDVDMenuClicked(false),
 	m_bfirstPlay(false),
@@ -989,6 +993,8 @@ void CMainFrame::OnDestroy()
 
 	m_fileDropTarget.Revoke();
 
+	m_pThumbnailSheet.Free();
+
 	if ( m_pGraphThread ) {
 		CAMEvent e;
 		m_pGraphThread->PostThreadMessage(CGraphThread::TM_EXIT, 0, (LPARAM)&e);
@@ -2160,6 +2166,13 @@ void CMainFrame::OnTimer(UINT_PTR nIDEvent)
 {
 	switch (nIDEvent) {
 
+		case TIMER_APIUPDATE:
+			SendUpdateToApi();
+			break;
+		case TIMER_PREVIEW:
+			// the worker of m_PreviewCache may have decoded a closer tile meanwhile
+			ShowPreviewTile();
+			break;
 		case TIMER_EXCLUSIVEBARHIDER:
 			if (m_pFullscreenWnd->IsWindow()) {
 				CPoint p;
@@ -6105,22 +6118,13 @@ void CMainFrame::SaveDIB(LPCTSTR fn, BYTE* pData, long size)
 {
 	AppSettings& s = AfxGetAppSettings();
 
-	CString ext = GetFileExt(fn).MakeLower();
+	SaveDIBFile(fn, pData, s.iThumbQuality, s.iThumbLevelPNG);
 
-	if (ext == _T(".bmp")) {
-		BMPDIB(fn, pData, L"", 0, 0, 0, 0);
-	} else if (ext == _T(".png")) {
-		PNGDIB(fn, pData, max(1, min(9, s.iThumbLevelPNG)));
-	} else if (ext == _T(".jpg")) {
-		BMPDIB(fn, pData, L"image/jpeg", s.iThumbQuality, 0, 0, 0);
-	} else if (ext == _T(".webp")) {
-		WebPDIB(fn, pData, s.iThumbQuality);
-	} else if (ext == _T(".webpll")) {
-		WebPDIB(fn, pData, 0);
-	} else if (ext == _T(".tif")) {
-		BMPDIB(fn, pData, L"image/tiff", s.iThumbQuality, 0, 0, 0);
-	}
+	SendSavedStatusMessage(fn);
+}
 
+void CMainFrame::SendSavedStatusMessage(LPCTSTR fn)
+{
 	CString fName(fn);
 	fName.Replace(_T("\\\\"), _T("\\"));
 
@@ -6151,288 +6155,40 @@ void CMainFrame::SaveImage(LPCTSTR fn)
 
 void CMainFrame::SaveThumbnails(LPCTSTR fn)
 {
-	if (!m_pMC || !m_pMS || GetPlaybackMode() != PM_FILE /*&& GetPlaybackMode() != PM_DVD*/) {
-		return;
-	}
-
-	REFERENCE_TIME rtPos = GetPos();
-	REFERENCE_TIME rtDur = GetDur();
-
-	if (rtDur <= 0) {
-		AfxMessageBox(ResStr(IDS_MAINFRM_54));
-		return;
-	}
-
-	//pMC->Pause();
-
-	if (GetMediaState() != State_Paused) {
-		SendMessage(WM_COMMAND, ID_PLAY_PAUSE);
-	}
-	GetMediaState(); // wait for completion of the pause command
-
-	//
-
-	CSize framesize, dar;
-
-	if (m_pMFVDC) {
-		m_pMFVDC->GetNativeVideoSize(&framesize, &dar);
-	} else if (m_pCAP) {
-		framesize = m_pCAP->GetVideoSize(false);
-		dar = m_pCAP->GetVideoSize(true);
-	} else {
-		m_pBV->GetVideoSize(&framesize.cx, &framesize.cy);
-
-		long arx = 0, ary = 0;
-		CComQIPtr<IBasicVideo2> pBV2 = m_pBV;
-		if (pBV2 && SUCCEEDED(pBV2->GetPreferredAspectRatio(&arx, &ary)) && arx > 0 && ary > 0) {
-			dar.SetSize(arx, ary);
-		}
-	}
-
-	if (framesize.cx <= 0 || framesize.cy <= 0) {
-		AfxMessageBox(ResStr(IDS_MAINFRM_55));
+	if (GetPlaybackMode() != PM_FILE /*&& GetPlaybackMode() != PM_DVD*/ || m_pThumbnailSheet) {
 		return;
 	}
 
-	// with the overlay mixer IBasicVideo2 won't tell the new AR when changed dynamically
-	DVD_VideoAttributes VATR;
-	if (GetPlaybackMode() == PM_DVD && SUCCEEDED(m_pDVDI->GetCurrentVideoAttributes(&VATR))) {
-		dar.SetSize(VATR.ulAspectX, VATR.ulAspectY);
-	}
-
-	if (dar.cx > 0 && dar.cy > 0) {
-		framesize.cx = MulDiv(framesize.cy, dar.cx, dar.cy);
-	}
-
-	AppSettings& s = AfxGetAppSettings();
-
-	const int infoheight = 70;
-	const int margin	= 10;
-	const int width		= min(max(s.iThumbWidth, 256), 2560);
-	const int cols		= min(max(s.iThumbCols, 1), 10);
-	const int rows		= min(max(s.iThumbRows, 1), 20);
-
-	CSize thumbsize;
-	thumbsize.cx		= (width - margin) / cols - margin;
-	thumbsize.cy		= MulDiv(thumbsize.cx, framesize.cy, framesize.cx);
-
-	const int height	= infoheight + margin + (thumbsize.cy + margin) * rows;
-	const int dibsize	= sizeof(BITMAPINFOHEADER) + width * height * 4;
-
-	CAutoVectorPtr<BYTE> dib;
-	if (!dib.Allocate(dibsize)) {
-		AfxMessageBox(ResStr(IDS_MAINFRM_56));
-		return;
+	CString title = GetFileOnly(GetCurFileName());
+	if (!m_strTitleAlt.IsEmpty()) {
+		title = GetAltFileName();
 	}
 
-	BITMAPINFOHEADER* bih = (BITMAPINFOHEADER*)(BYTE*)dib;
-	memset(bih, 0, sizeof(BITMAPINFOHEADER));
-	bih->biSize			= sizeof(BITMAPINFOHEADER);
-	bih->biWidth		= width;
-	bih->biHeight		= height;
-	bih->biPlanes		= 1;
-	bih->biBitCount		= 32;
-	bih->biCompression	= BI_RGB;
-	bih->biSizeImage	= width * height * 4;
-	memsetd(bih + 1, 0xffffff, bih->biSizeImage);
-
-	SubPicDesc spd;
-	spd.w		= width;
-	spd.h		= height;
-	spd.bpp		= 32;
-	spd.pitch	= -width * 4;
-	spd.vidrect	= CRect(0, 0, width, height);
-	spd.bits	= (BYTE*)(bih + 1) + (width * 4) * (height - 1);
-
-	{
-		BYTE* p = (BYTE*)spd.bits;
-		for (int y = 0; y < spd.h; y++, p += spd.pitch)
-			for (int x = 0; x < spd.w; x++) {
-				((DWORD*)p)[x] = 0x010101 * (0xe0 + 0x08*y/spd.h + 0x18*(spd.w-x)/spd.w);
-			}
+	// the frames come from graphs of the sheet, playback goes on meanwhile
+	m_pThumbnailSheet.Attach(DNew CThumbnailSheet(GetCurFileName(), title, fn));
+	if (!m_pThumbnailSheet->SaveAsync(m_hWnd)) {
+		m_pThumbnailSheet.Free();
 	}
+}
 
-	CCritSec csSubLock;
-	RECT bbox;
-
-	for (int i = 1, pics = cols*rows; i <= pics; i++) {
-		REFERENCE_TIME rt = rtDur * i / (pics+1);
-		DVD_HMSF_TIMECODE hmsf = RT2HMS_r(rt);
-
-		SeekTo(rt);
-
-		m_VolumeBeforeFrameStepping = m_wndToolBar.Volume;
-		m_pBA->put_Volume(-10000);
-
-		// Number of steps you need to do more than one for some decoders.
-		// TODO - maybe need to find another way to get correct frame ???
-		HRESULT hr = m_pFS ? m_pFS->Step(2, NULL) : E_FAIL;
-
-		if (FAILED(hr)) {
-			m_pBA->put_Volume(m_VolumeBeforeFrameStepping);
-			AfxMessageBox(ResStr(IDS_FRAME_STEP_ERROR_RENDERER), MB_ICONEXCLAMATION | MB_OK);
-			return;
-		}
-
-		HANDLE hGraphEvent = NULL;
-		m_pME->GetEventHandle((OAEVENT*)&hGraphEvent);
-
-		while (hGraphEvent && WaitForSingleObject(hGraphEvent, INFINITE) == WAIT_OBJECT_0) {
-			LONG evCode = 0;
-			LONG_PTR evParam1, evParam2;
-			while (m_pME && SUCCEEDED(m_pME->GetEvent(&evCode, &evParam1, &evParam2, 0))) {
-				m_pME->FreeEventParams(evCode, evParam1, evParam2);
-				if (EC_STEP_COMPLETE == evCode) {
-					hGraphEvent = NULL;
-				}
-			}
-		}
-
-		m_pBA->put_Volume(m_VolumeBeforeFrameStepping);
-
-		int col = (i-1)%cols;
-		int row = (i-1)/cols;
-
-		CPoint p(margin + col * (thumbsize.cx + margin), infoheight + margin + row * (thumbsize.cy + margin));
-		CRect r(p, thumbsize);
-
-		CRenderedTextSubtitle rts(&csSubLock);
-		rts.CreateDefaultStyle(0);
-		rts.m_dstScreenSize.SetSize(width, height);
-		STSStyle* style = DNew STSStyle();
-		style->marginRect.SetRectEmpty();
-		rts.AddStyle(_T("thumbs"), style);
-
-		CStringW str;
-		str.Format(L"{\\an7\\1c&Hffffff&\\4a&Hb0&\\bord1\\shad4\\be1}{\\p1}m %d %d l %d %d %d %d %d %d{\\p}",
-				   r.left, r.top, r.right, r.top, r.right, r.bottom, r.left, r.bottom);
-		rts.Add(str, true, 0, 1, _T("thumbs"));
-		str.Format(L"{\\an3\\1c&Hffffff&\\3c&H000000&\\alpha&H80&\\fs16\\b1\\bord2\\shad0\\pos(%d,%d)}%02d:%02d:%02d",
-				   r.right-5, r.bottom-3, hmsf.bHours, hmsf.bMinutes, hmsf.bSeconds);
-		rts.Add(str, true, 1, 2, _T("thumbs"));
-
-		rts.Render(spd, 0, 25, bbox);
-
-		BYTE* pData = NULL;
-		long size = 0;
-		if (!GetDIB(&pData, size)) {
-			return;
-		}
-
-		BITMAPINFO* bi = (BITMAPINFO*)pData;
-
-		if (bi->bmiHeader.biBitCount != 32) {
-			CString str;
-			str.Format(ResStr(IDS_MAINFRM_57), bi->bmiHeader.biBitCount);
-			AfxMessageBox(str);
-			delete [] pData;
-			return;
-		}
-
-		int sw = bi->bmiHeader.biWidth;
-		int sh = abs(bi->bmiHeader.biHeight);
-		int sp = sw*4;
-		const BYTE* src = pData + sizeof(bi->bmiHeader);
-		if (bi->bmiHeader.biHeight >= 0) {
-			src += sp*(sh-1);
-			sp = -sp;
-		}
-
-		int dp = spd.pitch;
-		BYTE* dst = (BYTE*)spd.bits + spd.pitch*r.top + r.left*4;
-
-		for (DWORD h = r.bottom - r.top, y = 0, yd = (sh<<8)/h; h > 0; y += yd, h--) {
-			DWORD yf = y&0xff;
-			DWORD yi = y>>8;
-
-			DWORD* s0 = (DWORD*)(src + (int)yi*sp);
-			DWORD* s1 = (DWORD*)(src + (int)yi*sp + sp);
-			DWORD* d = (DWORD*)dst;
-
-			for (DWORD w = r.right - r.left, x = 0, xd = (sw<<8)/w; w > 0; x += xd, w--) {
-				DWORD xf = x&0xff;
-				DWORD xi = x>>8;
-
-				DWORD c0 = s0[xi];
-				DWORD c1 = s0[xi+1];
-				DWORD c2 = s1[xi];
-				DWORD c3 = s1[xi+1];
-
-				c0 = ((c0&0xff00ff) + ((((c1&0xff00ff) - (c0&0xff00ff)) * xf) >> 8)) & 0xff00ff
-					 | ((c0&0x00ff00) + ((((c1&0x00ff00) - (c0&0x00ff00)) * xf) >> 8)) & 0x00ff00;
-
-				c2 = ((c2&0xff00ff) + ((((c3&0xff00ff) - (c2&0xff00ff)) * xf) >> 8)) & 0xff00ff
-					 | ((c2&0x00ff00) + ((((c3&0x00ff00) - (c2&0x00ff00)) * xf) >> 8)) & 0x00ff00;
-
-				c0 = ((c0&0xff00ff) + ((((c2&0xff00ff) - (c0&0xff00ff)) * yf) >> 8)) & 0xff00ff
-					 | ((c0&0x00ff00) + ((((c2&0x00ff00) - (c0&0x00ff00)) * yf) >> 8)) & 0x00ff00;
-
-				*d++ = c0;
-			}
-
-			dst += dp;
-		}
-
-		rts.Render(spd, 10000, 25, bbox);
-
-		delete [] pData;
+LRESULT CMainFrame::OnThumbnailsSaved(WPARAM wParam, LPARAM lParam)
+{
+	if (!m_pThumbnailSheet) {
+		return 0;
 	}
 
-	{
-		CRenderedTextSubtitle rts(&csSubLock);
-		rts.CreateDefaultStyle(0);
-		rts.m_dstScreenSize.SetSize(width, height);
-		STSStyle* style = DNew STSStyle();
-		style->marginRect.SetRect(margin, margin, margin, height-infoheight-margin);
-		rts.AddStyle(_T("thumbs"), style);
-
-		CStringW str;
-		str.Format(L"{\\an9\\fs%d\\b1\\bord0\\shad0\\1c&Hffffff&}%s", infoheight-10, width >= 550 ? L"MPC-BE" : L"MPC");
-
-		rts.Add(str, true, 0, 1, _T("thumbs"), _T(""), _T(""), CRect(0,0,0,0), -1);
+	const CString fn = m_pThumbnailSheet->GetFileName();
+	m_pThumbnailSheet.Free();
 
-		DVD_HMSF_TIMECODE hmsf = RT2HMS_r(rtDur);
-
-		CStringW fn = GetFileOnly(GetCurFileName());
-		if (!m_strTitleAlt.IsEmpty()) {
-			fn = GetAltFileName();
-		}
-
-		CStringW fs;
-		WIN32_FIND_DATA wfd;
-		HANDLE hFind = FindFirstFile(GetCurFileName(), &wfd);
-		if (hFind != INVALID_HANDLE_VALUE) {
-			FindClose(hFind);
-
-			__int64 size = (__int64(wfd.nFileSizeHigh)<<32)|wfd.nFileSizeLow;
-			const int MAX_FILE_SIZE_BUFFER = 65;
-			WCHAR szFileSize[MAX_FILE_SIZE_BUFFER];
-			StrFormatByteSizeW(size, szFileSize, MAX_FILE_SIZE_BUFFER);
-			CStringW strByteSize;
-			strByteSize.Format(_T("%I64d"), size);
-			for (int i = strByteSize.GetLength() - 3; i > 0; i -= 3) {
-				strByteSize.Insert(i, L'\x00A0');
-			}
-			fs.Format(ResStr(IDS_MAINFRM_58), szFileSize, strByteSize);
-		}
-
-		CStringW ar;
-		if (dar.cx > 0 && dar.cy > 0 && dar.cx != framesize.cx && dar.cy != framesize.cy) {
-			ar.Format(L"(%d:%d)", dar.cx, dar.cy);
-		}
-
-		str.Format(ResStr(IDS_MAINFRM_59),
-				   fn, fs, framesize.cx, framesize.cy, ar, hmsf.bHours, hmsf.bMinutes, hmsf.bSeconds);
-		rts.Add(str, true, 0, 1, _T("thumbs"));
-
-		rts.Render(spd, 0, 25, bbox);
+	if (wParam) {
+		AfxMessageBox(ResStr((UINT)wParam));
+		return 0;
 	}
 
-	SaveDIB(fn, (BYTE*)dib, dibsize);
-
-	SeekTo(rtPos);
-
+	SendSavedStatusMessage(fn);
 	m_OSD.DisplayMessage(OSD_TOPLEFT, ResStr(IDS_OSD_THUMBS_SAVED), 3000);
+
+	return 0;
 }
 
 static CString MakeSnapshotFileName(LPCTSTR prefix)
@@ -6695,6 +6451,7 @@ void CMainFrame::OnUpdateFileSaveThumbnails(CCmdUI* pCmdUI)
 	pCmdUI->Enable(m_iMediaLoadState == MLS_LOADED
 					&& !m_fAudioOnly
 					&& (GetPlaybackMode() == PM_FILE /*|| GetPlaybackMode() == PM_DVD*/)
+					&& !m_pThumbnailSheet
 					&& !GetBufferingProgress(&iProgress));
 	UNREFERENCED_PARAMETER(iProgress);
 
@@ -12051,7 +11808,7 @@ void CMainFrame::MoveVideoWindow(bool fShowStats)
 
 		m_wndView.SetVideoRect(wr);
 
-		if (b_UseSmartSeek && m_wndPreView) {
+		if (b_UseSmartSeek && m_pGB_preview && m_wndPreView) {
 			m_wndPreView.GetVideoRect(&wr2);
 			CRect vr2 = CRect(0,0,0,0);
 
@@ -12545,11 +12302,6 @@ CString CMainFrame::OpenCreateGraphObject(OpenMediaData* pOMD)
 
 		if (!m_fCustomGraph) {
 			m_pGB = DNew CFGManagerPlayer(_T("CFGManagerPlayer"), NULL, m_pVideoWnd->m_hWnd);
-
-			// Graph for preview
-			if (b_UseSmartSeek && m_wndPreView) {
-				m_pGB_preview = DNew CFGManagerPlayer(_T("CFGManagerPlayer"), NULL, m_wndPreView.GetVideoHWND(), true);
-			}
 		}
 	} else if (OpenDVDData* p = dynamic_cast<OpenDVDData*>(pOMD)) {
 		m_pGB = DNew CFGManagerDVD(_T("CFGManagerDVD"), NULL, m_pVideoWnd->m_hWnd);
@@ -12569,7 +12321,8 @@ CString CMainFrame::OpenCreateGraphObject(OpenMediaData* pOMD)
 		return ResStr(IDS_MAINFRM_80);
 	}
 
-	if (!m_pGB_preview) {
+	// files are previewed from m_PreviewCache, which builds its own graph
+	if (!m_pGB_preview && (m_fCustomGraph || !dynamic_cast<OpenFileData*>(pOMD) || !m_wndPreView)) {
 		b_UseSmartSeek = false;
 	}
 
@@ -12583,7 +12336,7 @@ CString CMainFrame::OpenCreateGraphObject(OpenMediaData* pOMD)
 	m_pBA = m_pGB; // audio
 	m_pFS = m_pGB;
 
-	if (b_UseSmartSeek) {
+	if (m_pGB_preview) {
 		m_pGB_preview->AddToROT();
 
 		m_pMC_preview = m_pGB_preview;
@@ -12645,6 +12398,9 @@ HRESULT CMainFrame::PreviewWindowHide()
 		}
 	}
 
+	KillTimer(TIMER_PREVIEW);
+	m_nPreviewPos = -1;
+
 	return hr;
 }
 
@@ -12656,14 +12412,15 @@ HRESULT CMainFrame::PreviewWindowShow(REFERENCE_TIME rtCur2)
 		return E_FAIL;
 	}
 
-	if (!m_kfs.IsEmpty()) {
-		int i = rangebsearch(rtCur2, m_kfs);
-		if (i >= 1 && i < (int)m_kfs.GetCount() - 1) {
-			rtCur2 = m_kfs[i];
-		}
-	}
-
-	if (GetPlaybackMode() == PM_DVD && m_pDVDC_preview) {
+	if (GetPlaybackMode() == PM_FILE) {
+		if (!m_kfs.IsEmpty()) {
+			m_nPreviewPos = rangebsearch(rtCur2, m_kfs);
+		} else if (m_rtPreviewStep > 0) {
+			m_nPreviewPos = (int)((rtCur2 + m_rtPreviewStep / 2) / m_rtPreviewStep);
+		}
+		ShowPreviewTile();
+		SetTimer(TIMER_PREVIEW, 100, NULL);
+	} else if (GetPlaybackMode() == PM_DVD && m_pDVDC_preview) {
 		DVD_PLAYBACK_LOCATION2 Loc, Loc2;
 		double fps = 0;
 
@@ -12721,8 +12478,6 @@ HRESULT CMainFrame::PreviewWindowShow(REFERENCE_TIME rtCur2)
 
 		m_pDVDC_preview->Pause(FALSE);
 		m_pMC_preview->Run();
-	} else if (GetPlaybackMode() == PM_FILE && m_pMS_preview) {
-		hr = m_pMS_preview->SetPositions(&rtCur2, AM_SEEKING_AbsolutePositioning, NULL, AM_SEEKING_NoPositioning);
 	}
 
 	if (FAILED(hr)) {
@@ -12745,6 +12500,42 @@ HRESULT CMainFrame::PreviewWindowShow(REFERENCE_TIME rtCur2)
 	return hr;
 }
 
+#define PREVIEW_POSITIONS	200		// steps of the duration that are previewed when there are no keyframes
+
+void CMainFrame::OpenPreviewCache(LPCTSTR fn)
+{
+	CAtlArray<REFERENCE_TIME> rts;
+	m_rtPreviewStep = 0;
+
+	REFERENCE_TIME rtDur = 0;
+	if (!m_kfs.IsEmpty()) {
+		rts.Copy(m_kfs);
+	} else if (m_pMS && SUCCEEDED(m_pMS->GetDuration(&rtDur)) && rtDur >= PREVIEW_POSITIONS) {
+		m_rtPreviewStep = rtDur / PREVIEW_POSITIONS;
+		rts.SetCount(PREVIEW_POSITIONS);
+		for (size_t i = 0; i < PREVIEW_POSITIONS; i++) {
+			rts[i] = m_rtPreviewStep * i;
+		}
+	}
+
+	CRect r;
+	m_wndPreView.GetVideoRect(&r);
+	m_PreviewCache.Open(fn, rts, r.Width(), r.Height());
+}
+
+void CMainFrame::ShowPreviewTile()
+{
+	const CPreviewCache::tile_t* pTile = m_nPreviewPos >= 0 ? m_PreviewCache.Find(m_nPreviewPos) : NULL;
+	if (pTile != m_pPreviewTile) {
+		m_pPreviewTile = pTile;
+		if (pTile) {
+			m_wndPreView.SetImage(pTile->bits, pTile->w, pTile->h);
+		} else {
+			m_wndPreView.SetImage(NULL, 0, 0);
+		}
+	}
+}
+
 CWnd *CMainFrame::GetModalParent()
 {
 	AppSettings& s = AfxGetAppSettings();
@@ -13013,27 +12804,7 @@ CString CMainFrame::OpenFile(OpenFileData* pOFD)
 			}
 			EndEnumFilters;
 
-			if (!bIsVideo || FAILED(m_pGB_preview->RenderFile(fn, NULL))) {
-				if (m_pGB_preview) {
-					m_pMFVP_preview  = NULL;
-					m_pMFVDC_preview = NULL;
-
-					m_pMC_preview.Release();
-					m_pME_preview.Release();
-					m_pMS_preview.Release();
-					m_pVW_preview.Release();
-					m_pBV_preview.Release();
-					m_pFS_preview.Release();
-
-					if (m_pDVDC_preview) {
-						m_pDVDC_preview.Release();
-						m_pDVDI_preview.Release();
-					}
-
-					m_pGB_preview->RemoveFromROT();
-					m_pGB_preview.Release();
-					m_pGB_preview = NULL;
-				}
+			if (!bIsVideo) {
 				b_UseSmartSeek = false;
 			}
 		}
@@ -13152,6 +12923,9 @@ CString CMainFrame::OpenFile(OpenFileData* pOFD)
 			m_kfs.RemoveAll();
 		}
 	}
+	if (b_UseSmartSeek) {
+		OpenPreviewCache(pOFD->fns.GetHead());
+	}
 
 	SetPlaybackMode(PM_FILE);
 
@@ -13750,7 +13524,7 @@ void CMainFrame::OpenSetupVideo()
 			pWnd->EnableWindow(FALSE); // little trick to let WM_SETCURSOR thru
 		}
 
-		if (b_UseSmartSeek && m_wndPreView) {
+		if (b_UseSmartSeek && m_pVW_preview && m_wndPreView) {
 			m_pVW_preview->put_Owner((OAHWND)m_wndPreView.GetVideoHWND());
 			m_pVW_preview->put_WindowStyle(WS_CHILD|WS_CLIPSIBLINGS|WS_CLIPCHILDREN);
 		}
@@ -14880,27 +14654,49 @@ bool CMainFrame::OpenMediaPrivate(CAutoPtr<OpenMediaData> pOMD)
 			miFPS	= 0.0;
 			s.dFPS	= 0.0;
 
-			MediaInfo MI;
-
-			if (MI.Open(mi_fn.GetString())) {
-				CString strFPS =  MI.Get(Stream_Video, 0, _T("FrameRate"), Info_Text, Info_Name).c_str();
-				if (strFPS.IsEmpty() || wcstod(strFPS, NULL) > 200.0) {
-					strFPS =  MI.Get(Stream_Video, 0, _T("FrameRate_Original"), Info_Text, Info_Name).c_str();
-				}
-				CString strST = MI.Get(Stream_Video, 0, _T("ScanType"), Info_Text, Info_Name).c_str();
-				CString strSO = MI.Get(Stream_Video, 0, _T("ScanOrder"), Info_Text, Info_Name).c_str();
+			bool bFPS = false;
 
-				int nFactor = 1;
+			// the container headers are enough for most files, MediaInfo parses much more
+			VideoProbe probe;
+			if (ProbeVideo(mi_fn, probe)) {
+				// with the precision of MediaInfo
+				miFPS = floor(probe.fps * 1000 + 0.5) / 1000;
 
 				// 2:3 pulldown
-				if (strFPS == _T("29.970") && (strSO == _T("2:3 Pulldown") || (strST == _T("Progressive") && (strSO == _T("TFF") || strSO  == _T("BFF") || strSO  == _T("2:3 Pulldown"))))) {
-					strFPS = _T("23.976");
-				} else if (strST == _T("Interlaced") || strST == _T("MBAFF")) {
+				if (probe.bPulldown && miFPS == 29.970) {
+					miFPS = 23.976;
+				} else if (probe.nInterlaced == 1) {
 					// double fps for Interlaced video.
-					nFactor = 2;
+					miFPS *= 2;
 				}
-				miFPS	= wcstod(strFPS, NULL);
-				miFPS  *= nFactor;
+				bFPS = true;
+			} else {
+				MediaInfo MI;
+
+				if (MI.Open(mi_fn.GetString())) {
+					CString strFPS =  MI.Get(Stream_Video, 0, _T("FrameRate"), Info_Text, Info_Name).c_str();
+					if (strFPS.IsEmpty() || wcstod(strFPS, NULL) > 200.0) {
+						strFPS =  MI.Get(Stream_Video, 0, _T("FrameRate_Original"), Info_Text, Info_Name).c_str();
+					}
+					CString strST = MI.Get(Stream_Video, 0, _T("ScanType"), Info_Text, Info_Name).c_str();
+					CString strSO = MI.Get(Stream_Video, 0, _T("ScanOrder"), Info_Text, Info_Name).c_str();
+
+					int nFactor = 1;
+
+					// 2:3 pulldown
+					if (strFPS == _T("29.970") && (strSO == _T("2:3 Pulldown") || (strST == _T("Progressive") && (strSO == _T("TFF") || strSO  == _T("BFF") || strSO  == _T("2:3 Pulldown"))))) {
+						strFPS = _T("23.976");
+					} else if (strST == _T("Interlaced") || strST == _T("MBAFF")) {
+						// double fps for Interlaced video.
+						nFactor = 2;
+					}
+					miFPS	= wcstod(strFPS, NULL);
+					miFPS  *= nFactor;
+					bFPS	= true;
+				}
+			}
+
+			if (bFPS) {
 				s.dFPS	= miFPS;
 
 				AutoChangeMonitorMode();
@@ -14988,7 +14784,7 @@ bool CMainFrame::OpenMediaPrivate(CAutoPtr<OpenMediaData> pOMD)
 			m_pMFVDC->SetVideoPosition(NULL, &Rect);
 		}
 
-		if (b_UseSmartSeek && m_wndPreView) {
+		if (b_UseSmartSeek && m_pGB_preview && m_wndPreView) {
 			m_pGB_preview->FindInterface(__uuidof(IMFVideoDisplayControl), (void**)&m_pMFVDC_preview, TRUE);
 			m_pGB_preview->FindInterface(__uuidof(IMFVideoProcessor),      (void**)&m_pMFVP_preview,  TRUE);
 
@@ -15137,6 +14933,10 @@ void CMainFrame::CloseMediaPrivate()
 	m_fEndOfStream = false;
 	m_rtDurationOverride = -1;
 	m_kfs.RemoveAll();
+	m_PreviewCache.Close();
+	m_nPreviewPos	= -1;
+	m_rtPreviewStep	= 0;
+	m_pPreviewTile	= NULL;
 	m_pCB.Release();
 
 	{
@@ -15222,9 +15022,11 @@ void CMainFrame::CloseMediaPrivate()
 
 void CMainFrame::ParseDirs(CAtlList<CString>& sl)
 {
+	// RecurseAddDir appends the whole tree, only the original entries are expanded
 	POSITION pos = sl.GetHeadPosition();
+	size_t count = sl.GetCount();
 
-	while (pos) {
+	while (pos && count--) {
 		CString fn = sl.GetNext(pos);
 		WIN32_FIND_DATA fd = {0};
 		HANDLE hFind = FindFirstFile(fn, &fd);
@@ -18779,6 +18581,17 @@ void CMainFrame::ProcessAPICommand(COPYDATASTRUCT* pCDS)
 		case CMD_JUMPOFNSECONDS :
 			JumpOfNSeconds(_wtoi((LPCWSTR)pCDS->lpData));
 			break;
+		case CMD_SUBSCRIBE :
+			if (pCDS->cbData >= sizeof(MPC_SUBSCRIPTION)) {
+				const MPC_SUBSCRIPTION* pSub = (const MPC_SUBSCRIPTION*)pCDS->lpData;
+				m_ApiSubscription.Subscribe(pSub->nFields, pSub->nIntervalMS, GetTickCount());
+				if (m_ApiSubscription.IsActive()) {
+					SetTimer(TIMER_APIUPDATE, m_ApiSubscription.GetInterval(), NULL);
+				} else {
+					KillTimer(TIMER_APIUPDATE);
+				}
+			}
+			break;
 		case CMD_GETPLAYLIST :
 			SendPlaylistToApi();
 			break;
@@ -19065,6 +18878,71 @@ void CMainFrame::SendCurrentPositionToApi(bool fNotifySeek)
 	}
 }
 
+void CMainFrame::SendUpdateToApi()
+{
+	HWND hMasterWnd = AfxGetAppSettings().hMasterWnd;
+
+	if (!hMasterWnd || !m_ApiSubscription.IsActive()) {
+		KillTimer(TIMER_APIUPDATE);
+		return;
+	}
+
+	MPC_UPDATE cur;
+	memset(&cur, 0, sizeof(cur));
+	cur.nLoadState		= m_iMediaLoadState;
+	cur.nPlayState		= PS_STOP;
+	cur.nAudioTrack		= -1;
+	cur.nSubtitleTrack	= -1;
+
+	if (m_iMediaLoadState == MLS_LOADED) {
+		const UINT fields = m_ApiSubscription.GetFields();
+
+		cur.llPosition	= GetPos() / 10000;
+		cur.llDuration	= GetDur() / 10000;
+
+		OAFilterState fs = GetMediaState();
+		cur.nPlayState = fs == State_Running ? PS_PLAY : fs == State_Paused ? PS_PAUSE : PS_STOP;
+
+		if (fields & MPC_UPDATE_AUDIOTRACK) {
+			CComQIPtr<IAMStreamSelect> pSS = FindSwitcherFilter();
+			DWORD cStreams = 0;
+			if (pSS && SUCCEEDED(pSS->Count(&cStreams))) {
+				for (int i = 0; i < (int)cStreams; i++) {
+					DWORD dwFlags = 0;
+					if (SUCCEEDED(pSS->Info(i, NULL, &dwFlags, NULL, NULL, NULL, NULL, NULL)) && dwFlags == AMSTREAMSELECTINFO_EXCLUSIVE) {
+						cur.nAudioTrack = i;
+						break;
+					}
+				}
+			}
+		}
+
+		if ((fields & MPC_UPDATE_SUBTITLETRACK) && AfxGetAppSettings().fEnableSubtitles) {
+			cur.nSubtitleTrack = m_iSubtitleSel;
+		}
+	}
+
+	const DWORD now = GetTickCount();
+
+	MPC_UPDATE upd;
+	if (!m_ApiSubscription.GetUpdate(cur, now, upd)) {
+		return;
+	}
+
+	COPYDATASTRUCT CDS;
+	CDS.dwData = CMD_UPDATE;
+	CDS.cbData = sizeof(upd);
+	CDS.lpData = (LPVOID)&upd;
+
+	// runs on the UI thread, a host that doesn't take the update in time
+	// gets the changes merged into a later one after the backoff
+	DWORD_PTR dwResult = 0;
+	const bool bDelivered = !!::SendMessageTimeout(hMasterWnd, WM_COPYDATA, (WPARAM)GetSafeHwnd(), (LPARAM)&CDS,
+												   SMTO_ABORTIFHUNG, 100, &dwResult);
+
+	m_ApiSubscription.OnSent(upd, now, bDelivered);
+}
+
 void CMainFrame::ShowOSDCustomMessageApi(MPC_OSDDATA *osdData)
 {
 	m_OSD.DisplayMessage((OSD_MESSAGEPOS)osdData->nMsgPos, osdData->strMsg, osdData->nDurationMS);
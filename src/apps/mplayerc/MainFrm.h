@@ -65,6 +65,10 @@
 #include "VMROSD.h"
 #include "LcdSupport.h"
 #include "MpcApi.h"
+#include "ApiSubscription.h"
+#include "PreviewCache.h"
+#include "ThumbnailSheet.h"
+#include "VideoProbe.h"
 #include "../../filters/renderer/SyncClock/SyncClock.h"
 #include "../../filters/transform/DecSSFilter/VobFile.h"
 #include <sizecbar/scbarg.h>
@@ -190,7 +194,9 @@ class CMainFrame : public CFrameWnd, public CDropTarget
 		TIMER_LEFTCLICK,
 		TIMER_STATUSERASER,
 		TIMER_FLYBARWINDOWHIDER,
-		TIMER_EXCLUSIVEBARHIDER
+		TIMER_EXCLUSIVEBARHIDER,
+		TIMER_APIUPDATE,
+		TIMER_PREVIEW
 	};
 	enum {
 		SEEK_DIRECTION_NONE,
@@ -408,9 +414,11 @@ class CMainFrame : public CFrameWnd, public CDropTarget
 
 	bool GetDIB(BYTE** ppData, long& size, bool fSilent = false);
 	void SaveDIB(LPCTSTR fn, BYTE* pData, long size);
+	void SendSavedStatusMessage(LPCTSTR fn);
 	BOOL IsRendererCompatibleWithSaveImage();
 	void SaveImage(LPCTSTR fn);
 	void SaveThumbnails(LPCTSTR fn);
+	CAutoPtr<CThumbnailSheet> m_pThumbnailSheet;
 
 	//
 
@@ -688,6 +696,7 @@ public:
 	afx_msg LRESULT OnRepaintRenderLess(WPARAM wParam, LPARAM lParam);
 
 	afx_msg LRESULT OnPostOpen(WPARAM wParam, LPARAM lParam);
+	afx_msg LRESULT OnThumbnailsSaved(WPARAM wParam, LPARAM lParam);
 
 	BOOL OnButton(UINT id, UINT nFlags, CPoint point);
 
@@ -1055,6 +1064,13 @@ public:
 	HRESULT PreviewWindowShow(REFERENCE_TIME rtCur2);
 	bool CanPreviewUse();
 
+	CPreviewCache m_PreviewCache;
+	int				m_nPreviewPos;		// the hovered position of m_PreviewCache
+	REFERENCE_TIME	m_rtPreviewStep;	// the positions are steps of the duration when there are no keyframes
+	const CPreviewCache::tile_t* m_pPreviewTile;
+	void	OpenPreviewCache(LPCTSTR fn);
+	void	ShowPreviewTile();
+
 	SIZE			m_fullWndSize;
 	CFullscreenWnd*	m_pFullscreenWnd;
 	CVMROSD		m_OSD;
@@ -1107,6 +1123,8 @@ public:
 	afx_msg void OnFileOpenDirectory();
 
 	void		SendCurrentPositionToApi(bool fNotifySeek = false);
+	CApiSubscription m_ApiSubscription;
+	void		SendUpdateToApi();
 	void		ShowOSDCustomMessageApi(MPC_OSDDATA *osdData);
 	void		JumpOfNSeconds(int seconds);
 
@@ -111,7 +111,7 @@ int CALLBACK COpenDirHelper::BrowseCallbackProcDIR(HWND hwnd, UINT uMsg, LPARAM
 	return 0;
 }
 
-void COpenDirHelper::RecurseAddDir(CString path, CAtlList<CString>* sl)
+static void AddSubDirs(const CString& path, CAtlList<CString>& sl, bool bRecurse)
 {
 	WIN32_FIND_DATA fd = {0};
 
@@ -128,13 +128,77 @@ void COpenDirHelper::RecurseAddDir(CString path, CAtlList<CString>* sl)
 					fullpath += '\\';
 				}
 
-				sl->AddTail(fullpath);
-				RecurseAddDir(fullpath, sl);
-			} else {
-				continue;
+				sl.AddTail(fullpath);
+				if (bRecurse) {
+					AddSubDirs(fullpath, sl, true);
+				}
 			}
 		} while (FindNextFile(hFind, &fd));
 
 		FindClose(hFind);
 	}
 }
+
+struct subtrees_t {
+	CAtlArray<CString>					roots;
+	CAutoPtrArray<CAtlList<CString> >	dirs;
+	volatile LONG						next;
+};
+
+static DWORD WINAPI AddSubTreesThread(LPVOID lpParameter)
+{
+	subtrees_t* p = (subtrees_t*)lpParameter;
+
+	for (;;) {
+		const LONG i = InterlockedIncrement(&p->next) - 1;
+		if (i >= (LONG)p->roots.GetCount()) {
+			break;
+		}
+		AddSubDirs(p->roots[i], *p->dirs[i], true);
+	}
+
+	return 0;
+}
+
+// The subtrees of the first level are walked on worker threads,
+// the result is in the same order as of a serial walk.
+void COpenDirHelper::RecurseAddDir(CString path, CAtlList<CString>* sl)
+{
+	CAtlList<CString> dirs;
+	AddSubDirs(path, dirs, false);
+
+	subtrees_t p;
+	p.next = 0;
+
+	POSITION pos = dirs.GetHeadPosition();
+	while (pos) {
+		p.roots.Add(dirs.GetNext(pos));
+		CAutoPtr<CAtlList<CString> > pDirs(DNew CAtlList<CString>());
+		p.dirs.Add(pDirs);
+	}
+
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	const DWORD nThreads = min(max(si.dwNumberOfProcessors, 1UL), min(8UL, (DWORD)p.roots.GetCount()));
+
+	CAtlArray<HANDLE> threads;
+	for (DWORD i = 1; i < nThreads; i++) {
+		HANDLE hThread = ::CreateThread(NULL, 0, AddSubTreesThread, &p, 0, NULL);
+		if (hThread) {
+			threads.Add(hThread);
+		}
+	}
+	AddSubTreesThread(&p);
+
+	if (threads.GetCount()) {
+		WaitForMultipleObjects((DWORD)threads.GetCount(), threads.GetData(), TRUE, INFINITE);
+		for (size_t i = 0; i < threads.GetCount(); i++) {
+			CloseHandle(threads[i]);
+		}
+	}
+
+	for (size_t i = 0; i < p.roots.GetCount(); i++) {
+		sl->AddTail(p.roots[i]);
+		sl->AddTailList(p.dirs[i]);
+	}
+}
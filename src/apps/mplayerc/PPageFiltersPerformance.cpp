@@ -32,6 +32,7 @@ CPPageFiltersPerformance::CPPageFiltersPerformance()
 	, m_nCachSize(0)
 	, m_nMinQueuePackets(0)
 	, m_nMaxQueuePackets(0)
+	, m_nTimeShift(0)
 {
 	MEMORYSTATUSEX msEx;
 	msEx.dwLength = sizeof(msEx);
@@ -52,9 +53,11 @@ void CPPageFiltersPerformance::DoDataExchange(CDataExchange* pDX)
 	DDX_Control(pDX, IDC_SPIN2, m_nMinQueueSizeCtrl);
 	DDX_Control(pDX, IDC_SPIN3, m_nMaxQueueSizeCtrl);
 	DDX_Control(pDX, IDC_SPIN4, m_nCachSizeCtrl);
+	DDX_Control(pDX, IDC_SPIN5, m_nTimeShiftCtrl);
 	DDX_Text(pDX, IDC_MINQUEUE_SIZE, m_nMinQueueSize);
 	DDX_Text(pDX, IDC_MAXQUEUE_SIZE, m_nMaxQueueSize);
 	DDX_Text(pDX, IDC_CACH_SIZE, m_nCachSize);
+	DDX_Text(pDX, IDC_TIMESHIFT_SIZE, m_nTimeShift);
 }
 
 BEGIN_MESSAGE_MAP(CPPageFiltersPerformance, CPPageBase)
@@ -74,6 +77,7 @@ BOOL CPPageFiltersPerformance::OnInitDialog()
 	m_nMinQueueSizeCtrl.SetRange(64, KILOBYTE);
 	m_nMaxQueueSizeCtrl.SetRange(10, min(512, m_halfMemMB));
 	m_nCachSizeCtrl.SetRange(16, KILOBYTE);
+	m_nTimeShiftCtrl.SetRange(0, MAXTIMESHIFT);
 
 	m_nMinQueueSize	= s.PerfomanceSettings.iMinQueueSize;
 	m_nMaxQueueSize	= s.PerfomanceSettings.iMaxQueueSize;
@@ -82,6 +86,8 @@ BOOL CPPageFiltersPerformance::OnInitDialog()
 	m_nMinQueuePackets = s.PerfomanceSettings.iMinQueuePackets;
 	m_nMaxQueuePackets = s.PerfomanceSettings.iMaxQueuePackets;
 
+	m_nTimeShift = s.PerfomanceSettings.iTimeShift;
+
 	m_DefaultCtrl.SetCheck(s.PerfomanceSettings.fDefault);
 	OnBnClickedCheck1();
 
@@ -105,6 +111,8 @@ BOOL CPPageFiltersPerformance::OnApply()
 	s.PerfomanceSettings.iMinQueuePackets = max(10, min(MAXQUEUEPACKETS, m_nMinQueuePackets));
 	s.PerfomanceSettings.iMaxQueuePackets = max(s.PerfomanceSettings.iMinQueuePackets*2, min(MAXQUEUEPACKETS*10, m_nMaxQueuePackets));
 
+	s.PerfomanceSettings.iTimeShift = min(MAXTIMESHIFT, m_nTimeShift);
+
 	s.PerfomanceSettings.UpdateStatus();
 
 	return __super::OnApply();
@@ -124,6 +132,8 @@ void CPPageFiltersPerformance::OnBnClickedCheck1()
 		m_nMinQueuePackets = s.PerfomanceSettings.iMinQueuePackets;
 		m_nMaxQueuePackets = s.PerfomanceSettings.iMaxQueuePackets;
 
+		m_nTimeShift = s.PerfomanceSettings.iTimeShift;
+
 		UpdateData(FALSE);
 	}
 
@@ -48,11 +48,13 @@ public:
 	CSpinButtonCtrl m_nMinQueueSizeCtrl;
 	CSpinButtonCtrl m_nMaxQueueSizeCtrl;
 	CSpinButtonCtrl m_nCachSizeCtrl;
+	CSpinButtonCtrl m_nTimeShiftCtrl;
 	DWORD m_nMinQueueSize;
 	DWORD m_nMaxQueueSize;
 	DWORD m_nCachSize;
 	DWORD m_nMinQueuePackets;
 	DWORD m_nMaxQueuePackets;
+	DWORD m_nTimeShift;
 	CButton m_DefaultCtrl;
 
 	afx_msg void OnBnClickedCheck1();
@@ -30,6 +30,7 @@
 #include "PlayerPlaylistBar.h"
 #include "SettingsDefines.h"
 #include "OpenDlg.h"
+#include "OpenDirHelper.h"
 
 static CString MakePath(CString path)
 {
@@ -192,6 +193,7 @@ CPlaylistItem& CPlaylistItem::operator = (const CPlaylistItem& pli)
 		m_type = pli.m_type;
 		m_fInvalid = pli.m_fInvalid;
 		m_duration = pli.m_duration;
+		m_summary = pli.m_summary;
 		m_vinput = pli.m_vinput;
 		m_vchannel = pli.m_vchannel;
 		m_ainput = pli.m_ainput;
@@ -312,8 +314,9 @@ void CPlaylistItem::AutoLoadFiles()
 		name.Truncate(n);
 	}
 
+	// may run on a worker thread, AfxGetMainWnd() only works on the UI thread
 	CString BDLabel, empty;
-	CMainFrame* pMainFrm = (CMainFrame*)AfxGetMainWnd();
+	CMainFrame* pMainFrm = (CMainFrame*)AfxGetApp()->m_pMainWnd;
 	if (pMainFrm) {
 		pMainFrm->MakeBDLabel(fn, empty, &BDLabel);
 	}
@@ -751,6 +754,24 @@ void CPlayerPlaylistBar::SetHiddenDueToFullscreen(bool bHiddenDueToFullscreen)
 	m_bHiddenDueToFullscreen = bHiddenDueToFullscreen;
 }
 
+// The duration, title and streams of a local file from the info cache, or from its headers.
+// A file the probe doesn't know is stored without them and not read again until it changes.
+static void GetItemInfo(CPlaylistItem& pli, CPlaylistInfoCache& cache)
+{
+	const CString fn = pli.m_fns.GetHead();
+	if (fn.Find(_T("://")) >= 0 || cache.Lookup(fn, pli.m_duration, pli.m_label, pli.m_summary)) {
+		return;
+	}
+
+	MediaProbe probe;
+	ProbeMedia(fn, probe);
+
+	pli.m_duration	= probe.duration;
+	pli.m_label		= probe.title;
+	pli.m_summary	= probe.summary;
+	cache.Store(fn, probe.duration, probe.title, probe.summary);
+}
+
 void CPlayerPlaylistBar::AddItem(CString fn, CAtlList<CString>* subs)
 {
 	CAtlList<CString> sl;
@@ -782,6 +803,10 @@ void CPlayerPlaylistBar::AddItem(CAtlList<CString>& fns, CAtlList<CString>* subs
 
 	pli.AutoLoadFiles();
 
+	if (!pli.m_fns.IsEmpty()) {
+		GetItemInfo(pli, m_InfoCache);
+	}
+
 	m_pl.AddTail(pli);
 }
 
@@ -851,6 +876,227 @@ static bool SearchFiles(CString mask, CAtlList<CString>& sl)
 		   || sl.GetCount() == 0 && mask.FindOneOf(_T("?*")) >= 0);
 }
 
+static bool IsPlayListType(const CStringA& ct)
+{
+	return ct == "application/x-mpc-playlist"
+		   || ct == "application/x-bdmv-playlist"
+		   || ct == "audio/x-mpegurl"
+		   || ct == "application/x-cue-metadata";
+}
+
+struct prepare_t {
+	struct item_t {
+		CString			fn;
+		CPlaylistItem	pli;
+		bool			bParse; // playlists and redirections go through ParsePlayList
+	};
+
+	CAtlArray<item_t>	items;
+	volatile LONG		next;
+	CPlaylistInfoCache*	pInfoCache;
+};
+
+static DWORD WINAPI PrepareItemsThread(LPVOID lpParameter)
+{
+	prepare_t* p = (prepare_t*)lpParameter;
+
+	for (;;) {
+		const LONG i = InterlockedIncrement(&p->next) - 1;
+		if (i >= (LONG)p->items.GetCount()) {
+			break;
+		}
+
+		prepare_t::item_t& item = p->items[i];
+
+		CAtlList<CString> redir;
+		CStringA ct = GetContentType(item.fn, &redir);
+		if (!redir.IsEmpty() || IsPlayListType(ct)) {
+			item.bParse = true;
+			continue;
+		}
+
+		item.pli.m_fns.AddTail(MakePath(item.fn));
+		item.pli.AutoLoadFiles();
+		GetItemInfo(item.pli, *p->pInfoCache);
+	}
+
+	return 0;
+}
+
+// The files are classified, their audio and subtitle files are searched and the
+// headers of the files missing in the info cache are probed on worker threads.
+static void PrepareItems(CAtlList<CString>& fns, prepare_t& p)
+{
+	p.next = 0;
+
+	// the playlist item ids are assigned here, on the calling thread
+	p.items.SetCount(fns.GetCount());
+	POSITION pos = fns.GetHeadPosition();
+	for (size_t i = 0; pos; i++) {
+		p.items[i].fn		= fns.GetNext(pos);
+		p.items[i].bParse	= false;
+	}
+
+	p.pInfoCache->Load();
+
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	const DWORD nThreads = min(max(si.dwNumberOfProcessors, 1UL), min(8UL, (DWORD)p.items.GetCount()));
+
+	CAtlArray<HANDLE> threads;
+	for (DWORD i = 1; i < nThreads; i++) {
+		HANDLE hThread = ::CreateThread(NULL, 0, PrepareItemsThread, &p, 0, NULL);
+		if (hThread) {
+			threads.Add(hThread);
+		}
+	}
+	PrepareItemsThread(&p);
+
+	if (threads.GetCount()) {
+		WaitForMultipleObjects((DWORD)threads.GetCount(), threads.GetData(), TRUE, INFINITE);
+		for (size_t i = 0; i < threads.GetCount(); i++) {
+			CloseHandle(threads[i]);
+		}
+	}
+}
+
+// the items are added in the original order
+void CPlayerPlaylistBar::AddFiles(CAtlList<CString>& fns)
+{
+	prepare_t p;
+	p.pInfoCache = &m_InfoCache;
+	PrepareItems(fns, p);
+
+	for (size_t i = 0; i < p.items.GetCount(); i++) {
+		if (p.items[i].bParse) {
+			ParsePlayList(p.items[i].fn, NULL);
+		} else {
+			m_pl.AddTail(p.items[i].pli);
+		}
+	}
+}
+
+// RIFF AVI with a video and an audio stream header and an empty movi list
+static bool WriteBenchFile(LPCTSTR fn, DWORD nFrames)
+{
+	const DWORD avi[] = {
+		FCC('RIFF'), 320, FCC('AVI '),
+		FCC('LIST'), 296, FCC('hdrl'),
+		FCC('avih'), 56, 40000, 0, 0, 0, nFrames, 0, 2, 0, 1280, 720, 0, 0, 0, 0,
+		FCC('LIST'), 116, FCC('strl'),
+		FCC('strh'), 56, FCC('vids'), FCC('H264'), 0, 0, 0, 1, 25, 0, nFrames, 0, 0, 0, 0, 0,
+		FCC('strf'), 40, 40, 1280, 720, 1 | (24 << 16), FCC('H264'), 1280 * 720 * 3, 0, 0, 0, 0,
+		FCC('LIST'), 96, FCC('strl'),
+		FCC('strh'), 56, FCC('auds'), 0, 0, 0, 0, 1, 48000, 0, nFrames * 1920, 0, 0, 4, 0, 0,
+		FCC('strf'), 20, 1 | (2 << 16), 48000, 192000, 4 | (16 << 16), 0,
+		FCC('LIST'), 4, FCC('movi'),
+	};
+
+	HANDLE hFile = CreateFile(fn, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	DWORD dwWritten = 0;
+	const BOOL bRet = WriteFile(hFile, avi, sizeof(avi), &dwWritten, NULL);
+	CloseHandle(hFile);
+
+	return bRet && dwWritten == sizeof(avi);
+}
+
+// The files are spread over 16 folders of 8 subfolders each. The first pass starts
+// with an empty info cache and probes every file, the second one finds them in the
+// saved cache.
+CString CPlayerPlaylistBar::ScanBench(int nFiles)
+{
+	CString str;
+
+	TCHAR tmp[MAX_PATH];
+	if (!GetTempPath(_countof(tmp), tmp)) {
+		return str;
+	}
+
+	CString root;
+	root.Format(_T("%smpc-scanbench-%u\\"), tmp, GetTickCount());
+
+	CAtlList<CString> dirs, files;
+	if (!CreateDirectory(root, NULL)) {
+		return str;
+	}
+	dirs.AddTail(root);
+
+	for (int i = 0; i < nFiles; i++) {
+		CString dir;
+		dir.Format(_T("%sd%02d\\"), root, i % 16);
+		if (CreateDirectory(dir, NULL)) {
+			dirs.AddTail(dir);
+		}
+		dir.AppendFormat(_T("e%02d\\"), (i / 16) % 8);
+		if (CreateDirectory(dir, NULL)) {
+			dirs.AddTail(dir);
+		}
+
+		CString fn;
+		fn.Format(_T("%s%05d.avi"), dir, i);
+		if (!WriteBenchFile(fn, 25 * (60 + i % 600))) {
+			break;
+		}
+		files.AddTail(fn);
+	}
+
+	str.Format(_T("%u files in %u folders\n"), (UINT)files.GetCount(), (UINT)dirs.GetCount());
+
+	const CString cache = root + _T("playlistinfo.dat");
+
+	for (int pass = 0; pass < 2; pass++) {
+		CPlaylistInfoCache infocache(cache);
+
+		const DWORD dwStart = GetTickCount();
+
+		CAtlList<CString> sl, fns;
+		sl.AddTail(root);
+		COpenDirHelper::RecurseAddDir(root, &sl);
+		POSITION pos = sl.GetHeadPosition();
+		while (pos) {
+			CAtlList<CString> found;
+			SearchFiles(sl.GetNext(pos), found);
+			fns.AddTailList(&found);
+		}
+
+		const DWORD dwWalk = GetTickCount() - dwStart;
+
+		prepare_t p;
+		p.pInfoCache = &infocache;
+		PrepareItems(fns, p);
+
+		const DWORD dwPrepare = GetTickCount() - dwStart - dwWalk;
+
+		size_t nDuration = 0;
+		for (size_t i = 0; i < p.items.GetCount(); i++) {
+			if (p.items[i].pli.m_duration > 0) {
+				nDuration++;
+			}
+		}
+
+		str.AppendFormat(_T("%s: walk %u ms, prepare %u ms, %u of %u with duration\n"),
+						 pass ? _T("info cache") : _T("probe"), dwWalk, dwPrepare, (UINT)nDuration, (UINT)p.items.GetCount());
+
+		infocache.Save();
+	}
+
+	DeleteFile(cache);
+	POSITION pos = files.GetHeadPosition();
+	while (pos) {
+		DeleteFile(files.GetNext(pos));
+	}
+	pos = dirs.GetTailPosition();
+	while (pos) {
+		RemoveDirectory(dirs.GetPrev(pos));
+	}
+
+	return str;
+}
+
 void CPlayerPlaylistBar::ParsePlayList(CString fn, CAtlList<CString>* subs)
 {
 	CAtlList<CString> sl;
@@ -911,7 +1157,8 @@ void CPlayerPlaylistBar::ParsePlayList(CAtlList<CString>& fns, CAtlList<CString>
 
 		if (!bDVD_BD) {
 			if (sl.GetCount() > 1) {
-				subs = NULL;
+				AddFiles(sl);
+				return;
 			}
 			POSITION pos = sl.GetHeadPosition();
 			while (pos) {
@@ -1580,7 +1827,12 @@ void CPlayerPlaylistBar::SetCurLabel(CString label)
 {
 	POSITION pos = m_pl.GetPos();
 	if (pos) {
-		m_pl.GetAt(pos).m_label = label;
+		CPlaylistItem& pli = m_pl.GetAt(pos);
+		pli.m_label = label;
+
+		if (pli.m_type == CPlaylistItem::file && !pli.m_fns.IsEmpty() && pli.m_duration > 0) {
+			m_InfoCache.Store(pli.m_fns.GetHead(), pli.m_duration, label, pli.m_summary);
+		}
 	}
 	UpdateList();
 }
@@ -1592,6 +1844,10 @@ void CPlayerPlaylistBar::SetCurTime(REFERENCE_TIME rt)
 		CPlaylistItem& pli = m_pl.GetAt(pos);
 		pli.m_duration = rt;
 		m_list.SetItemText(FindItem(pos), COL_TIME, pli.GetLabel(1));
+
+		if (pli.m_type == CPlaylistItem::file && !pli.m_fns.IsEmpty() && rt > 0) {
+			m_InfoCache.Store(pli.m_fns.GetHead(), rt, pli.m_label, pli.m_summary);
+		}
 	}
 	UpdateList();
 }
@@ -1696,6 +1952,8 @@ void CPlayerPlaylistBar::SavePlaylist()
 			::DeleteFile(p);
 		}
 	}
+
+	m_InfoCache.Save();
 }
 
 BEGIN_MESSAGE_MAP(CPlayerPlaylistBar, CSizingControlBarG)
@@ -2142,6 +2400,9 @@ BOOL CPlayerPlaylistBar::OnToolTipNotify(UINT id, NMHDR* pNMHDR, LRESULT* pResul
 		while (pos) {
 			strTipText += _T("\n") + pli.m_fns.GetNext(pos).GetName();
 		}
+		if (!pli.m_summary.IsEmpty()) {
+			strTipText += _T("\n") + pli.m_summary;
+		}
 		strTipText.Trim();
 
 		if (pli.m_type == CPlaylistItem::device) {
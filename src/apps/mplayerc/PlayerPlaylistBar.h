@@ -24,6 +24,7 @@
 #include <afxcoll.h>
 #include "PlayerBar.h"
 #include "PlayerListCtrl.h"
+#include "PlaylistInfoCache.h"
 #include "../../DSUtil/CUE.h"
 #include <vector>
 
@@ -112,6 +113,7 @@ public:
 		device
 	} m_type;
 	REFERENCE_TIME m_duration;
+	CString m_summary;
 	int m_vinput, m_vchannel;
 	int m_ainput;
 	long m_country;
@@ -173,6 +175,9 @@ private:
 	void ParsePlayList(CString fn, CAtlList<CString>* subs);
 	void ParsePlayList(CAtlList<CString>& fns, CAtlList<CString>* subs);
 	void ResolveLinkFiles( CAtlList<CString> &fns );
+	void AddFiles(CAtlList<CString>& fns);
+
+	CPlaylistInfoCache m_InfoCache;
 
 	bool ParseBDMVPlayList(CString fn);
 
@@ -244,6 +249,9 @@ public:
 
 	bool SelectFileInPlaylist(CString filename);
 
+	// /scanbench, times the folder walk and the preparation of a generated tree of nFiles files
+	static CString ScanBench(int nFiles);
+
 protected:
 	virtual BOOL PreCreateWindow(CREATESTRUCT& cs);
 	virtual BOOL PreTranslateMessage(MSG* pMsg);
@@ -24,6 +24,9 @@
 // CPrevView
 
 CPreView::CPreView()
+	: m_imagew(0)
+	, m_imageh(0)
+	, m_bImage(false)
 {
 }
 
@@ -69,6 +72,35 @@ COLORREF CPreView::RGBFill(int r1, int g1, int b1, int r2, int g2, int b2, int i
 	return RGB(r, g, b);
 }
 
+void CPreView::SetImage(const DWORD* bits, int w, int h)
+{
+	if (!bits || w <= 0 || h <= 0) {
+		if (m_bImage) {
+			m_bImage = false;
+			m_view.ShowWindow(SW_SHOWNOACTIVATE);
+		}
+		return;
+	}
+
+	if (w * h != m_imagew * m_imageh) {
+		m_image.Free();
+		if (!m_image.Allocate(w * h)) {
+			m_imagew = m_imageh = 0;
+			return;
+		}
+	}
+	memcpy(m_image, bits, w * h * sizeof(DWORD));
+	m_imagew = w;
+	m_imageh = h;
+
+	if (!m_bImage) {
+		m_bImage = true;
+		m_view.ShowWindow(SW_HIDE);
+	}
+
+	InvalidateRect(v_rect, FALSE);
+}
+
 IMPLEMENT_DYNAMIC(CPreView, CWnd)
 
 BEGIN_MESSAGE_MAP(CPreView, CWnd)
@@ -276,7 +308,22 @@ void CPreView::OnPaint()
 	rtime.bottom = hc;
 	mdc.DrawText(tooltipstr, tooltipstr.GetLength(), &rtime, DT_CENTER|DT_VCENTER|DT_SINGLELINE);
 
-	dc.ExcludeClipRect(v_rect);
+	if (m_bImage) {
+		BITMAPINFO bmi;
+		memset(&bmi, 0, sizeof(bmi));
+		bmi.bmiHeader.biSize		= sizeof(bmi.bmiHeader);
+		bmi.bmiHeader.biWidth		= m_imagew;
+		bmi.bmiHeader.biHeight		= -m_imageh;
+		bmi.bmiHeader.biPlanes		= 1;
+		bmi.bmiHeader.biBitCount	= 32;
+		bmi.bmiHeader.biCompression	= BI_RGB;
+
+		mdc.SetStretchBltMode(COLORONCOLOR);
+		StretchDIBits(mdc.GetSafeHdc(), v_rect.left, v_rect.top, v_rect.Width(), v_rect.Height(),
+					  0, 0, m_imagew, m_imageh, m_image, &bmi, DIB_RGB_COLORS, SRCCOPY);
+	} else {
+		dc.ExcludeClipRect(v_rect);
+	}
 	dc.BitBlt(0, 0, rcBar.Width(), rcBar.Height(), &mdc, 0, 0, SRCCOPY);
 
 	mdc.SelectObject(pOldBm);
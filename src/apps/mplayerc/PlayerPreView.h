@@ -34,12 +34,21 @@ public:
 	HWND GetVideoHWND();
 	COLORREF RGBFill(int r1, int g1, int b1, int r2, int g2, int b2, int i, int k);
 
+	// shows a 32 bit top-down image instead of the video, NULL shows the video again
+	void SetImage(const DWORD* bits, int w, int h);
+
 protected:
 	CString tooltipstr;
 	CWnd	m_view;
 	int wb;
 	int hc;
 	CRect v_rect;
+
+	CAutoVectorPtr<DWORD> m_image;
+	int		m_imagew;
+	int		m_imageh;
+	bool	m_bImage;
+
 	virtual BOOL PreCreateWindow(CREATESTRUCT& cs);
 
 	afx_msg int OnCreate(LPCREATESTRUCT lpCreateStruct);
@@ -0,0 +1,238 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include <algorithm>
+#include "mplayerc.h"
+#include "PlaylistInfoCache.h"
+#include "../../Subtitles/TextFile.h"
+
+#define MAX_ENTRIES 20000 // the least recently used entries are dropped on save
+
+CPlaylistInfoCache::CPlaylistInfoCache(LPCTSTR path)
+	: m_path(path)
+	, m_nStamp(0)
+	, m_bLoaded(false)
+	, m_bModified(false)
+{
+}
+
+bool CPlaylistInfoCache::GetFileKey(LPCTSTR fn, ULONGLONG& size, ULONGLONG& mtime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA fad;
+	if (!GetFileAttributesEx(fn, GetFileExInfoStandard, &fad) || (fad.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+		return false;
+	}
+
+	size	= ((ULONGLONG)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
+	mtime	= ((ULONGLONG)fad.ftLastWriteTime.dwHighDateTime << 32) | fad.ftLastWriteTime.dwLowDateTime;
+
+	return true;
+}
+
+CString CPlaylistInfoCache::GetCachePath()
+{
+	if (!m_path.IsEmpty()) {
+		return m_path;
+	}
+
+	CString base;
+	if (!AfxGetMyApp()->GetAppSavePath(base)) {
+		return L"";
+	}
+
+	CPath p;
+	p.Combine(base, _T("playlistinfo.dat"));
+	return (LPCTSTR)p;
+}
+
+void CPlaylistInfoCache::Load()
+{
+	CAutoLock cAutoLock(&m_csLock);
+
+	if (m_bLoaded) {
+		return;
+	}
+	m_bLoaded = true;
+
+	CTextFile f(CTextFile::UTF8, CTextFile::ANSI);
+	if (!f.Open(GetCachePath())) {
+		return;
+	}
+
+	CString str;
+	if (!f.ReadString(str) || str != _T("MPCINFOCACHE")) {
+		return;
+	}
+
+	// path, size, last write time, duration, label and summary separated by tabs,
+	// the summary is missing in the lines of older versions
+	while (f.ReadString(str)) {
+		CString fields[6];
+		int pos = 0, n = 0;
+		for (; n < 4; n++) {
+			int next = str.Find('\t', pos);
+			if (next < 0) {
+				break;
+			}
+			fields[n] = str.Mid(pos, next - pos);
+			pos = next + 1;
+		}
+		if (n < 4 || fields[0].IsEmpty()) {
+			continue;
+		}
+		int next = str.Find('\t', pos);
+		if (next >= 0) {
+			fields[4] = str.Mid(pos, next - pos);
+			fields[5] = str.Mid(next + 1);
+		} else {
+			fields[4] = str.Mid(pos);
+		}
+
+		info_t info;
+		info.size		= _tcstoui64(fields[1], NULL, 10);
+		info.mtime		= _tcstoui64(fields[2], NULL, 10);
+		info.duration	= _tcstoi64(fields[3], NULL, 10);
+		info.label		= fields[4];
+		info.summary	= fields[5];
+		info.stamp		= m_nStamp++;
+
+		m_info[fields[0]] = info;
+	}
+}
+
+void CPlaylistInfoCache::Save()
+{
+	CAutoLock cAutoLock(&m_csLock);
+
+	if (!m_bModified) {
+		return;
+	}
+
+	CString path = GetCachePath();
+	if (path.IsEmpty()) {
+		return;
+	}
+
+	CString dir = path.Left(path.ReverseFind('\\'));
+	if (!::PathFileExists(dir)) {
+		::CreateDirectory(dir, NULL);
+	}
+
+	UINT minstamp = 0;
+	if (m_info.GetCount() > MAX_ENTRIES) {
+		CAtlArray<UINT> stamps;
+		POSITION pos = m_info.GetStartPosition();
+		while (pos) {
+			stamps.Add(m_info.GetNextValue(pos).stamp);
+		}
+		std::nth_element(stamps.GetData(), stamps.GetData() + stamps.GetCount() - MAX_ENTRIES, stamps.GetData() + stamps.GetCount());
+		minstamp = stamps[stamps.GetCount() - MAX_ENTRIES];
+	}
+
+	CTextFile f;
+	if (!f.Save(path, CTextFile::UTF8)) {
+		return;
+	}
+
+	f.WriteString(_T("MPCINFOCACHE\n"));
+
+	POSITION pos = m_info.GetStartPosition();
+	while (pos) {
+		const CAtlMap<CString, info_t, CStringElementTraitsI<CString>>::CPair* pPair = m_info.GetNext(pos);
+		const info_t& info = pPair->m_value;
+		if (info.stamp < minstamp) {
+			continue;
+		}
+
+		CString str;
+		str.Format(_T("%s\t%I64u\t%I64u\t%I64d\t%s\t%s\n"), pPair->m_key, info.size, info.mtime, info.duration, info.label, info.summary);
+		f.WriteString(str);
+	}
+
+	m_bModified = false;
+}
+
+bool CPlaylistInfoCache::Lookup(LPCTSTR fn, REFERENCE_TIME& duration, CString& label, CString& summary)
+{
+	if (_tcsstr(fn, _T("://"))) {
+		return false;
+	}
+
+	ULONGLONG size, mtime;
+	if (!GetFileKey(fn, size, mtime)) {
+		return false;
+	}
+
+	CAutoLock cAutoLock(&m_csLock);
+
+	Load();
+
+	CAtlMap<CString, info_t, CStringElementTraitsI<CString>>::CPair* pPair = m_info.Lookup(fn);
+	if (!pPair || pPair->m_value.size != size || pPair->m_value.mtime != mtime) {
+		return false;
+	}
+
+	pPair->m_value.stamp = m_nStamp++;
+
+	duration	= pPair->m_value.duration;
+	label		= pPair->m_value.label;
+	summary		= pPair->m_value.summary;
+
+	return true;
+}
+
+void CPlaylistInfoCache::Store(LPCTSTR fn, REFERENCE_TIME duration, LPCTSTR label, LPCTSTR summary)
+{
+	if (_tcsstr(fn, _T("://"))) {
+		return;
+	}
+
+	ULONGLONG size, mtime;
+	if (!GetFileKey(fn, size, mtime)) {
+		return;
+	}
+
+	CAutoLock cAutoLock(&m_csLock);
+
+	Load();
+
+	info_t info;
+	info.size		= size;
+	info.mtime		= mtime;
+	info.duration	= duration;
+	info.label		= label;
+	info.label.Replace('\t', ' ');
+	info.label.Replace('\n', ' ');
+	info.summary	= summary;
+	info.summary.Replace('\t', ' ');
+	info.summary.Replace('\n', ' ');
+	info.stamp		= m_nStamp++;
+
+	CAtlMap<CString, info_t, CStringElementTraitsI<CString>>::CPair* pPair = m_info.Lookup(fn);
+	if (pPair && pPair->m_value.size == size && pPair->m_value.mtime == mtime
+			&& pPair->m_value.duration == duration && pPair->m_value.label == info.label && pPair->m_value.summary == info.summary) {
+		pPair->m_value.stamp = info.stamp;
+		return;
+	}
+
+	m_info[fn] = info;
+	m_bModified = true;
+}
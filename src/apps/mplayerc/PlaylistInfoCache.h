@@ -0,0 +1,59 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <atlcoll.h>
+
+// Durations, titles and stream summaries of local files that were played or probed,
+// kept between sessions in a text file next to the settings. Entries are keyed by path, size and last write
+// time, a file that has changed since is a miss. Lookup may be called from worker
+// threads.
+
+class CPlaylistInfoCache
+{
+	struct info_t {
+		ULONGLONG		size;
+		ULONGLONG		mtime;
+		REFERENCE_TIME	duration;
+		CString			label;
+		CString			summary;
+		UINT			stamp;
+	};
+
+	CCritSec	m_csLock;
+	CString		m_path;
+	CAtlMap<CString, info_t, CStringElementTraitsI<CString>> m_info;
+	UINT		m_nStamp;
+	bool		m_bLoaded;
+	bool		m_bModified;
+
+	static bool GetFileKey(LPCTSTR fn, ULONGLONG& size, ULONGLONG& mtime);
+	CString GetCachePath();
+
+public:
+	CPlaylistInfoCache(LPCTSTR path = NULL); // the file in the settings folder by default
+
+	void Load();
+	void Save();
+
+	bool Lookup(LPCTSTR fn, REFERENCE_TIME& duration, CString& label, CString& summary);
+	void Store(LPCTSTR fn, REFERENCE_TIME duration, LPCTSTR label, LPCTSTR summary);
+};
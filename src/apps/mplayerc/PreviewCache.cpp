@@ -0,0 +1,422 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include <algorithm>
+#include "mplayerc.h"
+#include "PreviewCache.h"
+#include "KeyFrameGrabber.h"
+#include "ISDb.h"
+#include <zlib/zlib.h>
+
+#define NO_SLOT				((size_t)-1)
+#define FRAME_TIMEOUT		5000	// ms the preview graph may take for one frame
+#define CACHE_ID			MAKEFOURCC('M','P','C','P')
+#define CACHE_VERSION		1
+#define CACHE_MAXFILES		100		// the least recently written files are deleted on save
+
+struct cacheheader_t {
+	DWORD			id;
+	DWORD			version;
+	UINT64			filesize;
+	UINT64			count;
+	UINT64			step;
+	int				w, h;
+	REFERENCE_TIME	rtLast;
+};
+
+CPreviewCache::CPreviewCache(size_t nMaxSize)
+	: m_evAbort(TRUE)
+	, m_nCount(0)
+	, m_nStep(1)
+	, m_w(0)
+	, m_h(0)
+	, m_nRequest(-1)
+	, m_nMaxSize(nMaxSize)
+{
+}
+
+CPreviewCache::~CPreviewCache()
+{
+	Close();
+}
+
+void CPreviewCache::Open(LPCTSTR fn, const CAtlArray<REFERENCE_TIME>& rts, int w, int h)
+{
+	Close();
+
+	if (rts.IsEmpty() || w <= 0 || h <= 0) {
+		return;
+	}
+
+	// every slot fits into the memory budget, tiles are never dropped
+	const size_t capacity = max(m_nMaxSize / (w * h * sizeof(DWORD)), (size_t)1);
+
+	m_nCount	= rts.GetCount();
+	m_nStep		= (m_nCount + capacity - 1) / capacity;
+
+	const size_t slots = (m_nCount + m_nStep - 1) / m_nStep;
+	m_rts.SetCount(slots);
+	m_tiles.SetCount(slots);
+	m_nearest.SetCount(slots);
+	for (size_t s = 0; s < slots; s++) {
+		m_rts[s]		= rts[s * m_nStep];
+		m_nearest[s]	= NO_SLOT;
+	}
+
+	m_fn		= fn;
+	m_w			= w;
+	m_h			= h;
+	m_nRequest	= -1;
+
+	m_evAbort.Reset();
+	Create();
+}
+
+void CPreviewCache::Close()
+{
+	if (ThreadExists()) {
+		m_evAbort.Set();
+		CAMThread::Close();
+	}
+
+	m_rts.RemoveAll();
+	m_tiles.RemoveAll();
+	m_nearest.RemoveAll();
+	m_nCount = 0;
+	m_nStep = 1;
+}
+
+const CPreviewCache::tile_t* CPreviewCache::Find(size_t i)
+{
+	CAutoLock cAutoLock(&m_csLock);
+
+	if (i >= m_nCount) {
+		return NULL;
+	}
+
+	const size_t s = min((i + m_nStep / 2) / m_nStep, m_tiles.GetCount() - 1);
+	if (!m_tiles[s]) {
+		InterlockedExchange(&m_nRequest, (LONG)s);
+	}
+
+	const size_t n = m_nearest[s];
+	return n != NO_SLOT ? m_tiles[n] : NULL;
+}
+
+CPreviewCache::tile_t* CPreviewCache::Scale(const BYTE* pDIB, int w, int h)
+{
+	const BITMAPINFOHEADER* bih = (const BITMAPINFOHEADER*)pDIB;
+	const int bpp = bih->biBitCount;
+	if (bih->biCompression != BI_RGB || (bpp != 24 && bpp != 32) || bih->biWidth <= 0 || bih->biHeight == 0) {
+		return NULL;
+	}
+
+	const int sw = bih->biWidth;
+	const int sh = abs(bih->biHeight);
+	int sp = ((sw * bpp / 8) + 3) & ~3;
+	const BYTE* src = pDIB + bih->biSize;
+	if (bih->biHeight > 0) {
+		src += sp * (sh - 1);
+		sp = -sp;
+	}
+
+	CAutoPtr<tile_t> pTile(DNew tile_t);
+	if (!pTile->bits.Allocate(w * h)) {
+		return NULL;
+	}
+	pTile->w = w;
+	pTile->h = h;
+
+	// point sampling is enough for this size
+	DWORD* dst = pTile->bits;
+	for (int y = 0; y < h; y++) {
+		const BYTE* s = src + sp * (y * sh / h);
+		for (int x = 0; x < w; x++) {
+			const BYTE* p = s + (x * sw / w) * (bpp / 8);
+			*dst++ = p[0] | (p[1] << 8) | (p[2] << 16);
+		}
+	}
+
+	return pTile.Detach();
+}
+
+void CPreviewCache::Insert(size_t slot, tile_t* pTile)
+{
+	CAutoLock cAutoLock(&m_csLock);
+
+	if (m_tiles[slot]) {
+		delete pTile;
+		return;
+	}
+	m_tiles[slot].Attach(pTile);
+
+	// the slots that are closer to this one than to their tile so far, Find only reads the result
+	const size_t slots = m_nearest.GetCount();
+	m_nearest[slot] = slot;
+	for (size_t j = slot + 1; j < slots; j++) {
+		const size_t n = m_nearest[j];
+		if (n != NO_SLOT && (n > j ? n - j : j - n) <= j - slot) {
+			break;
+		}
+		m_nearest[j] = slot;
+	}
+	for (size_t j = slot; j-- > 0;) {
+		const size_t n = m_nearest[j];
+		if (n != NO_SLOT && (n > j ? n - j : j - n) <= slot - j) {
+			break;
+		}
+		m_nearest[j] = slot;
+	}
+}
+
+DWORD CPreviewCache::ThreadProc()
+{
+	SetThreadName((DWORD)-1, "CPreviewCache");
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+
+	const CString path = GetCachePath();
+	if (!path.IsEmpty()) {
+		LoadCache(path);
+	}
+
+	const size_t slots = m_tiles.GetCount();
+
+	CAtlArray<bool> tried;
+	tried.SetCount(slots);
+	size_t left = 0;
+	for (size_t s = 0; s < slots; s++) {
+		tried[s] = !!m_tiles[s];
+		left += !tried[s];
+	}
+
+	bool bModified = false;
+
+	if (left && SUCCEEDED(CoInitialize(NULL))) {
+		CKeyFrameGrabber grabber;
+
+		if (SUCCEEDED(grabber.Open(m_fn))) {
+			// every 2^n-th slot first, a hovered slot before all others
+			size_t stride = 1;
+			while (stride * 2 < slots) {
+				stride *= 2;
+			}
+			size_t next = 0;
+
+			while (left && !m_evAbort.Check()) {
+				size_t s = NO_SLOT;
+
+				const LONG r = InterlockedExchange(&m_nRequest, -1);
+				if (r >= 0 && (size_t)r < slots && !tried[r]) {
+					s = r;
+				}
+				while (s == NO_SLOT) {
+					if (next >= slots) {
+						stride = max(stride / 2, (size_t)1);
+						next = 0;
+					}
+					if (!tried[next]) {
+						s = next;
+					}
+					next += stride;
+				}
+
+				tried[s] = true;
+				left--;
+
+				BYTE* pDIB = NULL;
+				if (grabber.GetFrame(m_rts[s], &pDIB, FRAME_TIMEOUT, m_evAbort)) {
+					tile_t* pTile = Scale(pDIB, m_w, m_h);
+					delete [] pDIB;
+					if (pTile) {
+						Insert(s, pTile);
+						bModified = true;
+					}
+				}
+			}
+
+			grabber.Close();
+		}
+
+		CoUninitialize();
+	}
+
+	if (bModified && !path.IsEmpty()) {
+		SaveCache(path);
+	}
+
+	return 0;
+}
+
+CString CPreviewCache::GetCachePath()
+{
+	filehash fh;
+	CString base;
+	if (!mpc_filehash(m_fn, fh) || !AfxGetMyApp()->GetAppSavePath(base)) {
+		return L"";
+	}
+
+	CString name;
+	name.Format(_T("%016I64x.dat"), fh.mpc_filehash);
+
+	CPath p;
+	p.Combine(base, _T("PreviewCache"));
+	p.Append(name);
+	return (LPCTSTR)p;
+}
+
+void CPreviewCache::LoadCache(const CString& path)
+{
+	FILE* fp = NULL;
+	if (_tfopen_s(&fp, path, _T("rb")) || !fp) {
+		return;
+	}
+
+	WIN32_FILE_ATTRIBUTE_DATA fad;
+	const UINT64 filesize = GetFileAttributesEx(m_fn, GetFileExInfoStandard, &fad)
+							? ((UINT64)fad.nFileSizeHigh << 32) | fad.nFileSizeLow
+							: 0;
+
+	// a cache of other positions or another tile size is written again
+	cacheheader_t hdr;
+	if (fread(&hdr, sizeof(hdr), 1, fp) != 1
+			|| hdr.id != CACHE_ID || hdr.version != CACHE_VERSION || hdr.filesize != filesize
+			|| hdr.count != m_nCount || hdr.step != m_nStep || hdr.w != m_w || hdr.h != m_h
+			|| hdr.rtLast != m_rts[m_rts.GetCount() - 1]) {
+		fclose(fp);
+		return;
+	}
+
+	const uLong size = m_w * m_h * sizeof(DWORD);
+	CAutoVectorPtr<BYTE> pPacked;
+	if (!pPacked.Allocate(compressBound(size))) {
+		fclose(fp);
+		return;
+	}
+
+	for (size_t s = 0, slots = m_tiles.GetCount(); s < slots && !m_evAbort.Check(); s++) {
+		DWORD len = 0;
+		if (fread(&len, sizeof(len), 1, fp) != 1 || len > compressBound(size)) {
+			break;
+		}
+		if (!len) {
+			continue;
+		}
+		if (fread(pPacked, len, 1, fp) != 1) {
+			break;
+		}
+
+		CAutoPtr<tile_t> pTile(DNew tile_t);
+		if (!pTile->bits.Allocate(m_w * m_h)) {
+			break;
+		}
+		pTile->w = m_w;
+		pTile->h = m_h;
+
+		uLongf dstlen = size;
+		if (uncompress((Bytef*)(DWORD*)pTile->bits, &dstlen, pPacked, len) != Z_OK || dstlen != size) {
+			break;
+		}
+
+		Insert(s, pTile.Detach());
+	}
+
+	fclose(fp);
+}
+
+void CPreviewCache::SaveCache(const CString& path)
+{
+	CString dir = path.Left(path.ReverseFind('\\'));
+	if (!::PathFileExists(dir)) {
+		::CreateDirectory(dir, NULL);
+	}
+
+	WIN32_FILE_ATTRIBUTE_DATA fad;
+	if (!GetFileAttributesEx(m_fn, GetFileExInfoStandard, &fad)) {
+		return;
+	}
+
+	const uLong size = m_w * m_h * sizeof(DWORD);
+	CAutoVectorPtr<BYTE> pPacked;
+	if (!pPacked.Allocate(compressBound(size))) {
+		return;
+	}
+
+	FILE* fp = NULL;
+	if (_tfopen_s(&fp, path, _T("wb")) || !fp) {
+		return;
+	}
+
+	cacheheader_t hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.id			= CACHE_ID;
+	hdr.version		= CACHE_VERSION;
+	hdr.filesize	= ((UINT64)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
+	hdr.count		= m_nCount;
+	hdr.step		= m_nStep;
+	hdr.w			= m_w;
+	hdr.h			= m_h;
+	hdr.rtLast		= m_rts[m_rts.GetCount() - 1];
+
+	bool bOk = fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+
+	for (size_t s = 0, slots = m_tiles.GetCount(); s < slots && bOk; s++) {
+		DWORD len = 0;
+		if (m_tiles[s]) {
+			uLongf dstlen = compressBound(size);
+			if (compress2(pPacked, &dstlen, (const Bytef*)(DWORD*)m_tiles[s]->bits, size, Z_BEST_SPEED) == Z_OK) {
+				len = dstlen;
+			}
+		}
+		bOk = fwrite(&len, sizeof(len), 1, fp) == 1 && (!len || fwrite(pPacked, len, 1, fp) == 1);
+	}
+
+	fclose(fp);
+
+	if (!bOk) {
+		::DeleteFile(path);
+		return;
+	}
+
+	// keep the newest files
+	CAtlArray<ULONGLONG> times;
+	CAtlArray<CString> files;
+	WIN32_FIND_DATA fd;
+	HANDLE hFind = FindFirstFile(dir + _T("\\*.dat"), &fd);
+	if (hFind != INVALID_HANDLE_VALUE) {
+		do {
+			times.Add(((ULONGLONG)fd.ftLastWriteTime.dwHighDateTime << 32) | fd.ftLastWriteTime.dwLowDateTime);
+			files.Add(dir + _T("\\") + fd.cFileName);
+		} while (FindNextFile(hFind, &fd));
+		FindClose(hFind);
+	}
+
+	if (files.GetCount() > CACHE_MAXFILES) {
+		CAtlArray<ULONGLONG> sorted;
+		sorted.Copy(times);
+		std::nth_element(sorted.GetData(), sorted.GetData() + sorted.GetCount() - CACHE_MAXFILES, sorted.GetData() + sorted.GetCount());
+		const ULONGLONG mintime = sorted[sorted.GetCount() - CACHE_MAXFILES];
+		for (size_t i = 0; i < files.GetCount(); i++) {
+			if (times[i] < mintime) {
+				::DeleteFile(files[i]);
+			}
+		}
+	}
+}
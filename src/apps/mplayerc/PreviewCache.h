@@ -0,0 +1,70 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <atlcoll.h>
+
+// Small frames of the smart seek preview. A worker decodes them in its own graph, one
+// slot per keyframe (or per step of keyframes when they don't fit into the memory
+// budget), coarse to fine over the file and the hovered slot first. The tiles are kept
+// in a file of the settings folder keyed by the hash of the media file.
+
+class CPreviewCache : protected CAMThread
+{
+public:
+	struct tile_t {
+		int						w, h;
+		CAutoVectorPtr<DWORD>	bits; // 32 bit, top-down
+	};
+
+private:
+	CCritSec					m_csLock;
+	CAMEvent					m_evAbort;
+	CString						m_fn;
+	size_t						m_nCount;	// positions
+	size_t						m_nStep;	// positions per slot
+	CAtlArray<REFERENCE_TIME>	m_rts;		// the time of each slot
+	int							m_w, m_h;
+	CAutoPtrArray<tile_t>		m_tiles;
+	CAtlArray<size_t>			m_nearest;	// the filled slot nearest to each slot
+	volatile LONG				m_nRequest;	// a slot that was hovered before the pass got to it
+	size_t						m_nMaxSize;
+
+	DWORD ThreadProc();
+
+	static tile_t* Scale(const BYTE* pDIB, int w, int h);
+	void Insert(size_t slot, tile_t* pTile); // takes the tile
+
+	CString GetCachePath();
+	void LoadCache(const CString& path);
+	void SaveCache(const CString& path);
+
+public:
+	CPreviewCache(size_t nMaxSize = 8 * 1024 * 1024);
+	~CPreviewCache();
+
+	// starts filling the tiles of the positions rts with frames of the file fn
+	void Open(LPCTSTR fn, const CAtlArray<REFERENCE_TIME>& rts, int w, int h);
+	void Close();
+
+	// the tile of position i or of the nearest position that has one
+	const tile_t* Find(size_t i);
+};
@@ -30,6 +30,8 @@
 #define MINQUEUESIZE			256		// in Kb
 #define MAXQUEUESIZE			128		// in Mb
 
+#define MAXTIMESHIFT			4096	// in Mb
+
 #define IDS_R_SETTINGS						_T("Settings")
 #define IDS_R_FILTERS						_T("Filters")
 #define IDS_R_INTERNAL_FILTERS				_T("Internal Filters")
@@ -297,6 +299,8 @@
 #define IDS_RS_PERFOMANCE_MAXQUEUESIZE		_T("MaxQueueSize")
 #define IDS_RS_PERFOMANCE_MINQUEUEPACKETS	_T("MinQueuePackets")
 #define IDS_RS_PERFOMANCE_MAXQUEUEPACKETS	_T("MaxQueuePackets")
+#define IDS_RS_PERFOMANCE_MAPPED_FILES		_T("MappedFiles")
+#define IDS_RS_PERFOMANCE_TIMESHIFT			_T("TimeShift")
 
 #define IDS_R_FILTERS_PRIORITY				_T("\\Filters Priority")
 
@@ -0,0 +1,432 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "stdafx.h"
+#include "mplayerc.h"
+#include "ThumbnailSheet.h"
+#include "KeyFrameGrabber.h"
+#include "DIB.h"
+#include "../../Subtitles/RTS.h"
+
+#define FRAME_TIMEOUT		10000	// ms a worker graph may take for one frame
+#define INFO_HEIGHT			70
+#define MARGIN				10
+
+struct sheetjob_t {
+	CString						fn;
+	CAtlArray<REFERENCE_TIME>	rts;
+	CAtlArray<CRect>			rects;
+	SubPicDesc					spd;
+	CCritSec					csCompose;	// the subtitle renderer is not reentrant
+	volatile LONG				next;
+	volatile LONG				grabbed;
+};
+
+static void ComposeTile(sheetjob_t* p, const BYTE* pDIB, const CRect& r, REFERENCE_TIME rt)
+{
+	DVD_HMSF_TIMECODE hmsf = RT2HMS_r(rt);
+	CCritSec csSubLock;
+	RECT bbox;
+
+	CRenderedTextSubtitle rts(&csSubLock);
+	rts.CreateDefaultStyle(0);
+	rts.m_dstScreenSize.SetSize(p->spd.w, p->spd.h);
+	STSStyle* style = DNew STSStyle();
+	style->marginRect.SetRectEmpty();
+	rts.AddStyle(_T("thumbs"), style);
+
+	CStringW str;
+	str.Format(L"{\\an7\\1c&Hffffff&\\4a&Hb0&\\bord1\\shad4\\be1}{\\p1}m %d %d l %d %d %d %d %d %d{\\p}",
+			   r.left, r.top, r.right, r.top, r.right, r.bottom, r.left, r.bottom);
+	rts.Add(str, true, 0, 1, _T("thumbs"));
+	str.Format(L"{\\an3\\1c&Hffffff&\\3c&H000000&\\alpha&H80&\\fs16\\b1\\bord2\\shad0\\pos(%d,%d)}%02d:%02d:%02d",
+			   r.right-5, r.bottom-3, hmsf.bHours, hmsf.bMinutes, hmsf.bSeconds);
+	rts.Add(str, true, 1, 2, _T("thumbs"));
+
+	{
+		CAutoLock cAutoLock(&p->csCompose);
+		rts.Render(p->spd, 0, 25, bbox);
+	}
+
+	if (pDIB) {
+		// the tiles don't overlap, scaling needs no lock
+		const BITMAPINFO* bi = (BITMAPINFO*)pDIB;
+
+		int sw = bi->bmiHeader.biWidth;
+		int sh = abs(bi->bmiHeader.biHeight);
+		int sp = sw*4;
+		const BYTE* src = pDIB + sizeof(bi->bmiHeader);
+		if (bi->bmiHeader.biHeight >= 0) {
+			src += sp*(sh-1);
+			sp = -sp;
+		}
+
+		int dp = p->spd.pitch;
+		BYTE* dst = (BYTE*)p->spd.bits + p->spd.pitch*r.top + r.left*4;
+
+		for (DWORD h = r.bottom - r.top, y = 0, yd = (sh<<8)/h; h > 0; y += yd, h--) {
+			DWORD yf = y&0xff;
+			DWORD yi = y>>8;
+
+			DWORD* s0 = (DWORD*)(src + (int)yi*sp);
+			DWORD* s1 = (DWORD*)(src + (int)yi*sp + sp);
+			DWORD* d = (DWORD*)dst;
+
+			for (DWORD w = r.right - r.left, x = 0, xd = (sw<<8)/w; w > 0; x += xd, w--) {
+				DWORD xf = x&0xff;
+				DWORD xi = x>>8;
+
+				DWORD c0 = s0[xi];
+				DWORD c1 = s0[xi+1];
+				DWORD c2 = s1[xi];
+				DWORD c3 = s1[xi+1];
+
+				c0 = ((c0&0xff00ff) + ((((c1&0xff00ff) - (c0&0xff00ff)) * xf) >> 8)) & 0xff00ff
+					 | ((c0&0x00ff00) + ((((c1&0x00ff00) - (c0&0x00ff00)) * xf) >> 8)) & 0x00ff00;
+
+				c2 = ((c2&0xff00ff) + ((((c3&0xff00ff) - (c2&0xff00ff)) * xf) >> 8)) & 0xff00ff
+					 | ((c2&0x00ff00) + ((((c3&0x00ff00) - (c2&0x00ff00)) * xf) >> 8)) & 0x00ff00;
+
+				c0 = ((c0&0xff00ff) + ((((c2&0xff00ff) - (c0&0xff00ff)) * yf) >> 8)) & 0xff00ff
+					 | ((c0&0x00ff00) + ((((c2&0x00ff00) - (c0&0x00ff00)) * yf) >> 8)) & 0x00ff00;
+
+				*d++ = c0;
+			}
+
+			dst += dp;
+		}
+	}
+
+	{
+		CAutoLock cAutoLock(&p->csCompose);
+		rts.Render(p->spd, 10000, 25, bbox);
+	}
+}
+
+static void GrabTiles(sheetjob_t* p, CKeyFrameGrabber& grabber)
+{
+	for (;;) {
+		const LONG i = InterlockedIncrement(&p->next) - 1;
+		if (i >= (LONG)p->rts.GetCount()) {
+			break;
+		}
+
+		BYTE* pDIB = NULL;
+		if (grabber.GetFrame(p->rts[i], &pDIB, FRAME_TIMEOUT)) {
+			InterlockedIncrement(&p->grabbed);
+		}
+		ComposeTile(p, pDIB, p->rects[i], p->rts[i]);
+		delete [] pDIB;
+	}
+}
+
+static DWORD WINAPI GrabThread(LPVOID lpParameter)
+{
+	sheetjob_t* p = (sheetjob_t*)lpParameter;
+
+	SetThreadName((DWORD)-1, "CThumbnailSheet");
+
+	if (SUCCEEDED(CoInitialize(NULL))) {
+		{
+			CKeyFrameGrabber grabber;
+			if (SUCCEEDED(grabber.Open(p->fn))) {
+				GrabTiles(p, grabber);
+			}
+		}
+		CoUninitialize();
+	}
+
+	return 0;
+}
+
+static int rangebsearch(REFERENCE_TIME val, const CAtlArray<REFERENCE_TIME>& rta)
+{
+	// the last element not after val
+	int i = 0, j = (int)rta.GetCount() - 1;
+	if (j < 0 || val < rta[0]) {
+		return -1;
+	}
+	while (i < j) {
+		int mid = (i + j + 1) >> 1;
+		if (rta[mid] <= val) {
+			i = mid;
+		} else {
+			j = mid - 1;
+		}
+	}
+	return i;
+}
+
+//
+// CThumbnailSheet
+//
+
+CThumbnailSheet::CThumbnailSheet(LPCTSTR fn, LPCTSTR title, LPCTSTR dst, int nWorkers)
+	: m_fn(fn)
+	, m_title(title)
+	, m_dst(dst)
+	, m_nWorkers(nWorkers)
+	, m_hNotify(NULL)
+	, m_nError(0)
+	, m_dwTime(0)
+{
+	// a copy of the settings, the dialog may change them while saving
+	AppSettings& s = AfxGetAppSettings();
+
+	m_width		= min(max(s.iThumbWidth, 256), 2560);
+	m_cols		= min(max(s.iThumbCols, 1), 10);
+	m_rows		= min(max(s.iThumbRows, 1), 20);
+	m_quality	= s.iThumbQuality;
+	m_levelPNG	= s.iThumbLevelPNG;
+
+	if (m_nWorkers <= 0) {
+		SYSTEM_INFO si;
+		GetSystemInfo(&si);
+		m_nWorkers = min(max((int)si.dwNumberOfProcessors, 1), 8);
+	}
+	m_nWorkers = min(m_nWorkers, m_cols * m_rows);
+}
+
+CThumbnailSheet::~CThumbnailSheet()
+{
+	Wait();
+}
+
+UINT CThumbnailSheet::Save()
+{
+	m_nError = SaveSheet();
+	return m_nError;
+}
+
+UINT CThumbnailSheet::SaveSheet()
+{
+	const DWORD dwStart = GetTickCount();
+
+	// this graph gives the size and the keyframes, then grabs frames like the others
+	CKeyFrameGrabber grabber;
+	if (FAILED(grabber.Open(m_fn))) {
+		return IDS_MAINFRM_55;
+	}
+
+	const REFERENCE_TIME rtDur = grabber.GetDuration();
+	if (rtDur <= 0) {
+		return IDS_MAINFRM_54;
+	}
+
+	CSize framesize, dar;
+	if (!grabber.GetVideoSize(framesize, dar) || framesize.cx <= 0 || framesize.cy <= 0) {
+		return IDS_MAINFRM_55;
+	}
+	CSize picsize = framesize;
+	if (dar.cx > 0 && dar.cy > 0) {
+		picsize.cx = MulDiv(picsize.cy, dar.cx, dar.cy);
+	}
+
+	CAtlArray<REFERENCE_TIME> kfs;
+	grabber.GetKeyFrames(kfs);
+
+	const int width		= m_width;
+	const int cols		= m_cols;
+	const int rows		= m_rows;
+
+	CSize thumbsize;
+	thumbsize.cx		= (width - MARGIN) / cols - MARGIN;
+	thumbsize.cy		= MulDiv(thumbsize.cx, picsize.cy, picsize.cx);
+
+	const int height	= INFO_HEIGHT + MARGIN + (thumbsize.cy + MARGIN) * rows;
+	const int dibsize	= sizeof(BITMAPINFOHEADER) + width * height * 4;
+
+	CAutoVectorPtr<BYTE> dib;
+	if (!dib.Allocate(dibsize)) {
+		return IDS_MAINFRM_56;
+	}
+
+	BITMAPINFOHEADER* bih = (BITMAPINFOHEADER*)(BYTE*)dib;
+	memset(bih, 0, sizeof(BITMAPINFOHEADER));
+	bih->biSize			= sizeof(BITMAPINFOHEADER);
+	bih->biWidth		= width;
+	bih->biHeight		= height;
+	bih->biPlanes		= 1;
+	bih->biBitCount		= 32;
+	bih->biCompression	= BI_RGB;
+	bih->biSizeImage	= width * height * 4;
+	memsetd(bih + 1, 0xffffff, bih->biSizeImage);
+
+	sheetjob_t job;
+	job.fn			= m_fn;
+	job.next		= 0;
+	job.grabbed		= 0;
+
+	SubPicDesc& spd	= job.spd;
+	spd.w		= width;
+	spd.h		= height;
+	spd.bpp		= 32;
+	spd.pitch	= -width * 4;
+	spd.vidrect	= CRect(0, 0, width, height);
+	spd.bits	= (BYTE*)(bih + 1) + (width * 4) * (height - 1);
+
+	{
+		BYTE* p = (BYTE*)spd.bits;
+		for (int y = 0; y < spd.h; y++, p += spd.pitch)
+			for (int x = 0; x < spd.w; x++) {
+				((DWORD*)p)[x] = 0x010101 * (0xe0 + 0x08*y/spd.h + 0x18*(spd.w-x)/spd.w);
+			}
+	}
+
+	for (int i = 1, pics = cols*rows; i <= pics; i++) {
+		REFERENCE_TIME rt = rtDur * i / (pics+1);
+
+		// a keyframe close to the tile time does not need to decode the frames before it
+		if (!kfs.IsEmpty()) {
+			const REFERENCE_TIME rtMaxDiff = rtDur / (pics+1) / 2;
+			const int k = rangebsearch(rt, kfs);
+			REFERENCE_TIME rtKey = INVALID_TIME;
+			if (k >= 0 && rt - kfs[k] <= rtMaxDiff) {
+				rtKey = kfs[k];
+			}
+			if (k + 1 < (int)kfs.GetCount() && kfs[k+1] - rt <= rtMaxDiff && (rtKey == INVALID_TIME || kfs[k+1] - rt < rt - rtKey)) {
+				rtKey = kfs[k+1];
+			}
+			if (rtKey != INVALID_TIME) {
+				rt = rtKey;
+			}
+		}
+
+		int col = (i-1)%cols;
+		int row = (i-1)/cols;
+
+		CPoint p(MARGIN + col * (thumbsize.cx + MARGIN), INFO_HEIGHT + MARGIN + row * (thumbsize.cy + MARGIN));
+
+		job.rts.Add(rt);
+		job.rects.Add(CRect(p, thumbsize));
+	}
+
+	// every worker seeks its own graph, this thread works with the probe graph
+	CAtlArray<HANDLE> threads;
+	for (int i = 1; i < m_nWorkers; i++) {
+		HANDLE hThread = ::CreateThread(NULL, 0, GrabThread, &job, 0, NULL);
+		if (hThread) {
+			threads.Add(hThread);
+		}
+	}
+	GrabTiles(&job, grabber);
+
+	if (threads.GetCount()) {
+		WaitForMultipleObjects((DWORD)threads.GetCount(), threads.GetData(), TRUE, INFINITE);
+		for (size_t i = 0; i < threads.GetCount(); i++) {
+			CloseHandle(threads[i]);
+		}
+	}
+
+	grabber.Close();
+
+	if (!job.grabbed) {
+		return IDS_MAINFRM_55;
+	}
+
+	{
+		CCritSec csSubLock;
+		RECT bbox;
+
+		CRenderedTextSubtitle rts(&csSubLock);
+		rts.CreateDefaultStyle(0);
+		rts.m_dstScreenSize.SetSize(width, height);
+		STSStyle* style = DNew STSStyle();
+		style->marginRect.SetRect(MARGIN, MARGIN, MARGIN, height-INFO_HEIGHT-MARGIN);
+		rts.AddStyle(_T("thumbs"), style);
+
+		CStringW str;
+		str.Format(L"{\\an9\\fs%d\\b1\\bord0\\shad0\\1c&Hffffff&}%s", INFO_HEIGHT-10, width >= 550 ? L"MPC-BE" : L"MPC");
+
+		rts.Add(str, true, 0, 1, _T("thumbs"), _T(""), _T(""), CRect(0,0,0,0), -1);
+
+		DVD_HMSF_TIMECODE hmsf = RT2HMS_r(rtDur);
+
+		CStringW fs;
+		WIN32_FIND_DATA wfd;
+		HANDLE hFind = FindFirstFile(m_fn, &wfd);
+		if (hFind != INVALID_HANDLE_VALUE) {
+			FindClose(hFind);
+
+			__int64 size = (__int64(wfd.nFileSizeHigh)<<32)|wfd.nFileSizeLow;
+			const int MAX_FILE_SIZE_BUFFER = 65;
+			WCHAR szFileSize[MAX_FILE_SIZE_BUFFER];
+			StrFormatByteSizeW(size, szFileSize, MAX_FILE_SIZE_BUFFER);
+			CStringW strByteSize;
+			strByteSize.Format(_T("%I64d"), size);
+			for (int i = strByteSize.GetLength() - 3; i > 0; i -= 3) {
+				strByteSize.Insert(i, L'\x00A0');
+			}
+			fs.Format(ResStr(IDS_MAINFRM_58), szFileSize, strByteSize);
+		}
+
+		CStringW ar;
+		if (dar.cx > 0 && dar.cy > 0 && dar.cx != picsize.cx && dar.cy != picsize.cy) {
+			ar.Format(L"(%d:%d)", dar.cx, dar.cy);
+		}
+
+		str.Format(ResStr(IDS_MAINFRM_59),
+				   m_title, fs, picsize.cx, picsize.cy, ar, hmsf.bHours, hmsf.bMinutes, hmsf.bSeconds);
+		rts.Add(str, true, 0, 1, _T("thumbs"));
+
+		rts.Render(spd, 0, 25, bbox);
+	}
+
+	SaveDIBFile(m_dst, (BYTE*)dib, m_quality, m_levelPNG);
+
+	m_dwTime = GetTickCount() - dwStart;
+
+	return 0;
+}
+
+DWORD CThumbnailSheet::ThreadProc()
+{
+	SetThreadName((DWORD)-1, "CThumbnailSheet");
+
+	m_nError = IDS_MAINFRM_55;
+	if (SUCCEEDED(CoInitialize(NULL))) {
+		Save();
+		CoUninitialize();
+	}
+
+	if (m_hNotify) {
+		::PostMessage(m_hNotify, WM_THUMBNAILS_SAVED, m_nError, 0);
+	}
+
+	return 0;
+}
+
+bool CThumbnailSheet::SaveAsync(HWND hWnd)
+{
+	if (ThreadExists()) {
+		return false;
+	}
+
+	m_hNotify = hWnd;
+	return !!Create();
+}
+
+void CThumbnailSheet::Wait()
+{
+	if (ThreadExists()) {
+		CAMThread::Close();
+	}
+}
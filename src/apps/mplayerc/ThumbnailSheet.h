@@ -0,0 +1,67 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+
+#include <atlcoll.h>
+
+// Thumbnail sheet of a file. The frames are grabbed by workers, each with its own
+// CKeyFrameGrabber graph, so the playback graph is neither paused nor seeked.
+
+class CThumbnailSheet : protected CAMThread
+{
+	CString			m_fn, m_title, m_dst;
+	int				m_width, m_cols, m_rows;
+	ULONG			m_quality;
+	int				m_levelPNG;
+	int				m_nWorkers;
+
+	HWND			m_hNotify;
+	UINT			m_nError;
+	DWORD			m_dwTime;
+
+	UINT SaveSheet();
+	DWORD ThreadProc();
+
+public:
+	// nWorkers = 0 uses one graph per core, at most 8
+	CThumbnailSheet(LPCTSTR fn, LPCTSTR title, LPCTSTR dst, int nWorkers = 0);
+	~CThumbnailSheet();
+
+	// returns 0 or the id of the error string, COM has to be initialized
+	UINT Save();
+	// Save() in a thread, posts WM_THUMBNAILS_SAVED to hWnd when done
+	bool SaveAsync(HWND hWnd);
+	void Wait();
+
+	LPCTSTR GetFileName() const {
+		return m_dst;
+	}
+	UINT GetError() const {
+		return m_nError;
+	}
+	DWORD GetTime() const { // ms
+		return m_dwTime;
+	}
+	int GetWorkers() const {
+		return m_nWorkers;
+	}
+};
@@ -0,0 +1,1426 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include "VideoProbe.h"
+#include "../../DSUtil/DSUtil.h"
+#include "../../DSUtil/VideoParser.h"
+
+#define PROBE_BLOCK		(16 * 1024)
+#define PROBE_ES_SIZE	(512 * 1024)	// video data collected from a transport stream
+#define UNKNOWN_SIZE	(~0ULL)
+
+static DWORD RB16(const BYTE* p) { return (p[0] << 8) | p[1]; }
+static DWORD RB24(const BYTE* p) { return (p[0] << 16) | (p[1] << 8) | p[2]; }
+static DWORD RB32(const BYTE* p) { return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+static UINT64 RB64(const BYTE* p) { return ((UINT64)RB32(p) << 32) | RB32(p + 4); }
+static DWORD RL32(const BYTE* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24); }
+
+// Reads the file in small blocks and counts every byte taken from it.
+
+class CProbeReader
+{
+	HANDLE	m_hFile;
+	__int64	m_len;
+	__int64	m_pos;
+	__int64	m_read;
+	__int64	m_budget;
+
+	BYTE	m_buf[PROBE_BLOCK];
+	__int64	m_bufpos;
+	DWORD	m_buflen;
+
+public:
+	CProbeReader(LPCTSTR fn, __int64 budget)
+		: m_len(0)
+		, m_pos(0)
+		, m_read(0)
+		, m_budget(budget)
+		, m_bufpos(0)
+		, m_buflen(0) {
+		m_hFile = CreateFile(fn, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		LARGE_INTEGER size;
+		if (m_hFile != INVALID_HANDLE_VALUE && GetFileSizeEx(m_hFile, &size)) {
+			m_len = size.QuadPart;
+		}
+	}
+
+	~CProbeReader() {
+		if (m_hFile != INVALID_HANDLE_VALUE) {
+			CloseHandle(m_hFile);
+		}
+	}
+
+	bool	IsOpen() const { return m_hFile != INVALID_HANDLE_VALUE && m_len > 0; }
+	__int64	GetLength() const { return m_len; }
+	__int64	GetPos() const { return m_pos; }
+	__int64	GetRead() const { return m_read; }
+	void	Seek(__int64 pos) { m_pos = pos; }
+
+	bool Read(BYTE* p, DWORD size) {
+		if (m_pos < 0 || m_pos + size > m_len) {
+			return false;
+		}
+
+		while (size) {
+			if (m_pos < m_bufpos || m_pos >= m_bufpos + m_buflen) {
+				const DWORD len = (DWORD)min(PROBE_BLOCK, m_len - m_pos);
+				if (m_read + len > m_budget) {
+					return false;
+				}
+
+				LARGE_INTEGER li;
+				li.QuadPart = m_pos;
+				DWORD dwRead = 0;
+				if (!SetFilePointerEx(m_hFile, li, NULL, FILE_BEGIN) || !ReadFile(m_hFile, m_buf, len, &dwRead, NULL) || dwRead != len) {
+					m_buflen = 0;
+					return false;
+				}
+				m_bufpos	= m_pos;
+				m_buflen	= len;
+				m_read		+= len;
+			}
+
+			const DWORD offset	= (DWORD)(m_pos - m_bufpos);
+			const DWORD n		= min(size, m_buflen - offset);
+			memcpy(p, m_buf + offset, n);
+			p		+= n;
+			size	-= n;
+			m_pos	+= n;
+		}
+
+		return true;
+	}
+
+	bool ReadByte(BYTE& b) {
+		return Read(&b, 1);
+	}
+};
+
+//
+// elementary streams
+//
+
+static bool ParseSPS(const BYTE* nal, size_t len, VideoProbe& probe)
+{
+	// without the emulation prevention bytes
+	BYTE buf[512];
+	size_t n = 0;
+	for (size_t i = 1; i < len && n < sizeof(buf); i++) {
+		if (i + 2 < len && nal[i] == 0 && nal[i + 1] == 0 && nal[i + 2] == 3) {
+			buf[n++] = 0;
+			if (n < sizeof(buf)) {
+				buf[n++] = 0;
+			}
+			i += 2;
+			continue;
+		}
+		buf[n++] = nal[i];
+	}
+
+	avc_hdr h;
+	if (!ParseAVCHeader(CGolombBuffer(buf, (int)n), h)) {
+		return false;
+	}
+
+	probe.nInterlaced = h.interlaced ? 1 : 0;
+	if (probe.fps == 0 && h.AvgTimePerFrame > 0) {
+		probe.fps = 10000000.0 / h.AvgTimePerFrame;
+	}
+
+	return true;
+}
+
+static bool ParseAvcC(const BYTE* p, size_t len, VideoProbe& probe)
+{
+	if (len < 8 || p[0] != 1 || (p[5] & 0x1f) == 0) {
+		return false;
+	}
+
+	const size_t size = RB16(p + 6);
+	return 8 + size <= len && ParseSPS(p + 8, size, probe);
+}
+
+// MPEG-2 or H.264 with start codes, returns true when nothing more is needed
+static bool ParseES(const BYTE* p, size_t len, bool bAVC, VideoProbe& probe)
+{
+	static const double rates[16] = {0, 24000.0/1001, 24, 25, 30000.0/1001, 30, 50, 60000.0/1001, 60};
+
+	bool bSeqHdr = false, bSeqExt = false, bProgSeq = true, bFields = false;
+	int nPictures = 0;
+
+	for (size_t i = 0; i + 9 <= len; i++) {
+		if (p[i] != 0 || p[i + 1] != 0 || p[i + 2] != 1) {
+			continue;
+		}
+
+		const BYTE* s = p + i + 3;
+		const size_t size = len - i - 3;
+
+		if (bAVC) {
+			if ((s[0] & 0x1f) == 7 && ParseSPS(s, min(size, (size_t)512), probe)) {
+				return true;
+			}
+		} else if (s[0] == 0xb3) {
+			if (probe.fps == 0) {
+				probe.fps = rates[s[4] & 0x0f];
+			}
+			bSeqHdr = true;
+		} else if (s[0] == 0xb5 && (s[1] >> 4) == 1) {
+			bProgSeq	= !!(s[2] & 0x08);
+			bSeqExt		= true;
+		} else if (s[0] == 0xb5 && (s[1] >> 4) == 8 && bSeqExt) {
+			const bool bRFF			= !!(s[4] & 0x02);
+			const bool bProgFrame	= !!(s[5] & 0x80);
+			if (bRFF && bProgFrame) {
+				probe.bPulldown = true;
+			}
+			if (!bProgFrame) {
+				bFields = true;
+			}
+			nPictures++;
+		}
+
+		if (bSeqHdr && bSeqExt && nPictures >= 16) {
+			break;
+		}
+	}
+
+	if (!bAVC && bSeqHdr) {
+		// MPEG-1 has no sequence extension, an interlaced sequence may still code progressive frames only
+		probe.nInterlaced = (bProgSeq || (nPictures && !bFields)) ? 0 : 1;
+		return bSeqExt ? nPictures >= 16 : false;
+	}
+
+	return false;
+}
+
+// MPEG-2 and H.264 are often coded interlaced, the other codecs are progressive
+// unless the container says otherwise
+static bool IsScanTypeCodec(DWORD fcc)
+{
+	DWORD upper = 0;
+	for (int i = 24; i >= 0; i -= 8) {
+		upper = (upper << 8) | (BYTE)toupper((char)(fcc >> i));
+	}
+
+	switch (upper) {
+		case 'MPG2':
+		case 'MP2V':
+		case 'MMES':
+		case 'M701':
+		case 'AVC1':
+		case 'AVC3':
+		case 'H264':
+		case 'X264':
+		case 'DAVC':
+		case 'VSSH':
+			return true;
+	}
+
+	// HDV and XDCAM
+	return (upper >> 8) == 'HDV' || (upper >> 8) == 'XDV';
+}
+
+//
+// Matroska
+//
+
+static bool ReadVint(CProbeReader& r, UINT64& v, bool bId)
+{
+	BYTE b;
+	if (!r.ReadByte(b)) {
+		return false;
+	}
+
+	int n = 1;
+	BYTE mask = 0x80;
+	while (n <= 8 && !(b & mask)) {
+		n++;
+		mask >>= 1;
+	}
+	if (n > 8) {
+		return false;
+	}
+
+	v = bId ? b : (b & (mask - 1));
+	bool bAllOnes = (b & (mask - 1)) == mask - 1;
+	for (int i = 1; i < n; i++) {
+		if (!r.ReadByte(b)) {
+			return false;
+		}
+		v = (v << 8) | b;
+		bAllOnes = bAllOnes && b == 0xff;
+	}
+
+	if (!bId && bAllOnes) {
+		v = UNKNOWN_SIZE;
+	}
+
+	return true;
+}
+
+static bool ReadElement(CProbeReader& r, UINT64& id, UINT64& size)
+{
+	return ReadVint(r, id, true) && ReadVint(r, size, false);
+}
+
+static bool ReadUInt(CProbeReader& r, UINT64 size, UINT64& v)
+{
+	BYTE buf[8];
+	if (size > 8 || !r.Read(buf, (DWORD)size)) {
+		return false;
+	}
+
+	v = 0;
+	for (UINT64 i = 0; i < size; i++) {
+		v = (v << 8) | buf[i];
+	}
+	return true;
+}
+
+static bool ProbeMatroskaTrack(CProbeReader& r, __int64 end, VideoProbe& probe)
+{
+	UINT64 type = 0, duration = 0, interlaced = 0;
+	CStringA codec;
+	CAtlArray<BYTE> priv;
+
+	UINT64 id, size;
+	while (r.GetPos() < end && ReadElement(r, id, size) && size != UNKNOWN_SIZE) {
+		const __int64 next = r.GetPos() + size;
+
+		if (id == 0x83) {
+			ReadUInt(r, size, type);
+		} else if (id == 0x23E383) {
+			ReadUInt(r, size, duration);
+		} else if (id == 0x86 && size < 64) {
+			char buf[64] = {0};
+			r.Read((BYTE*)buf, (DWORD)size);
+			codec = buf;
+		} else if (id == 0x63A2 && size < 4096) {
+			priv.SetCount((size_t)size);
+			if (!r.Read(priv.GetData(), (DWORD)size)) {
+				priv.RemoveAll();
+			}
+		} else if (id == 0xE0) {
+			continue; // Video, read its children
+		} else if (id == 0x9A) {
+			ReadUInt(r, size, interlaced);
+		}
+
+		r.Seek(next);
+	}
+
+	if (type != 1) {
+		return false;
+	}
+
+	if (codec == "V_MS/VFW/FOURCC") {
+		probe.bScanTypeCodec = priv.GetCount() >= 20 && IsScanTypeCodec(RB32(priv.GetData() + 16));
+	} else {
+		probe.bScanTypeCodec = codec == "V_MPEG2" || codec == "V_MPEG4/ISO/AVC";
+	}
+
+	if (duration) {
+		probe.fps = 1000000000.0 / duration;
+	}
+	if (interlaced == 1 || interlaced == 2) {
+		probe.nInterlaced = interlaced == 1 ? 1 : 0;
+	}
+
+	if (!priv.IsEmpty()) {
+		if (codec == "V_MPEG4/ISO/AVC") {
+			const int nInterlaced = probe.nInterlaced;
+			ParseAvcC(priv.GetData(), priv.GetCount(), probe);
+			if (nInterlaced >= 0) {
+				probe.nInterlaced = nInterlaced;
+			}
+		} else if (codec == "V_MPEG2" && probe.nInterlaced < 0) {
+			ParseES(priv.GetData(), priv.GetCount(), false, probe);
+		}
+	}
+
+	return true;
+}
+
+static bool ProbeMatroska(CProbeReader& r, VideoProbe& probe)
+{
+	UINT64 id, size;
+
+	r.Seek(0);
+	if (!ReadElement(r, id, size) || id != 0x1A45DFA3 || size == UNKNOWN_SIZE) {
+		return false;
+	}
+	r.Seek(r.GetPos() + size);
+
+	if (!ReadElement(r, id, size) || id != 0x18538067) {
+		return false;
+	}
+	const __int64 end = size == UNKNOWN_SIZE ? r.GetLength() : r.GetPos() + size;
+
+	while (r.GetPos() < end && ReadElement(r, id, size) && size != UNKNOWN_SIZE) {
+		const __int64 next = r.GetPos() + size;
+
+		if (id == 0x1654AE6B) {
+			// Tracks, the first video track
+			while (r.GetPos() < next && ReadElement(r, id, size) && size != UNKNOWN_SIZE) {
+				const __int64 entry = r.GetPos() + size;
+				if (id == 0xAE && ProbeMatroskaTrack(r, entry, probe)) {
+					return true;
+				}
+				r.Seek(entry);
+			}
+			return false;
+		}
+
+		if (id == 0x1F43B675) {
+			break; // Cluster
+		}
+
+		r.Seek(next);
+	}
+
+	return false;
+}
+
+//
+// MP4
+//
+
+static bool FindBox(CProbeReader& r, __int64 start, __int64 end, DWORD type, __int64& body, __int64& next)
+{
+	for (__int64 pos = start; pos + 8 <= end; pos = next) {
+		BYTE h[16];
+		r.Seek(pos);
+		if (!r.Read(h, 8)) {
+			return false;
+		}
+
+		UINT64 size = RB32(h);
+		int hdrsize = 8;
+		if (size == 1) {
+			if (!r.Read(h + 8, 8)) {
+				return false;
+			}
+			size = RB64(h + 8);
+			hdrsize = 16;
+		} else if (size == 0) {
+			size = end - pos;
+		}
+
+		if (size < (UINT64)hdrsize || pos + (__int64)size > end) {
+			return false;
+		}
+
+		body = pos + hdrsize;
+		next = pos + size;
+		if (RB32(h + 4) == type) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool ProbeMP4Track(CProbeReader& r, __int64 start, __int64 end, VideoProbe& probe)
+{
+	__int64 mdia, mdiaend, body, next;
+	if (!FindBox(r, start, end, 'mdia', mdia, mdiaend)) {
+		return false;
+	}
+
+	BYTE buf[32];
+
+	if (!FindBox(r, mdia, mdiaend, 'hdlr', body, next) || !r.Read(buf, 12) || RB32(buf + 8) != 'vide') {
+		return false;
+	}
+
+	if (!FindBox(r, mdia, mdiaend, 'mdhd', body, next) || !r.Read(buf, 24)) {
+		return false;
+	}
+	const DWORD timescale = RB32(buf + (buf[0] == 1 ? 20 : 12));
+
+	__int64 minf, minfend, stbl, stblend;
+	if (!FindBox(r, mdia, mdiaend, 'minf', minf, minfend) || !FindBox(r, minf, minfend, 'stbl', stbl, stblend)) {
+		return false;
+	}
+
+	if (FindBox(r, stbl, stblend, 'stts', body, next) && r.Read(buf, 8)) {
+		const DWORD count = min(RB32(buf + 4), 512UL);
+		DWORD maxcount = 0, delta = 0;
+		for (DWORD i = 0; i < count && r.Read(buf, 8); i++) {
+			const DWORD n = RB32(buf);
+			const DWORD d = RB32(buf + 4);
+			if (n > 1 && delta && d != delta) {
+				probe.bVFR = true;
+			}
+			if (n > maxcount) {
+				maxcount	= n;
+				delta		= d;
+			}
+		}
+		if (timescale && delta) {
+			probe.fps = (double)timescale / delta;
+		}
+	}
+
+	// the first sample entry, its boxes follow the 78 bytes of the visual sample entry
+	if (FindBox(r, stbl, stblend, 'stsd', body, next) && r.Read(buf, 16)) {
+		const __int64 entry = body + 8;
+		const __int64 entryend = min(entry + RB32(buf + 8), next);
+		const DWORD format = RB32(buf + 12);
+		probe.bScanTypeCodec = IsScanTypeCodec(format);
+
+		__int64 box, boxend;
+		if (FindBox(r, entry + 86, entryend, 'fiel', box, boxend) && r.Read(buf, 1)) {
+			probe.nInterlaced = buf[0] == 2 ? 1 : 0;
+		}
+
+		if ((format == 'avc1' || format == 'avc3') && FindBox(r, entry + 86, entryend, 'avcC', box, boxend) && boxend - box < 4096) {
+			CAtlArray<BYTE> avcC;
+			avcC.SetCount((size_t)(boxend - box));
+			r.Seek(box);
+			if (r.Read(avcC.GetData(), (DWORD)avcC.GetCount())) {
+				const int nInterlaced = probe.nInterlaced;
+				ParseAvcC(avcC.GetData(), avcC.GetCount(), probe);
+				if (nInterlaced >= 0) {
+					probe.nInterlaced = nInterlaced;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+static bool ProbeMP4(CProbeReader& r, VideoProbe& probe)
+{
+	__int64 moov, moovend;
+	if (!FindBox(r, 0, r.GetLength(), 'moov', moov, moovend)) {
+		return false;
+	}
+
+	__int64 trak, next;
+	for (__int64 pos = moov; FindBox(r, pos, moovend, 'trak', trak, next); pos = next) {
+		if (ProbeMP4Track(r, trak, next, probe)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//
+// AVI
+//
+
+static bool ProbeAVI(CProbeReader& r, VideoProbe& probe)
+{
+	BYTE buf[64];
+
+	// RIFF AVI, LIST hdrl
+	r.Seek(12);
+	if (!r.Read(buf, 12) || RB32(buf) != 'LIST' || RB32(buf + 8) != 'hdrl') {
+		return false;
+	}
+	const __int64 hdrlend = 20 + RL32(buf + 4);
+
+	bool bVideo = false;
+
+	for (__int64 pos = 24; pos + 8 <= hdrlend; ) {
+		r.Seek(pos);
+		if (!r.Read(buf, 12)) {
+			break;
+		}
+		const DWORD size = RL32(buf + 4);
+		const __int64 next = pos + 8 + size + (size & 1);
+
+		if (RB32(buf) == 'LIST' && RB32(buf + 8) == 'strl') {
+			// the chunks of the stream
+			for (__int64 chunk = pos + 12; chunk + 8 <= next; ) {
+				r.Seek(chunk);
+				if (!r.Read(buf, 8)) {
+					break;
+				}
+				const DWORD chunksize = RL32(buf + 4);
+				const DWORD fcc = RB32(buf);
+
+				if (fcc == 'strh' && chunksize >= 28 && r.Read(buf, 28) && RB32(buf) == 'vids') {
+					const DWORD scale	= RL32(buf + 20);
+					const DWORD rate	= RL32(buf + 24);
+					if (scale && rate) {
+						probe.fps = (double)rate / scale;
+					}
+					probe.bScanTypeCodec = IsScanTypeCodec(RB32(buf + 4));
+					bVideo = true;
+				} else if (fcc == 'strf' && bVideo && chunksize >= 20 && r.Read(buf, 20)) {
+					probe.bScanTypeCodec = probe.bScanTypeCodec || IsScanTypeCodec(RB32(buf + 16));
+				} else if (fcc == 'vprp' && bVideo && chunksize >= 36 && r.Read(buf, 36)) {
+					const DWORD fields = RL32(buf + 32);
+					if (fields == 1 || fields == 2) {
+						probe.nInterlaced = fields == 2 ? 1 : 0;
+					}
+				}
+
+				chunk += 8 + chunksize + (chunksize & 1);
+			}
+
+			if (bVideo) {
+				return true;
+			}
+		}
+
+		pos = next;
+	}
+
+	return false;
+}
+
+//
+// FLV
+//
+
+static bool ProbeFLV(CProbeReader& r, VideoProbe& probe)
+{
+	BYTE buf[16];
+
+	r.Seek(5);
+	if (!r.Read(buf, 4)) {
+		return false;
+	}
+	__int64 pos = RB32(buf) + 4;
+
+	bool bVideo = false;
+
+	for (int i = 0; i < 16; i++) {
+		r.Seek(pos);
+		if (!r.Read(buf, 11)) {
+			break;
+		}
+		const BYTE type		= buf[0] & 0x1f;
+		const DWORD size	= RB24(buf + 1);
+		pos += 11 + size + 4;
+
+		if (type == 18 && size < 64 * 1024) {
+			// onMetaData, the number after the "framerate" key
+			CAtlArray<BYTE> data;
+			data.SetCount(size);
+			if (r.Read(data.GetData(), size)) {
+				static const BYTE key[] = {0x00, 0x09, 'f', 'r', 'a', 'm', 'e', 'r', 'a', 't', 'e', 0x00};
+				for (DWORD j = 0; j + sizeof(key) + 8 <= size; j++) {
+					if (!memcmp(data.GetData() + j, key, sizeof(key))) {
+						UINT64 v = RB64(data.GetData() + j + sizeof(key));
+						double fps;
+						memcpy(&fps, &v, sizeof(fps));
+						if (fps > 0 && fps < 1000) {
+							probe.fps = fps;
+						}
+						break;
+					}
+				}
+			}
+		} else if (type == 9 && size > 5 && size < 4096) {
+			CAtlArray<BYTE> data;
+			data.SetCount(size);
+			if (!r.Read(data.GetData(), size)) {
+				break;
+			}
+			bVideo = true;
+			probe.bScanTypeCodec = (data[0] & 0x0f) == 7;
+
+			// AVC sequence header
+			if ((data[0] & 0x0f) == 7 && data[1] == 0) {
+				ParseAvcC(data.GetData() + 5, size - 5, probe);
+				break;
+			}
+		} else if (type == 9) {
+			bVideo = true;
+			probe.bScanTypeCodec = r.Read(buf, 1) && (buf[0] & 0x0f) == 7;
+			break;
+		}
+	}
+
+	return bVideo;
+}
+
+//
+// MPEG-TS
+//
+
+static bool ProbeTS(CProbeReader& r, VideoProbe& probe, int offset)
+{
+	const int packetsize = 188 + offset;
+
+	// MPEG-1, MPEG-2 or H.264, the scan type comes from the stream
+	probe.bScanTypeCodec = true;
+
+	WORD pmtpid = 0, videopid = 0;
+	bool bAVC = false;
+
+	CAtlArray<BYTE> es;
+	size_t parsed = 0;
+
+	BYTE p[192];
+	for (__int64 pos = 0; pos + packetsize <= r.GetLength(); pos += packetsize) {
+		r.Seek(pos);
+		if (!r.Read(p, packetsize)) {
+			break;
+		}
+
+		const BYTE* pkt = p + offset;
+		if (pkt[0] != 0x47) {
+			return false;
+		}
+
+		const bool bStart = !!(pkt[1] & 0x40);
+		const WORD pid = ((pkt[1] & 0x1f) << 8) | pkt[2];
+		const BYTE afc = (pkt[3] >> 4) & 3;
+		if (!(afc & 1)) {
+			continue;
+		}
+
+		int i = 4;
+		if (afc & 2) {
+			i += 1 + pkt[4];
+		}
+		if (i >= 188) {
+			continue;
+		}
+
+		if (!videopid && bStart && (pid == 0 || (pmtpid && pid == pmtpid))) {
+			i += 1 + pkt[i]; // pointer_field
+			if (i + 12 > 188) {
+				continue;
+			}
+			const BYTE* sec = pkt + i;
+			const int end = min(3 + (int)(RB16(sec + 1) & 0xfff) - 4, 188 - i);
+
+			if (pid == 0 && sec[0] == 0x00) {
+				for (int j = 8; j + 4 <= end; j += 4) {
+					if (RB16(sec + j)) {
+						pmtpid = RB16(sec + j + 2) & 0x1fff;
+						break;
+					}
+				}
+			} else if (sec[0] == 0x02) {
+				for (int j = 12 + (RB16(sec + 10) & 0xfff); j + 5 <= end; j += 5 + (RB16(sec + j + 3) & 0xfff)) {
+					const BYTE type = sec[j];
+					if (type == 0x01 || type == 0x02 || type == 0x1b) {
+						videopid	= RB16(sec + j + 1) & 0x1fff;
+						bAVC		= type == 0x1b;
+						break;
+					}
+				}
+			}
+			continue;
+		}
+
+		if (videopid && pid == videopid) {
+			const size_t n = es.GetCount();
+			es.SetCount(n + 188 - i);
+			memcpy(es.GetData() + n, pkt + i, 188 - i);
+
+			if (es.GetCount() >= parsed + 64 * 1024 || es.GetCount() >= PROBE_ES_SIZE) {
+				parsed = es.GetCount();
+				if (ParseES(es.GetData(), es.GetCount(), bAVC, probe) || es.GetCount() >= PROBE_ES_SIZE) {
+					return probe.nInterlaced >= 0;
+				}
+			}
+		}
+	}
+
+	if (!es.IsEmpty() && parsed < es.GetCount()) {
+		ParseES(es.GetData(), es.GetCount(), bAVC, probe);
+	}
+
+	return probe.nInterlaced >= 0;
+}
+
+enum container_t {
+	CONTAINER_NONE,
+	CONTAINER_MKV,
+	CONTAINER_AVI,
+	CONTAINER_FLV,
+	CONTAINER_MP4,
+	CONTAINER_TS,
+	CONTAINER_TS4,	// 192 byte packets
+};
+
+static container_t GetContainer(CProbeReader& r)
+{
+	BYTE h[200];
+	memset(h, 0, sizeof(h));
+	r.Seek(0);
+	if (!r.Read(h, (DWORD)min((__int64)sizeof(h), r.GetLength()))) {
+		return CONTAINER_NONE;
+	}
+
+	const DWORD type = RB32(h + 4);
+
+	if (RB32(h) == 0x1A45DFA3) {
+		return CONTAINER_MKV;
+	} else if (RB32(h) == 'RIFF' && RB32(h + 8) == 'AVI ') {
+		return CONTAINER_AVI;
+	} else if (h[0] == 'F' && h[1] == 'L' && h[2] == 'V') {
+		return CONTAINER_FLV;
+	} else if (type == 'ftyp' || type == 'moov' || type == 'mdat' || type == 'free' || type == 'skip' || type == 'wide') {
+		return CONTAINER_MP4;
+	} else if (r.GetLength() >= 192 * 2) {
+		if (h[0] == 0x47 && h[188] == 0x47) {
+			return CONTAINER_TS;
+		} else if (h[4] == 0x47 && h[196] == 0x47) {
+			return CONTAINER_TS4;
+		}
+	}
+
+	return CONTAINER_NONE;
+}
+
+bool ProbeVideo(LPCTSTR fn, VideoProbe& probe, __int64 nBudget)
+{
+	probe.fps			= 0;
+	probe.bVFR			= false;
+	probe.nInterlaced	= -1;
+	probe.bPulldown		= false;
+	probe.bScanTypeCodec	= false;
+	probe.nBytesRead	= 0;
+
+	const DWORD start = GetTickCount();
+
+	CProbeReader r(fn, nBudget);
+	if (!r.IsOpen()) {
+		return false;
+	}
+
+	bool bRet = false;
+
+	switch (GetContainer(r)) {
+		case CONTAINER_MKV:
+			bRet = ProbeMatroska(r, probe);
+			break;
+		case CONTAINER_AVI:
+			bRet = ProbeAVI(r, probe);
+			break;
+		case CONTAINER_FLV:
+			bRet = ProbeFLV(r, probe);
+			break;
+		case CONTAINER_MP4:
+			bRet = ProbeMP4(r, probe);
+			break;
+		case CONTAINER_TS:
+			bRet = ProbeTS(r, probe, 0);
+			break;
+		case CONTAINER_TS4:
+			bRet = ProbeTS(r, probe, 4);
+			break;
+	}
+
+	// only MPEG-2 and H.264 without a flag are left to MediaInfo
+	if (bRet && probe.nInterlaced < 0 && !probe.bScanTypeCodec) {
+		probe.nInterlaced = 0;
+	}
+
+	probe.nBytesRead = r.GetRead();
+	bRet = bRet && probe.fps > 0 && probe.nInterlaced >= 0;
+
+	DbgLog((LOG_TRACE, 3, L"ProbeVideo() : '%s', fps = %.3f, vfr = %d, interlaced = %d, pulldown = %d, %I64d bytes, %u ms%s",
+			fn, probe.fps, probe.bVFR, probe.nInterlaced, probe.bPulldown, probe.nBytesRead, GetTickCount() - start, bRet ? L"" : L", fallback"));
+
+	return bRet;
+}
+
+//
+// stream summary
+//
+
+struct streams_t {
+	REFERENCE_TIME	duration;
+	CString			title;
+	CString			codec;	// of the first video stream
+	int				width, height;
+	int				nVideo, nAudio, nSubs;
+};
+
+static CString GetCodecName(DWORD fcc)
+{
+	static const struct {
+		DWORD	fcc;
+		LPCTSTR	name;
+	} names[] = {
+		{'AVC1', _T("H.264")}, {'AVC3', _T("H.264")}, {'H264', _T("H.264")}, {'X264', _T("H.264")},
+		{'HVC1', _T("HEVC")}, {'HEV1', _T("HEVC")}, {'HEVC', _T("HEVC")},
+		{'MP4V', _T("MPEG-4")}, {'XVID', _T("MPEG-4")}, {'DIVX', _T("MPEG-4")}, {'DX50', _T("MPEG-4")}, {'FMP4', _T("MPEG-4")},
+		{'MPG2', _T("MPEG-2")}, {'WVC1', _T("VC-1")}, {'WMV3', _T("WMV9")}, {'VP80', _T("VP8")}, {'VP90', _T("VP9")},
+		{'MJPG', _T("MJPEG")},
+	};
+
+	DWORD upper = 0;
+	CString str;
+	for (int i = 24; i >= 0; i -= 8) {
+		const char c = (char)(fcc >> i);
+		upper = (upper << 8) | (BYTE)toupper(c);
+		if (c > ' ' && c < 127) {
+			str += (TCHAR)c;
+		}
+	}
+
+	for (size_t i = 0; i < _countof(names); i++) {
+		if (names[i].fcc == upper) {
+			return names[i].name;
+		}
+	}
+
+	return str;
+}
+
+static CString ReadString(CProbeReader& r, UINT64 size, bool bUTF8)
+{
+	if (size == 0 || size >= 1024) {
+		return L"";
+	}
+
+	char buf[1024];
+	if (!r.Read((BYTE*)buf, (DWORD)size)) {
+		return L"";
+	}
+	buf[size] = 0;
+
+	CString str = bUTF8 ? UTF8ToString(buf) : CString(buf);
+	return str.Trim();
+}
+
+static CString FormatSummary(const streams_t& s)
+{
+	CString str = s.codec;
+	if (s.width > 0 && s.height > 0) {
+		str.AppendFormat(str.IsEmpty() ? _T("%dx%d") : _T(" %dx%d"), s.width, s.height);
+	}
+	if (str.IsEmpty() && s.nVideo) {
+		str = _T("video");
+	}
+
+	if (s.nAudio) {
+		if (!str.IsEmpty()) {
+			str += _T(", ");
+		}
+		str.AppendFormat(_T("%d audio"), s.nAudio);
+	}
+	if (s.nSubs) {
+		if (!str.IsEmpty()) {
+			str += _T(", ");
+		}
+		str.AppendFormat(s.nSubs > 1 ? _T("%d subtitles") : _T("%d subtitle"), s.nSubs);
+	}
+
+	return str;
+}
+
+static bool ReadFloat(CProbeReader& r, UINT64 size, double& v)
+{
+	UINT64 u;
+	if ((size != 4 && size != 8) || !ReadUInt(r, size, u)) {
+		return false;
+	}
+
+	if (size == 4) {
+		const DWORD d = (DWORD)u;
+		float f;
+		memcpy(&f, &d, sizeof(f));
+		v = f;
+	} else {
+		memcpy(&v, &u, sizeof(v));
+	}
+
+	return true;
+}
+
+static void InfoMatroskaTrack(CProbeReader& r, __int64 end, streams_t& s)
+{
+	UINT64 type = 0, width = 0, height = 0;
+	CStringA codec;
+	DWORD fcc = 0;
+
+	UINT64 id, size;
+	while (r.GetPos() < end && ReadElement(r, id, size) && size != UNKNOWN_SIZE) {
+		const __int64 next = r.GetPos() + size;
+
+		if (id == 0x83) {
+			ReadUInt(r, size, type);
+		} else if (id == 0x86 && size < 64) {
+			char buf[64] = {0};
+			r.Read((BYTE*)buf, (DWORD)size);
+			codec = buf;
+		} else if (id == 0x63A2 && size >= 20) {
+			// the BITMAPINFOHEADER of V_MS/VFW/FOURCC
+			BYTE bih[20];
+			if (r.Read(bih, sizeof(bih))) {
+				fcc = RB32(bih + 16);
+			}
+		} else if (id == 0xE0) {
+			continue; // Video, read its children
+		} else if (id == 0xB0) {
+			ReadUInt(r, size, width);
+		} else if (id == 0xBA) {
+			ReadUInt(r, size, height);
+		}
+
+		r.Seek(next);
+	}
+
+	if (type == 1 && !s.nVideo++) {
+		if (codec == "V_MS/VFW/FOURCC") {
+			s.codec = GetCodecName(fcc);
+		} else if (codec == "V_MPEG4/ISO/AVC") {
+			s.codec = _T("H.264");
+		} else if (codec == "V_MPEGH/ISO/HEVC") {
+			s.codec = _T("HEVC");
+		} else if (codec == "V_MPEG2") {
+			s.codec = _T("MPEG-2");
+		} else if (codec == "V_MPEG1") {
+			s.codec = _T("MPEG-1");
+		} else if (codec.Left(11) == "V_MPEG4/ISO") {
+			s.codec = _T("MPEG-4");
+		} else if (codec.Left(2) == "V_") {
+			s.codec = CString(codec.Mid(2));
+		}
+		s.width		= (int)width;
+		s.height	= (int)height;
+	} else if (type == 2) {
+		s.nAudio++;
+	} else if (type == 0x11) {
+		s.nSubs++;
+	}
+}
+
+static bool InfoMatroska(CProbeReader& r, streams_t& s)
+{
+	UINT64 id, size;
+
+	r.Seek(0);
+	if (!ReadElement(r, id, size) || id != 0x1A45DFA3 || size == UNKNOWN_SIZE) {
+		return false;
+	}
+	r.Seek(r.GetPos() + size);
+
+	if (!ReadElement(r, id, size) || id != 0x18538067) {
+		return false;
+	}
+	const __int64 end = size == UNKNOWN_SIZE ? r.GetLength() : r.GetPos() + size;
+
+	bool bTracks = false;
+
+	while (r.GetPos() < end && ReadElement(r, id, size) && size != UNKNOWN_SIZE) {
+		const __int64 next = r.GetPos() + size;
+
+		if (id == 0x1549A966) {
+			// Info
+			UINT64 scale = 1000000;
+			double duration = 0;
+			while (r.GetPos() < next && ReadElement(r, id, size) && size != UNKNOWN_SIZE) {
+				const __int64 child = r.GetPos() + size;
+				if (id == 0x2AD7B1) {
+					ReadUInt(r, size, scale);
+				} else if (id == 0x4489) {
+					ReadFloat(r, size, duration);
+				} else if (id == 0x7BA9) {
+					s.title = ReadString(r, size, true);
+				}
+				r.Seek(child);
+			}
+			s.duration = (REFERENCE_TIME)(duration * scale / 100);
+		} else if (id == 0x1654AE6B) {
+			// Tracks
+			while (r.GetPos() < next && ReadElement(r, id, size) && size != UNKNOWN_SIZE) {
+				const __int64 entry = r.GetPos() + size;
+				if (id == 0xAE) {
+					InfoMatroskaTrack(r, entry, s);
+				}
+				r.Seek(entry);
+			}
+			bTracks = true;
+		} else if (id == 0x1F43B675) {
+			break; // Cluster
+		}
+
+		r.Seek(next);
+	}
+
+	return bTracks;
+}
+
+static bool InfoMP4(CProbeReader& r, streams_t& s)
+{
+	__int64 moov, moovend, body, next;
+	if (!FindBox(r, 0, r.GetLength(), 'moov', moov, moovend)) {
+		return false;
+	}
+
+	BYTE buf[48];
+
+	if (FindBox(r, moov, moovend, 'mvhd', body, next) && r.Read(buf, 32)) {
+		const DWORD timescale	= RB32(buf + (buf[0] == 1 ? 20 : 12));
+		const UINT64 duration	= buf[0] == 1 ? RB64(buf + 24) : RB32(buf + 16);
+		if (timescale && duration != (buf[0] == 1 ? ~0ULL : 0xffffffffULL)) {
+			s.duration = (REFERENCE_TIME)(10000000.0 * duration / timescale);
+		}
+	}
+
+	__int64 trak, trakend;
+	for (__int64 pos = moov; FindBox(r, pos, moovend, 'trak', trak, trakend); pos = trakend) {
+		__int64 mdia, mdiaend;
+		if (!FindBox(r, trak, trakend, 'mdia', mdia, mdiaend) || !FindBox(r, mdia, mdiaend, 'hdlr', body, next) || !r.Read(buf, 12)) {
+			continue;
+		}
+
+		const DWORD handler = RB32(buf + 8);
+		if (handler == 'soun') {
+			s.nAudio++;
+		} else if (handler == 'sbtl' || handler == 'subt' || handler == 'subp' || handler == 'text') {
+			s.nSubs++;
+		} else if (handler == 'vide' && !s.nVideo++) {
+			// the format of the first sample entry, the size of the visual sample entry
+			__int64 minf, minfend, stbl, stblend;
+			if (FindBox(r, mdia, mdiaend, 'minf', minf, minfend) && FindBox(r, minf, minfend, 'stbl', stbl, stblend)
+					&& FindBox(r, stbl, stblend, 'stsd', body, next) && r.Read(buf, 44)) {
+				s.codec		= GetCodecName(RB32(buf + 12));
+				s.width		= RB16(buf + 40);
+				s.height	= RB16(buf + 42);
+			}
+		}
+	}
+
+	// udta/meta/ilst/(c)nam/data
+	__int64 udta, udtaend, meta, metaend, ilst, ilstend, nam, namend;
+	if (FindBox(r, moov, moovend, 'udta', udta, udtaend) && FindBox(r, udta, udtaend, 'meta', meta, metaend)
+			&& FindBox(r, meta + 4, metaend, 'ilst', ilst, ilstend) && FindBox(r, ilst, ilstend, 0xA96E616D, nam, namend)
+			&& FindBox(r, nam, namend, 'data', body, next) && next - body > 8) {
+		r.Seek(body + 8);
+		s.title = ReadString(r, next - body - 8, true);
+	}
+
+	return true;
+}
+
+static bool InfoAVI(CProbeReader& r, streams_t& s)
+{
+	BYTE buf[64];
+
+	// RIFF AVI, LIST hdrl
+	r.Seek(12);
+	if (!r.Read(buf, 12) || RB32(buf) != 'LIST' || RB32(buf + 8) != 'hdrl') {
+		return false;
+	}
+	const __int64 hdrlend = 20 + RL32(buf + 4);
+
+	REFERENCE_TIME rtVideo = 0;
+
+	for (__int64 pos = 24; pos + 8 <= hdrlend; ) {
+		r.Seek(pos);
+		if (!r.Read(buf, 12)) {
+			break;
+		}
+		const DWORD size = RL32(buf + 4);
+		const __int64 next = pos + 8 + size + (size & 1);
+
+		if (RB32(buf) == 'avih' && size >= 40) {
+			r.Seek(pos + 8);
+			if (r.Read(buf, 40)) {
+				s.duration	= (REFERENCE_TIME)RL32(buf) * RL32(buf + 16) * 10;
+				s.width		= RL32(buf + 32);
+				s.height	= RL32(buf + 36);
+			}
+		} else if (RB32(buf) == 'LIST' && RB32(buf + 8) == 'strl') {
+			bool bFirstVideo = false;
+
+			for (__int64 chunk = pos + 12; chunk + 8 <= next; ) {
+				r.Seek(chunk);
+				if (!r.Read(buf, 8)) {
+					break;
+				}
+				const DWORD chunksize = RL32(buf + 4);
+				const DWORD fcc = RB32(buf);
+
+				if (fcc == 'strh' && chunksize >= 36 && r.Read(buf, 36)) {
+					const DWORD type = RB32(buf);
+					if (type == 'vids' && !s.nVideo++) {
+						const DWORD scale	= RL32(buf + 20);
+						const DWORD rate	= RL32(buf + 24);
+						if (scale && rate) {
+							rtVideo = (REFERENCE_TIME)(10000000.0 * RL32(buf + 32) * scale / rate);
+						}
+						s.codec		= GetCodecName(RB32(buf + 4));
+						bFirstVideo	= true;
+					} else if (type == 'auds') {
+						s.nAudio++;
+					} else if (type == 'txts') {
+						s.nSubs++;
+					}
+				} else if (fcc == 'strf' && bFirstVideo && chunksize >= 20 && r.Read(buf, 20) && RB32(buf + 16)) {
+					// biCompression names the codec better than fccHandler
+					s.codec = GetCodecName(RB32(buf + 16));
+				}
+
+				chunk += 8 + chunksize + (chunksize & 1);
+			}
+		}
+
+		pos = next;
+	}
+
+	if (rtVideo) {
+		s.duration = rtVideo;
+	}
+
+	// the title is in LIST INFO between hdrl and movi
+	for (__int64 pos = hdrlend + (hdrlend & 1); ; ) {
+		r.Seek(pos);
+		if (!r.Read(buf, 12) || (RB32(buf) != 'LIST' && RB32(buf) != 'JUNK')) {
+			break;
+		}
+		const DWORD size = RL32(buf + 4);
+
+		if (RB32(buf) == 'LIST' && RB32(buf + 8) == 'INFO') {
+			for (__int64 chunk = pos + 12; chunk + 8 <= pos + 8 + size; ) {
+				r.Seek(chunk);
+				if (!r.Read(buf, 8)) {
+					break;
+				}
+				const DWORD chunksize = RL32(buf + 4);
+				if (RB32(buf) == 'INAM') {
+					s.title = ReadString(r, chunksize, false);
+					break;
+				}
+				chunk += 8 + chunksize + (chunksize & 1);
+			}
+			break;
+		} else if (RB32(buf) == 'LIST' && RB32(buf + 8) == 'movi') {
+			break;
+		}
+
+		pos += 8 + size + (size & 1);
+	}
+
+	return s.nVideo || s.nAudio;
+}
+
+static bool FindAMFNumber(const BYTE* p, DWORD size, LPCSTR key, double& v)
+{
+	const DWORD len = (DWORD)strlen(key);
+	for (DWORD j = 0; j + 2 + len + 9 <= size; j++) {
+		if (RB16(p + j) == len && !memcmp(p + j + 2, key, len) && p[j + 2 + len] == 0x00) {
+			const UINT64 u = RB64(p + j + 3 + len);
+			memcpy(&v, &u, sizeof(v));
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool InfoFLV(CProbeReader& r, streams_t& s)
+{
+	static const LPCTSTR codecs[16] = {NULL, NULL, _T("H.263"), _T("Screen"), _T("VP6"), _T("VP6"), _T("Screen 2"), _T("H.264")};
+
+	BYTE buf[16];
+
+	r.Seek(0);
+	if (!r.Read(buf, 9)) {
+		return false;
+	}
+	s.nAudio = (buf[4] & 0x04) ? 1 : 0;
+	s.nVideo = (buf[4] & 0x01) ? 1 : 0;
+	__int64 pos = RB32(buf + 5) + 4;
+
+	for (int i = 0; i < 16; i++) {
+		r.Seek(pos);
+		if (!r.Read(buf, 11)) {
+			break;
+		}
+		const BYTE type		= buf[0] & 0x1f;
+		const DWORD size	= RB24(buf + 1);
+		pos += 11 + size + 4;
+
+		if (type == 18 && size < 64 * 1024) {
+			CAtlArray<BYTE> data;
+			data.SetCount(size);
+			if (r.Read(data.GetData(), size)) {
+				double v;
+				if (FindAMFNumber(data.GetData(), size, "duration", v) && v > 0) {
+					s.duration = (REFERENCE_TIME)(v * 10000000);
+				}
+				if (FindAMFNumber(data.GetData(), size, "width", v) && v > 0 && v < 65536) {
+					s.width = (int)v;
+				}
+				if (FindAMFNumber(data.GetData(), size, "height", v) && v > 0 && v < 65536) {
+					s.height = (int)v;
+				}
+			}
+		} else if (type == 9 && size > 0 && r.Read(buf, 1)) {
+			if (codecs[buf[0] & 0x0f]) {
+				s.codec = codecs[buf[0] & 0x0f];
+			}
+			break;
+		}
+	}
+
+	return true;
+}
+
+static bool InfoTS(CProbeReader& r, streams_t& s, int offset)
+{
+	const int packetsize = 188 + offset;
+
+	WORD pmtpid = 0;
+
+	BYTE p[192];
+	for (__int64 pos = 0; pos + packetsize <= r.GetLength(); pos += packetsize) {
+		r.Seek(pos);
+		if (!r.Read(p, packetsize)) {
+			break;
+		}
+
+		const BYTE* pkt = p + offset;
+		if (pkt[0] != 0x47) {
+			return false;
+		}
+
+		const bool bStart = !!(pkt[1] & 0x40);
+		const WORD pid = ((pkt[1] & 0x1f) << 8) | pkt[2];
+		const BYTE afc = (pkt[3] >> 4) & 3;
+		if (!(afc & 1) || !bStart || (pid != 0 && (!pmtpid || pid != pmtpid))) {
+			continue;
+		}
+
+		int i = 4;
+		if (afc & 2) {
+			i += 1 + pkt[4];
+		}
+		if (i >= 188) {
+			continue;
+		}
+
+		i += 1 + pkt[i]; // pointer_field
+		if (i + 12 > 188) {
+			continue;
+		}
+		const BYTE* sec = pkt + i;
+		const int end = min(3 + (int)(RB16(sec + 1) & 0xfff) - 4, 188 - i);
+
+		if (pid == 0 && sec[0] == 0x00) {
+			for (int j = 8; j + 4 <= end; j += 4) {
+				if (RB16(sec + j)) {
+					pmtpid = RB16(sec + j + 2) & 0x1fff;
+					break;
+				}
+			}
+		} else if (sec[0] == 0x02) {
+			// the streams of the first program
+			for (int j = 12 + (RB16(sec + 10) & 0xfff); j + 5 <= end; j += 5 + (RB16(sec + j + 3) & 0xfff)) {
+				switch (sec[j]) {
+					case 0x01:
+					case 0x02:
+					case 0x1b:
+					case 0x24:
+					case 0xea:
+						if (!s.nVideo++) {
+							s.codec = sec[j] == 0x1b ? _T("H.264") : sec[j] == 0x24 ? _T("HEVC") : sec[j] == 0xea ? _T("VC-1") : sec[j] == 0x01 ? _T("MPEG-1") : _T("MPEG-2");
+						}
+						break;
+					case 0x03:
+					case 0x04:
+					case 0x0f:
+					case 0x11:
+					case 0x80:
+					case 0x81:
+					case 0x82:
+					case 0x83:
+					case 0x84:
+					case 0x85:
+					case 0x86:
+					case 0x87:
+					case 0xa1:
+					case 0xa2:
+						s.nAudio++;
+						break;
+					case 0x90:
+						s.nSubs++;
+						break;
+				}
+			}
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool ProbeMedia(LPCTSTR fn, MediaProbe& probe, __int64 nBudget)
+{
+	probe.duration		= 0;
+	probe.title.Empty();
+	probe.summary.Empty();
+	probe.nBytesRead	= 0;
+
+	CProbeReader r(fn, nBudget);
+	if (!r.IsOpen()) {
+		return false;
+	}
+
+	streams_t s;
+	s.duration	= 0;
+	s.width		= s.height = 0;
+	s.nVideo	= s.nAudio = s.nSubs = 0;
+
+	bool bRet = false;
+
+	switch (GetContainer(r)) {
+		case CONTAINER_MKV:
+			bRet = InfoMatroska(r, s);
+			break;
+		case CONTAINER_AVI:
+			bRet = InfoAVI(r, s);
+			break;
+		case CONTAINER_FLV:
+			bRet = InfoFLV(r, s);
+			break;
+		case CONTAINER_MP4:
+			bRet = InfoMP4(r, s);
+			break;
+		case CONTAINER_TS:
+			bRet = InfoTS(r, s, 0);
+			break;
+		case CONTAINER_TS4:
+			bRet = InfoTS(r, s, 4);
+			break;
+	}
+
+	probe.nBytesRead = r.GetRead();
+
+	if (bRet) {
+		probe.duration	= max(s.duration, 0LL);
+		probe.title		= s.title;
+		probe.summary	= FormatSummary(s);
+	}
+
+	DbgLog((LOG_TRACE, 3, L"ProbeMedia() : '%s', duration = %I64d, '%s', '%s', %I64d bytes",
+			fn, probe.duration, probe.title, probe.summary, probe.nBytesRead));
+
+	return bRet;
+}
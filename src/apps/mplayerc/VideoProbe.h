@@ -0,0 +1,49 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+// Frame rate and scan type of the first video stream, read from the container headers
+// and the first sequence headers of MKV, MP4, AVI, FLV and MPEG-TS files. It never reads
+// more than the byte budget, a false result means the caller has to ask MediaInfo.
+
+struct VideoProbe {
+	double	fps;			// 0 if unknown
+	bool	bVFR;			// fps is the most common rate of a variable rate stream
+	int		nInterlaced;	// -1 unknown, 0 progressive, 1 interlaced
+	bool	bPulldown;		// MPEG-2 with repeated fields, fps is the coded rate
+	bool	bScanTypeCodec;	// MPEG-2 or H.264, without a flag the scan type stays unknown
+	__int64	nBytesRead;
+};
+
+bool ProbeVideo(LPCTSTR fn, VideoProbe& probe, __int64 nBudget = 2 * 1024 * 1024);
+
+// Duration, title and a short description of the streams ("H.264 1920x1080, 2 audio,
+// 1 subtitle") of the same containers, for the playlist. The duration of transport
+// streams is not probed and stays 0.
+
+struct MediaProbe {
+	REFERENCE_TIME	duration;	// 0 if unknown
+	CString			title;
+	CString			summary;
+	__int64			nBytesRead;
+};
+
+bool ProbeMedia(LPCTSTR fn, MediaProbe& probe, __int64 nBudget = 256 * 1024);
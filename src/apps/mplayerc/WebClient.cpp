@@ -24,12 +24,16 @@
 #include "MainFrm.h"
 #include "../../Subtitles/TextFile.h"
 #include "WebClient.h"
-#include "DIB.h"
 #include "../../DSUtil/WinAPIUtils.h"
 
 CWebClientSocket::CWebClientSocket(CWebServer* pWebServer, CMainFrame* pMainFrame)
 	: m_pWebServer(pWebServer)
 	, m_pMainFrame(pMainFrame)
+	, m_sendpos(0)
+	, m_nLastActivity(GetTickCount())
+	, m_nStream(STREAM_NONE)
+	, m_nStreamWidth(0)
+	, m_nStreamQuality(0)
 {
 }
 
@@ -133,6 +137,8 @@ void CWebClientSocket::Header()
 
 	CStringA reshdr, resbody;
 
+	m_nLastActivity = GetTickCount();
+
 	if (m_cmd == _T("POST")) {
 		CString str;
 		if (m_hdrlines.Lookup(_T("content-length"), str)) {
@@ -259,10 +265,39 @@ void CWebClientSocket::Header()
 			}
 		}
 
+		// HTTP/1.1 connections stay open unless the client doesn't want it or the length of the response is unknown
+		CString connection = m_ver == _T("HTTP/1.1") ? _T("keep-alive") : _T("close");
+		m_hdrlines.Lookup(_T("connection"), connection);
+		const bool fKeepAlive = m_nStream == STREAM_NONE
+								&& !connection.CompareNoCase(_T("keep-alive"))
+								&& reshdr.Find("HTTP/1.1 200 OK") == 0
+								&& reshdr.Find("Content-Length:") >= 0;
+
 		reshdr +=
-			"Server: MPC-BE WebServer\r\n"
-			"Connection: close\r\n"
-			"\r\n";
+			"Server: MPC-BE WebServer\r\n";
+		reshdr += fKeepAlive
+				  ? "Connection: keep-alive\r\n" "\r\n"
+				  : "Connection: close\r\n" "\r\n";
+
+		if (m_nStream != STREAM_NONE) {
+			// the connection stays open, the updates are sent by the server
+			Clear();
+			if (!Queue(reshdr) || !Push()) {
+				OnClose(0);
+			}
+			return;
+		}
+
+		if (fKeepAlive) {
+			if (m_cmd != _T("HEAD")) {
+				reshdr += resbody;
+			}
+			Clear();
+			if (!Queue(reshdr)) {
+				OnClose(0);
+			}
+			return;
+		}
 
 		Send(reshdr, reshdr.GetLength());
 
@@ -270,9 +305,6 @@ void CWebClientSocket::Header()
 			Send(resbody, resbody.GetLength());
 		}
 
-		CString connection = _T("close");
-		m_hdrlines.Lookup(_T("connection"), connection);
-
 		Clear();
 
 		// if (connection == _T("close"))
@@ -302,6 +334,118 @@ void CWebClientSocket::OnReceive(int nErrorCode)
 	__super::OnReceive(nErrorCode);
 }
 
+void CWebClientSocket::OnSend(int nErrorCode)
+{
+	if (!m_sendbuf.IsEmpty() && (nErrorCode || !Flush())) {
+		OnClose(0);
+		return;
+	}
+
+	__super::OnSend(nErrorCode);
+}
+
+bool CWebClientSocket::Queue(const CStringA& data)
+{
+	if (m_sendpos > 0) {
+		m_sendbuf.Delete(0, m_sendpos);
+		m_sendpos = 0;
+	}
+	m_sendbuf += data;
+
+	return Flush();
+}
+
+bool CWebClientSocket::Flush()
+{
+	while (m_sendpos < m_sendbuf.GetLength()) {
+		int len = Send((LPCSTR)m_sendbuf + m_sendpos, m_sendbuf.GetLength() - m_sendpos);
+		if (len == SOCKET_ERROR) {
+			return GetLastError() == WSAEWOULDBLOCK;
+		}
+		m_sendpos += len;
+	}
+
+	m_sendbuf.Empty();
+	m_sendpos = 0;
+
+	return true;
+}
+
+bool CWebClientSocket::Push()
+{
+	if (!m_sendbuf.IsEmpty()) {
+		return true;
+	}
+
+	switch (m_nStream) {
+		case STREAM_MJPEG:
+			return SendFrame();
+		case STREAM_EVENTS:
+			return SendStatus();
+	}
+
+	return true;
+}
+
+bool CWebClientSocket::SendFrame()
+{
+	// without an allocator presenter every frame would pause and resume the graph
+	if (!m_pMainFrame->m_pCAP) {
+		return false;
+	}
+
+	CStringA jpeg;
+	if (!m_pWebServer->GetSnapshot(jpeg, m_nStreamWidth, m_nStreamQuality)) {
+		return true;
+	}
+
+	CStringA part;
+	part.Format(
+		"--" MJPEG_BOUNDARY "\r\n"
+		"Content-Type: image/jpeg\r\n"
+		"Content-Length: %d\r\n"
+		"\r\n",
+		jpeg.GetLength());
+
+	return Queue(part + jpeg + "\r\n");
+}
+
+bool CWebClientSocket::SendStatus()
+{
+	// only the changed values, volatile ones go along with the others
+
+	const CAtlArray<webstatus_t>& status = m_pWebServer->GetStatus();
+
+	bool fChanged = false;
+	for (size_t i = 0; i < status.GetCount() && !fChanged; i++) {
+		CStringA value;
+		fChanged = !status[i].bVolatile && (!m_sent.Lookup(status[i].key, value) || value != status[i].value);
+	}
+
+	if (!fChanged) {
+		// keeps proxies from closing the connection and detects the clients that are gone
+		if (GetTickCount() - m_nLastActivity > 15000) {
+			m_nLastActivity = GetTickCount();
+			return Queue(":\n\n");
+		}
+		return true;
+	}
+
+	CStringA data;
+	for (size_t i = 0; i < status.GetCount(); i++) {
+		CStringA value;
+		if (status[i].bVolatile || !m_sent.Lookup(status[i].key, value) || value != status[i].value) {
+			data += data.IsEmpty() ? "{\"" : ",\"";
+			data += status[i].key + "\":" + status[i].value;
+			m_sent[status[i].key] = status[i].value;
+		}
+	}
+	data += "}";
+
+	m_nLastActivity = GetTickCount();
+	return Queue("data: " + data + "\n\n");
+}
+
 void CWebClientSocket::OnClose(int nErrorCode)
 {
 	m_pWebServer->OnClose(this);
@@ -797,6 +941,39 @@ bool CWebClientSocket::OnStatus(CStringA& hdr, CStringA& body, CStringA& mime)
 	return true;
 }
 
+bool CWebClientSocket::OnStatusJson(CStringA& hdr, CStringA& body, CStringA& mime)
+{
+	const CAtlArray<webstatus_t>& status = m_pWebServer->GetStatus();
+
+	body = "{";
+	for (size_t i = 0; i < status.GetCount(); i++) {
+		body += i ? ",\"" : "\"";
+		body += status[i].key + "\":" + status[i].value;
+	}
+	body += "}";
+
+	hdr +=
+		"Expires: Thu, 19 Nov 1981 08:52:00 GMT\r\n"
+		"Cache-Control: no-store, no-cache, must-revalidate, post-check=0, pre-check=0\r\n"
+		"Pragma: no-cache\r\n";
+	mime = "application/json";
+
+	return true;
+}
+
+bool CWebClientSocket::OnEvents(CStringA& hdr, CStringA& body, CStringA& mime)
+{
+	m_nStream = STREAM_EVENTS;
+	m_sent.RemoveAll();
+
+	hdr +=
+		"Cache-Control: no-cache\r\n"
+		"Content-Type: text/event-stream\r\n";
+	mime = "text/event-stream";
+
+	return true;
+}
+
 bool CWebClientSocket::OnError404(CStringA& hdr, CStringA& body, CStringA& mime)
 {
 	m_pWebServer->LoadPage(IDR_HTML_404, body, m_path);
@@ -813,25 +990,39 @@ bool CWebClientSocket::OnPlayer(CStringA& hdr, CStringA& body, CStringA& mime)
 
 bool CWebClientSocket::OnSnapShotJpeg(CStringA& hdr, CStringA& body, CStringA& mime)
 {
-	bool fRet = false;
-
-	BYTE *pData = NULL, *jpeg = NULL;
-	long size = 0;
-	size_t jpeg_size = 0;
-
-	if (m_pMainFrame->GetDIB(&pData, size, true)) {
-		if (BMPDIB(0, pData, L"image/jpeg", AfxGetAppSettings().nWebServerQuality, 1, &jpeg, &jpeg_size)) {
-			hdr +=
-				"Expires: Thu, 19 Nov 1981 08:52:00 GMT\r\n"
-				"Cache-Control: no-store, no-cache, must-revalidate, post-check=0, pre-check=0\r\n"
-				"Pragma: no-cache\r\n";
-			body = CStringA((char*)jpeg, jpeg_size);
-			mime = "image/jpeg";
-			fRet = true;
-		}
+	CString arg;
+	int width = m_get.Lookup(_T("width"), arg) ? _ttoi(arg) : 0;
+	int quality = m_get.Lookup(_T("quality"), arg) ? _ttoi(arg) : 0;
 
-		delete [] pData;
+	if (!m_pWebServer->GetSnapshot(body, width, quality)) {
+		return false;
 	}
 
-	return fRet;
+	hdr +=
+		"Expires: Thu, 19 Nov 1981 08:52:00 GMT\r\n"
+		"Cache-Control: no-store, no-cache, must-revalidate, post-check=0, pre-check=0\r\n"
+		"Pragma: no-cache\r\n";
+	mime = "image/jpeg";
+
+	return true;
+}
+
+bool CWebClientSocket::OnSnapShotMjpeg(CStringA& hdr, CStringA& body, CStringA& mime)
+{
+	if (!m_pMainFrame->m_pCAP) {
+		return false;
+	}
+
+	CString arg;
+	m_nStreamWidth = m_get.Lookup(_T("width"), arg) ? _ttoi(arg) : 0;
+	m_nStreamQuality = m_get.Lookup(_T("quality"), arg) ? _ttoi(arg) : 0;
+	m_nStream = STREAM_MJPEG;
+
+	hdr +=
+		"Cache-Control: no-store, no-cache, must-revalidate, post-check=0, pre-check=0\r\n"
+		"Pragma: no-cache\r\n"
+		"Content-Type: multipart/x-mixed-replace; boundary=" MJPEG_BOUNDARY "\r\n";
+	mime = "multipart/x-mixed-replace";
+
+	return true;
 }
@@ -38,8 +38,23 @@ class CWebClientSocket : public CAsyncSocket
 	void Clear();
 	void Header();
 
+	// responses of keep-alive connections and streams, sent as the socket allows
+	CStringA m_sendbuf;
+	int m_sendpos;
+	bool Queue(const CStringA& data);
+	bool Flush();
+	DWORD m_nLastActivity;
+
+	// multipart/x-mixed-replace snapshots or server-sent status events
+	enum {STREAM_NONE, STREAM_MJPEG, STREAM_EVENTS} m_nStream;
+	int m_nStreamWidth, m_nStreamQuality;
+	CAtlStringMap<CStringA, CStringA> m_sent;
+	bool SendFrame();
+	bool SendStatus();
+
 protected:
 	void OnReceive(int nErrorCode);
+	void OnSend(int nErrorCode);
 	void OnClose(int nErrorCode);
 
 public:
@@ -48,6 +63,11 @@ public:
 
 	bool SetCookie(CString name, CString value = _T(""), __time64_t expire = -1, CString path = _T("/"), CString domain = _T(""));
 
+	bool IsStreaming() const { return m_nStream != STREAM_NONE; }
+	bool IsIdle(DWORD timeout) const { return m_nStream == STREAM_NONE && m_sendbuf.IsEmpty() && GetTickCount() - m_nLastActivity > timeout; }
+	// returns false if the connection is lost, busy clients skip the update
+	bool Push();
+
 	CString m_sessid;
 	CString m_cmd, m_path, m_query, m_ver;
 	CStringA m_data;
@@ -62,7 +82,10 @@ public:
 	bool OnControls(CStringA& hdr, CStringA& body, CStringA& mime);
 	bool OnVariables(CStringA& hdr, CStringA& body, CStringA& mime);
 	bool OnStatus(CStringA& hdr, CStringA& body, CStringA& mime);
+	bool OnStatusJson(CStringA& hdr, CStringA& body, CStringA& mime);
+	bool OnEvents(CStringA& hdr, CStringA& body, CStringA& mime);
 	bool OnError404(CStringA& hdr, CStringA& body, CStringA& mime);
 	bool OnPlayer(CStringA& hdr, CStringA& body, CStringA& mime);
 	bool OnSnapShotJpeg(CStringA& hdr, CStringA& body, CStringA& mime);
+	bool OnSnapShotMjpeg(CStringA& hdr, CStringA& body, CStringA& mime);
 };
@@ -25,6 +25,44 @@
 #include <zlib/zlib.h>
 #include "WebServer.h"
 #include "WebClient.h"
+#include "DIB.h"
+
+#define SNAPSHOT_INTERVAL	100	// ms, a grabbed frame is shared by the requests of this period
+#define SNAPSHOT_VARIANTS	8	// encoded sizes and qualities kept per frame
+#define KEEPALIVE_TIMEOUT	30000	// ms
+
+static bool GZip(const CStringA& src, CStringA& dst)
+{
+	z_stream strm;
+	strm.zalloc = Z_NULL;
+	strm.zfree = Z_NULL;
+	strm.opaque = Z_NULL;
+	int ret = deflateInit2(&strm, 9, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+	if (ret != Z_OK) {
+		ASSERT(0);
+		return false;
+	}
+
+	int gzippedBuffLen = src.GetLength();
+	BYTE* gzippedBuff = DNew BYTE[gzippedBuffLen];
+	strm.avail_in = src.GetLength();
+	strm.next_in = (Bytef*)(LPCSTR)src;
+	strm.avail_out = gzippedBuffLen;
+	strm.next_out = gzippedBuff;
+
+	ret = deflate(&strm, Z_FINISH);
+	if (ret != Z_STREAM_END || strm.avail_in != 0) {
+		deflateEnd(&strm);
+		delete [] gzippedBuff;
+		return false;
+	}
+	gzippedBuffLen -= strm.avail_out;
+	memcpy(dst.GetBufferSetLength(gzippedBuffLen), gzippedBuff, gzippedBuffLen);
+	deflateEnd(&strm);
+	delete [] gzippedBuff;
+
+	return true;
+}
 
 CWebServerSocket::CWebServerSocket(CWebServer* pWebServer, int port)
 	: m_pWebServer(pWebServer)
@@ -48,11 +86,14 @@ void CWebServerSocket::OnAccept(int nErrorCode)
 
 CAtlStringMap<CWebServer::RequestHandler> CWebServer::m_internalpages;
 CAtlStringMap<UINT> CWebServer::m_downloads;
+CAtlStringMap<CStringA> CWebServer::m_gzdownloads;
 CAtlStringMap<CStringA, CStringA> CWebServer::m_mimes;
 
 CWebServer::CWebServer(CMainFrame* pMainFrame, int nPort)
 	: m_pMainFrame(pMainFrame)
 	, m_nPort(nPort)
+	, m_nSnapshotTime(0)
+	, m_nStatusTime(0)
 {
 	if (m_internalpages.IsEmpty()) {
 		m_internalpages[_T("/")] = &CWebClientSocket::OnIndex;
@@ -62,9 +103,12 @@ CWebServer::CWebServer(CMainFrame* pMainFrame, int nPort)
 		m_internalpages[_T("/controls.html")] = &CWebClientSocket::OnControls;
 		m_internalpages[_T("/command.html")] = &CWebClientSocket::OnCommand;
 		m_internalpages[_T("/status.html")] = &CWebClientSocket::OnStatus;
+		m_internalpages[_T("/status.json")] = &CWebClientSocket::OnStatusJson;
+		m_internalpages[_T("/events")] = &CWebClientSocket::OnEvents;
 		m_internalpages[_T("/player.html")] = &CWebClientSocket::OnPlayer;
 		m_internalpages[_T("/variables.html")] = &CWebClientSocket::OnVariables;
 		m_internalpages[_T("/snapshot.jpg")] = &CWebClientSocket::OnSnapShotJpeg;
+		m_internalpages[_T("/snapshot.mjpg")] = &CWebClientSocket::OnSnapShotMjpeg;
 		m_internalpages[_T("/404.html")] = &CWebClientSocket::OnError404;
 	}
 
@@ -105,6 +149,22 @@ CWebServer::CWebServer(CMainFrame* pMainFrame, int nPort)
 		m_downloads[_T("/controlvolumegrip.png")] = IDF_CONTROLVOLUMEGRIP_PNG;
 	}
 
+	if (m_gzdownloads.IsEmpty()) {
+		POSITION pos = m_downloads.GetStartPosition();
+		while (pos) {
+			CString fn;
+			UINT id;
+			m_downloads.GetNextAssoc(pos, fn, id);
+
+			CStringA ext = CPath(fn).GetExtension().MakeLower();
+			CStringA data, gz;
+			if (ext != ".png" && ext != ".jpg" && ext != ".gif"
+					&& LoadResource(id, data, _T("FILE")) && GZip(data, gz)) {
+				m_gzdownloads[fn] = gz;
+			}
+		}
+	}
+
 	CRegKey key;
 	CString str(_T("MIME\\Database\\Content Type"));
 	if (ERROR_SUCCESS == key.Open(HKEY_CLASSES_ROOT, str, KEY_READ)) {
@@ -190,15 +250,227 @@ DWORD CWebServer::ThreadProc()
 
 	CWebServerSocket s(this, m_nPort);
 
+	UINT_PTR timer = SetTimer(NULL, 0, SNAPSHOT_INTERVAL, NULL);
+
 	MSG msg;
 	while ((int)GetMessage(&msg, NULL, 0, 0) > 0) {
+		if (msg.message == WM_TIMER && msg.hwnd == NULL && msg.wParam == timer) {
+			OnTimer();
+			continue;
+		}
 		TranslateMessage(&msg);
 		DispatchMessage(&msg);
 	}
 
+	KillTimer(NULL, timer);
+
 	return 0;
 }
 
+void CWebServer::OnTimer()
+{
+	POSITION pos = m_clients.GetHeadPosition();
+	while (pos) {
+		POSITION cur = pos;
+		CWebClientSocket* pClient = m_clients.GetNext(pos);
+		if (pClient->IsStreaming() ? !pClient->Push() : pClient->IsIdle(KEEPALIVE_TIMEOUT)) {
+			m_clients.RemoveAt(cur);
+		}
+	}
+
+	if (m_pSnapshotDIB && GetTickCount() - m_nSnapshotTime >= 10 * SNAPSHOT_INTERVAL) {
+		m_pSnapshotDIB.Free();
+		m_snapshots.RemoveAll();
+	}
+}
+
+static CStringA JsonString(const CString& str)
+{
+	CStringA utf8 = UTF8(str), ret = "\"";
+
+	for (int i = 0; i < utf8.GetLength(); i++) {
+		const char c = utf8[i];
+		if (c == '"' || c == '\\') {
+			ret += '\\';
+			ret += c;
+		} else if ((BYTE)c < 0x20) {
+			CStringA esc;
+			esc.Format("\\u%04x", (BYTE)c);
+			ret += esc;
+		} else {
+			ret += c;
+		}
+	}
+
+	return ret + "\"";
+}
+
+static void AddStatus(CAtlArray<webstatus_t>& status, CStringA key, CStringA value, bool bVolatile = false)
+{
+	webstatus_t s;
+	s.key		= key;
+	s.value		= value;
+	s.bVolatile	= bVolatile;
+	status.Add(s);
+}
+
+const CAtlArray<webstatus_t>& CWebServer::GetStatus()
+{
+	const DWORD now = GetTickCount();
+
+	if (!m_status.IsEmpty() && now - m_nStatusTime < SNAPSHOT_INTERVAL) {
+		return m_status;
+	}
+
+	m_status.RemoveAll();
+	m_nStatusTime = now;
+
+	CString title;
+	m_pMainFrame->GetWindowText(title);
+
+	CString path = m_pMainFrame->m_wndPlaylistBar.GetCurFileName();
+
+	OAFilterState fs = m_pMainFrame->GetMediaState();
+	CString statestring;
+	switch (fs) {
+		case State_Stopped:
+			statestring = ResStr(IDS_CONTROLS_STOPPED);
+			break;
+		case State_Paused:
+			statestring = ResStr(IDS_CONTROLS_PAUSED);
+			break;
+		case State_Running:
+			statestring = ResStr(IDS_CONTROLS_PLAYING);
+			break;
+		default:
+			statestring = _T("n/a");
+			break;
+	}
+
+	int pos = (int)(m_pMainFrame->GetPos()/10000);
+	int dur = (int)(m_pMainFrame->GetDur()/10000);
+
+	CString positionstring, durationstring;
+	positionstring.Format(_T("%02d:%02d:%02d"), (pos/3600000), (pos/60000)%60, (pos/1000)%60);
+	durationstring.Format(_T("%02d:%02d:%02d"), (dur/3600000), (dur/60000)%60, (dur/1000)%60);
+
+	CStringA num;
+
+	AddStatus(m_status, "title", JsonString(title));
+	AddStatus(m_status, "filepath", JsonString(path));
+	num.Format("%d", fs);
+	AddStatus(m_status, "state", num);
+	AddStatus(m_status, "statestring", JsonString(statestring));
+	num.Format("%d", pos);
+	AddStatus(m_status, "position", num, true);
+	AddStatus(m_status, "positionstring", JsonString(positionstring));
+	num.Format("%d", dur);
+	AddStatus(m_status, "duration", num);
+	AddStatus(m_status, "durationstring", JsonString(durationstring));
+	num.Format("%d", m_pMainFrame->GetVolume());
+	AddStatus(m_status, "volumelevel", num);
+	AddStatus(m_status, "muted", m_pMainFrame->IsMuted() ? "true" : "false");
+
+	return m_status;
+}
+
+static BYTE* ScaleDIB(const BYTE* pData, int width)
+{
+	const BITMAPINFOHEADER* bih = (const BITMAPINFOHEADER*)pData;
+
+	const int w = bih->biWidth, h = abs(bih->biHeight), bpp = bih->biBitCount / 8;
+	const int h2 = max(1, (int)((__int64)h * width / w));
+
+	BITMAPINFOHEADER hdr = *bih;
+	hdr.biWidth = width;
+	hdr.biHeight = bih->biHeight < 0 ? -h2 : h2;
+
+	// the same stride as the readers in DIB.h
+	const int pitch = DIBPITCH(bih);
+	const int pitch2 = DIBPITCH(&hdr);
+	hdr.biSizeImage = pitch2 * h2;
+
+	BYTE* pScaled = DNew BYTE[sizeof(BITMAPINFOHEADER) + pitch2 * h2];
+	memcpy(pScaled, &hdr, sizeof(hdr));
+
+	const BYTE* src = pData + sizeof(BITMAPINFOHEADER);
+	BYTE* dst = pScaled + sizeof(BITMAPINFOHEADER);
+
+	for (int y = 0; y < h2; y++, dst += pitch2) {
+		const BYTE* row = src + (__int64)pitch * ((__int64)y * h / h2);
+		for (int x = 0; x < width; x++) {
+			memcpy(dst + x * bpp, row + bpp * (int)((__int64)x * w / width), bpp);
+		}
+		memset(dst + width * bpp, 0, pitch2 - width * bpp);
+	}
+
+	return pScaled;
+}
+
+bool CWebServer::GetSnapshot(CStringA& jpeg, int width, int quality)
+{
+	const DWORD now = GetTickCount();
+
+	if (!m_pSnapshotDIB || now - m_nSnapshotTime >= SNAPSHOT_INTERVAL) {
+		BYTE* pData = NULL;
+		long size = 0;
+
+		m_pSnapshotDIB.Free();
+		m_snapshots.RemoveAll();
+
+		if (!m_pMainFrame->GetDIB(&pData, size, true)) {
+			return false;
+		}
+
+		m_pSnapshotDIB.Attach(pData);
+		m_nSnapshotTime = now;
+	}
+
+	const BITMAPINFOHEADER* bih = (const BITMAPINFOHEADER*)(BYTE*)m_pSnapshotDIB;
+
+	if (width <= 0 || width > bih->biWidth) {
+		width = bih->biWidth;
+	}
+	width = max(width, 16);
+	quality = quality > 0 ? min(quality, 100) : AfxGetAppSettings().nWebServerQuality;
+
+	POSITION pos = m_snapshots.GetHeadPosition();
+	while (pos) {
+		const snapshot_t& s = m_snapshots.GetNext(pos);
+		if (s.width == width && s.quality == quality) {
+			jpeg = s.jpeg;
+			return true;
+		}
+	}
+
+	CAutoVectorPtr<BYTE> pScaled;
+	if (width != bih->biWidth) {
+		pScaled.Attach(ScaleDIB(m_pSnapshotDIB, width));
+	}
+
+	BYTE* pDIB = pScaled ? (BYTE*)pScaled : (BYTE*)m_pSnapshotDIB;
+
+	BYTE* pBuf = NULL;
+	size_t len = 0;
+	if (!BMPDIB(0, pDIB, L"image/jpeg", quality, 1, &pBuf, &len) || !pBuf) {
+		return false;
+	}
+
+	snapshot_t s;
+	s.width		= width;
+	s.quality	= quality;
+	s.jpeg		= CStringA((char*)pBuf, (int)len);
+	free(pBuf);
+
+	if (m_snapshots.GetCount() >= SNAPSHOT_VARIANTS) {
+		m_snapshots.RemoveHead();
+	}
+	m_snapshots.AddTail(s);
+
+	jpeg = s.jpeg;
+	return true;
+}
+
 static void PutFileContents(LPCTSTR fn, const CStringA& data)
 {
 	FILE* f = NULL;
@@ -329,6 +601,21 @@ void CWebServer::OnClose(CWebClientSocket* pClient)
 	}
 }
 
+static bool AcceptsGZip(CWebClientSocket* pClient)
+{
+	if (!AfxGetAppSettings().fWebServerUseCompression) {
+		return false;
+	}
+
+	CString accept_encoding;
+	pClient->m_hdrlines.Lookup(_T("accept-encoding"), accept_encoding);
+	accept_encoding.MakeLower();
+	CAtlList<CString> sl;
+	ExplodeMin(accept_encoding, sl, ',');
+
+	return !!sl.Find(_T("gzip"));
+}
+
 void CWebServer::OnRequest(CWebClientSocket* pClient, CStringA& hdr, CStringA& body)
 {
 	CPath p(pClient->m_path);
@@ -375,6 +662,11 @@ void CWebServer::OnRequest(CWebClientSocket* pClient, CStringA& hdr, CStringA& b
 
 	RequestHandler rh = NULL;
 	if (!fHandled && m_internalpages.Lookup(pClient->m_path, rh) && (pClient->*rh)(hdr, body, mime)) {
+		if (pClient->IsStreaming()) {
+			// the handler wrote the complete header
+			return;
+		}
+
 		if (mime.IsEmpty()) {
 			mime = "text/html";
 		}
@@ -400,6 +692,14 @@ void CWebServer::OnRequest(CWebClientSocket* pClient, CStringA& hdr, CStringA& b
 	}
 
 	UINT resid;
+	if (!fHandled && AcceptsGZip(pClient) && m_gzdownloads.Lookup(pClient->m_path, body)) {
+		if (mime.IsEmpty()) {
+			mime = "application/octet-stream";
+		}
+		hdr += "Content-Encoding: gzip\r\n";
+		fHandled = true;
+	}
+
 	if (!fHandled && m_downloads.Lookup(pClient->m_path, resid) && LoadResource(resid, body, _T("FILE"))) {
 		if (mime.IsEmpty()) {
 			mime = "application/octet-stream";
@@ -467,49 +767,14 @@ void CWebServer::OnRequest(CWebClientSocket* pClient, CStringA& hdr, CStringA& b
 	}
 
 	// gzip
-	if (AfxGetAppSettings().fWebServerUseCompression && !body.IsEmpty()
-		&& hdr.Find("Content-Encoding:") < 0 && ext != ".png" && ext != ".jpg" && ext != ".gif")
-		do {
-			CString accept_encoding;
-			pClient->m_hdrlines.Lookup(_T("accept-encoding"), accept_encoding);
-			accept_encoding.MakeLower();
-			CAtlList<CString> sl;
-			ExplodeMin(accept_encoding, sl, ',');
-			if (!sl.Find(_T("gzip"))) {
-				break;
-			}
-
-			z_stream strm;
-			strm.zalloc = Z_NULL;
-			strm.zfree = Z_NULL;
-			strm.opaque = Z_NULL;
-			int ret = deflateInit2(&strm, 9, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
-			if (ret != Z_OK) {
-				ASSERT(0);
-				break;
-			}
-
-			int gzippedBuffLen = body.GetLength();
-			BYTE* gzippedBuff = DNew BYTE[gzippedBuffLen];
-			strm.avail_in = body.GetLength();
-			strm.next_in = (Bytef*)(LPCSTR)body;
-			strm.avail_out = gzippedBuffLen;
-			strm.next_out = gzippedBuff;
-
-			ret = deflate(&strm, Z_FINISH);
-			if (ret != Z_STREAM_END || strm.avail_in != 0) {
-				ASSERT(0);
-				deflateEnd(&strm);
-				delete [] gzippedBuff;
-				break;
-			}
-			gzippedBuffLen -= strm.avail_out;
-			memcpy(body.GetBufferSetLength(gzippedBuffLen), gzippedBuff, gzippedBuffLen);
-			deflateEnd(&strm);
-			delete [] gzippedBuff;
-
+	if (!body.IsEmpty() && hdr.Find("Content-Encoding:") < 0 && ext != ".png" && ext != ".jpg" && ext != ".gif"
+			&& AcceptsGZip(pClient)) {
+		CStringA gz;
+		if (GZip(body, gz)) {
+			body = gz;
 			hdr += "Content-Encoding: gzip\r\n";
-		} while (0);
+		}
+	}
 
 	CStringA content;
 	content.Format(
@@ -31,6 +31,14 @@
 #define CMD_SETPOS "-1"
 #define CMD_SETVOLUME "-2"
 
+#define MJPEG_BOUNDARY "mpcbeframe"
+
+// a variable of the player status, value is JSON encoded
+struct webstatus_t {
+	CStringA key, value;
+	bool bVolatile; // changes of this value alone are not pushed to the event streams
+};
+
 class CWebServer;
 
 class CWebServerSocket : public CAsyncSocket
@@ -64,12 +72,27 @@ class CWebServer
 	typedef bool (CWebClientSocket::*RequestHandler)(CStringA& hdr, CStringA& body, CStringA& mime);
 	static CAtlStringMap<RequestHandler> m_internalpages;
 	static CAtlStringMap<UINT> m_downloads;
+	static CAtlStringMap<CStringA> m_gzdownloads; // compressed once, for the clients that accept gzip
 	static CAtlStringMap<CStringA, CStringA> m_mimes;
 	CPath m_webroot;
 
 	CAtlStringMap<> m_cgi;
 	bool CallCGI(CWebClientSocket* pClient, CStringA& hdr, CStringA& body, CStringA& mime);
 
+	// the last grabbed frame and its encoded variants, shared by all clients
+	struct snapshot_t {
+		int width, quality;
+		CStringA jpeg;
+	};
+	CAutoVectorPtr<BYTE> m_pSnapshotDIB;
+	DWORD m_nSnapshotTime;
+	CAtlList<snapshot_t> m_snapshots;
+
+	CAtlArray<webstatus_t> m_status;
+	DWORD m_nStatusTime;
+
+	void OnTimer();
+
 public:
 	CWebServer(CMainFrame* pMainFrame, int nPort = 13579);
 	virtual ~CWebServer();
@@ -82,4 +105,9 @@ public:
 	void OnAccept(CWebServerSocket* pServer);
 	void OnClose(CWebClientSocket* pClient);
 	void OnRequest(CWebClientSocket* pClient, CStringA& reshdr, CStringA& resbody);
+
+	// width = 0 keeps the size of the video, quality = 0 uses the setting of the web server
+	bool GetSnapshot(CStringA& jpeg, int width = 0, int quality = 0);
+	// the status is shared by the requests of one timer period
+	const CAtlArray<webstatus_t>& GetStatus();
 };
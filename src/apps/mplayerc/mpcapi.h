@@ -39,6 +39,33 @@ struct MPC_OSDDATA {
 	int nDurationMS;   // duration in milliseconds
 	TCHAR strMsg[128]; // message to display thought OSD
 };
+// MPC_SUBSCRIPTION.nFields and MPC_UPDATE.nFields flags
+typedef enum MPC_UPDATEFIELDS {
+	MPC_UPDATE_POSITION			= 0x0001,
+	MPC_UPDATE_DURATION			= 0x0002,
+	MPC_UPDATE_LOADSTATE		= 0x0004,
+	MPC_UPDATE_PLAYSTATE		= 0x0008,
+	MPC_UPDATE_AUDIOTRACK		= 0x0010,
+	MPC_UPDATE_SUBTITLETRACK	= 0x0020,
+	MPC_UPDATE_ALL				= 0x003F
+};
+
+struct MPC_SUBSCRIPTION {
+	UINT nFields;      // MPC_UPDATEFIELDS to receive, 0 ends the subscription
+	UINT nIntervalMS;  // minimal time between two updates (50 - 10000)
+};
+
+struct MPC_UPDATE {
+	UINT nFields;        // MPC_UPDATEFIELDS of the members that changed since the last update
+	UINT nSequence;      // counts the delivered updates
+	__int64 llPosition;  // ms
+	__int64 llDuration;  // ms
+	int nLoadState;      // see MPC_LOADSTATE
+	int nPlayState;      // see MPC_PLAYSTATE
+	int nAudioTrack;     // -1 if none
+	int nSubtitleTrack;  // -1 if disabled
+};
+
 //// MPC_OSDDATA.nMsgPos constants (for host side programming):
 //typedef enum
 //{
@@ -105,6 +132,11 @@ typedef enum MPCAPI_COMMAND {
 	// Par 1 : none.
 	CMD_NOTIFYENDOFSTREAM	= 0x50000009,
 
+	// Changes of the subscribed values, see CMD_SUBSCRIBE.
+	// Updates that the host couldn't take in time are merged into the next one.
+	// Par : MPC_UPDATE (binary)
+	CMD_UPDATE				= 0x5000000A,
+
 	// List of files in the playlist
 	// Par 1 : file path 0
 	// Par 2 : file path 1
@@ -177,6 +209,10 @@ typedef enum MPCAPI_COMMAND {
 	// Par 1 : seconds (negative values for backward)
 	CMD_JUMPOFNSECONDS		= 0xA0003005,
 
+	// Subscribe to CMD_UPDATE, the first update has all requested values
+	// Par : MPC_SUBSCRIPTION (binary)
+	CMD_SUBSCRIBE			= 0xA0003006,
+
 	// Ask for a list of the audio tracks of the file
 	// return a CMD_LISTAUDIOTRACKS
 	CMD_GETAUDIOTRACKS		= 0xA0003001,
@@ -423,6 +423,77 @@ void CMPlayerCApp::ShowCmdlnSwitches() const
 	AfxMessageBox(s, MB_ICONINFORMATION | MB_OK);
 }
 
+// the results of the command line benchmarks go to the console of the caller
+static void WriteCmdlnOutput(CString out)
+{
+	if (AttachConsole(ATTACH_PARENT_PROCESS)) {
+		HANDLE hConsole = CreateFile(_T("CONOUT$"), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+		if (hConsole != INVALID_HANDLE_VALUE) {
+			out.Replace(_T("\n"), _T("\r\n"));
+			DWORD dwWritten = 0;
+			WriteConsole(hConsole, out, out.GetLength(), &dwWritten, NULL);
+			CloseHandle(hConsole);
+		}
+		FreeConsole();
+	} else {
+		AfxMessageBox(out, MB_ICONINFORMATION | MB_OK);
+	}
+}
+
+// /thumbnails saves the sheet of the first file without opening the player, /thumbbench
+// repeats it with 1, 2, 4 ... worker graphs.
+void CMPlayerCApp::SaveThumbnailsCmdln()
+{
+	CString out;
+
+	if (m_s.slFiles.IsEmpty()) {
+		out = ResStr(IDS_USAGE);
+	} else {
+		const CString fn = m_s.slFiles.GetHead();
+
+		CAtlList<int> workers;
+		if (m_s.fThumbnailsBench) {
+			SYSTEM_INFO si;
+			GetSystemInfo(&si);
+			const int nMax = min(max((int)si.dwNumberOfProcessors, 1), 8);
+			for (int n = 1; n < nMax; n *= 2) {
+				workers.AddTail(n);
+			}
+			workers.AddTail(nMax);
+		} else {
+			workers.AddTail(m_s.iThumbnailsWorkers);
+		}
+
+		POSITION pos = workers.GetHeadPosition();
+		while (pos) {
+			CThumbnailSheet sheet(fn, GetFileOnly(fn), m_s.strThumbnailsDst, workers.GetNext(pos));
+
+			CString str;
+			if (UINT nError = sheet.Save()) {
+				str.Format(_T("%s: %s\n"), fn, ResStr(nError));
+				out += str;
+				break;
+			}
+			str.Format(_T("%s: %d worker(s), %u ms\n"), m_s.strThumbnailsDst, sheet.GetWorkers(), sheet.GetTime());
+			out += str;
+		}
+	}
+
+	WriteCmdlnOutput(out);
+}
+
+// /scanbench adds a generated folder tree the way a dropped folder is added, once
+// probing the files and once from the info cache.
+void CMPlayerCApp::ScanBenchCmdln()
+{
+	CString out = CPlayerPlaylistBar::ScanBench(m_s.iScanBenchFiles);
+	if (out.IsEmpty()) {
+		out = _T("Cannot create the files in the temporary folder\n");
+	}
+
+	WriteCmdlnOutput(out);
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // The one and only CMPlayerCApp object
 
@@ -1044,6 +1115,18 @@ BOOL CMPlayerCApp::InitInstance()
 		return FALSE;
 	}
 
+	if (m_s.nCLSwitches & CLSW_THUMBNAILS) {
+		m_s.LoadSettings();
+		SaveThumbnailsCmdln();
+		return FALSE;
+	}
+
+	if (m_s.nCLSwitches & CLSW_SCANBENCH) {
+		m_s.LoadSettings();
+		ScanBenchCmdln();
+		return FALSE;
+	}
+
 	if (m_s.nCLSwitches & CLSW_RESET) { // reset settings
 		// We want the other instances to be closed before resetting the settings.
 		HWND hWnd = FindWindow(_T(MPC_WND_CLASS_NAME), NULL);
@@ -2108,11 +2191,14 @@ CStringA GetContentType(CString fn, CAtlList<CString>* redir)
 			ct = _T("application/x-cue-metadata");
 		}
 
+		// the signatures below need 4 bytes, only playlists are searched for redirections
+		const int size = (redir && !ct.IsEmpty()) ? 10 * KILOBYTE : 4;
+
 		FILE* f = NULL;
 		_tfopen_s(&f, fn, _T("rb"));
 		if (f) {
 			CStringA str;
-			str.ReleaseBufferSetLength(fread(str.GetBuffer(10 * KILOBYTE), 1, 10 * KILOBYTE, f));
+			str.ReleaseBufferSetLength(fread(str.GetBuffer(size), 1, size, f));
 			body = AToT(str);
 			fclose(f);
 		}
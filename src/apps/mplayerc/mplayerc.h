@@ -44,7 +44,8 @@ enum {
 	WM_TUNER_SCAN_END,
 	WM_TUNER_STATS,
 	WM_TUNER_NEW_CHANNEL,
-	WM_POSTOPEN
+	WM_POSTOPEN,
+	WM_THUMBNAILS_SAVED
 };
 
 #define WM_MYMOUSELAST WM_XBUTTONDBLCLK
@@ -120,6 +121,8 @@ public:
 	CMPlayerCApp();
 
 	void ShowCmdlnSwitches() const;
+	void SaveThumbnailsCmdln();
+	void ScanBenchCmdln();
 
 	bool StoreSettingsToIni();
 	bool StoreSettingsToRegistry();
@@ -409,6 +409,7 @@
 // avi splitter
 #define IDS_AVISPLITTER_NON_INTERLEAVED 7100
 #define IDS_AVISPLITTER_REINDEX_BROKEN  7101
+#define IDS_AVISPLITTER_READ_BUFFER     7102
 // mpeg splitter
 #define IDS_MPEGSPLITTER_SUB_FORCING    7201
 #define IDS_MPEGSPLITTER_ALT_DUR_CALC   7202
@@ -458,6 +459,7 @@
 #define IDS_VDF_STATUS_FRAMESIZE        7442
 #define IDS_VDF_STATUS_OUTPUT           7443
 #define IDS_VDF_STATUS_ADAPTER          7444
+#define IDS_VDF_STATUS_COPY             7445
 #define IDS_VDF_TT_AR                   7450
 #define IDS_VDF_TT_PRESET               7451
 #define IDS_VDF_TT_STANDARD             7452
@@ -474,6 +476,7 @@
 #define IDS_MPEG2_HUE                   7508
 #define IDS_MPEG2_SATURATION            7509
 #define IDS_MPEG2_READ_AR               7511
+#define IDS_MPEG2_THREADNUMBER          7512
 // audio renderer
 #define IDS_ARS_WASAPI_MODE             7600
 #define IDS_ARS_MUTE_FAST_FORWARD       7601
@@ -555,6 +558,8 @@
 #define IDC_STATIC6                     10206
 #define IDC_STATIC7                     10207
 #define IDC_STATIC8                     10208
+#define IDC_STATIC9                     10209
+#define IDC_STATIC10                    10210
 //
 #define IDC_CHECK1                      10221
 #define IDC_CHECK2                      10222
@@ -726,6 +731,7 @@
 #define IDC_MAXQUEUE_SIZE               10743
 #define IDC_CACH_SIZE                   10744
 #define IDC_PERFOMANCE_DEFAULT          10745
+#define IDC_TIMESHIFT_SIZE              10746
 //
 // 11000...13999 are reserved
 //
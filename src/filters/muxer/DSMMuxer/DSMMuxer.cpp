@@ -175,6 +175,11 @@ void CDSMMuxerFilter::MuxInit()
 	m_sps.RemoveAll();
 	m_isps.RemoveAll();
 	m_rtPrevSyncPoint = INVALID_TIME;
+
+	m_kfs.RemoveAll();
+	for (int i = 0; i < _countof(m_rtLastKeyFrame); i++) {
+		m_rtLastKeyFrame[i] = INVALID_TIME;
+	}
 }
 
 void CDSMMuxerFilter::MuxHeader(IBitStream* pBS)
@@ -339,6 +344,7 @@ void CDSMMuxerFilter::MuxPacket(IBitStream* pBS, const MuxerPacket* pPacket)
 		ASSERT(iDuration <= 7);
 
 		IndexSyncPoint(pPacket, pBS->GetPos());
+		IndexKeyFrame(pPacket, pBS->GetPos());
 	}
 
 	int len = 2 + iTimeStamp + iDuration + pPacket->pData.GetCount(); // id + flags + data
@@ -356,6 +362,57 @@ void CDSMMuxerFilter::MuxPacket(IBitStream* pBS, const MuxerPacket* pPacket)
 
 void CDSMMuxerFilter::MuxFooter(IBitStream* pBS)
 {
+	// keyframes, one packet per stream
+
+	for (int id = 0; id < _countof(m_rtLastKeyFrame); id++) {
+		if (m_rtLastKeyFrame[id] == INVALID_TIME) {
+			continue;
+		}
+
+		int len = 1; // id
+		REFERENCE_TIME rtPrev = 0;
+		UINT64 fpPrev = 0;
+
+		POSITION pos = m_kfs.GetHeadPosition();
+		while (pos) {
+			const KeyFrame& kf = m_kfs.GetNext(pos);
+			if (kf.id == id) {
+				len += 1 + GetByteLength(myabs(kf.rt - rtPrev)) + GetByteLength(kf.fp - fpPrev); // flags + rt + fp
+				rtPrev = kf.rt;
+				fpPrev = kf.fp;
+			}
+		}
+
+		MuxPacketHeader(pBS, DSMP_KEYFRAMES, len);
+		pBS->BitWrite(id, 8);
+
+		rtPrev = 0;
+		fpPrev = 0;
+
+		pos = m_kfs.GetHeadPosition();
+		while (pos) {
+			const KeyFrame& kf = m_kfs.GetNext(pos);
+			if (kf.id != id) {
+				continue;
+			}
+
+			REFERENCE_TIME rt = kf.rt - rtPrev;
+			UINT64 fp = kf.fp - fpPrev;
+			rtPrev = kf.rt;
+			fpPrev = kf.fp;
+
+			int irt = GetByteLength(myabs(rt));
+			int ifp = GetByteLength(fp);
+
+			pBS->BitWrite(rt < 0, 1);
+			pBS->BitWrite(irt, 3);
+			pBS->BitWrite(ifp, 3);
+			pBS->BitWrite(0, 1); // reserved
+			pBS->BitWrite(myabs(rt), irt<<3);
+			pBS->BitWrite(fp, ifp<<3);
+		}
+	}
+
 	// syncpoints
 
 	int len = 0;
@@ -445,4 +502,26 @@ void CDSMMuxerFilter::IndexSyncPoint(const MuxerPacket* p, __int64 fp)
 	}
 
 	m_sps.AddTail(sp);
-}
\ No newline at end of file
+}
+
+void CDSMMuxerFilter::IndexKeyFrame(const MuxerPacket* p, __int64 fp)
+{
+	// every keyframe of the streams, except for subtitles, not closer than 100ms
+
+	if (fp < 0 || !p || !p->IsTimeValid() || !p->IsSyncPoint() || p->pPin->IsSubtitleStream()) {
+		return;
+	}
+
+	const BYTE id = (BYTE)p->pPin->GetID();
+
+	if (m_rtLastKeyFrame[id] != INVALID_TIME && p->rtStart < m_rtLastKeyFrame[id] + 1000000) {
+		return;
+	}
+	m_rtLastKeyFrame[id] = p->rtStart;
+
+	KeyFrame kf;
+	kf.id = id;
+	kf.rt = p->rtStart;
+	kf.fp = fp;
+	m_kfs.AddTail(kf);
+}
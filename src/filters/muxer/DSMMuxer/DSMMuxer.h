@@ -46,6 +46,15 @@ class __declspec(uuid("C6590B76-587E-4082-9125-680D0693A97B"))
 	REFERENCE_TIME m_rtPrevSyncPoint;
 	void IndexSyncPoint(const MuxerPacket* p, __int64 fp);
 
+	struct KeyFrame {
+		BYTE id;
+		REFERENCE_TIME rt;
+		__int64 fp;
+	};
+	CAtlList<KeyFrame> m_kfs;
+	REFERENCE_TIME m_rtLastKeyFrame[256];
+	void IndexKeyFrame(const MuxerPacket* p, __int64 fp);
+
 	void MuxPacketHeader(IBitStream* pBS, dsmp_t type, UINT64 len);
 	void MuxFileInfo(IBitStream* pBS);
 	void MuxStreamInfo(IBitStream* pBS, CBaseMuxerInputPin* pPin);
@@ -29,6 +29,10 @@
 #define OPT_SECTION_AVISplit _T("Filters\\AVI Splitter")
 #define OPT_BadInterleaved   _T("BadInterleavedSuport")
 #define OPT_NeededReindex    _T("NeededReindex")
+#define OPT_ReadBufferSize   _T("ReadBufferSize")
+
+#define BATCH_MAX_GAP        (64 * 1024) // bytes of other data that are read through within a run
+#define MAX_READBUFFERSIZE   1024
 
 #ifdef REGISTER_FILTER
 
@@ -94,6 +98,9 @@ CAviSplitterFilter::CAviSplitterFilter(LPUNKNOWN pUnk, HRESULT* phr)
 	, m_maxTimeStamp(INVALID_TIME)
 	, m_bBadInterleavedSuport(true)
 	, m_bSetReindex(true)
+	, m_nReadBufferSize(32)
+	, m_bInterleaved(true)
+	, m_nBatchSize(0)
 {
 #ifdef REGISTER_FILTER
 	CRegKey key;
@@ -108,11 +115,18 @@ CAviSplitterFilter::CAviSplitterFilter(LPUNKNOWN pUnk, HRESULT* phr)
 		if (ERROR_SUCCESS == key.QueryDWORDValue(OPT_NeededReindex, dw)) {
 			m_bSetReindex = !!dw;
 		}
+
+		if (ERROR_SUCCESS == key.QueryDWORDValue(OPT_ReadBufferSize, dw)) {
+			m_nReadBufferSize = dw;
+		}
 	}
 #else
 	m_bBadInterleavedSuport	= !!AfxGetApp()->GetProfileInt(OPT_SECTION_AVISplit, OPT_BadInterleaved, m_bBadInterleavedSuport);
 	m_bSetReindex			= !!AfxGetApp()->GetProfileInt(OPT_SECTION_AVISplit, OPT_NeededReindex, m_bSetReindex);
+	m_nReadBufferSize		= AfxGetApp()->GetProfileInt(OPT_SECTION_AVISplit, OPT_ReadBufferSize, m_nReadBufferSize);
 #endif
+
+	m_nReadBufferSize = min(m_nReadBufferSize, MAX_READBUFFERSIZE);
 }
 
 STDMETHODIMP CAviSplitterFilter::NonDelegatingQueryInterface(REFIID riid, void** ppv)
@@ -154,6 +168,8 @@ HRESULT CAviSplitterFilter::CreateOutputs(IAsyncReader* pAsyncReader)
 
 	m_pFile.Free();
 	m_tFrame.Free();
+	m_readbufs.RemoveAll();
+	m_nBatchSize = 0;
 
 	m_pFile.Attach(DNew CAviFile(pAsyncReader, hr));
 	if (!m_pFile) {
@@ -489,6 +505,12 @@ HRESULT CAviSplitterFilter::CreateOutputs(IAsyncReader* pAsyncReader)
 		}
 	}
 
+	// DemuxInit runs again on every seek, the index does not change after this point
+	m_bInterleaved = m_pFile->IsInterleaved();
+	for (DWORD track = 0; track < m_pFile->m_avih.dwStreams; track++) {
+		m_pFile->m_strms[track]->cs2.RemoveAll();
+	}
+
 	m_tFrame.Attach(DNew DWORD[m_pFile->m_avih.dwStreams]);
 
 	return m_pOutputs.GetCount() > 0 ? S_OK : E_FAIL;
@@ -502,9 +524,76 @@ bool CAviSplitterFilter::DemuxInit()
 		return false;
 	}
 
+	m_readbufs.RemoveAll();
+	m_nBatchSize = 0;
+
+	if (m_nReadBufferSize && !m_bInterleaved) {
+		DWORD nStreams = 0;
+		for (DWORD track = 0; track < m_pFile->m_avih.dwStreams; track++) {
+			CAviFile::strm_t* s = m_pFile->m_strms[track];
+			if (!s->IsRawSubtitleStream() && s->cs.GetCount()) {
+				nStreams++;
+			}
+		}
+
+		if (nStreams > 1) {
+			m_nBatchSize = (UINT64)m_nReadBufferSize * 1024 * 1024 / nStreams;
+			for (DWORD track = 0; track < m_pFile->m_avih.dwStreams; track++) {
+				CAutoPtr<readbuf_t> buf(DNew readbuf_t);
+				buf->pos = 0;
+				m_readbufs.Add(buf);
+			}
+		}
+
+		DbgLog((LOG_TRACE, 3, L"CAviSplitterFilter::DemuxInit() : non-interleaved file, %I64u bytes per stream buffer", m_nBatchSize));
+	}
+
 	return true;
 }
 
+const BYTE* CAviSplitterFilter::GetBatchedChunk(DWORD track, DWORD f, DWORD& avail)
+{
+	CAviFile::strm_t* s = m_pFile->m_strms[track];
+	readbuf_t* buf = m_readbufs[track];
+
+	const CAviFile::strm_t::chunk& c = s->cs[f];
+	const UINT64 start = c.filepos;
+	const UINT64 len = (c.fChunkHdr ? 8 : 0) + c.orgsize;
+
+	if (start < buf->pos || start + len > buf->pos + buf->data.GetCount()) {
+		if (len > m_nBatchSize) {
+			return NULL;
+		}
+
+		// the following chunks of the stream, as long as they are close to each other
+		UINT64 end = start + len;
+		for (size_t i = f + 1; i < s->cs.GetCount(); i++) {
+			const CAviFile::strm_t::chunk& c2 = s->cs[i];
+			const UINT64 stop = c2.filepos + (c2.fChunkHdr ? 8 : 0) + c2.orgsize;
+			if (c2.filepos < end || c2.filepos - end > BATCH_MAX_GAP || stop - start > m_nBatchSize) {
+				break;
+			}
+			end = stop;
+		}
+		end = min(end, (UINT64)m_pFile->GetLength());
+
+		if (end < start + len || !buf->data.SetCount((size_t)(end - start))) {
+			buf->data.RemoveAll();
+			return NULL;
+		}
+
+		m_pFile->Seek(start);
+		if (S_OK != m_pFile->ByteRead(buf->data.GetData(), buf->data.GetCount())) {
+			buf->data.RemoveAll();
+			return NULL;
+		}
+		buf->pos = start;
+	}
+
+	avail = (DWORD)min(buf->pos + buf->data.GetCount() - start, DWORD_MAX);
+	return buf->data.GetData() + (start - buf->pos);
+}
+
 HRESULT CAviSplitterFilter::ReIndex(__int64 end, UINT64& Size, DWORD TrackNumber)
 {
 	HRESULT hr = S_OK;
@@ -585,6 +674,10 @@ void CAviSplitterFilter::DemuxSeek(REFERENCE_TIME rt)
 	memset((DWORD*)m_tFrame, 0, m_pFile->m_avih.dwStreams * sizeof(DWORD));
 	m_pFile->Seek(0);
 
+	for (size_t i = 0; i < m_readbufs.GetCount(); i++) {
+		m_readbufs[i]->data.RemoveAll();
+	}
+
 	DbgLog((LOG_TRACE, 0, _T("Seek: %I64d"), rt / 10000));
 
 	if (rt > 0) {
@@ -601,6 +694,22 @@ void CAviSplitterFilter::DemuxSeek(REFERENCE_TIME rt)
 	}
 }
 
+static void PushChunk(CInterleaver& interleaver, CAviFile* pFile, DWORD track, DWORD f)
+{
+	CAviFile::strm_t* s = pFile->m_strms[track];
+
+	if (f >= (DWORD)s->cs.GetCount()) {
+		return;
+	}
+
+	if (s->IsRawSubtitleStream()) {
+		// TODO: get subtitle time from index
+		interleaver.Push(track, _I64_MIN); // read all subtitles at once
+	} else {
+		interleaver.Push(track, s->GetRefTime(f, s->cs[f].size), s->cs[f].filepos);
+	}
+}
+
 bool CAviSplitterFilter::DemuxLoop()
 {
 	HRESULT hr = S_OK;
@@ -609,35 +718,14 @@ bool CAviSplitterFilter::DemuxLoop()
 	fDiscontinuity.SetCount(m_pFile->m_avih.dwStreams);
 	memset(fDiscontinuity.GetData(), 0, m_pFile->m_avih.dwStreams * sizeof(BOOL));
 
-	while (SUCCEEDED(hr) && !CheckRequest(nullptr)) {
-		DWORD curTrack = DWORD_MAX;
-
-		REFERENCE_TIME minTime = INT64_MAX;
-		UINT64 minpos = INT64_MAX;
-		for (DWORD track = 0; track < m_pFile->m_avih.dwStreams; track++) { 
-			CAviFile::strm_t* s = m_pFile->m_strms[track];
-			DWORD f = m_tFrame[track];
-
-			if (f >= (DWORD)s->cs.GetCount()) {
-				continue;
-			}
-
-			if (s->IsRawSubtitleStream()) {
-				// TODO: get subtitle time from index
-				minTime  = 0;
-				curTrack = track;
-				break; // read all subtitles at once
-			}
-
-			REFERENCE_TIME start = s->GetRefTime(f, s->cs[f].size);
-			if (start < minTime || (start == minTime && s->cs[f].filepos < minpos)) {
-				minTime  = start;
-				curTrack = track;
-				minpos   = s->cs[f].filepos;
-			}
-		}
+	CInterleaver interleaver;
+	for (DWORD track = 0; track < m_pFile->m_avih.dwStreams; track++) {
+		PushChunk(interleaver, m_pFile, track, m_tFrame[track]);
+	}
 
-		if (minTime == INT64_MAX) {
+	while (SUCCEEDED(hr) && !CheckRequest(nullptr)) {
+		DWORD curTrack;
+		if (!interleaver.Pop(curTrack)) {
 			return true;
 		}
 
@@ -646,15 +734,29 @@ bool CAviSplitterFilter::DemuxLoop()
 			DWORD f = m_tFrame[curTrack];
 			//TRACE(_T("CAviFile::DemuxLoop(): track %d, time %I64d, pos %I64d\n"), curTrack, minTime, s->cs[f].filepos);
 
+			DWORD avail = 0;
+			const BYTE* pData = NULL;
+			if (m_nBatchSize && !s->IsRawSubtitleStream()) {
+				pData = GetBatchedChunk(curTrack, f, avail);
+			}
+
 			m_pFile->Seek(s->cs[f].filepos);
 			DWORD size = 0;
+			DWORD hdrsize = 0;
 
 			if (s->cs[f].fChunkHdr) {
 				DWORD id = 0;
-				if (S_OK != m_pFile->ReadAvi(id) || id == 0 || curTrack != TRACKNUM(id) || S_OK != m_pFile->ReadAvi(size)) {
+				if (pData) {
+					id		= *(DWORD*)pData;
+					size	= *(DWORD*)(pData + 4);
+				} else if (S_OK != m_pFile->ReadAvi(id) || S_OK != m_pFile->ReadAvi(size)) {
+					id = 0;
+				}
+				if (id == 0 || curTrack != TRACKNUM(id)) {
 					fDiscontinuity[curTrack] = true;
 					break;
 				}
+				hdrsize = 8;
 
 				if (size != s->cs[f].orgsize) {
 					TRACE(_T("WARNING: CAviFile::DemuxLoop() incorrect chunk size. By index: %d, by header: %d\n"), s->cs[f].orgsize, size);
@@ -674,8 +776,13 @@ bool CAviSplitterFilter::DemuxLoop()
 			p->rtStart			= s->GetRefTime(f, s->cs[f].size);
 			p->rtStop			= s->GetRefTime(f + 1, f + 1 < (DWORD)s->cs.GetCount() ? s->cs[f + 1].size : s->totalsize);
 			p->SetCount(size);
-			if (S_OK != (hr = m_pFile->ByteRead(p->GetData(), p->GetCount()))) {
-				return true;    // break;
+			if (pData && hdrsize + size <= avail) {
+				memcpy(p->GetData(), pData + hdrsize, size);
+			} else {
+				m_pFile->Seek(s->cs[f].filepos + hdrsize);
+				if (S_OK != (hr = m_pFile->ByteRead(p->GetData(), p->GetCount()))) {
+					return true;    // break;
+				}
 			}
 #if defined(_DEBUG) && 0
 			DbgLog((LOG_TRACE, 0,
@@ -692,7 +799,7 @@ bool CAviSplitterFilter::DemuxLoop()
 			fDiscontinuity[curTrack] = false;
 		} while (0);
 
-		m_tFrame[curTrack]++;
+		PushChunk(interleaver, m_pFile, curTrack, ++m_tFrame[curTrack]);
 	}
 
 	if (m_maxTimeStamp != INVALID_TIME) {
@@ -1004,10 +1111,12 @@ STDMETHODIMP CAviSplitterFilter::Apply()
 	if (ERROR_SUCCESS == key.Create(HKEY_CURRENT_USER, OPT_REGKEY_AVISplit)) {
 		key.SetDWORDValue(OPT_BadInterleaved, m_bBadInterleavedSuport);
 		key.SetDWORDValue(OPT_NeededReindex, m_bSetReindex);
+		key.SetDWORDValue(OPT_ReadBufferSize, m_nReadBufferSize);
 	}
 #else
 	AfxGetApp()->WriteProfileInt(OPT_SECTION_AVISplit, OPT_BadInterleaved, m_bBadInterleavedSuport);
 	AfxGetApp()->WriteProfileInt(OPT_SECTION_AVISplit, OPT_NeededReindex, m_bSetReindex);
+	AfxGetApp()->WriteProfileInt(OPT_SECTION_AVISplit, OPT_ReadBufferSize, m_nReadBufferSize);
 #endif
 	return S_OK;
 }
@@ -1038,6 +1147,19 @@ STDMETHODIMP_(BOOL) CAviSplitterFilter::GetReindex()
 	return m_bSetReindex;
 }
 
+STDMETHODIMP CAviSplitterFilter::SetReadBufferSize(DWORD nValue)
+{
+	CAutoLock cAutoLock(&m_csProps);
+	m_nReadBufferSize = min(nValue, MAX_READBUFFERSIZE);
+	return S_OK;
+}
+
+STDMETHODIMP_(DWORD) CAviSplitterFilter::GetReadBufferSize()
+{
+	CAutoLock cAutoLock(&m_csProps);
+	return m_nReadBufferSize;
+}
+
 //
 // CAviSourceFilter
 //
@@ -49,6 +49,18 @@ class __declspec(uuid("9736D831-9D6C-4E72-B6E7-560EF9181001"))
 
 private:
 	bool m_bBadInterleavedSuport, m_bSetReindex;
+	DWORD m_nReadBufferSize; // MB for all streams, 0 disables the read batching
+	bool m_bInterleaved;
+
+	// non-interleaved files are read in long runs of chunks of each stream
+	struct readbuf_t {
+		CAtlArray<BYTE>	data;
+		UINT64			pos;
+	};
+	CAutoPtrArray<readbuf_t> m_readbufs;
+	UINT64 m_nBatchSize;
+
+	const BYTE* GetBatchedChunk(DWORD track, DWORD f, DWORD& avail);
 
 protected:
 	CCritSec m_csProps;
@@ -106,6 +118,9 @@ public:
 
 	STDMETHODIMP SetReindex(BOOL nValue);
 	STDMETHODIMP_(BOOL) GetReindex();
+
+	STDMETHODIMP SetReadBufferSize(DWORD nValue);
+	STDMETHODIMP_(DWORD) GetReadBufferSize();
 };
 
 class __declspec(uuid("CEA8DEFF-0AF7-4DB9-9A38-FB3C3AEFC0DE"))
@@ -59,10 +59,35 @@ bool CAviSplitterSettingsWnd::OnActivate()
 	p.y += IPP_SCALE(20);
 
 	m_cbSetReindex.Create (ResStr(IDS_AVISPLITTER_REINDEX_BROKEN), WS_VISIBLE|WS_CHILD|WS_TABSTOP|BS_AUTOCHECKBOX|BS_LEFTTEXT, CRect(p, CSize(IPP_SCALE(270), m_fontheight)), this, IDC_PP_SET_REINDEX);
+	p.y += IPP_SCALE(25);
+
+	m_txtReadBufferSize.Create(ResStr(IDS_AVISPLITTER_READ_BUFFER), WS_VISIBLE|WS_CHILD, CRect(p, CSize(IPP_SCALE(200), m_fontheight)), this, (UINT)IDC_STATIC);
+	m_cbReadBufferSize.Create(dwStyle|CBS_DROPDOWNLIST|WS_VSCROLL, CRect(p + CPoint(IPP_SCALE(200), -4), CSize(IPP_SCALE(60), 200)), this, IDC_PP_READ_BUFFER_SIZE);
+	static const DWORD sizes[] = {0, 8, 16, 32, 64, 128, 256};
+	CString str;
+	for (size_t i = 0; i < _countof(sizes); i++) {
+		str.Format(_T("%u"), sizes[i]);
+		m_cbReadBufferSize.SetItemData(m_cbReadBufferSize.AddString(str), sizes[i]);
+	}
 
 	if (m_pMSF) {
 		m_cbBadInterleavedSuport.SetCheck(m_pMSF->GetBadInterleavedSuport());
 		m_cbSetReindex.SetCheck(m_pMSF->GetReindex());
+
+		DWORD size = m_pMSF->GetReadBufferSize();
+		int sel = CB_ERR;
+		for (int i = 0; i < m_cbReadBufferSize.GetCount() && sel == CB_ERR; i++) {
+			if (m_cbReadBufferSize.GetItemData(i) == size) {
+				sel = i;
+			}
+		}
+		if (sel == CB_ERR) {
+			// a value set in the registry by hand
+			str.Format(_T("%u"), size);
+			sel = m_cbReadBufferSize.AddString(str);
+			m_cbReadBufferSize.SetItemData(sel, size);
+		}
+		m_cbReadBufferSize.SetCurSel(sel);
 	}
 
 	for (CWnd* pWnd = GetWindow(GW_CHILD); pWnd; pWnd = pWnd->GetNextWindow()) {
@@ -86,6 +111,10 @@ bool CAviSplitterSettingsWnd::OnApply()
 	if (m_pMSF) {
 		m_pMSF->SetBadInterleavedSuport(m_cbBadInterleavedSuport.GetCheck());
 		m_pMSF->SetReindex(m_cbSetReindex.GetCheck());
+		int sel = m_cbReadBufferSize.GetCurSel();
+		if (sel != CB_ERR) {
+			m_pMSF->SetReadBufferSize((DWORD)m_cbReadBufferSize.GetItemData(sel));
+		}
 		m_pMSF->Apply();
 	}
 
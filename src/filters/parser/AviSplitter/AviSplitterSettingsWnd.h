@@ -32,10 +32,13 @@ private :
 
 	CButton	m_cbBadInterleavedSuport;
 	CButton	m_cbSetReindex;
+	CStatic	m_txtReadBufferSize;
+	CComboBox	m_cbReadBufferSize;
 
 	enum {
 		IDC_PP_INTERLEAVED_SUPPORT = 10000,
 		IDC_PP_SET_REINDEX,
+		IDC_PP_READ_BUFFER_SIZE,
 	};
 
 public:
@@ -48,7 +51,7 @@ public:
 	bool OnApply();
 
 	static LPCTSTR GetWindowTitle() { return MAKEINTRESOURCE(IDS_FILTER_SETTINGS_CAPTION); }
-	static CSize GetWindowSize() { return CSize(270, 53); }
+	static CSize GetWindowSize() { return CSize(270, 78); }
 
 	DECLARE_MESSAGE_MAP()
 };
@@ -30,4 +30,7 @@ public IUnknown {
 
 	STDMETHOD(SetReindex(BOOL nValue)) = 0;
 	STDMETHOD_(BOOL, GetReindex()) = 0;
+
+	STDMETHOD(SetReadBufferSize(DWORD nValue)) = 0;
+	STDMETHOD_(DWORD, GetReadBufferSize()) = 0;
 };
@@ -5,6 +5,7 @@
 #define IDS_FILTER_SETTINGS_CAPTION     7000
 #define IDS_AVISPLITTER_NON_INTERLEAVED 7100
 #define IDS_AVISPLITTER_REINDEX_BROKEN  7101
+#define IDS_AVISPLITTER_READ_BUFFER     7102
 
 // Next default values for new objects
 // 
@@ -24,6 +24,7 @@
 #include <afxsock.h>
 #include <afxinet.h>
 #include "../../../DSUtil/DSUtil.h"
+#include "../apps/mplayerc/SettingsDefines.h"
 
 //
 // CAsyncFileReader
@@ -38,6 +39,7 @@ CAsyncFileReader::CAsyncFileReader(CString fn, HRESULT& hr)
 	hr = Open(fn, modeRead|shareDenyNone|typeBinary|osSequentialScan) ? S_OK : E_FAIL;
 	if (SUCCEEDED(hr)) {
 		m_len = GetLength();
+		InitMappings();
 	}
 }
 
@@ -50,9 +52,27 @@ CAsyncFileReader::CAsyncFileReader(CHdmvClipInfo::CPlaylist& Items, HRESULT& hr)
 	hr = OpenFiles(Items, modeRead|shareDenyNone|typeBinary|osSequentialScan) ? S_OK : E_FAIL;
 	if (SUCCEEDED(hr)) {
 		m_len = GetLength();
+		InitMappings();
 	}
 }
 
+void CAsyncFileReader::InitMappings()
+{
+	if (!AfxGetApp()->GetProfileInt(IDS_R_SETTINGS IDS_R_PERFOMANCE, IDS_RS_PERFOMANCE_MAPPED_FILES, TRUE)) {
+		return;
+	}
+
+	// a failing page-in raises an exception, only files on local fixed disks are mapped
+	for (size_t i = 0; i < m_strFiles.GetCount(); i++) {
+		const CString& fn = m_strFiles[i];
+		if (fn.Find(_T(":\\")) != 1 || GetDriveType(fn.Left(3)) != DRIVE_FIXED) {
+			return;
+		}
+	}
+
+	CreateMappings();
+}
+
 STDMETHODIMP CAsyncFileReader::NonDelegatingQueryInterface(REFIID riid, void** ppv)
 {
 	CheckPointer(ppv, E_POINTER);
@@ -61,6 +81,7 @@ STDMETHODIMP CAsyncFileReader::NonDelegatingQueryInterface(REFIID riid, void** p
 		QI(IAsyncReader)
 		QI(ISyncReader)
 		QI(IFileHandle)
+		QI(IFileMapping)
 		__super::NonDelegatingQueryInterface(riid, ppv);
 }
 
@@ -68,6 +89,8 @@ STDMETHODIMP CAsyncFileReader::NonDelegatingQueryInterface(REFIID riid, void** p
 
 STDMETHODIMP CAsyncFileReader::SyncRead(LONGLONG llPosition, LONG lLength, BYTE* pBuffer)
 {
+	CAutoLock cAutoLock(&m_csRead);
+
 	do {
 		try {
 			if ((ULONGLONG)llPosition+lLength > GetLength()) {
@@ -139,3 +162,25 @@ STDMETHODIMP_(bool) CAsyncFileReader::IsValidFilename()
 {
 	return m_strFiles.IsEmpty() ? false : true;
 }
+
+// IFileMapping
+
+STDMETHODIMP CAsyncFileReader::GetMapping(LONGLONG llPosition, HANDLE* phMapping, LONGLONG* pllStart, LONGLONG* pllLength)
+{
+	CheckPointer(phMapping, E_POINTER);
+	CheckPointer(pllStart, E_POINTER);
+	CheckPointer(pllLength, E_POINTER);
+
+	CAutoLock cAutoLock(&m_csRead);
+
+	ULONGLONG llStart = 0, llLength = 0;
+	*phMapping = CMultiFiles::GetMapping(llPosition, llStart, llLength);
+	if (!*phMapping) {
+		return E_FAIL;
+	}
+
+	*pllStart	= llStart;
+	*pllLength	= llLength;
+
+	return S_OK;
+}
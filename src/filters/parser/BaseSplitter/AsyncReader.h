@@ -40,12 +40,21 @@ public IUnknown {
 	STDMETHOD_(bool, IsValidFilename)() = 0;	
 };
 
-class CAsyncFileReader : public CUnknown, public CMultiFiles, public IAsyncReader, public ISyncReader, public IFileHandle
+interface __declspec(uuid("E1D85D25-ED2A-4822-9C31-AEB6FA63BBA9"))
+IFileMapping :
+public IUnknown {
+	STDMETHOD(GetMapping) (LONGLONG llPosition, HANDLE* phMapping, LONGLONG* pllStart, LONGLONG* pllLength) = 0;
+};
+
+class CAsyncFileReader : public CUnknown, public CMultiFiles, public IAsyncReader, public ISyncReader, public IFileHandle, public IFileMapping
 {
 protected:
 	ULONGLONG m_len;
 	HANDLE m_hBreakEvent;
 	LONG m_lOsError; // CFileException::m_lOsError
+	CCritSec m_csRead; // Seek() and Read() share the file position
+
+	void InitMappings();
 
 public:
 	CAsyncFileReader(CString fn, HRESULT& hr);
@@ -97,4 +106,8 @@ public:
 	STDMETHODIMP_(HANDLE) GetFileHandle();
 	STDMETHODIMP_(LPCTSTR) GetFileName();
 	STDMETHODIMP_(bool) IsValidFilename();
+
+	// IFileMapping
+
+	STDMETHODIMP GetMapping(LONGLONG llPosition, HANDLE* phMapping, LONGLONG* pllStart, LONGLONG* pllLength);
 };
@@ -28,6 +28,21 @@
 // CBaseSplitterFilter
 //
 
+#ifdef _DEBUG
+static LONGLONG GetPerfTime()
+{
+	static LARGE_INTEGER freq = {0};
+	if (!freq.QuadPart) {
+		QueryPerformanceFrequency(&freq);
+	}
+
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+
+	return (LONGLONG)((double)now.QuadPart * UNITS / freq.QuadPart);
+}
+#endif
+
 CBaseSplitterFilter::CBaseSplitterFilter(LPCTSTR pName, LPUNKNOWN pUnk, HRESULT* phr, const CLSID& clsid)
 	: CBaseFilter(pName, pUnk, this, clsid)
 	, m_rtDuration(0), m_rtStart(0), m_rtStop(0), m_rtCurrent(0)
@@ -39,6 +54,10 @@ CBaseSplitterFilter::CBaseSplitterFilter(LPCTSTR pName, LPUNKNOWN pUnk, HRESULT*
 	, m_priority(THREAD_PRIORITY_NORMAL)
 	, m_nFlag(0)
 {
+#ifdef _DEBUG
+	memset(&m_stats, 0, sizeof(m_stats));
+#endif
+
 	if (phr) {
 		*phr = S_OK;
 	}
@@ -232,7 +251,15 @@ DWORD CBaseSplitterFilter::ThreadProc()
 		m_pSyncReader->SetBreakEvent(GetRequestHandle());
 	}
 
-	if (!DemuxInit()) {
+#ifdef _DEBUG
+	LONGLONG start = GetPerfTime();
+#endif
+	bool bInit = DemuxInit();
+#ifdef _DEBUG
+	m_stats.init = GetPerfTime() - start;
+#endif
+
+	if (!bInit) {
 		for (;;) {
 			DWORD cmd = GetRequest();
 			if (cmd == CMD_EXIT) {
@@ -260,6 +287,13 @@ DWORD CBaseSplitterFilter::ThreadProc()
 		m_rtStart = m_rtNewStart;
 		m_rtStop = m_rtNewStop;
 
+#ifdef _DEBUG
+		m_stats.seekstart	= GetPerfTime();
+		m_stats.seek		= 0;
+		m_stats.packets		= 0;
+		m_stats.bytes		= 0;
+#endif
+
 		DemuxSeek(m_rtStart);
 
 		if (cmd != (DWORD)-1) {
@@ -283,6 +317,10 @@ DWORD CBaseSplitterFilter::ThreadProc()
 			m_bDiscontinuitySent.RemoveAll();
 		} while (!DemuxLoop());
 
+#ifdef _DEBUG
+		LogDemuxStats();
+#endif
+
 		pos = m_pActivePins.GetHeadPosition();
 		while (pos && !CheckRequest(&cmd)) {
 			m_pActivePins.GetNext(pos)->QueueEndOfStream();
@@ -295,6 +333,21 @@ DWORD CBaseSplitterFilter::ThreadProc()
 	return 0;
 }
 
+#ifdef _DEBUG
+void CBaseSplitterFilter::LogDemuxStats()
+{
+	const LONGLONG dur = GetPerfTime() - m_stats.seekstart;
+	const double secs = dur > 0 ? (double)dur / UNITS : 0.0;
+
+	DbgLog((LOG_TRACE, 3, L"DemuxStats: filter=%s open_ms=%.3f init_ms=%.3f seek_ms=%.3f packets=%I64u bytes=%I64u secs=%.3f packets_per_sec=%.0f mb_per_sec=%.3f",
+			m_pName ? m_pName : L"",
+			m_stats.open / 10000.0, m_stats.init / 10000.0, m_stats.seek / 10000.0,
+			m_stats.packets, m_stats.bytes, secs,
+			secs > 0 ? m_stats.packets / secs : 0.0,
+			secs > 0 ? m_stats.bytes / secs / (1024 * 1024) : 0.0));
+}
+#endif
+
 HRESULT CBaseSplitterFilter::DeliverPacket(CAutoPtr<Packet> p)
 {
 	HRESULT hr = S_FALSE;
@@ -330,6 +383,13 @@ HRESULT CBaseSplitterFilter::DeliverPacket(CAutoPtr<Packet> p)
 	DWORD TrackNumber = p->TrackNumber;
 	BOOL bDiscontinuity = p->bDiscontinuity;
 
+#ifdef _DEBUG
+	if (!m_stats.packets++) {
+		m_stats.seek = GetPerfTime() - m_stats.seekstart;
+	}
+	m_stats.bytes += p->GetCount();
+#endif
+
 #if defined(_DEBUG) && 0
 	TRACE(_T("[%d]: d%d s%d p%d, b=%d, [%20I64d - %20I64d]\n"),
 		  p->TrackNumber,
@@ -420,11 +480,17 @@ HRESULT CBaseSplitterFilter::CompleteConnect(PIN_DIRECTION dir, CBasePin* pPin)
 		HRESULT hr;
 
 		CComPtr<IAsyncReader> pAsyncReader;
+#ifdef _DEBUG
+		LONGLONG start = GetPerfTime();
+#endif
 		if (FAILED(hr = pIn->GetAsyncReader(&pAsyncReader))
 				|| FAILED(hr = DeleteOutputs())
 				|| FAILED(hr = CreateOutputs(pAsyncReader))) {
 			return hr;
 		}
+#ifdef _DEBUG
+		m_stats.open = GetPerfTime() - start;
+#endif
 
 		SortOutputPin();
 		ChapSort();
@@ -524,12 +590,18 @@ STDMETHODIMP CBaseSplitterFilter::Load(LPCOLESTR pszFileName, const AM_MEDIA_TYP
 		pAsyncReader = (IAsyncReader*)DNew CAsyncFileReader(CString(pszFileName), hr);
 	}
 
+#ifdef _DEBUG
+	LONGLONG start = GetPerfTime();
+#endif
 	if (FAILED(hr)
 			|| FAILED(hr = DeleteOutputs())
 			|| FAILED(hr = CreateOutputs(pAsyncReader))) {
 		m_fn = "";
 		return hr;
 	}
+#ifdef _DEBUG
+	m_stats.open = GetPerfTime() - start;
+#endif
 
 	SortOutputPin();
 
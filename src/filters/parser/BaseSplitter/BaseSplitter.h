@@ -31,6 +31,7 @@
 #include "BaseSplitterOutputPin.h"
 #include "BaseSplitterParserOutputPin.h"
 #include "AsyncReader.h"
+#include "Interleaver.h"
 #include "../../../DSUtil/DSMPropertyBag.h"
 #include "../../../DSUtil/FontInstaller.h"
 #include "../apps/mplayerc/SettingsDefines.h"
@@ -65,6 +66,16 @@ class CBaseSplitterFilter
 	CComQIPtr<ISyncReader>		m_pSyncReader;
 	CHdmvClipInfo::CPlaylist	m_Items;
 
+#ifdef _DEBUG
+	// demuxer statistics of debug builds, written to the debug log as one key=value line per segment
+	struct demuxstats_t {
+		LONGLONG		open, init;			// 100ns
+		LONGLONG		seekstart, seek;	// 100ns, seek lasts until the first packet is delivered
+		UINT64			packets, bytes;
+	} m_stats;
+	void LogDemuxStats();
+#endif
+
 protected:
 	CStringW m_fn;
 
@@ -21,9 +21,18 @@
 
 #include "stdafx.h"
 #include "BaseSplitterFile.h"
+#include "AsyncReader.h"
 #include "../../../DSUtil/DSUtil.h"
 #include "../apps/mplayerc/SettingsDefines.h"
 
+#define PREFETCH_BLOCK	(MEGABYTE)	// size of the reads of the prefetch threads
+
+#ifdef _WIN64
+#define MAP_VIEW_SIZE	(256 * MEGABYTE)
+#else
+#define MAP_VIEW_SIZE	(16 * MEGABYTE)
+#endif
+
 //
 // CBaseSplitterFile
 //
@@ -37,7 +46,14 @@ CBaseSplitterFile::CBaseSplitterFile(IAsyncReader* pAsyncReader, HRESULT& hr, bo
 	, m_cachepos(0), m_cachelen(0)
 	, m_available(0)
 	, m_hThread(NULL)
+	, m_evPrefetchStop(TRUE)
+	, m_nBytesRead(0)
+	, m_pView(NULL)
+	, m_viewpos(0), m_viewlen(0)
+	, m_pLocked(NULL), m_lockedlen(0)
 {
+	memset(m_hPrefetch, 0, sizeof(m_hPrefetch));
+
 	if (!m_pAsyncReader) {
 		hr = E_UNEXPECTED;
 		return;
@@ -65,6 +81,15 @@ CBaseSplitterFile::CBaseSplitterFile(IAsyncReader* pAsyncReader, HRESULT& hr, bo
 		ResumeThread(m_hThread);
 	}
 
+	if (m_fRandomAccess) {
+		HANDLE hMapping;
+		LONGLONG start, length;
+		CComQIPtr<IFileMapping> pFileMapping = m_pAsyncReader;
+		if (pFileMapping && SUCCEEDED(pFileMapping->GetMapping(0, &hMapping, &start, &length))) {
+			m_pFileMapping = pFileMapping;
+		}
+	}
+
 	size_t cachelen = KILOBYTE * max(16, min(KILOBYTE, AfxGetApp()->GetProfileInt(IDS_R_SETTINGS, IDS_RS_PERFOMANCE_CACHE_LENGTH, DEFAULT_CACHE_LENGTH)));
 	if (!SetCacheSize(cachelen)) {
 		hr = E_OUTOFMEMORY;
@@ -76,6 +101,9 @@ CBaseSplitterFile::CBaseSplitterFile(IAsyncReader* pAsyncReader, HRESULT& hr, bo
 
 CBaseSplitterFile::~CBaseSplitterFile()
 {
+	ClearPrefetch();
+	UnmapView();
+
 	if (m_hThread != NULL) {
 		m_evStop.Set();
 		if (WaitForSingleObject(m_hThread, 500) == WAIT_TIMEOUT) {
@@ -114,6 +142,292 @@ DWORD CBaseSplitterFile::ThreadProc()
 	return 0;
 }
 
+void CBaseSplitterFile::Prefetch(__int64 pos, __int64 len)
+{
+	// only data that is already available can be read ahead, mapped files don't need it
+	if (!m_fRandomAccess || m_fStreaming || m_pFileMapping) {
+		return;
+	}
+
+	const __int64 end = min(pos + len, m_len);
+	pos = max(pos, 0);
+
+	CAutoLock cAutoLock(&m_csPrefetch);
+
+	while (pos < end) {
+		__int64 stop = min(end, pos + PREFETCH_BLOCK);
+
+		bool bQueued = false;
+		for (size_t i = 0; i < m_prefetch.GetCount(); i++) {
+			const prefetch_t* p = m_prefetch[i];
+			if (p->state == prefetch_t::canceled) {
+				continue;
+			}
+			if (p->pos <= pos && pos < p->pos + p->len) {
+				pos = p->pos + p->len;
+				bQueued = true;
+				break;
+			}
+			if (pos < p->pos && p->pos < stop) {
+				stop = p->pos;
+			}
+		}
+		if (bQueued) {
+			continue;
+		}
+
+		CAutoPtr<prefetch_t> p(DNew prefetch_t);
+		p->pos		= pos;
+		p->len		= stop - pos;
+		p->hr		= S_OK;
+		p->state	= prefetch_t::queued;
+		m_prefetch.Add(p);
+
+		pos = stop;
+	}
+
+	// the threads exit when the queue is empty
+	for (size_t i = 0; i < _countof(m_hPrefetch); i++) {
+		if (m_hPrefetch[i] && WaitForSingleObject(m_hPrefetch[i], 0) == WAIT_OBJECT_0) {
+			CloseHandle(m_hPrefetch[i]);
+			m_hPrefetch[i] = NULL;
+		}
+		if (!m_hPrefetch[i]) {
+			m_hPrefetch[i] = ::CreateThread(NULL, 0, StaticPrefetchThreadProc, (LPVOID)this, 0, NULL);
+		}
+	}
+}
+
+void CBaseSplitterFile::CancelPrefetch()
+{
+	CAutoLock cAutoLock(&m_csPrefetch);
+
+	for (size_t i = 0; i < m_prefetch.GetCount(); i++) {
+		if (m_prefetch[i]->state == prefetch_t::queued) {
+			m_prefetch[i]->state = prefetch_t::canceled;
+		}
+	}
+}
+
+void CBaseSplitterFile::ClearPrefetch()
+{
+	CancelPrefetch();
+
+	m_evPrefetchStop.Set();
+	for (size_t i = 0; i < _countof(m_hPrefetch); i++) {
+		if (m_hPrefetch[i]) {
+			WaitForSingleObject(m_hPrefetch[i], INFINITE);
+			CloseHandle(m_hPrefetch[i]);
+			m_hPrefetch[i] = NULL;
+		}
+	}
+	m_evPrefetchStop.Reset();
+
+	m_prefetch.RemoveAll();
+}
+
+DWORD WINAPI CBaseSplitterFile::StaticPrefetchThreadProc(LPVOID lpParam)
+{
+	return ((CBaseSplitterFile*)lpParam)->PrefetchThreadProc();
+}
+
+DWORD CBaseSplitterFile::PrefetchThreadProc()
+{
+	SetThreadName((DWORD)-1, "CBaseSplitterFile prefetch");
+
+	while (WaitForSingleObject(m_evPrefetchStop, 0) == WAIT_TIMEOUT) {
+		prefetch_t* p = NULL;
+		{
+			CAutoLock cAutoLock(&m_csPrefetch);
+
+			// in file order, the parser consumes the regions that way
+			for (size_t i = 0; i < m_prefetch.GetCount(); i++) {
+				if (m_prefetch[i]->state == prefetch_t::queued) {
+					p = m_prefetch[i];
+					p->state = prefetch_t::reading;
+					break;
+				}
+			}
+		}
+
+		if (!p) {
+			break;
+		}
+
+		ReadBlock(p);
+	}
+
+	return 0;
+}
+
+void CBaseSplitterFile::ReadBlock(prefetch_t* p)
+{
+	CAutoVectorPtr<BYTE> data;
+	HRESULT hr = data.Allocate((size_t)p->len) ? m_pAsyncReader->SyncRead(p->pos, (long)p->len, data) : E_OUTOFMEMORY;
+	if (hr == S_OK) {
+		InterlockedExchangeAdd64(&m_nBytesRead, p->len);
+	}
+
+	{
+		CAutoLock cAutoLock(&m_csPrefetch);
+		p->hr		= hr;
+		p->data.Attach(data.Detach());
+		p->state	= prefetch_t::done;
+	}
+
+	m_evPrefetch.Set();
+}
+
+__int64 CBaseSplitterFile::ReadPrefetched(__int64 pos, __int64 len, BYTE* pData)
+{
+	for (;;) {
+		prefetch_t* p = NULL;
+		{
+			CAutoLock cAutoLock(&m_csPrefetch);
+
+			for (size_t i = 0; i < m_prefetch.GetCount(); i++) {
+				prefetch_t* p2 = m_prefetch[i];
+				if (p2->state != prefetch_t::canceled && p2->pos <= pos && pos < p2->pos + p2->len) {
+					p = p2;
+					break;
+				}
+			}
+
+			if (!p) {
+				return 0;
+			}
+
+			if (p->state == prefetch_t::done) {
+				if (p->hr != S_OK) {
+					return 0;
+				}
+
+				__int64 minlen = min(len, p->pos + p->len - pos);
+				memcpy(pData, &p->data[pos - p->pos], (size_t)minlen);
+				return minlen;
+			}
+
+			if (p->state == prefetch_t::queued) {
+				// the threads are behind, read the block here
+				p->state = prefetch_t::reading;
+			} else {
+				p = NULL;
+			}
+		}
+
+		if (p) {
+			ReadBlock(p);
+		} else {
+			WaitForSingleObject(m_evPrefetch, INFINITE);
+		}
+	}
+}
+
+HRESULT CBaseSplitterFile::SyncRead(__int64 pos, __int64 len, BYTE* pData)
+{
+	if (m_prefetch.GetCount()) {
+		while (len > 0) {
+			__int64 minlen = ReadPrefetched(pos, len, pData);
+			if (minlen <= 0) {
+				break;
+			}
+
+			len -= minlen;
+			pos += minlen;
+			pData += minlen;
+		}
+
+		if (len <= 0) {
+			return S_OK;
+		}
+	}
+
+	HRESULT hr = m_pAsyncReader->SyncRead(pos, (long)len, pData);
+	if (hr == S_OK) {
+		InterlockedExchangeAdd64(&m_nBytesRead, len);
+	}
+
+	return hr;
+}
+
+bool CBaseSplitterFile::MapView(__int64 pos, __int64 len)
+{
+	UnmapView();
+
+	HANDLE hMapping;
+	LONGLONG start, length;
+	if (FAILED(m_pFileMapping->GetMapping(pos, &hMapping, &start, &length))) {
+		return false;
+	}
+
+	static DWORD granularity = 0;
+	if (!granularity) {
+		SYSTEM_INFO si;
+		GetSystemInfo(&si);
+		granularity = si.dwAllocationGranularity;
+	}
+
+	const __int64 offset	= (pos - start) & ~((__int64)granularity - 1);
+	const __int64 size		= min(length - offset, max(MAP_VIEW_SIZE, pos - start - offset + len));
+
+	m_pView = (BYTE*)MapViewOfFile(hMapping, FILE_MAP_READ, (DWORD)(offset >> 32), (DWORD)offset, (SIZE_T)size);
+	if (!m_pView) {
+		return false;
+	}
+
+	m_viewpos	= start + offset;
+	m_viewlen	= size;
+
+	return true;
+}
+
+void CBaseSplitterFile::UnmapView()
+{
+	UnlockPeek();
+
+	if (m_pView) {
+		UnmapViewOfFile(m_pView);
+		m_pView = NULL;
+	}
+	m_viewpos = m_viewlen = 0;
+}
+
+// a page that can't be read raises an exception instead of returning an error
+static bool CopyFromView(BYTE* dst, const BYTE* src, size_t len)
+{
+	__try {
+		memcpy(dst, src, len);
+	} __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH) {
+		return false;
+	}
+
+	return true;
+}
+
+// brings in the pages of a view, a page that can't be read fails instead of raising later
+static bool TouchView(const BYTE* src, size_t len)
+{
+	__try {
+		for (size_t i = 0; i < len; i += 4096) {
+			(void)((volatile const BYTE*)src)[i];
+		}
+		(void)((volatile const BYTE*)src)[len - 1];
+	} __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH) {
+		return false;
+	}
+
+	return true;
+}
+
+void CBaseSplitterFile::UnlockPeek()
+{
+	if (m_pLocked) {
+		VirtualUnlock(m_pLocked, m_lockedlen);
+		m_pLocked = NULL;
+		m_lockedlen = 0;
+	}
+}
+
 bool CBaseSplitterFile::SetCacheSize(size_t cachelen)
 {
 	m_pCache.Free();
@@ -166,6 +480,8 @@ __int64 CBaseSplitterFile::GetTotal()
 
 void CBaseSplitterFile::Seek(__int64 pos)
 {
+	UnlockPeek();
+
 	__int64 len = GetLength();
 	m_pos = min(max(pos, 0), len);
 	BitFlush();
@@ -177,6 +493,8 @@ HRESULT CBaseSplitterFile::Read(BYTE* pData, __int64 len)
 
 	HRESULT hr = S_OK;
 
+	UnlockPeek();
+
 	if (!m_fRandomAccess) {
 		LONGLONG total = 0, available = -1;
 		m_pAsyncReader->Length(&total, &available);
@@ -186,8 +504,33 @@ HRESULT CBaseSplitterFile::Read(BYTE* pData, __int64 len)
 		}
 	}
 
+	if (m_pFileMapping) {
+		while (len > 0) {
+			if ((m_pos < m_viewpos || m_pos >= m_viewpos + m_viewlen) && !MapView(m_pos, 0)) {
+				break;
+			}
+
+			__int64 minlen = min(len, m_viewpos + m_viewlen - m_pos);
+			if (!CopyFromView(pData, &m_pView[m_pos - m_viewpos], (size_t)minlen)) {
+				// read the rest through the reader, it reports the error
+				UnmapView();
+				m_pFileMapping.Release();
+				break;
+			}
+			InterlockedExchangeAdd64(&m_nBytesRead, minlen);
+
+			len -= minlen;
+			m_pos += minlen;
+			pData += minlen;
+		}
+
+		if (len <= 0) {
+			return S_OK;
+		}
+	}
+
 	if (m_cachetotal == 0 || !m_pCache) {
-		hr = m_pAsyncReader->SyncRead(m_pos, (long)len, pData);
+		hr = SyncRead(m_pos, len, pData);
 		m_pos += len;
 		return hr;
 	}
@@ -205,7 +548,7 @@ HRESULT CBaseSplitterFile::Read(BYTE* pData, __int64 len)
 	}
 
 	while (len > m_cachetotal) {
-		hr = m_pAsyncReader->SyncRead(m_pos, (long)m_cachetotal, pData);
+		hr = SyncRead(m_pos, m_cachetotal, pData);
 		if (S_OK != hr) {
 			return hr;
 		}
@@ -223,7 +566,7 @@ HRESULT CBaseSplitterFile::Read(BYTE* pData, __int64 len)
 			return S_FALSE;
 		}
 
-		hr = m_pAsyncReader->SyncRead(m_pos, (long)maxlen, pCache);
+		hr = SyncRead(m_pos, maxlen, pCache);
 		if (S_OK != hr) {
 			return hr;
 		}
@@ -288,6 +631,61 @@ HRESULT CBaseSplitterFile::ByteRead(BYTE* pData, __int64 len)
 	return Read(pData, len);
 }
 
+const BYTE* CBaseSplitterFile::Peek(__int64 len)
+{
+	Seek(GetPos());
+
+	if (len <= 0 || m_pos + len > GetLength() || !m_pCache || len > m_cachetotal) {
+		return NULL;
+	}
+
+	// The callers don't expect exceptions. The pages are read in under a guard and locked,
+	// so they can't fail to load again while the caller uses them.
+	if (m_pFileMapping) {
+		if (m_pos < m_viewpos || m_pos + len > m_viewpos + m_viewlen) {
+			MapView(m_pos, len);
+		}
+		// a view ends with its part of a playlist
+		if (m_pView && m_viewpos <= m_pos && m_pos + len <= m_viewpos + m_viewlen) {
+			BYTE* pView = &m_pView[m_pos - m_viewpos];
+			if (!TouchView(pView, (size_t)len)) {
+				UnmapView();
+				m_pFileMapping.Release();
+				return NULL;
+			}
+			InterlockedExchangeAdd64(&m_nBytesRead, len);
+
+			if (VirtualLock(pView, (SIZE_T)len)) {
+				m_pLocked	= pView;
+				m_lockedlen	= (SIZE_T)len;
+				return pView;
+			}
+
+			// over the working set quota
+			if (!CopyFromView(m_pCache, pView, (size_t)len)) {
+				UnmapView();
+				m_pFileMapping.Release();
+				return NULL;
+			}
+			m_cachepos = m_pos;
+			m_cachelen = len;
+			return m_pCache;
+		}
+	}
+
+	if (m_pos < m_cachepos || m_pos + len > m_cachepos + m_cachelen) {
+		__int64 maxlen = min(GetLength() - m_pos, m_cachetotal);
+		if (S_OK != SyncRead(m_pos, maxlen, m_pCache)) {
+			return NULL;
+		}
+
+		m_cachepos = m_pos;
+		m_cachelen = maxlen;
+	}
+
+	return &m_pCache[m_pos - m_cachepos];
+}
+
 UINT64 CBaseSplitterFile::UExpGolombRead()
 {
 	int n = -1;
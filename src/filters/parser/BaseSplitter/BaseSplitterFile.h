@@ -23,6 +23,8 @@
 
 #include <atlcoll.h>
 
+interface IFileMapping;
+
 class CBaseSplitterFile
 {
 	CComPtr<IAsyncReader> m_pAsyncReader;
@@ -35,6 +37,40 @@ class CBaseSplitterFile
 
 	virtual HRESULT Read(BYTE* pData, __int64 len); // use ByteRead
 
+	// file regions read ahead in large blocks by worker threads
+	struct prefetch_t {
+		__int64 pos, len;
+		CAutoVectorPtr<BYTE> data;
+		HRESULT hr;
+		enum {queued, reading, done, canceled} state;
+	};
+	CAutoPtrArray<prefetch_t> m_prefetch;
+	CCritSec m_csPrefetch;
+	CAMEvent m_evPrefetch, m_evPrefetchStop;
+	HANDLE m_hPrefetch[2];
+	volatile LONGLONG m_nBytesRead;
+
+	void ReadBlock(prefetch_t* p);
+	__int64 ReadPrefetched(__int64 pos, __int64 len, BYTE* pData);
+	HRESULT SyncRead(__int64 pos, __int64 len, BYTE* pData);
+
+	DWORD PrefetchThreadProc();
+	static DWORD WINAPI StaticPrefetchThreadProc(LPVOID lpParam);
+
+	// a sliding view of the file mapping replaces the cache for local files
+	CComPtr<IFileMapping> m_pFileMapping;
+	BYTE* m_pView;
+	__int64 m_viewpos, m_viewlen;
+
+	bool MapView(__int64 pos, __int64 len);
+	void UnmapView();
+
+	// the pages of the view returned by Peek() stay locked until the next read or seek
+	BYTE* m_pLocked;
+	SIZE_T m_lockedlen;
+
+	void UnlockPeek();
+
 protected:
 	UINT64 m_bitbuff;
 	int m_bitlen;
@@ -52,6 +88,16 @@ public:
 
 	bool SetCacheSize(size_t cachelen);
 
+	// Queues a region for the read-ahead threads, Read() serves it from memory after that.
+	// Parts that are already queued are skipped. CancelPrefetch() drops the regions that
+	// were not started yet, ClearPrefetch() stops the threads and frees all regions.
+	void Prefetch(__int64 pos, __int64 len);
+	void CancelPrefetch();
+	void ClearPrefetch();
+	__int64 GetBytesRead() const {
+		return m_nBytesRead;
+	}
+
 	__int64 GetPos();
 	__int64 GetAvailable();
 	__int64 GetLength(bool fUpdate = false);
@@ -68,6 +114,11 @@ public:
 	void BitByteAlign(), BitFlush();
 	HRESULT ByteRead(BYTE* pData, __int64 len);
 
+	// Returns the next len bytes without moving the position, NULL if they don't fit into
+	// the cache. Mapped files return the view itself. The data is valid until the next
+	// read or seek.
+	const BYTE* Peek(__int64 len);
+
 	bool IsStreaming()		const {
 		return m_fStreaming;
 	}
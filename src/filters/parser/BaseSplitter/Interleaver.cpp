@@ -0,0 +1,76 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include "Interleaver.h"
+
+void CInterleaver::Push(DWORD track, REFERENCE_TIME rt, UINT64 pos)
+{
+	entry e = {rt, pos, track};
+
+	size_t i = m_heap.Add(e);
+	while (i > 0) {
+		const size_t parent = (i - 1) / 2;
+		if (!(e < m_heap[parent])) {
+			break;
+		}
+		m_heap[i] = m_heap[parent];
+		i = parent;
+	}
+	m_heap[i] = e;
+}
+
+bool CInterleaver::Pop(DWORD& track, REFERENCE_TIME* prt)
+{
+	const size_t n = m_heap.GetCount();
+	if (!n) {
+		return false;
+	}
+
+	track = m_heap[0].track;
+	if (prt) {
+		*prt = m_heap[0].rt;
+	}
+
+	const entry e = m_heap[n - 1];
+	m_heap.SetCount(n - 1);
+
+	const size_t count = n - 1;
+	if (count) {
+		size_t i = 0;
+		for (;;) {
+			size_t child = 2 * i + 1;
+			if (child >= count) {
+				break;
+			}
+			if (child + 1 < count && m_heap[child + 1] < m_heap[child]) {
+				child++;
+			}
+			if (!(m_heap[child] < e)) {
+				break;
+			}
+			m_heap[i] = m_heap[child];
+			i = child;
+		}
+		m_heap[i] = e;
+	}
+
+	return true;
+}
@@ -0,0 +1,56 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <atlcoll.h>
+
+// Min-heap of the next sample time of every track, for demuxers that read the
+// tracks of a file from their own indexes. Equal times are ordered by the file
+// position and then by the track number.
+
+class CInterleaver
+{
+	struct entry {
+		REFERENCE_TIME	rt;
+		UINT64			pos;
+		DWORD			track;
+
+		bool operator < (const entry& e) const {
+			return rt < e.rt || (rt == e.rt && (pos < e.pos || (pos == e.pos && track < e.track)));
+		}
+	};
+
+	CAtlArray<entry> m_heap;
+
+public:
+	void	Clear() { m_heap.RemoveAll(); }
+	bool	IsEmpty() const { return m_heap.IsEmpty(); }
+	size_t	GetCount() const { return m_heap.GetCount(); }
+
+	void	Push(DWORD track, REFERENCE_TIME rt, UINT64 pos = 0);
+	// removes the track with the smallest time
+	bool	Pop(DWORD& track, REFERENCE_TIME* prt = NULL);
+
+	// exact ts * 10000000 / timescale without the overflow of the product
+	static REFERENCE_TIME Rescale(UINT64 ts, UINT32 timescale) {
+		return timescale ? (REFERENCE_TIME)((ts / timescale) * UNITS + (ts % timescale) * UNITS / timescale) : 0;
+	}
+};
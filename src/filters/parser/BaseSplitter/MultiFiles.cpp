@@ -28,6 +28,7 @@ CMultiFiles::CMultiFiles()
 	: m_hFile(INVALID_HANDLE_VALUE)
 	, m_llTotalLength(0)
 	, m_nCurPart(-1)
+	, m_nMappedPart(-1)
 	, m_pCurrentPTSOffset(NULL)
 {
 }
@@ -162,10 +163,74 @@ UINT CMultiFiles::Read(BYTE* lpBuf, UINT nCount)
 
 void CMultiFiles::Close()
 {
+	CloseMappings();
 	ClosePart();
 	Reset();
 }
 
+BOOL CMultiFiles::CreateMappings()
+{
+	CloseMappings();
+
+	for (size_t i = 0; i < m_strFiles.GetCount(); i++) {
+		HANDLE hFile = CreateFile(m_strFiles[i], GENERIC_READ, FILE_SHARE_DELETE|FILE_SHARE_READ|FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+		if (hFile == INVALID_HANDLE_VALUE) {
+			CloseMappings();
+			return FALSE;
+		}
+
+		LARGE_INTEGER llSize = {0, 0};
+		GetFileSizeEx(hFile, &llSize);
+
+		// the mapping keeps its own reference to the file
+		HANDLE hMapping = llSize.QuadPart > 0 ? CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+		CloseHandle(hFile);
+
+		if (!hMapping) {
+			CloseMappings();
+			return FALSE;
+		}
+
+		m_hMappings.Add(hMapping);
+		m_MappingsSize.Add(llSize.QuadPart);
+	}
+
+	return !m_hMappings.IsEmpty();
+}
+
+void CMultiFiles::CloseMappings()
+{
+	for (size_t i = 0; i < m_hMappings.GetCount(); i++) {
+		CloseHandle(m_hMappings[i]);
+	}
+	m_hMappings.RemoveAll();
+	m_MappingsSize.RemoveAll();
+	m_nMappedPart = -1;
+}
+
+HANDLE CMultiFiles::GetMapping(ULONGLONG llPosition, ULONGLONG& llStart, ULONGLONG& llLength)
+{
+	ULONGLONG llSum = 0;
+	for (size_t i = 0; i < m_hMappings.GetCount(); i++) {
+		if (llPosition < llSum + m_MappingsSize[i]) {
+			// same as OpenPart(), the reader of the new part gets its PTS offset
+			if (m_nMappedPart != (int)i) {
+				m_nMappedPart = (int)i;
+				if (m_pCurrentPTSOffset != NULL && i < m_rtPtsOffsets.GetCount()) {
+					*m_pCurrentPTSOffset = m_rtPtsOffsets[i];
+				}
+			}
+
+			llStart		= llSum;
+			llLength	= m_MappingsSize[i];
+			return m_hMappings[i];
+		}
+		llSum += m_MappingsSize[i];
+	}
+
+	return NULL;
+}
+
 CMultiFiles::~CMultiFiles()
 {
 	Close();
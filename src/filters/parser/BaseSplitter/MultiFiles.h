@@ -78,6 +78,13 @@ public:
 	virtual UINT Read(BYTE* lpBuf, UINT nCount);
 	virtual void Close();
 
+	// Read-only file mappings of all parts, for parsers that read local files directly
+	// from mapped views. GetMapping returns the mapping of the part that contains llPosition
+	// and the range of that part in the combined file.
+	BOOL CreateMappings();
+	void CloseMappings();
+	HANDLE GetMapping(ULONGLONG llPosition, ULONGLONG& llStart, ULONGLONG& llLength);
+
 	// Implementation
 public:
 	virtual ~CMultiFiles();
@@ -90,6 +97,9 @@ protected:
 	HANDLE						m_hFile;
 	int							m_nCurPart;
 	ULONGLONG					m_llTotalLength;
+	CAtlArray<HANDLE>			m_hMappings;
+	CAtlArray<ULONGLONG>		m_MappingsSize;
+	int							m_nMappedPart;
 
 	BOOL						OpenPart(int nPart);
 	void						ClosePart();
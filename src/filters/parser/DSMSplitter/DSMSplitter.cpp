@@ -258,7 +258,13 @@ bool CDSMSplitterFilter::DemuxLoop()
 STDMETHODIMP CDSMSplitterFilter::GetKeyFrameCount(UINT& nKFs)
 {
 	CheckPointer(m_pFile, E_UNEXPECTED);
-	nKFs = m_pFile->m_sps.GetCount();
+
+	if (const CAtlArray<SyncPoint>* kfs = m_pFile->GetVideoKeyFrames()) {
+		nKFs = (UINT)kfs->GetCount();
+	} else {
+		nKFs = (UINT)m_pFile->m_sps.GetCount();
+	}
+
 	return S_OK;
 }
 
@@ -272,6 +278,15 @@ STDMETHODIMP CDSMSplitterFilter::GetKeyFrames(const GUID* pFormat, REFERENCE_TIM
 		return E_INVALIDARG;
 	}
 
+	if (const CAtlArray<SyncPoint>* kfs = m_pFile->GetVideoKeyFrames()) {
+		UINT n = 0;
+		for (; n < nKFs && n < kfs->GetCount(); n++) {
+			pKFs[n] = kfs->GetAt(n).rt - m_pFile->m_rtFirst;
+		}
+		nKFs = n;
+		return S_OK;
+	}
+
 	// these aren't really the keyframes, but quicky accessable points in the stream
 	for (nKFs = 0; nKFs < m_pFile->m_sps.GetCount(); nKFs++) {
 		pKFs[nKFs] = m_pFile->m_sps[nKFs].rt;
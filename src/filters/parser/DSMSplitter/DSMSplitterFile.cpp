@@ -50,6 +50,8 @@ HRESULT CDSMSplitterFile::Init(IDSMResourceBagImpl& res, IDSMChapterBagImpl& cha
 	m_rtFirst = m_rtDuration = 0;
 	m_fim.RemoveAll();
 	m_sim.RemoveAll();
+	m_kfs.RemoveAll();
+	m_kfpackets.RemoveAll();
 	res.ResRemoveAll();
 	chap.ChapRemoveAll();
 
@@ -114,6 +116,15 @@ HRESULT CDSMSplitterFile::Init(IDSMResourceBagImpl& res, IDSMChapterBagImpl& cha
 					}
 				} else if (type == DSMP_SYNCPOINTS) {
 					Read(len, m_sps);
+				} else if (type == DSMP_KEYFRAMES) {
+					bool bFound = false;
+					for (size_t k = 0; k < m_kfpackets.GetCount() && !bFound; k++) {
+						bFound = (m_kfpackets[k].fp == pos);
+					}
+					if (!bFound) {
+						SyncPoint kp = {(REFERENCE_TIME)len, pos};
+						m_kfpackets.Add(kp);
+					}
 				} else if (type == DSMP_RESOURCE) {
 					Read(len, res);
 				} else if (type == DSMP_CHAPTERS) {
@@ -124,6 +135,9 @@ HRESULT CDSMSplitterFile::Init(IDSMResourceBagImpl& res, IDSMChapterBagImpl& cha
 			}
 		}
 
+	// only Init may move the file position, later the app and the demux thread share it
+	ReadKeyFrames();
+
 	if (m_rtFirst < 0) {
 		m_rtDuration += m_rtFirst;
 		m_rtFirst = 0;
@@ -306,6 +320,11 @@ __int64 CDSMSplitterFile::Read(__int64 len, CStringW& str)
 
 __int64 CDSMSplitterFile::FindSyncPoint(REFERENCE_TIME rt)
 {
+	__int64 fp;
+	if (FindKeyFrame(m_rtFirst + rt, fp)) {
+		return fp;
+	}
+
 	if (/*!m_sps.IsEmpty()*/ m_sps.GetCount() > 1) {
 		int i = range_bsearch(m_sps, m_rtFirst + rt);
 		return i >= 0 ? m_sps[i].fp : 0;
@@ -421,3 +440,84 @@ __int64 CDSMSplitterFile::FindSyncPoint(REFERENCE_TIME rt)
 
 	return ret;
 }
+
+void CDSMSplitterFile::ReadKeyFrames()
+{
+	for (size_t i = 0; i < m_kfpackets.GetCount(); i++) {
+		const __int64 len = m_kfpackets[i].rt;
+		if (len < 1) {
+			continue;
+		}
+
+		Seek(m_kfpackets[i].fp);
+
+		CAutoPtr<keyframes_t> kf(DNew keyframes_t);
+		kf->id = (BYTE)BitRead(8);
+		if (Read(len - 1, kf->sps) && !kf->sps.IsEmpty() && !GetKeyFrames(kf->id)) {
+			m_kfs.Add(kf);
+		}
+	}
+
+	m_kfpackets.RemoveAll();
+}
+
+const CDSMSplitterFile::keyframes_t* CDSMSplitterFile::GetKeyFrames(BYTE id)
+{
+	for (size_t i = 0; i < m_kfs.GetCount(); i++) {
+		if (m_kfs[i]->id == id) {
+			return m_kfs[i];
+		}
+	}
+
+	return NULL;
+}
+
+bool CDSMSplitterFile::FindKeyFrame(REFERENCE_TIME rt, __int64& fp)
+{
+	if (m_kfs.IsEmpty()) {
+		return false;
+	}
+
+	// the earliest of the last keyframes before rt of every stream, except for subtitle streams
+
+	bool bFound = false;
+	fp = 0;
+
+	POSITION pos = m_mts.GetStartPosition();
+	while (pos) {
+		BYTE id;
+		CMediaType mt;
+		m_mts.GetNextAssoc(pos, id, mt);
+		if (mt.majortype == MEDIATYPE_Text || mt.majortype == MEDIATYPE_Subtitle) {
+			continue;
+		}
+
+		const keyframes_t* kf = GetKeyFrames(id);
+		if (!kf) {
+			return false;
+		}
+
+		int i = range_bsearch(kf->sps, rt);
+		__int64 kfp = i >= 0 ? kf->sps[i].fp : 0;
+		fp = bFound ? min(fp, kfp) : kfp;
+		bFound = true;
+	}
+
+	return bFound;
+}
+
+const CAtlArray<SyncPoint>* CDSMSplitterFile::GetVideoKeyFrames()
+{
+	POSITION pos = m_mts.GetStartPosition();
+	while (pos) {
+		BYTE id;
+		CMediaType mt;
+		m_mts.GetNextAssoc(pos, id, mt);
+		if (mt.majortype == MEDIATYPE_Video) {
+			const keyframes_t* kf = GetKeyFrames(id);
+			return kf ? &kf->sps : NULL;
+		}
+	}
+
+	return NULL;
+}
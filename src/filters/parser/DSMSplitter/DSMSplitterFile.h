@@ -29,6 +29,17 @@ class CDSMSplitterFile : public CBaseSplitterFile
 {
 	HRESULT Init(IDSMResourceBagImpl& res, IDSMChapterBagImpl& chap);
 
+	// per stream keyframe index of the footer
+	struct keyframes_t {
+		BYTE id;
+		CAtlArray<SyncPoint> sps;
+	};
+	CAutoPtrArray<keyframes_t> m_kfs;
+	CAtlArray<SyncPoint> m_kfpackets; // rt = length, fp = position of the DSMP_KEYFRAMES payloads, until they are read
+
+	void ReadKeyFrames();
+	const keyframes_t* GetKeyFrames(BYTE id);
+
 public:
 	CDSMSplitterFile(IAsyncReader* pReader, HRESULT& hr, IDSMResourceBagImpl& res, IDSMChapterBagImpl& chap);
 
@@ -52,4 +63,8 @@ public:
 	__int64 Read(__int64 len, CStringW& str);
 
 	__int64 FindSyncPoint(REFERENCE_TIME rt);
+	bool FindKeyFrame(REFERENCE_TIME rt, __int64& fp);
+
+	// keyframes of the first video stream, NULL if the file has no index
+	const CAtlArray<SyncPoint>* GetVideoKeyFrames();
 };
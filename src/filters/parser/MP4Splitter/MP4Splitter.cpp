@@ -248,7 +248,9 @@ HRESULT CMP4SplitterFilter::CreateOutputs(IAsyncReader* pAsyncReader)
 
 			AP4_Sample sample;
 
-			if (!AP4_SUCCEEDED(track->GetSample(0, sample)) || sample.GetDescriptionIndex() == 0xFFFFFFFF) {
+			// the tracks of fragmented files have no samples in the moov
+			if ((!AP4_SUCCEEDED(track->GetSample(0, sample)) && !m_pFile->IsFragmented())
+					|| sample.GetDescriptionIndex() == 0xFFFFFFFF) {
 				continue;
 			}
 
@@ -1222,6 +1224,10 @@ HRESULT CMP4SplitterFilter::CreateOutputs(IAsyncReader* pAsyncReader)
 	if (rtVideoDuration > 0 && rtVideoDuration < m_rtDuration/2)
 		m_rtDuration = rtVideoDuration; // fix incorrect duration
 
+	if (m_pFile->IsFragmented()) {
+		m_rtDuration = max(m_rtDuration, m_pFile->GetFragmentsDuration());
+	}
+
 	m_rtNewStop = m_rtStop = m_rtDuration;
 
 	return m_pOutputs.GetCount() > 0 ? S_OK : E_FAIL;
@@ -1251,6 +1257,11 @@ bool CMP4SplitterFilter::DemuxInit()
 
 void CMP4SplitterFilter::DemuxSeek(REFERENCE_TIME rt)
 {
+	if (m_pFile->IsFragmented()) {
+		m_pFile->SeekFragment(rt);
+		return;
+	}
+
 	AP4_Movie* movie = (AP4_Movie*)m_pFile->GetMovie();
 
 	POSITION pos = m_trackpos.GetStartPosition();
@@ -1291,40 +1302,42 @@ void CMP4SplitterFilter::DemuxSeek(REFERENCE_TIME rt)
 
 bool CMP4SplitterFilter::DemuxLoop()
 {
+	if (m_pFile->IsFragmented()) {
+		return DemuxLoopFragmented();
+	}
+
 	HRESULT hr = S_OK;
 
 	m_pFile->Seek(0);
 	AP4_Movie* movie = (AP4_Movie*)m_pFile->GetMovie();
 
-	while (SUCCEEDED(hr) && !CheckRequest(NULL) && (!m_pFile->IsStreaming() || SUCCEEDED(m_pFile->WaitAvailable()))) {
-
-		CAtlMap<DWORD, trackpos>::CPair* pPairNext = NULL;
-		REFERENCE_TIME rtNext = 0;
+	CInterleaver interleaver;
 
-		POSITION pos = m_trackpos.GetStartPosition();
-		while (pos) {
-			CAtlMap<DWORD, trackpos>::CPair* pPair = m_trackpos.GetNext(pos);
-
-			AP4_Track* track = movie->GetTrack(pPair->m_key);
+	POSITION pos = m_trackpos.GetStartPosition();
+	while (pos) {
+		CAtlMap<DWORD, trackpos>::CPair* pPair = m_trackpos.GetNext(pos);
 
-			CBaseSplitterOutputPin* pPin = GetOutputPin((DWORD)track->GetId());
-			if (!pPin->IsConnected()) {
-				continue;
-			}
+		AP4_Track* track = movie->GetTrack(pPair->m_key);
 
-			REFERENCE_TIME rt = (REFERENCE_TIME)(10000000.0 / track->GetMediaTimeScale() * pPair->m_value.ts);
+		CBaseSplitterOutputPin* pPin = GetOutputPin((DWORD)track->GetId());
+		if (!pPin || !pPin->IsConnected()) {
+			continue;
+		}
 
-			if (pPair->m_value.index < track->GetSampleCount() && (!pPairNext || rt < rtNext)) {
-				pPairNext = pPair;
-				rtNext = rt;
-			}
+		if (pPair->m_value.index < track->GetSampleCount()) {
+			interleaver.Push(pPair->m_key, CInterleaver::Rescale(pPair->m_value.ts, track->GetMediaTimeScale()));
 		}
+	}
 
-		if (!pPairNext) {
+	while (SUCCEEDED(hr) && !CheckRequest(NULL) && (!m_pFile->IsStreaming() || SUCCEEDED(m_pFile->WaitAvailable()))) {
+
+		DWORD id;
+		if (!interleaver.Pop(id)) {
 			break;
 		}
 
-		AP4_Track* track = movie->GetTrack(pPairNext->m_key);
+		CAtlMap<DWORD, trackpos>::CPair* pPairNext = m_trackpos.Lookup(id);
+		AP4_Track* track = movie->GetTrack(id);
 
 		CBaseSplitterOutputPin* pPin = GetOutputPin((DWORD)track->GetId());
 
@@ -1446,6 +1459,74 @@ bool CMP4SplitterFilter::DemuxLoop()
 			}
 		}
 
+		if (pPairNext->m_value.index < track->GetSampleCount()) {
+			interleaver.Push(id, CInterleaver::Rescale(pPairNext->m_value.ts, track->GetMediaTimeScale()));
+		}
+
+	}
+
+	return true;
+}
+
+bool CMP4SplitterFilter::DemuxLoopFragmented()
+{
+	HRESULT hr = S_OK;
+
+	// a growing file that gets no new fragment for about half a minute has ended
+	int nWaits = 0;
+
+	while (SUCCEEDED(hr) && !CheckRequest(NULL)) {
+		HRESULT hrFragment = m_pFile->ReadFragment();
+		if (FAILED(hrFragment)) {
+			break;
+		}
+		if (hrFragment == S_FALSE) {
+			if (++nWaits > 20) {
+				break;
+			}
+			continue;
+		}
+		nWaits = 0;
+
+		CInterleaver interleaver;
+
+		POSITION pos = m_trackpos.GetStartPosition();
+		while (pos) {
+			DWORD id = m_trackpos.GetNextKey(pos);
+
+			CBaseSplitterOutputPin* pPin = GetOutputPin(id);
+			CMP4SplitterFile::fragment_track_t* t = m_pFile->GetFragmentTrack(id);
+			if (!pPin || !pPin->IsConnected() || !t || !t->timescale || t->samples.IsEmpty()) {
+				continue;
+			}
+
+			interleaver.Push(id, CInterleaver::Rescale(t->samples[0].dts, t->timescale), t->samples[0].pos);
+		}
+
+		DWORD id;
+		while (SUCCEEDED(hr) && !CheckRequest(NULL) && interleaver.Pop(id)) {
+			CMP4SplitterFile::fragment_track_t* t = m_pFile->GetFragmentTrack(id);
+			const CMP4SplitterFile::fragment_sample_t& s = t->samples[t->index++];
+
+			if (t->index < t->samples.GetCount()) {
+				const CMP4SplitterFile::fragment_sample_t& s2 = t->samples[t->index];
+				interleaver.Push(id, CInterleaver::Rescale(s2.dts, t->timescale), s2.pos);
+			}
+
+			CAutoPtr<Packet> p(DNew Packet());
+			p->TrackNumber	= id;
+			p->rtStart		= CInterleaver::Rescale(s.dts, t->timescale) + (REFERENCE_TIME)s.cto * UNITS / t->timescale;
+			p->rtStop		= p->rtStart + CInterleaver::Rescale(s.duration, t->timescale);
+			p->bSyncPoint	= s.bSyncPoint;
+
+			p->SetCount(s.size);
+			m_pFile->Seek(s.pos);
+			if (S_OK != m_pFile->ByteRead(p->GetData(), s.size)) {
+				continue; // a truncated file
+			}
+
+			hr = DeliverPacket(p);
+		}
 	}
 
 	return true;
@@ -46,6 +46,7 @@ protected:
 	bool DemuxInit();
 	void DemuxSeek(REFERENCE_TIME rt);
 	bool DemuxLoop();
+	bool DemuxLoopFragmented();
 
 public:
 	CMP4SplitterFilter(LPUNKNOWN pUnk, HRESULT* phr);
@@ -22,10 +22,24 @@
 #include "stdafx.h"
 #include "MP4SplitterFile.h"
 #include "Ap4AsyncReaderStream.h"
+#include "../../../DSUtil/GolombBuffer.h"
+
+#define MAX_BOX_DATA	(16 * 1024 * 1024) // limit for the boxes that are parsed in memory
+#define SAMPLE_NON_SYNC	0x10000
+#define MAX_TRUN_SAMPLES	(1024 * 1024) // limit for a trun without per sample fields
+#define MAX_SAMPLE_SIZE	(64 * 1024 * 1024)
 
 CMP4SplitterFile::CMP4SplitterFile(IAsyncReader* pReader, HRESULT& hr)
 	: CBaseSplitterFileEx(pReader, hr, false, true, true)
 	, m_pAp4File(NULL)
+	, m_bFragmented(false)
+	, m_FirstFragment(0)
+	, m_NextFragment(0)
+	, m_sidxpos(-1)
+	, m_rtFragmentsDuration(0)
+	, m_bSidxRead(false)
+	, m_bMfraRead(false)
+	, m_IndexPos(0)
 {
 	if (FAILED(hr)) {
 		return;
@@ -61,5 +75,643 @@ HRESULT CMP4SplitterFile::Init()
 
 	stream->Release();
 
+	if (movie && movie->GetMoovAtom()->FindChild("mvex")) {
+		InitFragments();
+	}
+
 	return movie ? S_OK : E_FAIL;
 }
+
+//
+// fragmented files
+//
+
+static bool NextBox(CGolombBuffer& gb, DWORD& type, CGolombBuffer& box)
+{
+	if (gb.RemainingSize() < 8) {
+		return false;
+	}
+
+	UINT64 size	= gb.ReadDword();
+	type		= gb.ReadDword();
+	int hdr		= 8;
+
+	if (size == 1) {
+		if (gb.RemainingSize() < 8) {
+			return false;
+		}
+		size = gb.BitRead(64);
+		hdr = 16;
+	} else if (size == 0) {
+		size = hdr + gb.RemainingSize();
+	}
+
+	if (size < (UINT64)hdr || size - hdr > (UINT64)gb.RemainingSize()) {
+		return false;
+	}
+
+	box.Reset(gb.GetBufferPos(), (int)(size - hdr));
+	gb.SkipBytes((int)(size - hdr));
+
+	return true;
+}
+
+bool CMP4SplitterFile::WaitBytes(__int64 end)
+{
+	if (GetLength() >= end) {
+		return true;
+	}
+
+	if (!IsStreaming()) {
+		return false;
+	}
+
+	WaitAvailable(1500, end - GetPos());
+
+	return GetLength() >= end;
+}
+
+bool CMP4SplitterFile::ReadBox(__int64 pos, __int64 end, DWORD& type, __int64& start, __int64& next)
+{
+	if (end - pos < 8 || !WaitBytes(pos + 8)) {
+		return false;
+	}
+
+	Seek(pos);
+	UINT64 size	= BitRead(32);
+	type		= (DWORD)BitRead(32);
+	start		= pos + 8;
+
+	if (size == 1) {
+		if (end - pos < 16 || !WaitBytes(pos + 16)) {
+			return false;
+		}
+		size = BitRead(64);
+		start += 8;
+	} else if (size == 0) {
+		// up to the end of the parent or of the file
+		size = (end == _I64_MAX ? GetLength() : end) - pos;
+	}
+
+	if (size < (UINT64)(start - pos) || size > (UINT64)(end - pos)) {
+		return false;
+	}
+
+	next = pos + (__int64)size;
+
+	return true;
+}
+
+bool CMP4SplitterFile::ReadBoxData(__int64 start, __int64 next, CAtlArray<BYTE>& data)
+{
+	if (next - start > MAX_BOX_DATA || !WaitBytes(next) || !data.SetCount((size_t)(next - start))) {
+		return false;
+	}
+
+	Seek(start);
+	return S_OK == ByteRead(data.GetData(), data.GetCount());
+}
+
+CMP4SplitterFile::fragment_track_t* CMP4SplitterFile::GetFragmentTrack(DWORD id)
+{
+	for (size_t i = 0; i < m_ftracks.GetCount(); i++) {
+		if (m_ftracks[i]->id == id) {
+			return m_ftracks[i];
+		}
+	}
+
+	return NULL;
+}
+
+void CMP4SplitterFile::InitFragments()
+{
+	AP4_Movie* movie = ((AP4_File*)m_pAp4File)->GetMovie();
+
+	// samples in the moov are played the usual way
+	for (AP4_List<AP4_Track>::Item* item = movie->GetTracks().FirstItem(); item; item = item->GetNext()) {
+		if (item->GetData()->GetSampleCount()) {
+			return;
+		}
+	}
+
+	for (AP4_List<AP4_Track>::Item* item = movie->GetTracks().FirstItem(); item; item = item->GetNext()) {
+		AP4_Track* track = item->GetData();
+
+		CAutoPtr<fragment_track_t> t(DNew fragment_track_t);
+		t->id				= track->GetId();
+		t->timescale		= track->GetMediaTimeScale();
+		t->default_duration	= 0;
+		t->default_size		= 0;
+		t->default_flags	= 0;
+		t->dts				= 0;
+		t->index			= 0;
+		m_ftracks.Add(t);
+	}
+
+	m_bFragmented = true;
+
+	// the top level boxes up to the first fragment, only their headers are read
+	const __int64 end = IsStreaming() ? _I64_MAX : GetLength();
+
+	DWORD type;
+	__int64 pos = 0, start, next;
+	for (; ReadBox(pos, end, type, start, next); pos = next) {
+		if (type == 'moof') {
+			break;
+		} else if (type == 'sidx' && m_sidxpos < 0) {
+			m_sidxpos = pos;
+		} else if (type == 'moov') {
+			DWORD type2;
+			__int64 start2, next2;
+			for (__int64 pos2 = start; ReadBox(pos2, next, type2, start2, next2); pos2 = next2) {
+				if (type2 != 'mvex') {
+					continue;
+				}
+
+				CAtlArray<BYTE> data;
+				if (!ReadBoxData(start2, next2, data)) {
+					break;
+				}
+
+				CGolombBuffer gb(data.GetData(), (int)data.GetCount());
+				CGolombBuffer box(NULL, 0);
+				DWORD type3;
+				while (NextBox(gb, type3, box)) {
+					if (type3 == 'trex' && box.GetSize() >= 24) {
+						box.ReadDword(); // version and flags
+						if (fragment_track_t* t = GetFragmentTrack(box.ReadDword())) {
+							box.ReadDword(); // default_sample_description_index
+							t->default_duration	= box.ReadDword();
+							t->default_size		= box.ReadDword();
+							t->default_flags	= box.ReadDword();
+						}
+					} else if (type3 == 'mehd' && box.GetSize() >= 8) {
+						const BYTE version = box.ReadByte();
+						box.BitRead(24);
+						const UINT64 duration = version == 1 ? box.BitRead(64) : box.ReadDword();
+						m_rtFragmentsDuration = CInterleaver::Rescale(duration, movie->GetTimeScale());
+					}
+				}
+				break;
+			}
+		}
+	}
+
+	m_FirstFragment = m_NextFragment = pos;
+}
+
+bool CMP4SplitterFile::ParseMoof(__int64 pos, __int64 start, __int64 next, bool& bTfdt)
+{
+	for (size_t i = 0; i < m_ftracks.GetCount(); i++) {
+		m_ftracks[i]->samples.RemoveAll();
+		m_ftracks[i]->index = 0;
+	}
+
+	bTfdt = false;
+
+	CAtlArray<BYTE> data;
+	if (!ReadBoxData(start, next, data)) {
+		return false;
+	}
+
+	CGolombBuffer gb(data.GetData(), (int)data.GetCount());
+	CGolombBuffer traf(NULL, 0), box(NULL, 0);
+	DWORD type;
+
+	// without an explicit base the data of a traf follows the data of the previous one
+	__int64 dataend = pos;
+
+	while (NextBox(gb, type, traf)) {
+		if (type != 'traf') {
+			continue;
+		}
+
+		fragment_track_t* t = NULL;
+		DWORD duration = 0, size = 0, flags = 0;
+		__int64 base = dataend, offset = dataend;
+
+		while (NextBox(traf, type, box)) {
+			if (type == 'tfhd' && box.GetSize() >= 8) {
+				const DWORD tfhd_flags = box.ReadDword() & 0xffffff;
+				t = GetFragmentTrack(box.ReadDword());
+				if (t) {
+					duration	= t->default_duration;
+					size		= t->default_size;
+					flags		= t->default_flags;
+				}
+
+				if (tfhd_flags & 0x000001) {
+					base = (__int64)box.BitRead(64);
+				} else if (tfhd_flags & 0x020000) { // default-base-is-moof
+					base = pos;
+				}
+				if (tfhd_flags & 0x000002) {
+					box.ReadDword(); // sample_description_index
+				}
+				if (tfhd_flags & 0x000008) {
+					duration = box.ReadDword();
+				}
+				if (tfhd_flags & 0x000010) {
+					size = box.ReadDword();
+				}
+				if (tfhd_flags & 0x000020) {
+					flags = box.ReadDword();
+				}
+				offset = base;
+			} else if (type == 'tfdt' && box.GetSize() >= 8) {
+				const BYTE version = box.ReadByte();
+				box.BitRead(24);
+				const UINT64 dts = version == 1 ? box.BitRead(64) : box.ReadDword();
+				if (t) {
+					t->dts = dts;
+					bTfdt = true;
+				}
+			} else if (type == 'trun' && box.GetSize() >= 8) {
+				const DWORD trun_flags = box.ReadDword() & 0xffffff;
+				DWORD count = box.ReadDword();
+
+				if (trun_flags & 0x000001) {
+					offset = base + (int)box.ReadDword();
+				}
+				DWORD first_flags = flags;
+				if (trun_flags & 0x000004) {
+					first_flags = box.ReadDword();
+				}
+
+				const int entry = 4 * (!!(trun_flags & 0x100) + !!(trun_flags & 0x200) + !!(trun_flags & 0x400) + !!(trun_flags & 0x800));
+				if (entry) {
+					if (count > (DWORD)(box.RemainingSize() / entry)) {
+						return false;
+					}
+				} else {
+					// all samples use the defaults, nothing in the box limits the count
+					if (count > MAX_TRUN_SAMPLES) {
+						return false;
+					}
+					if (size && !IsStreaming()) {
+						const __int64 left = GetLength() - offset;
+						if ((__int64)count * size > left) {
+							count = left > 0 ? (DWORD)(left / size) : 0;
+						}
+					}
+				}
+
+				if (t) {
+					// reserve only, the samples of the previous truns stay
+					t->samples.SetCount(t->samples.GetCount(), count);
+				}
+
+				for (DWORD i = 0; i < count; i++) {
+					fragment_sample_t s;
+					s.pos		= offset;
+					s.duration	= (trun_flags & 0x100) ? box.ReadDword() : duration;
+					s.size		= (trun_flags & 0x200) ? box.ReadDword() : size;
+					const DWORD sflags = (trun_flags & 0x400) ? box.ReadDword() : i == 0 ? first_flags : flags;
+					s.cto		= (trun_flags & 0x800) ? (int)box.ReadDword() : 0;
+					s.bSyncPoint = !(sflags & SAMPLE_NON_SYNC);
+
+					if (s.size > MAX_SAMPLE_SIZE) {
+						return false;
+					}
+
+					if (t) {
+						s.dts = t->dts;
+						t->dts += s.duration;
+						t->samples.Add(s);
+					}
+
+					offset += s.size;
+				}
+
+				dataend = max(dataend, offset);
+			}
+		}
+	}
+
+	return true;
+}
+
+bool CMP4SplitterFile::ReadMoofTime(__int64 start, __int64 next, REFERENCE_TIME& rt)
+{
+	CAtlArray<BYTE> data;
+	if (!ReadBoxData(start, next, data)) {
+		return false;
+	}
+
+	CGolombBuffer gb(data.GetData(), (int)data.GetCount());
+	CGolombBuffer traf(NULL, 0), box(NULL, 0);
+	DWORD type;
+
+	bool bFound = false;
+
+	while (NextBox(gb, type, traf)) {
+		if (type != 'traf') {
+			continue;
+		}
+
+		fragment_track_t* t = NULL;
+		while (NextBox(traf, type, box)) {
+			if (type == 'tfhd' && box.GetSize() >= 8) {
+				box.ReadDword();
+				t = GetFragmentTrack(box.ReadDword());
+			} else if (type == 'tfdt' && box.GetSize() >= 8 && t) {
+				const BYTE version = box.ReadByte();
+				box.BitRead(24);
+				const UINT64 dts = version == 1 ? box.BitRead(64) : box.ReadDword();
+				const REFERENCE_TIME rt2 = CInterleaver::Rescale(dts, t->timescale);
+				if (!bFound || rt2 < rt) {
+					rt = rt2;
+					bFound = true;
+				}
+			}
+		}
+	}
+
+	return bFound;
+}
+
+void CMP4SplitterFile::AddFragment(__int64 pos, REFERENCE_TIME rt)
+{
+	size_t i = 0, j = m_fragments.GetCount();
+	while (i < j) {
+		const size_t mid = (i + j) / 2;
+		if (m_fragments[mid].pos < pos) {
+			i = mid + 1;
+		} else {
+			j = mid;
+		}
+	}
+
+	if (i < m_fragments.GetCount() && m_fragments[i].pos == pos) {
+		return;
+	}
+
+	fragment_t f = {pos, rt};
+	m_fragments.InsertAt(i, f);
+}
+
+void CMP4SplitterFile::ReadSidx()
+{
+	m_bSidxRead = true;
+
+	DWORD type;
+	__int64 start, next;
+	CAtlArray<BYTE> data;
+	if (m_sidxpos < 0 || !ReadBox(m_sidxpos, _I64_MAX, type, start, next) || !ReadBoxData(start, next, data)) {
+		return;
+	}
+
+	CGolombBuffer gb(data.GetData(), (int)data.GetCount());
+	const BYTE version = gb.ReadByte();
+	gb.BitRead(24);
+	gb.ReadDword(); // reference_ID
+	const DWORD timescale = gb.ReadDword();
+	UINT64 ept			= version == 0 ? gb.ReadDword() : gb.BitRead(64);
+	__int64 offset		= next + (__int64)(version == 0 ? gb.ReadDword() : gb.BitRead(64));
+	gb.ReadShort();
+	const WORD count	= (WORD)gb.ReadShort();
+
+	if (!timescale || count > gb.RemainingSize() / 12) {
+		return;
+	}
+
+	for (WORD i = 0; i < count; i++) {
+		const DWORD ref			= gb.ReadDword();
+		const DWORD duration	= gb.ReadDword();
+		gb.ReadDword(); // SAP
+
+		// references to other sidx boxes are left to the walk over the fragments
+		if (!(ref & 0x80000000)) {
+			AddFragment(offset, CInterleaver::Rescale(ept, timescale));
+		}
+
+		ept		+= duration;
+		offset	+= ref & 0x7fffffff;
+	}
+
+	m_rtFragmentsDuration = max(m_rtFragmentsDuration, CInterleaver::Rescale(ept, timescale));
+}
+
+void CMP4SplitterFile::ReadMfra()
+{
+	m_bMfraRead = true;
+
+	const __int64 len = GetLength();
+	if (len < 16) {
+		return;
+	}
+
+	Seek(len - 16);
+	if (BitRead(32) != 16 || BitRead(32) != 'mfro') {
+		return;
+	}
+	BitRead(32);
+	const __int64 size = (__int64)BitRead(32);
+
+	DWORD type;
+	__int64 start, next;
+	CAtlArray<BYTE> data;
+	if (size > len || !ReadBox(len - size, len, type, start, next) || type != 'mfra' || !ReadBoxData(start, next, data)) {
+		return;
+	}
+
+	CGolombBuffer gb(data.GetData(), (int)data.GetCount());
+	CGolombBuffer box(NULL, 0);
+
+	// the random access points of one track are enough
+	while (NextBox(gb, type, box)) {
+		if (type != 'tfra' || box.GetSize() < 16) {
+			continue;
+		}
+
+		const BYTE version = box.ReadByte();
+		box.BitRead(24);
+		fragment_track_t* t = GetFragmentTrack(box.ReadDword());
+		const DWORD lengths	= box.ReadDword();
+		const DWORD count	= box.ReadDword();
+
+		const int skip	= ((lengths >> 4) & 3) + ((lengths >> 2) & 3) + (lengths & 3) + 3;
+		const int entry	= (version == 1 ? 16 : 8) + skip;
+		if (!t || !t->timescale || count > (DWORD)(box.RemainingSize() / entry)) {
+			continue;
+		}
+
+		for (DWORD i = 0; i < count; i++) {
+			const UINT64 time	= version == 1 ? box.BitRead(64) : box.ReadDword();
+			const UINT64 moof	= version == 1 ? box.BitRead(64) : box.ReadDword();
+			box.SkipBytes(skip);
+
+			AddFragment((__int64)moof, CInterleaver::Rescale(time, t->timescale));
+		}
+
+		break;
+	}
+}
+
+void CMP4SplitterFile::IndexFragments(REFERENCE_TIME rt)
+{
+	if (!m_bSidxRead) {
+		ReadSidx();
+	}
+	if (!m_bMfraRead && !IsStreaming()) {
+		ReadMfra();
+	}
+
+	if (!m_fragments.IsEmpty() && m_fragments[m_fragments.GetCount() - 1].rt > rt) {
+		return;
+	}
+
+	// walk over the fragments after the last known one until one starts after rt,
+	// fragments without tfdt are only indexed while they are demuxed
+	const __int64 end = GetLength();
+
+	__int64 pos = max(m_FirstFragment, m_IndexPos);
+	if (!m_fragments.IsEmpty()) {
+		pos = max(pos, m_fragments[m_fragments.GetCount() - 1].pos);
+	}
+
+	DWORD type;
+	__int64 start, next;
+	for (; pos < end && ReadBox(pos, end, type, start, next); pos = next) {
+		REFERENCE_TIME rtFragment;
+		if (type == 'moof' && ReadMoofTime(start, next, rtFragment)) {
+			AddFragment(pos, rtFragment);
+			if (rtFragment > rt) {
+				pos = next;
+				break;
+			}
+		}
+	}
+
+	m_IndexPos = pos;
+}
+
+REFERENCE_TIME CMP4SplitterFile::GetFragmentsDuration()
+{
+	if (m_rtFragmentsDuration > 0 || IsStreaming()) {
+		return m_rtFragmentsDuration;
+	}
+
+	// only the sidx and mfra indexes are read here, without them the duration stays
+	// unknown rather than walking over every moof of the file
+	if (!m_bSidxRead) {
+		ReadSidx();
+	}
+	if (!m_bMfraRead) {
+		ReadMfra();
+	}
+
+	if (m_rtFragmentsDuration > 0 || m_fragments.IsEmpty()) {
+		return m_rtFragmentsDuration;
+	}
+
+	const __int64 pos = m_fragments[m_fragments.GetCount() - 1].pos;
+	REFERENCE_TIME rtEnd = m_fragments[m_fragments.GetCount() - 1].rt;
+
+	// the end of the samples in the last fragment
+	DWORD type;
+	__int64 start, next;
+	bool bTfdt;
+	if (ReadBox(pos, GetLength(), type, start, next) && ParseMoof(pos, start, next, bTfdt) && bTfdt) {
+		for (size_t i = 0; i < m_ftracks.GetCount(); i++) {
+			fragment_track_t* t = m_ftracks[i];
+			rtEnd = max(rtEnd, CInterleaver::Rescale(t->dts, t->timescale));
+		}
+	}
+
+	SeekFragment(0);
+
+	return m_rtFragmentsDuration = rtEnd;
+}
+
+void CMP4SplitterFile::SeekFragment(REFERENCE_TIME rt)
+{
+	m_NextFragment = m_FirstFragment;
+	REFERENCE_TIME rtFragment = 0;
+
+	if (rt > 0) {
+		IndexFragments(rt);
+
+		for (size_t i = 0; i < m_fragments.GetCount(); i++) {
+			if (m_fragments[i].rt <= rt && m_fragments[i].rt >= rtFragment) {
+				m_NextFragment	= m_fragments[i].pos;
+				rtFragment		= m_fragments[i].rt;
+			}
+		}
+	}
+
+	// the decode time of fragments without tfdt
+	for (size_t i = 0; i < m_ftracks.GetCount(); i++) {
+		fragment_track_t* t = m_ftracks[i];
+		t->samples.RemoveAll();
+		t->index	= 0;
+		t->dts		= (UINT64)((double)rtFragment * t->timescale / UNITS);
+	}
+}
+
+HRESULT CMP4SplitterFile::ReadFragment()
+{
+	const __int64 end = IsStreaming() ? _I64_MAX : GetLength();
+
+	DWORD type;
+	__int64 start, next;
+	while (ReadBox(m_NextFragment, end, type, start, next)) {
+		const __int64 pos = m_NextFragment;
+
+		if (type != 'moof') {
+			m_NextFragment = next;
+			continue;
+		}
+
+		bool bTfdt;
+		if (!ParseMoof(pos, start, next, bTfdt)) {
+			if (!IsStreaming()) {
+				// skip a broken fragment
+				m_NextFragment = next;
+				continue;
+			}
+			break;
+		}
+
+		// the media data of the fragment must be complete
+		__int64 dataend = next;
+		REFERENCE_TIME rt = _I64_MAX;
+		for (size_t i = 0; i < m_ftracks.GetCount(); i++) {
+			fragment_track_t* t = m_ftracks[i];
+			for (size_t j = 0; j < t->samples.GetCount(); j++) {
+				dataend = max(dataend, t->samples[j].pos + t->samples[j].size);
+			}
+			if (!t->samples.IsEmpty()) {
+				rt = min(rt, CInterleaver::Rescale(t->samples[0].dts, t->timescale));
+			}
+		}
+
+		if (!WaitBytes(dataend)) {
+			// parse it again when the data has arrived
+			for (size_t i = 0; i < m_ftracks.GetCount(); i++) {
+				fragment_track_t* t = m_ftracks[i];
+				if (!t->samples.IsEmpty()) {
+					t->dts = t->samples[0].dts;
+					t->samples.RemoveAll();
+				}
+			}
+
+			if (!IsStreaming()) {
+				// a truncated file, demux what is there
+				ParseMoof(pos, start, next, bTfdt);
+				m_NextFragment = next;
+				return S_OK;
+			}
+			break;
+		}
+
+		if (rt != _I64_MAX) {
+			AddFragment(pos, rt);
+		}
+
+		m_NextFragment = next;
+		return S_OK;
+	}
+
+	return IsStreaming() ? S_FALSE : E_FAIL;
+}
@@ -29,9 +29,68 @@ class CMP4SplitterFile : public CBaseSplitterFileEx
 
 	HRESULT Init();
 
+public:
+	// fragmented files: the samples of the tracks are described by the moof boxes
+	// that follow the moov, only the fragment being demuxed is kept in memory
+
+	struct fragment_sample_t {
+		__int64	pos;
+		DWORD	size;
+		DWORD	duration;
+		UINT64	dts;
+		int		cto;
+		bool	bSyncPoint;
+	};
+
+	struct fragment_track_t {
+		DWORD	id;
+		DWORD	timescale;
+		DWORD	default_duration, default_size, default_flags; // trex
+		UINT64	dts; // decode time of the next sample
+		CAtlArray<fragment_sample_t> samples;
+		size_t	index;
+	};
+
+private:
+	bool		m_bFragmented;
+	__int64		m_FirstFragment, m_NextFragment;
+	__int64		m_sidxpos;
+	REFERENCE_TIME m_rtFragmentsDuration;
+	CAutoPtrArray<fragment_track_t> m_ftracks;
+
+	struct fragment_t {
+		__int64			pos;
+		REFERENCE_TIME	rt;
+	};
+	CAtlArray<fragment_t> m_fragments; // sorted by position
+	bool		m_bSidxRead, m_bMfraRead;
+	__int64		m_IndexPos; // the walk over the moof boxes continues here
+
+	bool	WaitBytes(__int64 end);
+	bool	ReadBox(__int64 pos, __int64 end, DWORD& type, __int64& start, __int64& next);
+	bool	ReadBoxData(__int64 start, __int64 next, CAtlArray<BYTE>& data);
+
+	void	InitFragments();
+	bool	ParseMoof(__int64 pos, __int64 start, __int64 next, bool& bTfdt);
+	bool	ReadMoofTime(__int64 start, __int64 next, REFERENCE_TIME& rt);
+	void	AddFragment(__int64 pos, REFERENCE_TIME rt);
+	void	ReadSidx();
+	void	ReadMfra();
+	void	IndexFragments(REFERENCE_TIME rt);
+
 public:
 	CMP4SplitterFile(IAsyncReader* pReader, HRESULT& hr);
 	virtual ~CMP4SplitterFile();
 
 	void* GetMovie();
+
+	bool	IsFragmented() const { return m_bFragmented; }
+	REFERENCE_TIME GetFragmentsDuration();
+	fragment_track_t* GetFragmentTrack(DWORD id);
+
+	// positions the demuxer at the last indexed fragment before rt
+	void	SeekFragment(REFERENCE_TIME rt);
+	// parses the next fragment into the sample lists of the tracks, returns S_FALSE
+	// if a growing file has no complete fragment yet and E_FAIL at the end of the file
+	HRESULT	ReadFragment();
 };
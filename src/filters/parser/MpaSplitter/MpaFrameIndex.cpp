@@ -0,0 +1,213 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include "MpaSplitterFile.h"
+#include "MpaFrameIndex.h"
+
+#define INDEX_STEP	16		// frames between two points
+#define SCAN_BATCH	1024	// frames walked by the scanner between two checks for the exit command
+
+CMpaFrameIndex::CMpaFrameIndex()
+	: m_endpos(0)
+	, m_endrt(0)
+	, m_nFrames(0)
+	, m_bMpa(true)
+{
+	memset(&m_mpahdr, 0, sizeof(m_mpahdr));
+	memset(&m_aachdr, 0, sizeof(m_aachdr));
+}
+
+CMpaFrameIndex::~CMpaFrameIndex()
+{
+	StopScan();
+}
+
+void CMpaFrameIndex::Reset(__int64 startpos)
+{
+	StopScan();
+
+	CAutoLock cAutoLock(&m_csIndex);
+
+	m_points.RemoveAll();
+	m_endpos	= startpos;
+	m_endrt		= 0;
+	m_nFrames	= 0;
+}
+
+bool CMpaFrameIndex::Add(__int64 start, __int64 end, REFERENCE_TIME rtDuration)
+{
+	CAutoLock cAutoLock(&m_csIndex);
+
+	if (start != m_endpos || end <= start) {
+		return false;
+	}
+
+	if (m_nFrames % INDEX_STEP == 0) {
+		point p = {start, m_endrt};
+		m_points.Add(p);
+	}
+
+	m_endpos = end;
+	m_endrt += rtDuration;
+	m_nFrames++;
+
+	return true;
+}
+
+bool CMpaFrameIndex::Find(REFERENCE_TIME rt, __int64& pos, REFERENCE_TIME& rtPos)
+{
+	CAutoLock cAutoLock(&m_csIndex);
+
+	if (m_points.IsEmpty() || rt >= m_endrt) {
+		return false;
+	}
+
+	size_t i = 0, j = m_points.GetCount();
+	while (j - i > 1) {
+		size_t mid = (i + j) / 2;
+		if (m_points[mid].rt <= rt) {
+			i = mid;
+		} else {
+			j = mid;
+		}
+	}
+
+	pos		= m_points[i].pos;
+	rtPos	= m_points[i].rt;
+
+	return true;
+}
+
+void CMpaFrameIndex::GetEnd(__int64& pos, REFERENCE_TIME& rt)
+{
+	CAutoLock cAutoLock(&m_csIndex);
+
+	pos	= m_endpos;
+	rt	= m_endrt;
+}
+
+void CMpaFrameIndex::StartScan(IAsyncReader* pAsyncReader, CMpaSplitterFile* pFile)
+{
+	StopScan();
+
+	m_pReader	= pAsyncReader;
+	m_bMpa		= pFile->IsMpa();
+	m_mpahdr	= pFile->GetMpaHeader();
+	m_aachdr	= pFile->GetAacHeader();
+
+	if (m_pReader) {
+		Create();
+	}
+}
+
+void CMpaFrameIndex::StopScan()
+{
+	if (ThreadExists()) {
+		CallWorker(CMD_EXIT);
+		Close();
+	}
+}
+
+// same as CMpaSplitterFile::Sync() without the duration update
+
+bool CMpaFrameIndex::SyncFrame(CBaseSplitterFileEx& file, __int64& end, REFERENCE_TIME& rtDuration)
+{
+	__int64 endpos = min(file.GetLength(), file.GetPos() + 0x2000);
+
+	if (m_bMpa) {
+		while (file.GetPos() <= endpos - 4) {
+			mpahdr h;
+			if (!file.Read(h, (int)(endpos - file.GetPos()), NULL, true)) {
+				break;
+			}
+			if (m_mpahdr == h) {
+				end			= file.GetPos() - 4 + h.FrameSize;
+				rtDuration	= h.rtDuration;
+				m_mpahdr	= h;
+				return true;
+			}
+		}
+	} else {
+		while (file.GetPos() <= endpos - 9) {
+			aachdr h;
+			if (!file.Read(h, (int)(endpos - file.GetPos()))) {
+				break;
+			}
+			if (m_aachdr == h) {
+				end			= file.GetPos() + h.FrameSize;
+				rtDuration	= h.rtDuration;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+DWORD CMpaFrameIndex::ThreadProc()
+{
+	SetThreadName((DWORD)-1, "CMpaFrameIndex");
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+
+	HRESULT hr = S_OK;
+	CAutoPtr<CBaseSplitterFileEx> pFile(DNew CBaseSplitterFileEx(m_pReader, hr, true, false));
+
+	bool bEnd = !pFile || FAILED(hr);
+	while (!bEnd && !CheckRequest(NULL)) {
+		__int64 start;
+		REFERENCE_TIME rt;
+		GetEnd(start, rt);
+
+		pFile->Seek(start);
+		for (int i = 0; i < SCAN_BATCH; i++) {
+			__int64 end;
+			REFERENCE_TIME rtDuration;
+			if (!SyncFrame(*pFile, end, rtDuration)) {
+				bEnd = true;
+				break;
+			}
+
+			// the demuxer got ahead, continue from the new end
+			if (!Add(start, end, rtDuration)) {
+				break;
+			}
+
+			pFile->Seek(end);
+			start = end;
+		}
+	}
+
+	DbgLog((LOG_TRACE, 3, L"CMpaFrameIndex::ThreadProc() : %u frames, %Iu points", m_nFrames, m_points.GetCount()));
+
+	pFile.Free();
+	m_pReader.Release();
+
+	// wait for the exit command
+	for (;;) {
+		DWORD cmd = GetRequest();
+		Reply(S_OK);
+		if (cmd == CMD_EXIT) {
+			break;
+		}
+	}
+
+	return 0;
+}
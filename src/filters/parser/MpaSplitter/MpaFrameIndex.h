@@ -0,0 +1,72 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <atlcoll.h>
+
+class CMpaSplitterFile;
+
+// Start times of every INDEX_STEP-th frame, built by walking the frames from the first one.
+// The demuxer extends the index while it plays through the end of the indexed part, a low
+// priority thread walks the rest of the file. A point stores the position where the search
+// for its frame starts, that is the end of the previous frame.
+
+class CMpaFrameIndex : protected CAMThread
+{
+	struct point {
+		__int64			pos;
+		REFERENCE_TIME	rt;
+	};
+
+	CCritSec			m_csIndex;
+	CAtlArray<point>	m_points;
+	__int64				m_endpos;	// end of the last indexed frame
+	REFERENCE_TIME		m_endrt;
+	DWORD				m_nFrames;
+
+	// background scanner
+	CComPtr<IAsyncReader>	m_pReader;
+	bool					m_bMpa;
+	mpahdr					m_mpahdr;
+	aachdr					m_aachdr;
+
+	bool SyncFrame(CBaseSplitterFileEx& file, __int64& end, REFERENCE_TIME& rtDuration);
+
+	enum {CMD_EXIT};
+	DWORD ThreadProc();
+
+public:
+	CMpaFrameIndex();
+	~CMpaFrameIndex();
+
+	void Reset(__int64 startpos);
+
+	// Adds the frame that a search from start found, it ends at end. Returns false
+	// if start is not the end of the indexed part.
+	bool Add(__int64 start, __int64 end, REFERENCE_TIME rtDuration);
+
+	// The last point at or before rt, false if rt is past the indexed part.
+	bool Find(REFERENCE_TIME rt, __int64& pos, REFERENCE_TIME& rtPos);
+	void GetEnd(__int64& pos, REFERENCE_TIME& rt);
+
+	void StartScan(IAsyncReader* pAsyncReader, CMpaSplitterFile* pFile);
+	void StopScan();
+};
@@ -113,6 +113,7 @@ HRESULT CMpaSplitterFilter::CreateOutputs(IAsyncReader* pAsyncReader)
 
 	HRESULT hr = E_FAIL;
 
+	m_FrameIndex.StopScan();
 	m_pFile.Free();
 
 	m_pFile.Attach(DNew CMpaSplitterFile(pAsyncReader, hr));
@@ -124,6 +125,11 @@ HRESULT CMpaSplitterFilter::CreateOutputs(IAsyncReader* pAsyncReader)
 		return hr;
 	}
 
+	m_FrameIndex.Reset(m_pFile->GetStartPos());
+	if (m_pFile->IsRandomAccess() && !m_pFile->IsStreaming()) {
+		m_FrameIndex.StartScan(pAsyncReader, m_pFile);
+	}
+
 	CAtlArray<CMediaType> mts;
 	mts.Add(m_pFile->GetMediaType());
 
@@ -200,11 +206,38 @@ void CMpaSplitterFilter::DemuxSeek(REFERENCE_TIME rt)
 	__int64 startpos = m_pFile->GetStartPos();
 	__int64 endpos = m_pFile->GetLength();
 
+	__int64 pos;
+	REFERENCE_TIME rtPos;
+
 	if (rt <= 0 || m_pFile->GetDuration() <= 0) {
 		m_pFile->Seek(startpos);
 		m_rtime = 0;
+	} else if (m_FrameIndex.Find(rt, pos, rtPos)) {
+		// walk to the frame that contains rt
+		int FrameSize;
+		REFERENCE_TIME rtDuration;
+
+		m_pFile->Seek(pos);
+		for (;;) {
+			pos = m_pFile->GetPos();
+			if (!m_pFile->Sync(FrameSize, rtDuration) || rtPos + rtDuration > rt) {
+				m_pFile->Seek(pos);
+				break;
+			}
+			m_pFile->Seek(m_pFile->GetPos() + FrameSize);
+			rtPos += rtDuration;
+		}
+
+		m_rtime = rtPos;
 	} else {
-		m_pFile->Seek(startpos + (__int64)((1.0 * rt / m_pFile->GetDuration()) * (endpos - startpos)));
+		// interpolate after the indexed part
+		m_FrameIndex.GetEnd(startpos, rtPos);
+		if (m_pFile->GetDuration() > rtPos && rt > rtPos) {
+			m_pFile->Seek(startpos + (__int64)((1.0 * (rt - rtPos) / (m_pFile->GetDuration() - rtPos)) * (endpos - startpos)));
+		} else {
+			m_pFile->Seek(startpos);
+			rt = rtPos;
+		}
 		m_rtime = rt;
 	}
 }
@@ -217,6 +250,7 @@ bool CMpaSplitterFilter::DemuxLoop()
 	REFERENCE_TIME rtDuration;
 
 	while (SUCCEEDED(hr) && !CheckRequest(NULL) && (m_pFile->GetPos() < m_pFile->GetLength() - 9 || m_pFile->IsStreaming())) {
+		__int64 start = m_pFile->GetPos();
 		if (!m_pFile->Sync(FrameSize, rtDuration)) {
 			Sleep(1);
 			continue;
@@ -226,6 +260,8 @@ bool CMpaSplitterFilter::DemuxLoop()
 		p->SetCount(FrameSize);
 		m_pFile->ByteRead(p->GetData(), FrameSize);
 
+		m_FrameIndex.Add(start, m_pFile->GetPos(), rtDuration);
+
 		p->TrackNumber = 0;
 		p->rtStart = m_rtime;
 		p->rtStop  = m_rtime + rtDuration;
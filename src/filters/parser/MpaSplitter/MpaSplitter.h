@@ -23,6 +23,7 @@
 
 #include "../BaseSplitter/BaseSplitter.h"
 #include "MpaSplitterFile.h"
+#include "MpaFrameIndex.h"
 
 #define MpaSplitterName L"MPC Mpa Splitter"
 #define MpaSourceName   L"MPC Mpa Source"
@@ -34,6 +35,7 @@ class __declspec(uuid("0E9D4BF7-CBCB-46C7-BD80-4EF223A3DC2B"))
 
 protected:
 	CAutoPtr<CMpaSplitterFile> m_pFile;
+	CMpaFrameIndex m_FrameIndex;
 	HRESULT CreateOutputs(IAsyncReader* pAsyncReader);
 
 	STDMETHODIMP GetDuration(LONGLONG* pDuration);
@@ -63,6 +63,16 @@ public:
 		return m_startpos;
 	}
 
+	bool IsMpa() const {
+		return m_mode == mpa;
+	}
+	const mpahdr& GetMpaHeader() const {
+		return m_mpahdr;
+	}
+	const aachdr& GetAacHeader() const {
+		return m_aachdr;
+	}
+
 	bool Sync(int limit = 0x2000);
 	bool Sync(int& FrameSize, REFERENCE_TIME& rtDuration, int limit = 0x2000);
 };
@@ -466,6 +466,8 @@ CMpegSplitterFilter::CMpegSplitterFilter(LPUNKNOWN pUnk, HRESULT* phr, const CLS
 	, m_rtPlaylistDuration(0)
 	, m_rtMin(0)
 	, m_rtMax(0)
+	, m_dwMasterTrack(0)
+	, m_wMasterProgram(0)
 	, m_ForcedSub(false)
 	, m_AC3CoreOnly(0)
 	, m_AlternativeDuration(false)
@@ -631,6 +633,7 @@ HRESULT CMpegSplitterFilter::DemuxNextPacket(REFERENCE_TIME rtStartOffset)
 		else if ((b >= 0xbd && b < 0xf0) || (b == 0xfd)) { // pes packet
 			CMpegSplitterFile::peshdr h;
 
+			__int64 pespos = m_pFile->GetPos() - 4;
 			if (!m_pFile->Read(h, b) || !h.len) {
 				return S_FALSE;
 			}
@@ -644,6 +647,10 @@ HRESULT CMpegSplitterFilter::DemuxNextPacket(REFERENCE_TIME rtStartOffset)
 
 			DWORD TrackNumber = m_pFile->AddStream(0, b, h.id_ext, h.len);
 
+			if (h.fpts && TrackNumber == m_dwMasterTrack) {
+				m_TimeIndex.Add(0, pespos, h.pts - m_pFile->m_rtMin);
+			}
+
 			if (GetOutputPin(TrackNumber)) {
 				CAutoPtr<Packet> p(DNew Packet());
 
@@ -662,7 +669,8 @@ HRESULT CMpegSplitterFilter::DemuxNextPacket(REFERENCE_TIME rtStartOffset)
 		}
 	} else if (m_pFile->m_type == mpeg_ts) {
 		CMpegSplitterFile::trhdr h;
-		if (m_pFile->Read(h) == -1) {
+		__int64 packetpos = m_pFile->Read(h);
+		if (packetpos == -1) {
 			return S_FALSE;
 		}
 
@@ -670,6 +678,17 @@ HRESULT CMpegSplitterFilter::DemuxNextPacket(REFERENCE_TIME rtStartOffset)
 
 		m_pFile->UpdatePrograms(h, false);
 
+		// the PCRs index every program, a discontinuity starts a new timebase
+		if (h.adapfield && h.length > 6 && h.fPCR && m_dwMasterTrack) {
+			POSITION pos2 = m_pFile->m_programs.GetStartPosition();
+			while (pos2) {
+				const CMpegSplitterFile::program& prg = m_pFile->m_programs.GetNextValue(pos2);
+				if (prg.pcr_pid == h.pid) {
+					m_TimeIndex.Add(prg.program_number, packetpos, h.PCR - m_pFile->m_rtMin, false, !!h.discontinuity);
+				}
+			}
+		}
+
 		if (h.payload && ISVALIDPID(h.pid)) {
 			DWORD TrackNumber = h.pid;
 
@@ -682,6 +701,10 @@ HRESULT CMpegSplitterFilter::DemuxNextPacket(REFERENCE_TIME rtStartOffset)
 						return E_FAIL;
 					}
 					TrackNumber = m_pFile->AddStream(h.pid, b, 0, h.bytes - (DWORD)(m_pFile->GetPos() - pos));
+
+					if (h2.fpts && TrackNumber == m_dwMasterTrack) {
+						m_TimeIndex.Add(m_wMasterProgram, packetpos, h2.pts - m_pFile->m_rtMin);
+					}
 				}
 			}
 
@@ -872,6 +895,9 @@ HRESULT CMpegSplitterFilter::CreateOutputs(IAsyncReader* pAsyncReader)
 
 	HRESULT hr = E_FAIL;
 
+	m_TimeIndex.Reset(0, 0);
+	m_dwMasterTrack = 0;
+	m_wMasterProgram = 0;
 	m_pFile.Free();
 
 	ReadClipInfo(GetPartFilename(pAsyncReader));
@@ -1120,6 +1146,28 @@ HRESULT CMpegSplitterFilter::CreateOutputs(IAsyncReader* pAsyncReader)
 		m_rtNewStop = m_rtStop = m_rtDuration = rt_IfoDuration ? rt_IfoDuration : (UNITS * m_pFile->GetLength() / m_pFile->m_rate);
 	}
 
+	if (m_pFile->IsRandomAccess() && !m_pFile->bIsBadPacked && (m_pFile->m_type == mpeg_ts || m_pFile->m_type == mpeg_ps)) {
+		if (CAtlList<CMpegSplitterFile::stream>* pMasterStream = m_pFile->GetMasterStream()) {
+			m_dwMasterTrack = pMasterStream->GetHead();
+			m_TimeIndex.Reset(m_pFile->GetLength(), m_pFile->m_rate);
+
+			WORD pcrpid = 0;
+			if (m_pFile->m_type == mpeg_ts) {
+				int iStream;
+				const CHdmvClipInfo::Stream* pClipInfo;
+				if (const CMpegSplitterFile::program* pProgram = m_pFile->FindProgram((WORD)m_dwMasterTrack, iStream, pClipInfo)) {
+					m_wMasterProgram	= pProgram->program_number;
+					pcrpid				= pProgram->pcr_pid;
+				}
+			}
+
+			// mpeg-ps is indexed only while demuxing and seeking, playlists are seeked by their clips
+			if (m_pFile->m_type == mpeg_ts && !m_rtPlaylistDuration && !m_ClipInfo.IsHdmv()) {
+				m_TimeIndex.StartScan(pAsyncReader, m_dwMasterTrack, m_wMasterProgram, pcrpid, m_pFile->m_rtMin);
+			}
+		}
+	}
+
 	return m_pOutputs.GetCount() > 0 ? S_OK : E_FAIL;
 }
 
@@ -1184,6 +1232,15 @@ void CMpegSplitterFilter::DemuxSeek(REFERENCE_TIME rt)
 			return;
 		}
 
+		if (m_dwMasterTrack) {
+			pos = SeekIndex(m_dwMasterTrack, rt);
+			if (pos >= 0) {
+				m_pFile->Seek(pos);
+				m_rtStartOffset = 0;
+				return;
+			}
+		}
+
 		__int64 len				= m_pFile->GetLength();
 		__int64 seekpos			= SeekPos(rt);
 		__int64 minseekpos		= _I64_MIN;
@@ -1270,6 +1327,49 @@ void CMpegSplitterFilter::DemuxSeek(REFERENCE_TIME rt)
 	}
 }
 
+__int64 CMpegSplitterFilter::SeekIndex(DWORD TrackNum, REFERENCE_TIME rt)
+{
+	const __int64 len				= m_pFile->GetLength();
+	const REFERENCE_TIME rtmax		= rt - UNITS;
+	const REFERENCE_TIME rtmin		= rtmax - UNITS/2;
+	const REFERENCE_TIME rttarget	= rtmax - UNITS/4;
+
+	__int64 pos, posMin, posMax;
+	REFERENCE_TIME rtMin;
+	if (!m_TimeIndex.Find(m_wMasterProgram, rttarget, SeekPos(rttarget), pos, posMin, rtMin, posMax)) {
+		return -1;
+	}
+
+	// every probe becomes a point of the index and narrows the interpolation
+	for (int nReads = 1; nReads <= 8; nReads++) {
+		m_pFile->Seek(pos);
+		REFERENCE_TIME rt2 = m_pFile->NextPTS(TrackNum);
+		if (rt2 == INVALID_TIME) {
+			break;
+		}
+
+		__int64 pos2 = m_pFile->GetPos();
+		m_TimeIndex.Add(m_wMasterProgram, pos2, rt2, true);
+
+		if (rtmin <= rt2 && rt2 <= rtmax) {
+			DbgLog((LOG_TRACE, 3, L"CMpegSplitterFilter::SeekIndex() : %s found after %d reads", ReftimeToString(rt2), nReads));
+			return pos2;
+		}
+
+		__int64 posPrev = pos;
+		if (!m_TimeIndex.Find(m_wMasterProgram, rttarget, posPrev, pos, posMin, rtMin, posMax) || pos == posPrev) {
+			break;
+		}
+	}
+
+	// nothing inside the window, start a little early from the nearest point
+	if (rtMin <= rttarget && rttarget - rtMin <= 5 * UNITS) {
+		return posMin;
+	}
+
+	return -1;
+}
+
 bool CMpegSplitterFilter::DemuxLoop()
 {
 	REFERENCE_TIME rtStartOffset = m_rtStartOffset ? m_rtStartOffset : m_pFile->m_rtMin;
@@ -1321,6 +1421,30 @@ bool CMpegSplitterFilter::BuildChapters(LPCTSTR pszFileName, CHdmvClipInfo::CPla
 	return SUCCEEDED (m_ClipInfo.ReadChapters (pszFileName, PlaylistItems, Items)) ? true : false;
 }
 
+// IKeyFrameInfo
+
+STDMETHODIMP CMpegSplitterFilter::GetKeyFrameCount(UINT& nKFs)
+{
+	// S_FALSE while the time index is still being built
+	nKFs = (UINT)m_TimeIndex.GetTimes(m_wMasterProgram, NULL, 0);
+	return m_TimeIndex.IsComplete() ? S_OK : S_FALSE;
+}
+
+STDMETHODIMP CMpegSplitterFilter::GetKeyFrames(const GUID* pFormat, REFERENCE_TIME* pKFs, UINT& nKFs)
+{
+	CheckPointer(pFormat, E_POINTER);
+	CheckPointer(pKFs, E_POINTER);
+
+	if (*pFormat != TIME_FORMAT_MEDIA_TIME) {
+		return E_INVALIDARG;
+	}
+
+	// these aren't really the keyframes, but the points of the time index
+	nKFs = (UINT)m_TimeIndex.GetTimes(m_wMasterProgram, pKFs, nKFs);
+
+	return S_OK;
+}
+
 // IAMStreamSelect
 
 STDMETHODIMP CMpegSplitterFilter::Count(DWORD* pcStreams)
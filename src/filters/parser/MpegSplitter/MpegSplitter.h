@@ -23,6 +23,7 @@
 
 #include "../BaseSplitter/BaseSplitter.h"
 #include "MpegSplitterFile.h"
+#include "MpegTimeIndex.h"
 #include "MpegSplitterSettingsWnd.h"
 #include "../../../DSUtil/AudioParser.h"
 #include <ITrackInfo.h>
@@ -44,6 +45,11 @@ class __declspec(uuid("DC257063-045F-4BE2-BD5B-E12279C464F0"))
 	CAutoPtr<CMpegSplitterFile> m_pFile;
 	CComQIPtr<ITrackInfo> pTI;
 
+	CMpegTimeIndex	m_TimeIndex;
+	DWORD			m_dwMasterTrack;
+	WORD			m_wMasterProgram;
+	__int64			SeekIndex(DWORD TrackNum, REFERENCE_TIME rt);
+
 	HRESULT CreateOutputs(IAsyncReader* pAsyncReader);
 	void	ReadClipInfo(LPCOLESTR pszFileName);
 
@@ -87,6 +93,11 @@ public:
 	STDMETHODIMP Enable(long lIndex, DWORD dwFlags);
 	STDMETHODIMP Info(long lIndex, AM_MEDIA_TYPE** ppmt, DWORD* pdwFlags, LCID* plcid, DWORD* pdwGroup, WCHAR** ppszName, IUnknown** ppObject, IUnknown** ppUnk);
 
+	// IKeyFrameInfo
+
+	STDMETHODIMP_(HRESULT) GetKeyFrameCount(UINT& nKFs);
+	STDMETHODIMP_(HRESULT) GetKeyFrames(const GUID* pFormat, REFERENCE_TIME* pKFs, UINT& nKFs);
+
 	// ISpecifyPropertyPages2
 
 	STDMETHODIMP GetPages(CAUUID* pPages);
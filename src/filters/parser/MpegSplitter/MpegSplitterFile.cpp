@@ -45,7 +45,10 @@ CMpegSplitterFile::CMpegSplitterFile(IAsyncReader* pAsyncReader, HRESULT& hr, CH
 {
 	memset(m_psm, 0, sizeof(m_psm));
 	if (SUCCEEDED(hr)) {
+		const DWORD dwStart = GetTickCount();
 		hr = Init(pAsyncReader);
+		ClearPrefetch();
+		DbgLog((LOG_TRACE, 3, L"CMpegSplitterFile::Init() : %u ms, %I64d bytes read", GetTickCount() - dwStart, GetBytesRead()));
 	}
 }
 
@@ -61,6 +64,20 @@ HRESULT CMpegSplitterFile::Init(IAsyncReader* pAsyncReader)
 
 	WaitAvailable(3000, MEGABYTE);
 
+	// read all search windows ahead in large blocks, the type detection uses the first one.
+	// Not for Blu-ray, the reader sets the PTS offset of the part it reads last.
+	const bool bPrefetch = !m_ClipInfo.IsHdmv();
+
+	CAtlArray<window> windows;
+	GetSearchWindows(windows, 10*MEGABYTE, MEGABYTE/4, MEGABYTE/2);
+	for (size_t i = 0; i < windows.GetCount() && bPrefetch; i++) {
+		Prefetch(windows[i].start, windows[i].stop - windows[i].start);
+	}
+
+	// the windows of the PTS pass of transport streams
+	CAtlArray<window> ptswindows;
+	GetSearchWindows(ptswindows, MEGABYTE, MEGABYTE/16, MEGABYTE/8);
+
 	// get the type first
 	m_type = mpeg_us;
 
@@ -145,15 +162,24 @@ HRESULT CMpegSplitterFile::Init(IAsyncReader* pAsyncReader)
 		WaitAvailable(5000, MEGABYTE*2);
 		SearchPrograms(0, min(GetLength(), IsStreaming() ? MEGABYTE*2 : MEGABYTE*5)); // max 5Mb for search a valid Program Map Table
 
-		__int64 pfp = 0;
-		const int k = 20;
-		for (int i = 0; i <= k; i++) {
-			__int64 fp = i * GetLength() / k;
-			fp = min(GetLength() - MEGABYTE/2, fp);
-			fp = max(pfp, fp);
-			__int64 nfp = fp + (pfp == 0 ? 10*MEGABYTE : MEGABYTE/4);
-			SearchStreams(fp, nfp, pAsyncReader);
-			pfp = nfp;
+		if (IsStreaming()) {
+			windows.RemoveAll();
+			GetSearchWindows(windows, 10*MEGABYTE, MEGABYTE/4, MEGABYTE/2);
+		}
+
+		for (size_t i = 0; i < windows.GetCount(); i++) {
+			SearchStreams(windows[i].start, windows[i].stop, pAsyncReader);
+
+			// the PTS of transport streams are sampled in their own pass, only the stream
+			// search of the remaining windows is skipped, the PTS windows stay queued
+			if (m_type == mpeg_ts && IsProgramStreamsFound()) {
+				DbgLog((LOG_TRACE, 3, L"CMpegSplitterFile::Init() : all program streams found after %Iu of %Iu windows", i + 1, windows.GetCount()));
+				CancelPrefetch();
+				for (size_t j = 0; j < ptswindows.GetCount() && bPrefetch; j++) {
+					Prefetch(ptswindows[j].start, ptswindows[j].stop - ptswindows[j].start);
+				}
+				break;
+			}
 		}
 	} else {
 		SearchStreams(0, MEGABYTE/2, pAsyncReader);
@@ -168,15 +194,19 @@ HRESULT CMpegSplitterFile::Init(IAsyncReader* pAsyncReader)
 				if (IsRandomAccess() || IsStreaming()) {
 					WaitAvailable(3000, MEGABYTE);
 
-					__int64 pfp = 0;
-					const int k = 20;
-					for (int i = 0; i <= k; i++) {
-						__int64 fp = i * GetLength() / k;
-						fp = min(GetLength() - MEGABYTE/8, fp);
-						fp = max(pfp, fp);
-						__int64 nfp = fp + (pfp == 0 ? MEGABYTE : MEGABYTE/16);
-						SearchStreams(fp, nfp, pAsyncReader, TRUE);
-						pfp = nfp;
+					if (step == 1) {
+						// a stream has grown since, the windows already queued are skipped by Prefetch
+						if (IsStreaming()) {
+							ptswindows.RemoveAll();
+							GetSearchWindows(ptswindows, MEGABYTE, MEGABYTE/16, MEGABYTE/8);
+						}
+						for (size_t i = 0; i < ptswindows.GetCount() && bPrefetch; i++) {
+							Prefetch(ptswindows[i].start, ptswindows[i].stop - ptswindows[i].start);
+						}
+					}
+
+					for (size_t i = 0; i < ptswindows.GetCount(); i++) {
+						SearchStreams(ptswindows[i].start, ptswindows[i].stop, pAsyncReader, TRUE);
 					}
 				} else {
 					SearchStreams(0, MEGABYTE/2, pAsyncReader, TRUE);
@@ -272,6 +302,24 @@ HRESULT CMpegSplitterFile::Init(IAsyncReader* pAsyncReader)
 	return S_OK;
 }
 
+void CMpegSplitterFile::GetSearchWindows(CAtlArray<window>& windows, __int64 first, __int64 next, __int64 tail)
+{
+	const __int64 len = GetLength();
+
+	__int64 pfp = 0;
+	const int k = 20;
+	for (int i = 0; i <= k; i++) {
+		__int64 fp = i * len / k;
+		fp = min(len - tail, fp);
+		fp = max(pfp, fp);
+		__int64 nfp = fp + (pfp == 0 ? first : next);
+
+		window w = {fp, nfp};
+		windows.Add(w);
+		pfp = nfp;
+	}
+}
+
 void CMpegSplitterFile::OnComplete(IAsyncReader* pAsyncReader)
 {
 	__int64 pos = GetPos();
@@ -589,6 +637,42 @@ static const StreamType PES_types[] = {
 	{ PES_PRIVATE,							DVB_SUB		}
 };
 
+bool CMpegSplitterFile::IsProgramStreamsFound()
+{
+	if (m_programs.IsEmpty()) {
+		return false;
+	}
+
+	POSITION pos = m_programs.GetStartPosition();
+	while (pos) {
+		const program& p = m_programs.GetNextValue(pos);
+		if (!p.streams[0].pid) {
+			return false;
+		}
+
+		for (int i = 0; i < _countof(p.streams) && p.streams[i].pid; i++) {
+			// data and section streams never become an output
+			bool bKnown = false;
+			for (size_t j = 0; j < _countof(PES_types) && !bKnown; j++) {
+				bKnown = (PES_types[j].pes_stream_type == p.streams[i].type);
+			}
+			if (!bKnown) {
+				continue;
+			}
+
+			bool bFound = false;
+			for (int type = stream_type::video; type < stream_type::unknown && !bFound; type++) {
+				bFound = (m_streams[type].FindStream(p.streams[i].pid) != NULL);
+			}
+			if (!bFound) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
 DWORD CMpegSplitterFile::AddStream(WORD pid, BYTE pesid, BYTE ps1id, DWORD len, BOOL bAddStream/* = TRUE*/)
 {
 	if (pid) {
@@ -1150,9 +1234,10 @@ void CMpegSplitterFile::UpdatePrograms(CGolombBuffer gb, WORD pid, bool UpdateLa
 		BYTE reserved2				= (BYTE)gb.BitRead(4);
 		WORD program_info_length	= (WORD)gb.BitRead(12);
 		UNREFERENCED_PARAMETER(reserved1);
-		UNREFERENCED_PARAMETER(PCR_PID);
 		UNREFERENCED_PARAMETER(reserved2);
 
+		pPair->m_value.pcr_pid = PCR_PID;
+
 		len -= (4 + program_info_length);
 		if (len <= 0)
 			return;
@@ -67,6 +67,13 @@ class CMpegSplitterFile : public CBaseSplitterFileEx
 	BOOL m_bOpeningCompleted;
 
 	HRESULT Init(IAsyncReader* pAsyncReader);
+
+	// the regions parsed while opening, spread through the file
+	struct window {
+		__int64 start, stop;
+	};
+	void GetSearchWindows(CAtlArray<window>& windows, __int64 first, __int64 next, __int64 tail);
+	bool IsProgramStreamsFound();
 	void OnComplete(IAsyncReader* pAsyncReader);
 
 public:
@@ -193,6 +200,7 @@ public:
 	// program map table - mpeg-ts
 	struct program {
 		WORD program_number;
+		WORD pcr_pid;
 		struct stream {
 			WORD			pid;
 			PES_STREAM_TYPE	type;
@@ -0,0 +1,331 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include "../BaseSplitter/BaseSplitter.h"
+#include "MpegTimeIndex.h"
+
+#define INDEX_SPACING	UNITS				// minimal distance of the points added while demuxing
+#define SCAN_GAP		(4 * UNITS)			// the scanner is done when all continuous points are this close
+#define SCAN_MIN_BYTES	(256 * KILOBYTE)	// gaps smaller than this are not scanned
+#define SCAN_LIMIT		(4 * MEGABYTE)		// bytes read by one probe
+
+CMpegTimeIndex::CMpegTimeIndex()
+	: m_len(0)
+	, m_rate(0)
+	, m_TrackNum(0)
+	, m_program(0)
+	, m_pcrpid(0)
+	, m_rtMin(0)
+	, m_bComplete(false)
+{
+}
+
+CMpegTimeIndex::~CMpegTimeIndex()
+{
+	StopScan();
+}
+
+void CMpegTimeIndex::Reset(__int64 len, int rate)
+{
+	StopScan();
+
+	CAutoLock cAutoLock(&m_csIndex);
+
+	m_points.RemoveAll();
+	m_empty.RemoveAll();
+	m_len		= len;
+	m_rate		= rate;
+	m_bComplete	= false;
+}
+
+size_t CMpegTimeIndex::Lower(WORD program, __int64 pos) const
+{
+	size_t i = 0, j = m_points.GetCount();
+	while (i < j) {
+		size_t mid = (i + j) / 2;
+		if (m_points[mid].program < program || m_points[mid].program == program && m_points[mid].pos < pos) {
+			i = mid + 1;
+		} else {
+			j = mid;
+		}
+	}
+	return i;
+}
+
+bool CMpegTimeIndex::IsContinuous(const point& a, const point& b) const
+{
+	if (a.program != b.program || b.discontinuity) {
+		return false;
+	}
+
+	// small steps back are reordered frames
+	if (b.rt < a.rt - UNITS) {
+		return false;
+	}
+
+	// allow a local bitrate down to a quarter of the average
+	const REFERENCE_TIME expected = m_rate > 0 ? UNITS * (b.pos - a.pos) / m_rate : 0;
+	return (b.rt - a.rt) <= 10 * UNITS + 4 * expected;
+}
+
+void CMpegTimeIndex::Add(WORD program, __int64 pos, REFERENCE_TIME rt, bool bForce, bool bDiscontinuity)
+{
+	CAutoLock cAutoLock(&m_csIndex);
+
+	point p = {program, pos, rt, bDiscontinuity};
+
+	const size_t n = m_points.GetCount();
+	const size_t i = Lower(program, pos);
+
+	if (i < n && m_points[i].program == program && m_points[i].pos == pos) {
+		return;
+	}
+
+	if (!bForce && !bDiscontinuity) {
+		if (i > 0 && IsContinuous(m_points[i - 1], p) && abs(rt - m_points[i - 1].rt) < INDEX_SPACING) {
+			return;
+		}
+		if (i < n && IsContinuous(p, m_points[i]) && abs(m_points[i].rt - rt) < INDEX_SPACING) {
+			return;
+		}
+	}
+
+	if (i == n) {
+		m_points.Add(p);
+	} else {
+		m_points.InsertAt(i, p);
+	}
+}
+
+bool CMpegTimeIndex::Find(WORD program, REFERENCE_TIME rt, __int64 posHint, __int64& pos, __int64& posMin, REFERENCE_TIME& rtMin, __int64& posMax)
+{
+	CAutoLock cAutoLock(&m_csIndex);
+
+	bool bFound = false;
+
+	const size_t end = Lower(program, _I64_MAX);
+	for (size_t i = Lower(program, 0) + 1; i < end; i++) {
+		const point& a = m_points[i - 1];
+		const point& b = m_points[i];
+
+		if (a.rt > rt || rt > b.rt || !IsContinuous(a, b)) {
+			continue;
+		}
+
+		__int64 p = a.pos;
+		if (b.rt > a.rt) {
+			p += (__int64)((double)(b.pos - a.pos) * (rt - a.rt) / (b.rt - a.rt));
+		}
+
+		if (!bFound || _abs64(p - posHint) < _abs64(pos - posHint)) {
+			pos		= p;
+			posMin	= a.pos;
+			rtMin	= a.rt;
+			posMax	= b.pos;
+			bFound	= true;
+		}
+	}
+
+	return bFound;
+}
+
+bool CMpegTimeIndex::FindGap(__int64& start, __int64& stop)
+{
+	CAutoLock cAutoLock(&m_csIndex);
+
+	__int64 size = 0;
+
+	// the ends of the file count as points without a timestamp
+	const size_t first	= Lower(m_program, 0);
+	const size_t n		= Lower(m_program, _I64_MAX);
+	for (size_t i = first; i <= n; i++) {
+		const __int64 a = i > first ? m_points[i - 1].pos : 0;
+		const __int64 b = i < n ? m_points[i].pos : m_len;
+
+		if (b - a <= max(size, SCAN_MIN_BYTES)) {
+			continue;
+		}
+		if (i > first && i < n && IsContinuous(m_points[i - 1], m_points[i]) && m_points[i].rt - m_points[i - 1].rt <= SCAN_GAP) {
+			continue;
+		}
+
+		bool bEmpty = false;
+		for (size_t j = 0; j < m_empty.GetCount() && !bEmpty; j++) {
+			bEmpty = (m_empty[j] == a);
+		}
+		if (bEmpty) {
+			continue;
+		}
+
+		start	= a;
+		stop	= b;
+		size	= b - a;
+	}
+
+	return size > 0;
+}
+
+void CMpegTimeIndex::StartScan(IAsyncReader* pAsyncReader, DWORD TrackNum, WORD program, WORD pcrpid, REFERENCE_TIME rtMin)
+{
+	StopScan();
+
+	m_pReader	= pAsyncReader;
+	m_TrackNum	= TrackNum;
+	m_program	= program;
+	m_pcrpid	= pcrpid;
+	m_rtMin		= rtMin;
+
+	if (m_pReader) {
+		Create();
+	}
+}
+
+void CMpegTimeIndex::StopScan()
+{
+	if (ThreadExists()) {
+		CallWorker(CMD_EXIT);
+		Close();
+	}
+}
+
+size_t CMpegTimeIndex::GetTimes(WORD program, REFERENCE_TIME* pTimes, size_t count)
+{
+	CAutoLock cAutoLock(&m_csIndex);
+
+	// only the points of an increasing timeline
+	size_t n = 0;
+	REFERENCE_TIME rtLast = INVALID_TIME;
+	const size_t end = Lower(program, _I64_MAX);
+	for (size_t i = Lower(program, 0); i < end; i++) {
+		if (m_points[i].discontinuity && n) {
+			break;
+		}
+		if (m_points[i].rt > rtLast) {
+			if (pTimes) {
+				if (n >= count) {
+					break;
+				}
+				pTimes[n] = m_points[i].rt;
+			}
+			rtLast = m_points[i].rt;
+			n++;
+		}
+	}
+
+	return n;
+}
+
+bool CMpegTimeIndex::IsComplete()
+{
+	CAutoLock cAutoLock(&m_csIndex);
+
+	return m_bComplete;
+}
+
+static bool ScanPTS(CBaseSplitterFileEx& file, __int64 start, __int64 stop, DWORD TrackNum, WORD pcrpid, __int64& pos, REFERENCE_TIME& rt, bool& bDiscontinuity)
+{
+	file.Seek(start);
+
+	while (file.GetPos() < stop && file.GetRemaining()) {
+		CBaseSplitterFileEx::trhdr h;
+		__int64 pos2 = file.Read(h);
+		if (pos2 == -1) {
+			break;
+		}
+
+		if (pcrpid && h.pid == pcrpid && h.adapfield && h.length > 6 && h.fPCR) {
+			pos				= pos2;
+			rt				= h.PCR;
+			bDiscontinuity	= !!h.discontinuity;
+			return true;
+		}
+
+		if (h.payloadstart && h.pid == TrackNum) {
+			BYTE b;
+			if (file.NextMpegStartCode(b, 4)) {
+				CBaseSplitterFileEx::peshdr h2;
+				if (file.Read(h2, b) && h2.fpts) {
+					pos				= pos2;
+					rt				= h2.pts;
+					bDiscontinuity	= false;
+					return true;
+				}
+			}
+		}
+
+		file.Seek(h.next);
+	}
+
+	return false;
+}
+
+DWORD CMpegTimeIndex::ThreadProc()
+{
+	SetThreadName((DWORD)-1, "CMpegTimeIndex");
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+
+	HRESULT hr = S_OK;
+	CAutoPtr<CBaseSplitterFileEx> pFile(DNew CBaseSplitterFileEx(m_pReader, hr, true, false));
+
+	unsigned nProbes = 0;
+
+	while (pFile && SUCCEEDED(hr) && !CheckRequest(NULL)) {
+		__int64 start, stop;
+		if (!FindGap(start, stop)) {
+			CAutoLock cAutoLock(&m_csIndex);
+			m_bComplete = true;
+			break;
+		}
+
+		const __int64 mid = start + (stop - start) / 2;
+
+		__int64 pos;
+		REFERENCE_TIME rt;
+		bool bDiscontinuity;
+		if (ScanPTS(*pFile, mid, min(stop, mid + SCAN_LIMIT), m_TrackNum, m_pcrpid, pos, rt, bDiscontinuity) && pos < stop) {
+			Add(m_program, pos, rt - m_rtMin, true, bDiscontinuity);
+		} else {
+			CAutoLock cAutoLock(&m_csIndex);
+			m_empty.Add(start);
+		}
+
+		nProbes++;
+	}
+
+	{
+		CAutoLock cAutoLock(&m_csIndex);
+		DbgLog((LOG_TRACE, 3, L"CMpegTimeIndex::ThreadProc() : %u probes, %Iu points, complete = %d", nProbes, m_points.GetCount(), m_bComplete));
+	}
+
+	pFile.Free();
+	m_pReader.Release();
+
+	// wait for the exit command
+	for (;;) {
+		DWORD cmd = GetRequest();
+		Reply(S_OK);
+		if (cmd == CMD_EXIT) {
+			break;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <atlcoll.h>
+
+// Sparse map from the timestamps of a program to file positions, one timeline per program
+// (0 for program streams). The points are the PES packets of the master stream and the
+// PCRs of the programs, added by the demuxer and by the seek probes. For transport streams
+// a low priority thread fills the largest gaps of the master program in the background.
+// Timestamps are relative to CMpegSplitterFile::m_rtMin, like CMpegSplitterFile::NextPTS().
+// A PCR runs a little ahead of the PTS of the same packets, the seek probes make up for it.
+
+class CMpegTimeIndex : protected CAMThread
+{
+	struct point {
+		WORD			program;
+		__int64			pos;
+		REFERENCE_TIME	rt;
+		bool			discontinuity; // a new timebase starts here
+	};
+
+	CCritSec			m_csIndex;
+	CAtlArray<point>	m_points; // sorted by program and position
+	CAtlArray<__int64>	m_empty;  // gaps of the scanned program without a timestamp, by start position
+	__int64				m_len;
+	int					m_rate;
+
+	size_t	Lower(WORD program, __int64 pos) const;
+	bool	IsContinuous(const point& a, const point& b) const;
+	bool	FindGap(__int64& start, __int64& stop);
+
+	// background scanner
+	CComPtr<IAsyncReader>	m_pReader;
+	DWORD					m_TrackNum;
+	WORD					m_program;
+	WORD					m_pcrpid;
+	REFERENCE_TIME			m_rtMin;
+	bool					m_bComplete;
+
+	enum {CMD_EXIT};
+	DWORD ThreadProc();
+
+public:
+	CMpegTimeIndex();
+	~CMpegTimeIndex();
+
+	void Reset(__int64 len, int rate);
+	void Add(WORD program, __int64 pos, REFERENCE_TIME rt, bool bForce = false, bool bDiscontinuity = false);
+
+	// Interpolates the position of rt between two continuous points of the program. If the
+	// timestamps repeat because of discontinuities the candidate nearest to posHint is used.
+	// posMin/posMax return the positions of the two points.
+	bool Find(WORD program, REFERENCE_TIME rt, __int64 posHint, __int64& pos, __int64& posMin, REFERENCE_TIME& rtMin, __int64& posMax);
+
+	// scans the PES packets of TrackNum and the PCRs of pcrpid (0 - none) of the program
+	void StartScan(IAsyncReader* pAsyncReader, DWORD TrackNum, WORD program, WORD pcrpid, REFERENCE_TIME rtMin);
+	void StopScan();
+
+	// the times of the points of the program that continue its first timebase
+	size_t	GetTimes(WORD program, REFERENCE_TIME* pTimes, size_t count);
+	bool	IsComplete();
+};
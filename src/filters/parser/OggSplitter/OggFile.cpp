@@ -20,7 +20,9 @@
  */
 
 #include "stdafx.h"
+#include <emmintrin.h>
 #include "OggFile.h"
+#include "../../../DSUtil/DSUtil.h"
 
 COggFile::COggFile(IAsyncReader* pAsyncReader, HRESULT& hr)
 	: CBaseSplitterFile(pAsyncReader, hr, false, true)
@@ -45,21 +47,165 @@ HRESULT COggFile::Init()
 	return S_OK;
 }
 
+#define SYNC_BLOCK 16384
+
+// CRC32 of the page, polynomial 0x04c11db7 without reflection, computed eight bytes at a time
+
+static struct ogg_crc_t {
+	DWORD t[8][256];
+
+	ogg_crc_t() {
+		for (DWORD n = 0; n < 256; n++) {
+			DWORD c = n << 24;
+			for (int k = 0; k < 8; k++) {
+				c = (c & 0x80000000) ? (c << 1) ^ 0x04c11db7 : (c << 1);
+			}
+			t[0][n] = c;
+		}
+		for (DWORD n = 0; n < 256; n++) {
+			for (int i = 1; i < 8; i++) {
+				t[i][n] = (t[i - 1][n] << 8) ^ t[0][t[i - 1][n] >> 24];
+			}
+		}
+	}
+
+	DWORD Update(DWORD crc, const BYTE* p, size_t len) const {
+		for (; len >= 8; p += 8, len -= 8) {
+			crc ^= (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+			crc = t[7][crc >> 24] ^ t[6][(crc >> 16) & 0xff] ^ t[5][(crc >> 8) & 0xff] ^ t[4][crc & 0xff]
+				^ t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+		}
+		for (; len > 0; p++, len--) {
+			crc = (crc << 8) ^ t[0][(crc >> 24) ^ *p];
+		}
+		return crc;
+	}
+} s_crc;
+
+// returns the offset of the first "OggS" in the buffer or -1
+
+static int FindCapturePattern(const BYTE* p, int len)
+{
+	int i = 0;
+
+	if (g_cpuid.m_flags & CCpuID::sse2) {
+		const __m128i O = _mm_set1_epi8('O');
+		const __m128i g = _mm_set1_epi8('g');
+		const __m128i S = _mm_set1_epi8('S');
+
+		for (; i + 16 + 3 <= len; i += 16) {
+			__m128i m = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)&p[i]), O);
+			m = _mm_and_si128(m, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)&p[i + 1]), g));
+			m = _mm_and_si128(m, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)&p[i + 2]), g));
+			m = _mm_and_si128(m, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)&p[i + 3]), S));
+
+			unsigned long mask = _mm_movemask_epi8(m), k;
+			if (_BitScanForward(&k, mask)) {
+				return i + k;
+			}
+		}
+	}
+
+	for (; i + 4 <= len; i++) {
+		if (*(DWORD*)&p[i] == 'SggO') {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+// false only if the page is complete and the CRC does not match
+
+bool COggFile::CheckPage(__int64 pos)
+{
+	Seek(pos);
+
+	OggPageHeader hdr;
+	if (S_OK != ByteRead((BYTE*)&hdr, sizeof(hdr))) {
+		return true;
+	}
+	if (hdr.stream_structure_version != 0) {
+		return false;
+	}
+
+	BYTE lacing[255];
+	if (S_OK != ByteRead(lacing, hdr.number_page_segments)) {
+		return true;
+	}
+
+	int pagelen = 0;
+	for (int i = 0; i < hdr.number_page_segments; i++) {
+		pagelen += lacing[i];
+	}
+	if (GetPos() + pagelen > GetLength()) {
+		return true;
+	}
+
+	const DWORD crc = hdr.CRC_checksum;
+	hdr.CRC_checksum = 0;
+
+	DWORD crc2 = s_crc.Update(0, (const BYTE*)&hdr, sizeof(hdr));
+	crc2 = s_crc.Update(crc2, lacing, hdr.number_page_segments);
+
+	if (const BYTE* p = Peek(pagelen)) {
+		crc2 = s_crc.Update(crc2, p, pagelen);
+	} else {
+		BYTE buff[4096];
+		while (pagelen > 0) {
+			const int len = min(pagelen, (int)sizeof(buff));
+			if (S_OK != ByteRead(buff, len)) {
+				return true;
+			}
+			crc2 = s_crc.Update(crc2, buff, len);
+			pagelen -= len;
+		}
+	}
+
+	return crc == crc2;
+}
+
 bool COggFile::Sync(HANDLE hBreak)
 {
 	__int64 start = GetPos();
 
 	WaitAvailable(1500, MAX_PAGE_SIZE);
 
+	// the usual case, the previous page ended here
 	DWORD dw;
-	for (__int64 i = 0, j = hBreak ? GetLength() - start : MAX_PAGE_SIZE;
-			i < j && S_OK == ByteRead((BYTE*)&dw, sizeof(dw))
-			&& ((i&0xffff) || !hBreak || WaitForSingleObject(hBreak, 0) != WAIT_OBJECT_0);
-			i++, Seek(start + i)) {
-		if (dw == 'SggO') {
-			Seek(start + i);
-			return true;
+	if (S_OK == ByteRead((BYTE*)&dw, sizeof(dw)) && dw == 'SggO') {
+		Seek(start);
+		return true;
+	}
+
+	// the capture pattern also occurs in the payload, the page must pass the CRC check
+	const __int64 end = start + (hBreak ? GetLength() - start : MAX_PAGE_SIZE);
+
+	BYTE buff[SYNC_BLOCK + 3];
+	for (__int64 pos = start + 1; pos < end; ) {
+		if (hBreak && WaitForSingleObject(hBreak, 0) == WAIT_OBJECT_0) {
+			break;
+		}
+
+		const int len = (int)min(SYNC_BLOCK + 3, GetLength() - pos);
+		if (len < 4) {
+			break;
+		}
+
+		Seek(pos);
+		if (S_OK != ByteRead(buff, len)) {
+			break;
+		}
+
+		const int n = (int)min(len - 3, end - pos);
+		for (int i = 0, k; i < n && (k = FindCapturePattern(&buff[i], n - i + 3)) >= 0 && i + k < n; i += k + 1) {
+			if (CheckPage(pos + i + k)) {
+				Seek(pos + i + k);
+				return true;
+			}
 		}
+
+		pos += n;
 	}
 
 	Seek(start);
@@ -82,12 +228,14 @@ bool COggFile::Read(OggPage& page, bool fFull, HANDLE hBreak)
 		return false;
 	}
 
+	BYTE lacing[255];
+	if (S_OK != ByteRead(lacing, page.m_hdr.number_page_segments)) {
+		return false;
+	}
+
 	int pagelen = 0, packetlen = 0;
 	for (BYTE i = 0; i < page.m_hdr.number_page_segments; i++) {
-		BYTE b;
-		if (S_OK != ByteRead(&b, 1)) {
-			return false;
-		}
+		BYTE b = lacing[i];
 		packetlen += b;
 		if (1/*b < 0xff*/) {
 			page.m_lens.AddTail(packetlen);
@@ -89,6 +89,7 @@ public:
 class COggFile : public CBaseSplitterFile
 {
 	HRESULT Init();
+	bool CheckPage(__int64 pos);
 
 public:
 	COggFile(IAsyncReader* pAsyncReader, HRESULT& hr);
@@ -66,8 +66,14 @@ CFilterApp theApp;
 
 #endif
 
-#define MAXSTORESIZE	25*MEGABYTE	// The maximum size of a buffer for storing the received information
+#define MINSTORESIZE	MEGABYTE	// The ring for storing the received information starts with this size
+#define MAXSTORESIZE	32*MEGABYTE	// and grows up to this one while the reader lags behind
 #define MAXBUFSIZE		65536		// Max UDP Packet size is 64 Kbyte
+#define RCVBUFSIZE		4*MEGABYTE	// Socket receive buffer, about a second of a 40 Mbit/s stream
+#define READ_TIMEOUT	3000		// How long Read() waits for data that was not received yet
+
+#define OPT_REGKEY_UDPReader	_T("Software\\MPC-BE Filters\\UDP Reader")
+#define OPT_TimeShift			_T("TimeShift") // size of the timeshift window in MB, 0 - disabled
 
 //
 // CUDPReader
@@ -170,6 +176,12 @@ CUDPStream::CUDPStream()
 	: m_protocol(PR_NONE)
 	, m_UdpSocket(INVALID_SOCKET)
 	, m_HttpSocketTread(INVALID_SOCKET)
+	, m_pos(0)
+	, m_hTimeShift(INVALID_HANDLE_VALUE)
+	, m_ringsize(0)
+	, m_start(0)
+	, m_len(0)
+	, m_bTimeShift(false)
 	, m_subtype(MEDIASUBTYPE_NULL)
 {
 	m_WSAEvent[0] = NULL;
@@ -205,25 +217,160 @@ void CUDPStream::Clear()
 		WSACleanup();
 	}
 
-	while (!m_packets.IsEmpty()) {
-		delete m_packets.RemoveHead();
+	m_ring.Free();
+	if (m_hTimeShift != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_hTimeShift);
+		m_hTimeShift = INVALID_HANDLE_VALUE;
+	}
+	m_ringsize = 0;
+
+	m_pos = m_start = m_len = 0;
+}
+
+bool CUDPStream::CreateRing()
+{
+	DWORD nTimeShift = 0;
+
+#ifdef REGISTER_FILTER
+	CRegKey key;
+	if (ERROR_SUCCESS == key.Open(HKEY_CURRENT_USER, OPT_REGKEY_UDPReader, KEY_READ)) {
+		DWORD dw;
+		if (ERROR_SUCCESS == key.QueryDWORDValue(OPT_TimeShift, dw)) {
+			nTimeShift = dw;
+		}
+	}
+#else
+	nTimeShift = AfxGetApp()->GetProfileInt(IDS_R_SETTINGS IDS_R_PERFOMANCE, IDS_RS_PERFOMANCE_TIMESHIFT, 0);
+#endif
+	nTimeShift = min(nTimeShift, MAXTIMESHIFT);
+
+	m_bTimeShift = false;
+
+	if (nTimeShift) {
+		TCHAR path[MAX_PATH], fn[MAX_PATH];
+		if (GetTempPath(_countof(path), path) && GetTempFileName(path, _T("mpc"), 0, fn)) {
+			m_hTimeShift = CreateFile(fn, GENERIC_READ|GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY|FILE_FLAG_DELETE_ON_CLOSE, NULL);
+		}
+
+		if (m_hTimeShift != INVALID_HANDLE_VALUE) {
+			m_ringsize		= (__int64)nTimeShift * MEGABYTE;
+			m_bTimeShift	= true;
+			return true;
+		}
+	}
+
+	m_ringsize = MINSTORESIZE;
+	return m_ring.Allocate(MINSTORESIZE);
+}
+
+void CUDPStream::GrowRing(__int64 size)
+{
+	// called with m_csRing held, readers can't look at the ring meanwhile
+	__int64 newsize = m_ringsize;
+	while (newsize < size && newsize < MAXSTORESIZE) {
+		newsize = min(newsize * 2, MAXSTORESIZE);
+	}
+
+	CAutoVectorPtr<BYTE> ring;
+	if (newsize == m_ringsize || !ring.Allocate((size_t)newsize)) {
+		return;
 	}
 
-	m_pos = m_len = 0;
+	for (__int64 pos = m_start; pos < m_len; ) {
+		const __int64 offset = pos % m_ringsize;
+		const DWORD len = (DWORD)min(m_len - pos, m_ringsize - offset);
+		const __int64 dst = pos % newsize;
+		const DWORD size = (DWORD)min(len, newsize - dst);
+		memcpy(&ring[dst], &m_ring[offset], size);
+		pos += size;
+	}
+
+	m_ring.Free();
+	m_ring.Attach(ring.Detach());
+	m_ringsize = newsize;
+}
+
+void CUDPStream::RingWrite(__int64 pos, const BYTE* buff, int len)
+{
+	while (len > 0) {
+		const __int64 offset = pos % m_ringsize;
+		const DWORD size = (DWORD)min(len, m_ringsize - offset);
+
+		if (m_hTimeShift != INVALID_HANDLE_VALUE) {
+			OVERLAPPED ov = {0};
+			ov.Offset		= (DWORD)offset;
+			ov.OffsetHigh	= (DWORD)(offset >> 32);
+			DWORD written = 0;
+			WriteFile(m_hTimeShift, buff, size, &written, &ov);
+		} else {
+			memcpy(&m_ring[offset], buff, size);
+		}
+
+		pos += size;
+		buff += size;
+		len -= size;
+	}
+}
+
+void CUDPStream::RingRead(__int64 pos, BYTE* buff, DWORD len)
+{
+	while (len > 0) {
+		const __int64 offset = pos % m_ringsize;
+		const DWORD size = (DWORD)min(len, m_ringsize - offset);
+
+		if (m_hTimeShift != INVALID_HANDLE_VALUE) {
+			OVERLAPPED ov = {0};
+			ov.Offset		= (DWORD)offset;
+			ov.OffsetHigh	= (DWORD)(offset >> 32);
+			DWORD read = 0;
+			if (!ReadFile(m_hTimeShift, buff, size, &read, &ov) || read < size) {
+				memset(buff + read, 0, size - read);
+			}
+		} else {
+			memcpy(buff, &m_ring[offset], size);
+		}
+
+		pos += size;
+		buff += size;
+		len -= size;
+	}
 }
 
 void CUDPStream::Append(BYTE* buff, int len)
 {
-	CAutoLock cAutoLock(&m_csLock);
+	__int64 pos;
+	{
+		CAutoLock cAutoLock(&m_csRing);
+
+		// the memory ring grows instead of dropping data that was not read yet
+		const __int64 unread = m_len + len - max(m_pos, m_start);
+		if (!m_bTimeShift && unread > m_ringsize) {
+			GrowRing(unread);
+		}
+
+		// the oldest data is given up before it is overwritten
+		pos = m_len;
+		m_start = max(m_start, m_len + len - m_ringsize);
+	}
+
+	RingWrite(pos, buff, len);
+
+	{
+		CAutoLock cAutoLock(&m_csRing);
+		m_len += len;
+	}
 
-	m_packets.AddTail(DNew packet_t(buff, m_len, m_len + len));
-	m_len += len;
+	m_evData.Set();
 }
 
 bool CUDPStream::Load(const WCHAR* fnw)
 {
 	Clear();
 
+	if (!CreateRing()) {
+		return false;
+	}
+
 	m_url_str = CString(fnw);
 
 	if (!m_url.CrackUrl(m_url_str)) {
@@ -271,7 +418,7 @@ bool CUDPStream::Load(const WCHAR* fnw)
 				}
 			}
 
-			dw = MAXBUFSIZE;
+			dw = RCVBUFSIZE;
 			if (setsockopt(m_UdpSocket, SOL_SOCKET, SO_RCVBUF, (const char*)&dw, sizeof(dw)) == SOCKET_ERROR) {
 				;
 			}
@@ -450,11 +597,10 @@ bool CUDPStream::Load(const WCHAR* fnw)
 HRESULT CUDPStream::SetPointer(LONGLONG llPos)
 {
 	CAutoLock cAutoLock(&m_csLock);
+	CAutoLock cRingLock(&m_csRing);
 
-	if (m_packets.IsEmpty() && llPos != 0
-			|| !m_packets.IsEmpty() && llPos < m_packets.GetHead()->m_start
-			|| !m_packets.IsEmpty() && llPos > m_packets.GetTail()->m_end) {
-		TRACE(_T("CUDPStream: SetPointer error - %lld, [%I64d -> %I64d]\n"), llPos, m_packets.GetHead()->m_start, m_packets.GetTail()->m_end);
+	if (llPos < m_start || llPos > m_len) {
+		TRACE(_T("CUDPStream: SetPointer error - %lld, [%I64d -> %I64d]\n"), llPos, m_start, m_len);
 		return E_FAIL;
 	}
 
@@ -470,22 +616,24 @@ HRESULT CUDPStream::Read(PBYTE pbBuffer, DWORD dwBytesToRead, BOOL bAlign, LPDWO
 	DWORD len = dwBytesToRead;
 	BYTE* ptr = pbBuffer;
 
-	while (len > 0 && !m_packets.IsEmpty()) {
-		POSITION pos = m_packets.GetHeadPosition();
-		while (pos && len > 0) {
-			packet_t* p = m_packets.GetNext(pos);
-
-			if (p->m_start <= m_pos && m_pos < p->m_end) {
-				DWORD size;
-
-				if (m_pos < p->m_start) {
-					ASSERT(0);
-					size = (DWORD)min(len, p->m_start - m_pos);
-					memset(ptr, 0, size);
-				} else {
-					size = (DWORD)min(len, p->m_end - m_pos);
-					memcpy(ptr, &p->m_buff[m_pos - p->m_start], size);
-				}
+	for (DWORD timeout = 0; len > 0; ) {
+		{
+			CAutoLock cRingLock(&m_csRing);
+
+			if (m_pos < m_start) {
+				// overwritten before it was read, the offsets of the following data are kept
+				const DWORD size = (DWORD)min(len, m_start - m_pos);
+				memset(ptr, 0, size);
+
+				m_pos += size;
+
+				ptr += size;
+				len -= size;
+			}
+
+			if (len > 0 && m_pos < m_len) {
+				const DWORD size = (DWORD)min(len, m_len - m_pos);
+				RingRead(m_pos, ptr, size);
 
 				m_pos += size;
 
@@ -493,9 +641,15 @@ HRESULT CUDPStream::Read(PBYTE pbBuffer, DWORD dwBytesToRead, BOOL bAlign, LPDWO
 				len -= size;
 			}
 		}
-	}
 
-	CheckBuffer();
+		if (len > 0) {
+			if (!CAMThread::ThreadExists() || timeout >= READ_TIMEOUT) {
+				break;
+			}
+			m_evData.Wait(100);
+			timeout += 100;
+		}
+	}
 
 	if (pdwBytesRead) {
 		*pdwBytesRead = ptr - pbBuffer;
@@ -506,7 +660,7 @@ HRESULT CUDPStream::Read(PBYTE pbBuffer, DWORD dwBytesToRead, BOOL bAlign, LPDWO
 
 LONGLONG CUDPStream::Size(LONGLONG* pSizeAvailable)
 {
-	CAutoLock cAutoLock(&m_csLock);
+	CAutoLock cAutoLock(&m_csRing);
 	if (pSizeAvailable) {
 		*pSizeAvailable = m_len;
 	}
@@ -529,15 +683,64 @@ void CUDPStream::Unlock()
 	m_csLock.Unlock();
 }
 
-void CUDPStream::CheckBuffer()
+void CUDPStream::Receive()
 {
-	CAutoLock cAutoLock(&m_csLock);
+	CAutoVectorPtr<BYTE> buff;
+	if (!buff.Allocate(MAXBUFSIZE * 2)) {
+		return;
+	}
+
+	int  buffsize = 0;
+	UINT attempts = 0;
 
-#define PacketsSize (m_packets.GetTail()->m_end - m_packets.GetHead()->m_start)
-	if (!m_packets.IsEmpty()) {
-		while (PacketsSize > MAXSTORESIZE) {
-			delete m_packets.RemoveHead();
+	do {
+		if (m_protocol == PR_UDP) {
+			DWORD res = WSAWaitForMultipleEvents(1, m_WSAEvent, FALSE, 100, FALSE);
+			if (res != WSA_WAIT_EVENT_0) {
+				attempts++;
+				continue;
+			}
+			WSAResetEvent(m_WSAEvent[0]);
+
+			// take all queued datagrams before waiting again
+			for (;;) {
+				int fromlen = sizeof(m_addr);
+				int len = recvfrom(m_UdpSocket, (char*)&buff[buffsize], MAXBUFSIZE, 0, (SOCKADDR*)&m_addr, &fromlen);
+				if (len <= 0) {
+					int err = WSAGetLastError();
+					if (err != WSAEWOULDBLOCK) {
+						attempts++;
+					}
+					break;
+				}
+
+				attempts = 0;
+				buffsize += len;
+
+				if (buffsize >= MAXBUFSIZE) {
+					Append(buff, buffsize);
+					buffsize = 0;
+				}
+			}
+		} else if (m_protocol == PR_HTTP) {
+			int len = m_HttpSocket.Receive(&buff[buffsize], MAXBUFSIZE);
+			if (len <= 0) {
+				attempts++;
+				continue;
+			}
+
+			attempts = 0;
+			buffsize += len;
+
+			if (buffsize >= MAXBUFSIZE) {
+				Append(buff, buffsize);
+				buffsize = 0;
+			}
 		}
+	} while (!CheckRequest(NULL) && attempts < 10);
+
+	if (buffsize) {
+		Append(buff, buffsize);
 	}
 }
 
@@ -549,11 +752,6 @@ DWORD CUDPStream::ThreadProc()
 		AfxSocketInit();
 	}
 
-#ifdef _DEBUG
-	FILE* dump = NULL;
-	//dump = _tfopen(_T("c:\\http.ts"), _T("wb"));
-#endif
-
 	for (;;) {
 		DWORD cmd = GetRequest();
 
@@ -564,13 +762,16 @@ DWORD CUDPStream::ThreadProc()
 				if (m_protocol == PR_HTTP) {
 					m_HttpSocketTread = m_HttpSocket.Detach();
 				}
-#ifdef _DEBUG
-				if (dump) { fclose(dump); }
-#endif
 				return 0;
 			case CMD_STOP:
+				Reply(S_OK);
+				break;
 			case CMD_PAUSE:
 				Reply(S_OK);
+				// the timeshift window is filled while paused
+				if (m_bTimeShift) {
+					Receive();
+				}
 				break;
 			case CMD_INIT:
 				if (m_protocol == PR_HTTP) {
@@ -578,54 +779,7 @@ DWORD CUDPStream::ThreadProc()
 				}
 			case CMD_RUN:
 				Reply(S_OK);
-				{
-					char  buff[MAXBUFSIZE * 2];
-					int   buffsize = 0;
-					UINT  attempts = 0;
-				
-					do {
-						int len =  0;
-				
-						if (m_protocol == PR_UDP) {
-							DWORD res = WSAWaitForMultipleEvents(1, m_WSAEvent, FALSE, 100, FALSE);
-							if (res == WSA_WAIT_EVENT_0) {
-								WSAResetEvent(m_WSAEvent[0]);
-								int fromlen = sizeof(m_addr);
-								len = recvfrom(m_UdpSocket, &buff[buffsize], MAXBUFSIZE, 0, (SOCKADDR*)&m_addr, &fromlen);
-								if (len <= 0) {
-									int err = WSAGetLastError();
-									if (err != WSAEWOULDBLOCK) {
-										attempts++;
-									}
-									continue;
-								}
-							} else {
-								attempts++;
-								continue;
-							}
-				
-						} else if (m_protocol == PR_HTTP) {
-							len = m_HttpSocket.Receive(&buff[buffsize], MAXBUFSIZE);
-							if (len <= 0) {
-								attempts++;
-								continue;
-							}
-				
-							attempts = 0;
-						}
-				
-						buffsize += len;
-				
-						if (buffsize >= MAXBUFSIZE) {
-#ifdef _DEBUG
-							if (dump) { fwrite(buff, buffsize, 1, dump); }
-#endif
-							Append((BYTE*)buff, buffsize);
-							buffsize = 0;
-						}
-					} while (!CheckRequest(NULL) && attempts < 10);
-				}
-
+				Receive();
 				break;
 		}
 	}
@@ -633,12 +787,3 @@ DWORD CUDPStream::ThreadProc()
 	ASSERT(0);
 	return (DWORD)-1;
 }
-
-CUDPStream::packet_t::packet_t(BYTE* p, __int64 start, __int64 end)
-	: m_start(start)
-	, m_end(end)
-{
-	size_t size = (size_t)(end - start);
-	m_buff      = DNew BYTE[size];
-	memcpy(m_buff, p, size);
-}
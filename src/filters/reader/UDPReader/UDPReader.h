@@ -32,18 +32,6 @@ class CUDPStream : public CAsyncStream, public CAMThread
 private:
 	CCritSec m_csLock;
 
-	class packet_t
-	{
-	public:
-		BYTE*   m_buff;
-		__int64 m_start, m_end;
-
-		packet_t(BYTE* p, __int64 start, __int64 end);
-		virtual ~packet_t() {
-			delete [] m_buff;
-		}
-	};
-
 	CString		m_url_str;
 	CUrl		m_url;
 	int			m_protocol;
@@ -56,18 +44,33 @@ private:
 	CMPCSocket	m_HttpSocket;
 	SOCKET		m_HttpSocketTread;
 
-	__int64		m_pos, m_len;
-	CAtlList<packet_t*> m_packets;
+	__int64		m_pos;
+
+	// Received data, a ring addressed by the stream offset. In memory it starts
+	// small and grows while the reader lags behind. With the timeshift window
+	// enabled the ring is a temporary file and the stream is received while
+	// paused. m_csRing guards m_start/m_len and the growth of the ring, the
+	// receive thread writes outside of it and never waits for a reader.
+	CCritSec	m_csRing;
+	CAutoVectorPtr<BYTE> m_ring;
+	HANDLE		m_hTimeShift;
+	__int64		m_ringsize;
+	__int64		m_start, m_len;
+	CAMEvent	m_evData;
+	bool		m_bTimeShift;
 
 	GUID		m_subtype;
 
 	void Clear();
+	bool CreateRing();
+	void GrowRing(__int64 size);
+	void RingWrite(__int64 pos, const BYTE* buff, int len);
+	void RingRead(__int64 pos, BYTE* buff, DWORD len);
 	void Append(BYTE* buff, int len);
+	void Receive();
 
 	DWORD ThreadProc();
 
-	void CheckBuffer();
-
 public:
 	CUDPStream();
 	virtual ~CUDPStream();
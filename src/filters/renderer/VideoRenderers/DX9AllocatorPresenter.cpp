@@ -22,6 +22,7 @@
 #include "stdafx.h"
 #include "RenderersSettings.h"
 #include "DX9AllocatorPresenter.h"
+#include "Dither.h"
 #include <InitGuid.h>
 #include <utility>
 #include "../../../SubPic/DX9SubPic.h"
@@ -2212,7 +2213,9 @@ STDMETHODIMP CDX9AllocatorPresenter::GetDIB(BYTE* lpDib, DWORD* size)
 
 	D3DLOCKED_RECT r;
 	CComPtr<IDirect3DSurface9> pSurface;
-	if (m_bFullFloatingPointProcessing || m_bHalfFloatingPointProcessing || m_bHighColorResolution) {
+	// 10-bit surfaces are read back as they are and dithered on the CPU
+	const bool bDither10bit = (desc.Format == D3DFMT_A2R10G10B10);
+	if (!bDither10bit && (m_bFullFloatingPointProcessing || m_bHalfFloatingPointProcessing || m_bHighColorResolution)) {
 		CComPtr<IDirect3DSurface9> fSurface = m_pVideoSurface[m_nCurSurface];
 		if (FAILED(hr = m_pD3DDev->CreateOffscreenPlainSurface(desc.Width, desc.Height, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &fSurface, NULL))
 				|| FAILED(hr = m_pD3DXLoadSurfaceFromSurface(fSurface, NULL, NULL, m_pVideoSurface[m_nCurSurface], NULL, NULL, D3DX_DEFAULT, 0))) return hr;
@@ -2243,10 +2246,16 @@ STDMETHODIMP CDX9AllocatorPresenter::GetDIB(BYTE* lpDib, DWORD* size)
 	bih->biPlanes = 1;
 	bih->biSizeImage = bih->biWidth * bih->biHeight * bih->biBitCount >> 3;
 
-	BitBltFromRGBToRGB(
-		bih->biWidth, bih->biHeight,
-		(BYTE*)(bih + 1), bih->biWidth*bih->biBitCount>>3, bih->biBitCount,
-		(BYTE*)r.pBits + r.Pitch*(desc.Height-1), -(int)r.Pitch, 32);
+	if (bDither10bit) {
+		DitherA2R10G10B10ToX8R8G8B8(
+			(BYTE*)(bih + 1) + (bih->biWidth*bih->biBitCount>>3)*(desc.Height-1), -(bih->biWidth*bih->biBitCount>>3),
+			(BYTE*)r.pBits, r.Pitch, desc.Width, desc.Height);
+	} else {
+		BitBltFromRGBToRGB(
+			bih->biWidth, bih->biHeight,
+			(BYTE*)(bih + 1), bih->biWidth*bih->biBitCount>>3, bih->biBitCount,
+			(BYTE*)r.pBits + r.Pitch*(desc.Height-1), -(int)r.Pitch, 32);
+	}
 
 	pSurface->UnlockRect();
 
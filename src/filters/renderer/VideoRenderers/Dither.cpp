@@ -19,6 +19,7 @@
  */
 
 #include "stdafx.h"
+#include <emmintrin.h>
 #include "Dither.h"
 
 // Dither matrix in 16-bit floating point format
@@ -88,3 +89,71 @@ const unsigned short DITHER_MATRIX[DITHER_MATRIX_SIZE][DITHER_MATRIX_SIZE] = {
 	0x3a0e, 0x3820, 0x32f8, 0x3954, 0x3afc, 0x38c0, 0x36a4, 0x3370, 0x2e70, 0x38b2, 0x3180, 0x3ba8, 0x2c80, 0x3778, 0x390c, 0x2cf0,
 	0x35c0, 0x32e0, 0x36f4, 0x3b94, 0x3454, 0x39f4, 0x3348, 0x397e, 0x3b4e, 0x0000, 0x38fc, 0x34dc, 0x3a2a, 0x36a8, 0x393a, 0x3b54,
 };
+
+// DITHER_MATRIX as 8-bit thresholds, in 1/256 of an output step
+static BYTE s_DitherMatrix8[DITHER_MATRIX_SIZE * DITHER_MATRIX_SIZE];
+
+static struct DitherMatrix8Init {
+	DitherMatrix8Init() {
+		for (int i = 0; i < DITHER_MATRIX_SIZE * DITHER_MATRIX_SIZE; i++) {
+			// all values are positive half floats below 1.0
+			const unsigned short h = DITHER_MATRIX[i / DITHER_MATRIX_SIZE][i % DITHER_MATRIX_SIZE];
+			const int e = (h >> 10) & 0x1f;
+			const int m = h & 0x3ff;
+			const float f = e ? ldexpf((float)(m | 0x400), e - 25) : ldexpf((float)m, -24);
+			s_DitherMatrix8[i] = (BYTE)min(255, (int)(f * 256));
+		}
+	}
+} s_DitherMatrix8Init;
+
+static void DitherA2R10G10B10Row_c(DWORD* dst, const DWORD* src, int x, int w, const BYTE* dither)
+{
+	for (; x < w; x++) {
+		const DWORD p = src[x];
+		const int d = dither[x & (DITHER_MATRIX_SIZE - 1)] >> 6;
+		const int r = min(255, (int)(((p >> 20) & 0x3ff) + d) >> 2);
+		const int g = min(255, (int)(((p >> 10) & 0x3ff) + d) >> 2);
+		const int b = min(255, (int)((p & 0x3ff) + d) >> 2);
+		dst[x] = 0xff000000 | (r << 16) | (g << 8) | b;
+	}
+}
+
+// eight pixels per iteration, the components are packed to words with saturation
+static void DitherA2R10G10B10Row_sse2(DWORD* dst, const DWORD* src, int x, int w, const BYTE* dither)
+{
+	const __m128i mask = _mm_set1_epi32(0x3ff);
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; x + 8 <= w; x += 8) {
+		__m128i p0 = _mm_loadu_si128((const __m128i*)&src[x]);
+		__m128i p1 = _mm_loadu_si128((const __m128i*)&src[x + 4]);
+		__m128i d = _mm_loadl_epi64((const __m128i*)&dither[x & (DITHER_MATRIX_SIZE - 1)]);
+		d = _mm_srli_epi16(_mm_unpacklo_epi8(d, zero), 6);
+
+		__m128i r = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 20), mask), _mm_and_si128(_mm_srli_epi32(p1, 20), mask));
+		__m128i g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 10), mask), _mm_and_si128(_mm_srli_epi32(p1, 10), mask));
+		__m128i b = _mm_packs_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+
+		r = _mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(r, d), 2), zero);
+		g = _mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(g, d), 2), zero);
+		b = _mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(b, d), 2), zero);
+
+		__m128i bg = _mm_unpacklo_epi8(b, g);
+		__m128i ra = _mm_unpacklo_epi8(r, _mm_cmpeq_epi8(zero, zero));
+
+		_mm_storeu_si128((__m128i*)&dst[x], _mm_unpacklo_epi16(bg, ra));
+		_mm_storeu_si128((__m128i*)&dst[x + 4], _mm_unpackhi_epi16(bg, ra));
+	}
+
+	DitherA2R10G10B10Row_c(dst, src, x, w, dither);
+}
+
+void DitherA2R10G10B10ToX8R8G8B8(BYTE* dst, int dstpitch, const BYTE* src, int srcpitch, int w, int h)
+{
+	void (*ditherrow)(DWORD* dst, const DWORD* src, int x, int w, const BYTE* dither) =
+		(g_cpuid.m_flags & CCpuID::sse2) ? DitherA2R10G10B10Row_sse2 : DitherA2R10G10B10Row_c;
+
+	for (int y = 0; y < h; y++, dst += dstpitch, src += srcpitch) {
+		ditherrow((DWORD*)dst, (const DWORD*)src, 0, w, &s_DitherMatrix8[(y & (DITHER_MATRIX_SIZE - 1)) * DITHER_MATRIX_SIZE]);
+	}
+}
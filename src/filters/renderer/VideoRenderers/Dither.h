@@ -22,3 +22,6 @@
 
 const int DITHER_MATRIX_SIZE = 32;
 extern const unsigned short DITHER_MATRIX[DITHER_MATRIX_SIZE][DITHER_MATRIX_SIZE];
+
+// Ordered dithering of A2R10G10B10 pixels to X8R8G8B8 on the CPU
+extern void DitherA2R10G10B10ToX8R8G8B8(BYTE* dst, int dstpitch, const BYTE* src, int srcpitch, int w, int h);
@@ -32,9 +32,19 @@
 
 #define MAXFRAMESIZE	((144 * 320000 / 8000) + 1)
 #define BUFFERS			2
-#define MINBUFFERLENGTH	1000000i64
-#define AVGBUFFERLENGTH	30000000i64
-#define MAXBUFFERLENGTH	100000000i64
+#define MINBUFFERLENGTH	1000000i64		// low water mark, buffering starts below it
+#define AVGBUFFERLENGTH	30000000i64		// pre-buffer, playback starts again above it
+#define MAXBUFFERLENGTH	100000000i64	// high water mark, receiving pauses above it
+#define BUFFERLIMIT		600000000i64	// upper limit for the settings, the ring holds the high water mark
+#define PREBUFFERGAP	10000000i64		// the pre-buffer stays 1 s below the high water mark
+#define MINBUFFERGAP	1000000i64		// and the low water mark 0.1 s below the pre-buffer
+#define MAXBYTESPERSEC	(2000000 / 8)	// upper limit for the bitrate in the stream header
+
+#define OPT_REGKEY_ShoutcastSource	_T("Software\\MPC-BE Filters\\Shoutcast Source")
+#define OPT_SECTION_ShoutcastSource	_T("Filters\\Shoutcast Source")
+#define OPT_PreBuffer				_T("PreBuffer") // ms
+#define OPT_MinBuffer				_T("MinBuffer") // ms
+#define OPT_MaxBuffer				_T("MaxBuffer") // ms
 
 #define ADTS_FRAME_SIZE	9
 
@@ -326,11 +336,43 @@ CShoutcastStream::CShoutcastStream(const WCHAR* wfn, CShoutcastSource* pParent,
 	: CSourceStream(NAME("ShoutcastStream"), phr, pParent, L"Output")
 	, m_fBuffering(false)
 	, m_hSocket(INVALID_SOCKET)
+	, m_ringsize(0)
+	, m_nWritten(0)
+	, m_nRead(0)
+	, m_bEndOfStream(false)
+	, m_nBytesPerSec(0)
+	, m_rtPreBuffer(AVGBUFFERLENGTH)
+	, m_rtMinBuffer(MINBUFFERLENGTH)
+	, m_rtMaxBuffer(MAXBUFFERLENGTH)
 {
 	ASSERT(phr);
 
 	*phr = S_OK;
 
+#ifdef REGISTER_FILTER
+	CRegKey key;
+	if (ERROR_SUCCESS == key.Open(HKEY_CURRENT_USER, OPT_REGKEY_ShoutcastSource, KEY_READ)) {
+		DWORD dw;
+		if (ERROR_SUCCESS == key.QueryDWORDValue(OPT_PreBuffer, dw)) {
+			m_rtPreBuffer = 10000i64 * dw;
+		}
+		if (ERROR_SUCCESS == key.QueryDWORDValue(OPT_MinBuffer, dw)) {
+			m_rtMinBuffer = 10000i64 * dw;
+		}
+		if (ERROR_SUCCESS == key.QueryDWORDValue(OPT_MaxBuffer, dw)) {
+			m_rtMaxBuffer = 10000i64 * dw;
+		}
+	}
+#else
+	m_rtPreBuffer = 10000i64 * AfxGetApp()->GetProfileInt(OPT_SECTION_ShoutcastSource, OPT_PreBuffer, (int)(AVGBUFFERLENGTH / 10000));
+	m_rtMinBuffer = 10000i64 * AfxGetApp()->GetProfileInt(OPT_SECTION_ShoutcastSource, OPT_MinBuffer, (int)(MINBUFFERLENGTH / 10000));
+	m_rtMaxBuffer = 10000i64 * AfxGetApp()->GetProfileInt(OPT_SECTION_ShoutcastSource, OPT_MaxBuffer, (int)(MAXBUFFERLENGTH / 10000));
+#endif
+
+	m_rtMaxBuffer = min(max(m_rtMaxBuffer, PREBUFFERGAP + MINBUFFERGAP), BUFFERLIMIT);
+	m_rtPreBuffer = min(max(m_rtPreBuffer, MINBUFFERGAP), m_rtMaxBuffer - PREBUFFERGAP);
+	m_rtMinBuffer = min(max(m_rtMinBuffer, 0), m_rtPreBuffer - MINBUFFERGAP);
+
 	CString fn(wfn);
 	if (fn.Find(_T("://")) < 0) {
 		fn = _T("http://") + fn;
@@ -386,35 +428,117 @@ CShoutcastStream::~CShoutcastStream()
 
 void CShoutcastStream::EmptyBuffer()
 {
-	CAutoLock cAutoLock(&m_queue);
-	m_queue.RemoveAll();
+	CAutoLock cAutoLock(&m_csRing);
+	m_nWritten = m_nRead = 0;
+	m_titles.RemoveAll();
+	m_bEndOfStream = false;
+}
+
+REFERENCE_TIME CShoutcastStream::BytesToTime(__int64 bytes) const
+{
+	return m_nBytesPerSec ? 10000000i64 * bytes / m_nBytesPerSec : 0;
+}
+
+REFERENCE_TIME CShoutcastStream::GetBufferedTime() const
+{
+	return BytesToTime(m_nWritten - m_nRead);
 }
 
 LONGLONG CShoutcastStream::GetBufferFullness()
 {
-	CAutoLock cAutoLock(&m_queue);
+	CAutoLock cAutoLock(&m_csRing);
 	if (!m_fBuffering) {
 		return 100;
 	}
-	if (m_queue.IsEmpty()) {
-		return 0;
-	}
-	LONGLONG ret = 100i64*(m_queue.GetTail()->rtStart - m_queue.GetHead()->rtStart) / AVGBUFFERLENGTH;
+	LONGLONG ret = 100i64 * GetBufferedTime() / m_rtPreBuffer;
 	return min(ret, 100);
 }
 
 CString CShoutcastStream::GetTitle()
 {
-	CAutoLock cAutoLock(&m_queue);
+	CAutoLock cAutoLock(&m_csRing);
 	return m_title;
 }
 
 CString CShoutcastStream::GetDescription()
 {
-	CAutoLock cAutoLock(&m_queue);
+	CAutoLock cAutoLock(&m_csRing);
 	return m_Description;
 }
 
+void CShoutcastStream::RingCopy(__int64 pos, BYTE* dst, int len) const
+{
+	const int offset = (int)(pos % m_ringsize);
+	const int size = (int)min(len, m_ringsize - offset);
+	memcpy(dst, &m_ring[offset], size);
+	if (size < len) {
+		memcpy(dst + size, &m_ring[0], len - size);
+	}
+}
+
+// takes the next sample from the ring, m_csRing must be locked
+bool CShoutcastStream::ReadFrame(BYTE* pData, long size, long& len)
+{
+	if (m_socket.m_Format == AUDIO_MPEG) {
+		len = (long)min(m_nWritten - m_nRead, min(size, MAXFRAMESIZE));
+		if (len <= 0) {
+			return false;
+		}
+
+		RingCopy(m_nRead, pData, len);
+		m_nRead += len;
+
+		return true;
+	}
+
+	// ADTS frames are delivered without the header, garbage is skipped until the next sync
+	for (;;) {
+		const __int64 available = m_nWritten - m_nRead;
+		if (available < ADTS_FRAME_SIZE) {
+			return false;
+		}
+
+		BYTE h[ADTS_FRAME_SIZE];
+		RingCopy(m_nRead, h, ADTS_FRAME_SIZE);
+
+		if (h[0] != 0xff || (h[1] & 0xf6) != 0xf0) {
+			m_nRead++;
+			continue;
+		}
+
+		const int framelen	= ((h[3] & 3) << 11) | (h[4] << 3) | (h[5] >> 5);
+		const int hdrlen	= (h[1] & 1) ? 7 : 9;
+		if (framelen <= hdrlen) {
+			m_nRead++;
+			continue;
+		}
+
+		if (available < framelen) {
+			return false;
+		}
+
+		if (available >= framelen + 2) {
+			BYTE next[2];
+			RingCopy(m_nRead + framelen, next, 2);
+			if (next[0] != 0xff || (next[1] & 0xf6) != 0xf0) {
+				m_nRead++;
+				continue;
+			}
+		}
+
+		len = framelen - hdrlen;
+		if (len > size) {
+			m_nRead += framelen;
+			continue;
+		}
+
+		RingCopy(m_nRead + hdrlen, pData, len);
+		m_nRead += framelen;
+
+		return true;
+	}
+}
+
 HRESULT CShoutcastStream::DecideBufferSize(IMemAllocator* pAlloc, ALLOCATOR_PROPERTIES* pProperties)
 {
 	ASSERT(pAlloc);
@@ -447,12 +571,25 @@ HRESULT CShoutcastStream::FillBuffer(IMediaSample* pSample)
 		return S_FALSE;
 	}
 
-	do {
+	long len = 0;
+	REFERENCE_TIME rtStart = 0, rtStop = 0;
+
+	for (;;) {
 		// do we have to refill our buffer?
 		{
-			CAutoLock cAutoLock(&m_queue);
-			if (!m_queue.IsEmpty() && m_queue.GetHead()->rtStart < m_queue.GetTail()->rtStart - MINBUFFERLENGTH) {
-				break;    // nope, that's great
+			CAutoLock cAutoLock(&m_csRing);
+			if (GetBufferedTime() > m_rtMinBuffer || m_bEndOfStream) {
+				rtStart = BytesToTime(m_nRead);
+				if (ReadFrame(pData, pSample->GetSize(), len)) {
+					rtStop = BytesToTime(m_nRead);
+					while (!m_titles.IsEmpty() && m_titles.GetHead().pos < m_nRead) {
+						m_title = m_titles.RemoveHead().title;
+					}
+					break;    // nope, that's great
+				}
+				if (m_bEndOfStream) {
+					return S_FALSE;
+				}
 			}
 		}
 
@@ -466,8 +603,8 @@ HRESULT CShoutcastStream::FillBuffer(IMediaSample* pSample)
 
 			Sleep(50);
 
-			CAutoLock cAutoLock(&m_queue);
-			if (!m_queue.IsEmpty() && m_queue.GetHead()->rtStart < m_queue.GetTail()->rtStart - AVGBUFFERLENGTH) {
+			CAutoLock cAutoLock(&m_csRing);
+			if (GetBufferedTime() >= m_rtPreBuffer || m_bEndOfStream) {
 				break;    // this is enough
 			}
 		}
@@ -481,21 +618,10 @@ HRESULT CShoutcastStream::FillBuffer(IMediaSample* pSample)
 
 		TRACE(_T("CShoutcastStream(): END BUFFERING\n"));
 		m_fBuffering = false;
-	} while (false);
-
-	{
-		CAutoLock cAutoLock(&m_queue);
-		ASSERT(!m_queue.IsEmpty());
-		if (!m_queue.IsEmpty()) {
-			CAutoPtr<ShoutCastPacket> p = m_queue.RemoveHead();
-			DWORD len = min((DWORD)pSample->GetSize(), p->GetCount());
-			memcpy(pData, p->GetData(), len);
-			pSample->SetActualDataLength(len);
-			pSample->SetTime(&p->rtStart, &p->rtStop);
-			m_title = p->title;
-		}
 	}
 
+	pSample->SetActualDataLength(len);
+	pSample->SetTime(&rtStart, &rtStop);
 	pSample->SetSyncPoint(TRUE);
 
 	return S_OK;
@@ -576,128 +702,122 @@ UINT CShoutcastStream::SocketThreadProc()
 
 	CShoutcastSocket soc;
 
-	CAutoVectorPtr<BYTE> pData;
-	if (!pData.Allocate(max(m_socket.m_metaint, MAXFRAMESIZE)) || !soc.Create()) {
+	if (!soc.Create()) {
+		CAutoLock cAutoLock(&m_csRing);
+		m_bEndOfStream = true;
 		return 1;
 	}
 
 	soc.Attach(m_hSocket);
 	soc = m_socket;
+	soc.m_pfExit = &fExitThread;
 
-	m_title			= soc.m_title;
-	m_Description	= soc.m_Description;
-
-	REFERENCE_TIME m_rtSampleTime = 0;
-
-	CAutoPtr<Packet> m_p;
+	{
+		CAutoLock cAutoLock(&m_csRing);
+		m_title			= soc.m_title;
+		m_Description	= soc.m_Description;
+	}
 
-	DWORD MinQueuePackets = max(10, min(MAXQUEUEPACKETS, AfxGetApp()->GetProfileInt(IDS_R_SETTINGS IDS_R_PERFOMANCE, IDS_RS_PERFOMANCE_MINQUEUEPACKETS, MINQUEUEPACKETS)));
-	DWORD MaxQueuePackets = max(MinQueuePackets*2, min(MAXQUEUEPACKETS*10, AfxGetApp()->GetProfileInt(IDS_R_SETTINGS IDS_R_PERFOMANCE, IDS_RS_PERFOMANCE_MAXQUEUEPACKETS, MAXQUEUEPACKETS)));
+	CString title;
 
 	while (!fExitThread) {
+		int size;
 		{
-			if (m_queue.GetCount() >= MaxQueuePackets) {
-				// Buffer is full
-				Sleep(100);	
-				continue;
+			CAutoLock cAutoLock(&m_csRing);
+			size = (int)min(m_ringsize - (m_nWritten - m_nRead), m_ringsize - m_nWritten % m_ringsize);
+			size = min(size, MAXFRAMESIZE);
+			if (GetBufferedTime() >= m_rtMaxBuffer) {
+				size = 0;
 			}
 		}
 
-		int len = soc.Receive(pData, MAXFRAMESIZE);
-		if (len <= 0) {
-			break;
+		if (size <= 0) {
+			// Buffer is full
+			Sleep(50);
+			continue;
 		}
 
-		if (m_socket.m_Format == AUDIO_MPEG) {
-			CAutoPtr<ShoutCastPacket> p(DNew ShoutCastPacket());
-
-			p->SetData(pData, len);
-			p->rtStop = (p->rtStart = m_rtSampleTime) + (10000000i64 * len * 8/soc.m_bitrate);
-			p->title = !soc.m_title.IsEmpty() ? soc.m_title : soc.m_url;
-			m_rtSampleTime = p->rtStop;
+		// only this thread moves m_nWritten
+		int len = soc.Receive(&m_ring[m_nWritten % m_ringsize], size);
+		if (len <= 0) {
+			if (fExitThread || !Reconnect(soc)) {
+				break;
+			}
+			continue;
+		}
 
-			CAutoLock cAutoLock(&m_queue);
-			m_queue.AddTail(p);
-		} else if (m_socket.m_Format == AUDIO_AAC) {
-			// code from MpegSplitter.cpp
-			CAutoPtr<Packet> p(DNew Packet());
-			p->SetData(pData, len);
+		const CString& t = !soc.m_title.IsEmpty() ? soc.m_title : soc.m_url;
 
-			if (m_p && m_p->GetCount() == 1 && m_p->GetAt(0) == 0xff && !(!p->IsEmpty() && (p->GetAt(0) & 0xf6) == 0xf0)) {
-				m_p.Free();
-			}
+		CAutoLock cAutoLock(&m_csRing);
+		if (t != title) {
+			title_t tt;
+			tt.pos		= m_nWritten;
+			tt.title	= title = t;
+			m_titles.AddTail(tt);
+		}
+		m_nWritten += len;
+	}
 
-			if (!m_p) {
-				BYTE* base = p->GetData();
-				BYTE* s = base;
-				BYTE* e = s + p->GetCount();
+	{
+		CAutoLock cAutoLock(&m_csRing);
+		m_bEndOfStream = true;
+	}
 
-				for (; s < e; s++) {
-					if (*s != 0xff) {
-						continue;
-					}
+	m_hSocket = soc.Detach();
 
-					if (s == e-1 || (s[1]&0xf6) == 0xf0) {
-						memmove(base, s, e - s);
-						p->SetCount(e - s);
-						m_p = p;
-						break;
-					}
-				}
-			} else {
-				m_p->Append(*p);
-			}
+	return 0;
+}
 
-			while (m_p && m_p->GetCount() > ADTS_FRAME_SIZE) {
-				BYTE* base	= m_p->GetData();
-				BYTE* s		= base;
-				BYTE* e		= s + m_p->GetCount();
-				int len		= ((s[3]&3)<<11)|(s[4]<<3)|(s[5]>>5);
-				bool crc	= !(s[1]&1);
-				s	+= 7;
-				len	-= 7;
-				if (crc) {
-					s += 2, len -= 2;
-				}
+// Connects again to the same stream, the buffer covers the time it takes and
+// the timestamps continue. A stream that comes back in another format ends playback.
+bool CShoutcastStream::Reconnect(CShoutcastSocket& soc)
+{
+	soc.Close();
 
-				if (e - s < len) {
-					break;
-				}
+	for (int i = 0; i < 5 && !fExitThread; i++) {
+		DbgLog((LOG_TRACE, 3, L"CShoutcastStream::Reconnect() : attempt %d", i + 1));
 
-				if (len <= 0 || (e - s >= len + 2 && (s[len] != 0xff || (s[len+1]&0xf6) != 0xf0))) {
-					m_p.Free();
-					break;
-				}
+		if (soc.Create()) {
+			soc.SetUserAgent("MPC ShoutCast Source");
 
-				{
-					CAutoPtr<ShoutCastPacket> p2(DNew ShoutCastPacket());
-					p2->SetData(s, len);
-					p2->rtStop = (p2->rtStart = m_rtSampleTime) + (10000000i64 * len * 8/soc.m_bitrate);
-					p2->title = !soc.m_title.IsEmpty() ? soc.m_title : soc.m_url;
-					m_rtSampleTime = p2->rtStop;
-
-					CAutoLock cAutoLock(&m_queue);
-					m_queue.AddTail(p2);
+			CString redirectUrl;
+			if (soc.Connect(m_url, redirectUrl)) {
+				if (soc.m_Format == m_socket.m_Format && soc.m_freq == m_socket.m_freq && soc.m_channels == m_socket.m_channels) {
+					return true;
 				}
-
-				s += len;
-				memmove(base, s, e - s);
-				m_p->SetCount(e - s);
+				soc.Close();
+				return false;
 			}
+			soc.Close();
 		}
-	}
-
-	m_p.Free();
 
-	m_hSocket = soc.Detach();
+		for (int j = 0; j < 10 && !fExitThread; j++) {
+			Sleep(100);
+		}
+	}
 
-	return 0;
+	return false;
 }
 
 HRESULT CShoutcastStream::OnThreadCreate()
 {
 	EmptyBuffer();
 
+	m_nBytesPerSec = m_socket.m_bitrate / 8;
+	if (!m_nBytesPerSec && m_socket.m_Format == AUDIO_AAC) {
+		m_nBytesPerSec = m_socket.m_aachdr.nBytesPerSec;
+	}
+	if (!m_nBytesPerSec) {
+		m_nBytesPerSec = 128000 / 8;
+	}
+	m_nBytesPerSec = min(m_nBytesPerSec, (DWORD)MAXBYTESPERSEC);
+
+	m_ring.Free();
+	m_ringsize = m_rtMaxBuffer * m_nBytesPerSec / 10000000i64 + 4 * MAXFRAMESIZE;
+	if (!m_ring.Allocate((size_t)m_ringsize)) {
+		return E_OUTOFMEMORY;
+	}
+
 	fExitThread = true;
 	m_hSocketThread = AfxBeginThread(::SocketThreadProc, this)->m_hThread;
 
@@ -710,11 +830,17 @@ HRESULT CShoutcastStream::OnThreadCreate()
 
 HRESULT CShoutcastStream::OnThreadDestroy()
 {
-	EmptyBuffer();
-
 	fExitThread = true;
 	m_socket.CancelBlockingCall();
-	WaitForSingleObject(m_hSocketThread, (DWORD)-1);
+	// a host name lookup can't be cancelled
+	if (WaitForSingleObject(m_hSocketThread, 5000) == WAIT_TIMEOUT) {
+		// the thread never blocks while it holds m_csRing, with the lock taken here
+		// it is not terminated inside one of its short sections
+		CAutoLock cAutoLock(&m_csRing);
+		TerminateThread(m_hSocketThread, 0xDEAD);
+	}
+
+	EmptyBuffer();
 
 	return NOERROR;
 }
@@ -828,6 +954,16 @@ int CShoutcastStream::CShoutcastSocket::Receive(void* lpBuf, int nBufLen, int nF
 	return len;
 }
 
+BOOL CShoutcastStream::CShoutcastSocket::OnMessagePending()
+{
+	if (m_pfExit && *m_pfExit) {
+		CancelBlockingCall();
+		return FALSE;
+	}
+
+	return __super::OnMessagePending();
+}
+
 bool CShoutcastStream::CShoutcastSocket::Connect(CUrl& url, CString& redirectUrl)
 {
 	redirectUrl.Empty();
@@ -152,29 +152,26 @@ public:
 
 class CShoutcastStream : public CSourceStream
 {
-
-	class ShoutCastPacket : public Packet
-	{
-	public:
-		CString title;
-	};
-
-	class ShoutCastqueue : public CAutoPtrList<ShoutCastPacket>, public CCritSec {} m_queue;
-
 	class CShoutcastSocket : public CMPCSocket
 	{
 		DWORD m_nBytesRead;
 
+	protected:
+		virtual BOOL OnMessagePending();
+
 	public:
 		CShoutcastSocket() {
 			SetTimeOut(3000, 3000);
 			m_metaint		= m_bitrate = m_freq = m_channels = 0;
 			m_nBytesRead	= 0;
 			m_Format		= AUDIO_NONE;
+			m_pfExit		= NULL;
 		}
 
 		int Receive(void* lpBuf, int nBufLen, int nFlags = 0);
 
+		const bool* m_pfExit; // a blocking call is cancelled when it gets set
+
 		DWORD m_metaint, m_bitrate, m_freq, m_channels;
 		aachdr m_aachdr;
 		StreamFormat m_Format;
@@ -208,6 +205,30 @@ class CShoutcastStream : public CSourceStream
 	bool m_fBuffering;
 	CString m_title, m_Description;
 
+	// Received audio. The socket thread receives straight into the free part of
+	// the ring, the ICY metadata is taken out by CShoutcastSocket::Receive().
+	// Both threads hold m_csRing only to move the positions.
+	CCritSec				m_csRing;
+	CAutoVectorPtr<BYTE>	m_ring;
+	__int64					m_ringsize;
+	__int64					m_nWritten, m_nRead;
+	bool					m_bEndOfStream;
+
+	struct title_t {
+		__int64	pos; // the title is shown from this position on
+		CString	title;
+	};
+	CAtlList<title_t>		m_titles;
+
+	DWORD					m_nBytesPerSec;
+	REFERENCE_TIME			m_rtPreBuffer, m_rtMinBuffer, m_rtMaxBuffer;
+
+	REFERENCE_TIME	BytesToTime(__int64 bytes) const;
+	REFERENCE_TIME	GetBufferedTime() const;
+	void			RingCopy(__int64 pos, BYTE* dst, int len) const;
+	bool			ReadFrame(BYTE* pData, long size, long& len);
+	bool			Reconnect(CShoutcastSocket& soc);
+
 public:
 	CShoutcastStream(const WCHAR* wfn, CShoutcastSource* pParent, HRESULT* phr);
 	virtual ~CShoutcastStream();
@@ -413,6 +413,14 @@ HRESULT CBaseVideoFilter::CopyBuffer(BYTE* pOut, BYTE** ppIn, int w, int h, int
 		BYTE* pInUV = ppIn[1];
 		BYTE* pOutUV = pOut + bihOut.biWidth * h * 2; // 2 bytes per pixel
 		BitBltFromP016ToP016(w, h, pOut, pOutUV, bihOut.biWidth * 2, pInY, pInUV, pitchIn);
+	} else if ((subtype == MEDIASUBTYPE_P010 || subtype == MEDIASUBTYPE_P016)
+			   && (bihOut.biCompression == BI_RGB || bihOut.biCompression == BI_BITFIELDS)) {
+		// 10 and 16 bit sources are dithered down to 8 bits
+		if (!BitBltFromP016ToRGB(w, h, pOut, pitchOut, bihOut.biBitCount, ppIn[0], ppIn[1], pitchIn, GetOrderedDitherMatrix())) {
+			for (int y = 0; y < h; y++, pOut += pitchOut) {
+				memsetd(pOut, 0, pitchOut);
+			}
+		}
 	} else if (subtype == MEDIASUBTYPE_NV12 && bihOut.biCompression == FCC('NV12')) {
 		// We currently don't support outputting NV12 input to something other than NV12
 		BYTE* pInY = ppIn[0];
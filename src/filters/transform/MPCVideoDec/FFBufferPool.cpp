@@ -0,0 +1,265 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include "FFBufferPool.h"
+#include "memcpy_sse.h"
+
+#pragma warning(push)
+#pragma warning(disable: 4005)
+extern "C" {
+	#include <ffmpeg/libavcodec/avcodec.h>
+	#include <ffmpeg/libavutil/buffer.h>
+}
+#pragma warning(pop)
+
+#define PLANE_GAP 64 // readable bytes after each plane, covers the overread of the optimized functions
+
+//
+// CFFPacketPool
+//
+
+CFFPacketPool::CFFPacketPool()
+{
+	memset(m_pools, 0, sizeof(m_pools));
+}
+
+CFFPacketPool::~CFFPacketPool()
+{
+	Clear();
+}
+
+AVBufferRef* CFFPacketPool::Get(int size)
+{
+	if (size < 0) {
+		return NULL;
+	}
+
+	const int need = size + FF_INPUT_BUFFER_PADDING_SIZE;
+
+	int c = MIN_CLASS;
+	while (c <= MAX_CLASS && (1 << c) < need) {
+		c++;
+	}
+
+	AVBufferRef* buf = NULL;
+	if (c > MAX_CLASS) {
+		buf = av_buffer_alloc(need);
+	} else {
+		AVBufferPool*& pool = m_pools[c - MIN_CLASS];
+		if (!pool) {
+			pool = av_buffer_pool_init(1 << c, NULL);
+		}
+		if (pool) {
+			buf = av_buffer_pool_get(pool);
+		}
+	}
+
+	if (buf) {
+		memset(buf->data + size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+	}
+
+	return buf;
+}
+
+void CFFPacketPool::Clear()
+{
+	// buffers still referenced by the decoder free themselves when released
+	for (int i = 0; i < _countof(m_pools); i++) {
+		av_buffer_pool_uninit(&m_pools[i]);
+	}
+}
+
+//
+// CFFFramePool
+//
+
+CFFFramePool::CFFFramePool()
+	: m_pPool(NULL)
+	, m_nPoolSize(0)
+	, m_out_pixfmt(PixFmt_None)
+	, m_dstStride(0)
+	, m_planeHeight(0)
+	, m_swof(NULL)
+{
+	memset(m_stride, 0, sizeof(m_stride));
+	memset(m_rows, 0, sizeof(m_rows));
+	memset(m_offset, 0, sizeof(m_offset));
+}
+
+CFFFramePool::~CFFFramePool()
+{
+	Clear();
+}
+
+void CFFFramePool::SetOutput(MPCPixelFormat out_pixfmt, int dstStride, int planeHeight)
+{
+	CAutoLock cAutoLock(&m_csLock);
+
+	m_out_pixfmt	= out_pixfmt;
+	m_dstStride		= dstStride;
+	m_planeHeight	= planeHeight;
+}
+
+bool CFFFramePool::GetBuffer(AVCodecContext* avctx, AVFrame* frame)
+{
+	CAutoLock cAutoLock(&m_csLock);
+
+	const int dstStride		= m_dstStride;
+	const int planeHeight	= m_planeHeight;
+
+	const SW_OUT_FMT* swof = GetSWOF(m_out_pixfmt);
+	if (!swof || swof->planes != 3 || swof->codedbytes != 1 || frame->format != swof->av_pix_fmt) {
+		return false;
+	}
+
+	if (!avctx->codec || !(avctx->codec->capabilities & CODEC_CAP_DR1)) {
+		return false;
+	}
+
+	int w = frame->width;
+	int h = frame->height;
+	int linesize_align[AV_NUM_DATA_POINTERS];
+	avcodec_align_dimensions2(avctx, &w, &h, linesize_align);
+
+	if (w > dstStride) {
+		return false;
+	}
+
+	int stride[3], rows[3];
+	stride[0]	= dstStride;
+	rows[0]		= max(h, planeHeight);
+	for (int i = 1; i < 3; i++) {
+		stride[i]	= dstStride / swof->planeWidth[i];
+		rows[i]		= max((h + (1 << swof->chroma_h) - 1) >> swof->chroma_h, planeHeight / swof->planeHeight[i]);
+	}
+
+	for (int i = 0; i < 3; i++) {
+		if (linesize_align[i] > 0 && stride[i] % linesize_align[i]) {
+			return false;
+		}
+	}
+
+	int offset[3];
+	offset[0] = 0;
+	offset[1] = FFALIGN(offset[0] + stride[0] * rows[0] + PLANE_GAP, 64);
+	offset[2] = FFALIGN(offset[1] + stride[1] * rows[1] + PLANE_GAP, 64);
+	const int size = offset[2] + stride[2] * rows[2] + PLANE_GAP;
+
+	if (size != m_nPoolSize || !m_pPool) {
+		av_buffer_pool_uninit(&m_pPool);
+		m_pPool = av_buffer_pool_init(size, NULL);
+		m_nPoolSize = m_pPool ? size : 0;
+	}
+
+	if (!m_pPool) {
+		return false;
+	}
+
+	m_swof = swof;
+	memcpy(m_stride, stride, sizeof(m_stride));
+	memcpy(m_rows, rows, sizeof(m_rows));
+	memcpy(m_offset, offset, sizeof(m_offset));
+
+	AVBufferRef* buf = av_buffer_pool_get(m_pPool);
+	if (!buf) {
+		return false;
+	}
+
+	memset(frame->buf, 0, sizeof(frame->buf));
+	memset(frame->data, 0, sizeof(frame->data));
+	memset(frame->linesize, 0, sizeof(frame->linesize));
+
+	frame->buf[0] = buf;
+	for (int i = 0; i < 3; i++) {
+		frame->data[i]		= buf->data + offset[i];
+		frame->linesize[i]	= stride[i];
+	}
+	frame->extended_data = frame->data;
+
+	return true;
+}
+
+bool CFFFramePool::IsDirect(const AVFrame* frame, MPCPixelFormat out_pixfmt, int dstStride, int planeHeight)
+{
+	CAutoLock cAutoLock(&m_csLock);
+
+	if (!m_pPool || !m_swof || m_swof != GetSWOF(out_pixfmt) || frame->format != m_swof->av_pix_fmt) {
+		return false;
+	}
+
+	// the output type may have changed after the frame was allocated
+	if (m_stride[0] != dstStride || m_rows[0] < planeHeight) {
+		return false;
+	}
+
+	if (!frame->buf[0] || frame->buf[1] || frame->buf[0]->size != m_nPoolSize || frame->data[0] != frame->buf[0]->data) {
+		return false;
+	}
+
+	for (int i = 0; i < 3; i++) {
+		if (frame->linesize[i] != m_stride[i] || frame->data[i] != frame->data[0] + m_offset[i]) {
+			return false;
+		}
+		if (m_rows[i] < planeHeight / m_swof->planeHeight[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+size_t CFFFramePool::CopyDirect(BYTE* dst, size_t dstSize, const AVFrame* frame, MPCPixelFormat out_pixfmt, int planeHeight) const
+{
+	// YV12, YV16 and YV24 store V before U
+	static const int order[3] = {0, 2, 1};
+
+	// only the frame itself is used, a frame thread may already allocate in a new layout
+	const SW_OUT_FMT* swof = GetSWOF(out_pixfmt);
+	if (!swof) {
+		return 0;
+	}
+
+	size_t size[3], total = 0;
+	for (int i = 0; i < 3; i++) {
+		size[i] = (size_t)frame->linesize[order[i]] * (planeHeight / swof->planeHeight[i]);
+		total += size[i];
+	}
+
+	if (total > dstSize) {
+		return 0;
+	}
+
+	for (int i = 0; i < 3; i++) {
+		memcpy_sse(dst, frame->data[order[i]], size[i]);
+		dst += size[i];
+	}
+
+	return total;
+}
+
+void CFFFramePool::Clear()
+{
+	CAutoLock cAutoLock(&m_csLock);
+
+	av_buffer_pool_uninit(&m_pPool);
+	m_nPoolSize	= 0;
+	m_swof		= NULL;
+}
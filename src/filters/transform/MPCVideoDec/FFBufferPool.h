@@ -0,0 +1,83 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include "FormatConverter.h"
+
+struct AVBufferRef;
+struct AVBufferPool;
+struct AVCodecContext;
+struct AVFrame;
+
+// Reference counted packet buffers, grouped in power of two size classes.
+// Every buffer has FF_INPUT_BUFFER_PADDING_SIZE zeroed bytes after the payload,
+// frame threads take a reference instead of copying the packet again.
+
+class CFFPacketPool
+{
+	enum {
+		MIN_CLASS	= 14,	// 16 KB
+		MAX_CLASS	= 26,	// 64 MB
+	};
+
+	AVBufferPool*	m_pools[MAX_CLASS - MIN_CLASS + 1];
+
+public:
+	CFFPacketPool();
+	~CFFPacketPool();
+
+	AVBufferRef*	Get(int size);
+	void			Clear();
+};
+
+// Frame buffers for avcodec's get_buffer2 that already use the plane strides
+// of the output media type, such frames are delivered with one copy per plane
+// instead of going through the format converter.
+// GetBuffer is called from the frame threads, the output layout is set by the decoding thread.
+
+class CFFFramePool
+{
+	CCritSec		m_csLock;
+
+	AVBufferPool*	m_pPool;
+	int				m_nPoolSize;
+
+	MPCPixelFormat	m_out_pixfmt;
+	int				m_dstStride;
+	int				m_planeHeight;
+
+	const SW_OUT_FMT* m_swof;
+	int				m_stride[3];
+	int				m_rows[3];
+	int				m_offset[3];
+
+public:
+	CFFFramePool();
+	~CFFFramePool();
+
+	void	SetOutput(MPCPixelFormat out_pixfmt, int dstStride, int planeHeight);
+	// returns false if frames of this codec can't be decoded in the output layout
+	bool	GetBuffer(AVCodecContext* avctx, AVFrame* frame);
+	bool	IsDirect(const AVFrame* frame, MPCPixelFormat out_pixfmt, int dstStride, int planeHeight);
+	// copies a direct frame into the output buffer, returns the number of bytes copied or 0 if it does not fit
+	size_t	CopyDirect(BYTE* dst, size_t dstSize, const AVFrame* frame, MPCPixelFormat out_pixfmt, int planeHeight) const;
+	void	Clear();
+};
@@ -147,6 +147,8 @@ public:
 	void SetOptions(int preset, int standard, int rgblevels);
 
 	MPCPixelFormat GetOutPixFormat() { return m_out_pixfmt; }
+	int  GetDstStride() { return m_dstStride; }
+	int  GetPlaneHeight() { return m_planeHeight; }
 
 	int  Converting(BYTE* dst, AVFrame* pFrame);
 
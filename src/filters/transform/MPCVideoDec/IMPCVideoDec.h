@@ -96,7 +96,8 @@ enum MPCInfo {
 	INFO_InputFormat,
 	INFO_FrameSize,
 	INFO_OutputFormat,
-	INFO_GraphicsAdapter
+	INFO_GraphicsAdapter,
+	INFO_CopyStats
 };
 
 interface __declspec(uuid("CDC3B5B3-A8B0-4c70-A805-9FC80CDEF262"))
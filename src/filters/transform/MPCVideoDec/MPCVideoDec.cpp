@@ -902,10 +902,10 @@ CMPCVideoDecFilter::CMPCVideoDecFilter(LPUNKNOWN lpunk, HRESULT* phr)
 	, m_nWorkaroundBug(FF_BUG_AUTODETECT)
 	, m_nErrorConcealment(FF_EC_DEBLOCK | FF_EC_GUESS_MVS)
 	, m_bDXVACompatible(true)
-	, m_pFFBuffer(NULL)
-	, m_nFFBufferSize(0)
-	, m_pFFBuffer2(NULL)
-	, m_nFFBufferSize2(0)
+	, m_nCopiedIn(0)
+	, m_nCopiedOut(0)
+	, m_nOutputFrames(0)
+	, m_nDirectFrames(0)
 	, m_nOutputWidth(0)
 	, m_nOutputHeight(0)
 	, m_nARX(0)
@@ -1359,10 +1359,13 @@ void CMPCVideoDecFilter::ffmpegCleanup()
 
 	av_frame_free(&m_pFrame);
 
-	av_freep(&m_pFFBuffer);
-	m_nFFBufferSize = 0;
-	av_freep(&m_pFFBuffer2);
-	m_nFFBufferSize2 = 0;
+	m_PacketPool.Clear();
+	m_FramePool.Clear();
+
+	m_nCopiedIn		= 0;
+	m_nCopiedOut	= 0;
+	m_nOutputFrames	= 0;
+	m_nDirectFrames	= 0;
 
 	m_FormatConverter.Cleanup();
 	
@@ -1676,6 +1679,9 @@ HRESULT CMPCVideoDecFilter::InitDecoder(const CMediaType *pmt)
 	m_pAVCtx->idct_algo             = FF_IDCT_AUTO;
 	m_pAVCtx->skip_loop_filter      = (AVDiscard)m_nDiscardMode;
 	m_pAVCtx->refcounted_frames		= 1;
+	m_pAVCtx->opaque				= this;
+	m_pAVCtx->get_buffer2			= GetBuffer2;
+	m_pAVCtx->thread_safe_callbacks	= 1; // m_FramePool is locked, lavc doesn't have to pass the calls to the decoding thread
 
 	if (m_nCodecId == AV_CODEC_ID_H264 && IsDXVASupported()) {
 		m_pAVCtx->flags2			|= CODEC_FLAG2_SHOW_ALL;
@@ -2268,6 +2274,50 @@ static int64_t process_rv_timestamp(RMDemuxContext *rm, enum AVCodecID nCodecId,
 	return rm_fix_timestamp(buf, timestamp, nCodecId, &rm->kf_base, &rm->kf_pts);
 }
 
+// Required number of additionally allocated bytes at the end of the input bitstream for decoding.
+// This is mainly needed because some optimized bitstream readers read
+// 32 or 64 bit at once and could read over the end.
+// Note: If the first 23 bits of the additional bytes are not 0, then damaged
+// MPEG bitstreams could cause overread and segfault.
+bool CMPCVideoDecFilter::IsPaddedInput(IMediaSample* pIn, BYTE* pDataIn, int nSize)
+{
+	// the parser and the frame threads keep the data after Transform() returns
+	if (!pIn || m_pParser || (m_pAVCtx->active_thread_type & FF_THREAD_FRAME)) {
+		return false;
+	}
+
+	BYTE* pBase = NULL;
+	if (FAILED(pIn->GetPointer(&pBase)) || pDataIn < pBase) {
+		return false;
+	}
+
+	if ((pDataIn - pBase) + nSize + FF_INPUT_BUFFER_PADDING_SIZE > pIn->GetSize()) {
+		return false;
+	}
+
+	const BYTE* pPadding = pDataIn + nSize;
+	for (int i = 0; i < FF_INPUT_BUFFER_PADDING_SIZE; i++) {
+		if (pPadding[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int CMPCVideoDecFilter::GetBuffer2(AVCodecContext* c, AVFrame* pic, int flags)
+{
+	CMPCVideoDecFilter* pFilter = (CMPCVideoDecFilter*)c->opaque;
+
+	if (pFilter && pFilter->m_nDecoderMode == MODE_SOFTWARE) {
+		if (pFilter->m_FramePool.GetBuffer(c, pic)) {
+			return 0;
+		}
+	}
+
+	return avcodec_default_get_buffer2(c, pic, flags);
+}
+
 #define PULLDOWN_FLAG (m_nCodecId == AV_CODEC_ID_VC1 && m_bIsEVO && m_rtAvrTimePerFrame == 333666)
 HRESULT CMPCVideoDecFilter::SoftwareDecode(IMediaSample* pIn, BYTE* pDataIn, int nSize, REFERENCE_TIME& rtStartIn, REFERENCE_TIME& rtStopIn)
 {
@@ -2279,34 +2329,38 @@ HRESULT CMPCVideoDecFilter::SoftwareDecode(IMediaSample* pIn, BYTE* pDataIn, int
 	AVPacket		avpkt;
 	av_init_packet(&avpkt);
 
+	// the whole sample is copied once into a padded pool buffer, unless it can be decoded in place
+	AVBufferRef*	pInBuf	= NULL;
+	AVBufferRef*	pOutBuf	= NULL;
+	BYTE*			pInEnd	= NULL;
+	if (!bFlush) {
+		if (!IsPaddedInput(pIn, pDataIn, nSize)) {
+			pInBuf = m_PacketPool.Get(nSize);
+			if (!pInBuf) {
+				return E_OUTOFMEMORY;
+			}
+			memcpy_sse(pInBuf->data, pDataIn, nSize);
+			m_nCopiedIn += nSize;
+			pDataIn = pInBuf->data;
+		}
+		pInEnd = pDataIn + nSize;
+	}
+
+	m_FramePool.SetOutput(m_FormatConverter.GetOutPixFormat(), m_FormatConverter.GetDstStride(), m_FormatConverter.GetPlaneHeight());
+
 	while (nSize > 0 || bFlush) {
 		REFERENCE_TIME rtStart = rtStartIn, rtStop = rtStopIn;
 		
 		if (!bFlush) {
-			if (nSize + FF_INPUT_BUFFER_PADDING_SIZE > m_nFFBufferSize) {
-				m_nFFBufferSize	= nSize + FF_INPUT_BUFFER_PADDING_SIZE;
-				m_pFFBuffer		= (BYTE*)av_realloc_f(m_pFFBuffer, m_nFFBufferSize, 1);
-				if (!m_pFFBuffer) {
-					m_nFFBufferSize = 0;
-					return E_OUTOFMEMORY;
-				}
-			}
-
-			// Required number of additionally allocated bytes at the end of the input bitstream for decoding.
-			// This is mainly needed because some optimized bitstream readers read
-			// 32 or 64 bit at once and could read over the end.
-			// Note: If the first 23 bits of the additional bytes are not 0, then damaged
-			// MPEG bitstreams could cause overread and segfault.
-			memcpy_sse(m_pFFBuffer, pDataIn, nSize);
-			memset(m_pFFBuffer + nSize, 0, FF_INPUT_BUFFER_PADDING_SIZE);
-
-			avpkt.data	= m_pFFBuffer;
+			avpkt.data	= pDataIn;
 			avpkt.size	= nSize;
+			avpkt.buf	= pInBuf;
 			avpkt.pts	= rtStartIn;
 			avpkt.flags	= AV_PKT_FLAG_KEY;
 		} else {
 			avpkt.data	= NULL;
 			avpkt.size	= 0;
+			avpkt.buf	= NULL;
 		}
 
 		// all Parser code from LAV ... thanks to it's author
@@ -2346,25 +2400,32 @@ HRESULT CMPCVideoDecFilter::SoftwareDecode(IMediaSample* pIn, BYTE* pDataIn, int
 
 			if (pOut_size > 0 || bFlush) {
 
+				av_buffer_unref(&pOutBuf);
+
 				if (pOut && pOut_size > 0) {
-					if (pOut_size + FF_INPUT_BUFFER_PADDING_SIZE > m_nFFBufferSize2) {
-						m_nFFBufferSize2	= pOut_size + FF_INPUT_BUFFER_PADDING_SIZE;
-						m_pFFBuffer2		= (BYTE *)av_realloc_f(m_pFFBuffer2, m_nFFBufferSize2, 1);
-						if (!m_pFFBuffer2) {
-							m_nFFBufferSize2 = 0;
-							return E_OUTOFMEMORY;
+					if (pInBuf && pOut >= pInBuf->data && pOut + pOut_size == pInEnd) {
+						// the frame ends at the end of the input, its padding is already there
+						pOutBuf = av_buffer_ref(pInBuf);
+					} else {
+						pOutBuf = m_PacketPool.Get(pOut_size);
+						if (!pOutBuf) {
+							hr = E_OUTOFMEMORY;
+							break;
 						}
+						memcpy_sse(pOutBuf->data, pOut, pOut_size);
+						m_nCopiedIn += pOut_size;
+						pOut = pOutBuf->data;
 					}
-					memcpy(m_pFFBuffer2, pOut, pOut_size);
-					memset(m_pFFBuffer2 + pOut_size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
 
-					avpkt.data		= m_pFFBuffer2;
+					avpkt.data		= pOut;
 					avpkt.size		= pOut_size;
+					avpkt.buf		= pOutBuf;
 					avpkt.pts		= rtStart;
 					avpkt.duration	= 0;
 				} else {
 					avpkt.data		= NULL;
 					avpkt.size		= 0;
+					avpkt.buf		= NULL;
 				}
 
 				if (m_nDecoderMode != MODE_SOFTWARE) {
@@ -2389,7 +2450,8 @@ HRESULT CMPCVideoDecFilter::SoftwareDecode(IMediaSample* pIn, BYTE* pDataIn, int
 
 		if (used_bytes < 0) {
 			av_frame_unref(m_pFrame);
-			return S_OK;
+			hr = S_OK;
+			break;
 		}
 
 		if (m_bWaitKeyFrame) {
@@ -2466,12 +2528,23 @@ HRESULT CMPCVideoDecFilter::SoftwareDecode(IMediaSample* pIn, BYTE* pDataIn, int
 				}
 			}
 		}
+		size_t nCopied = 0;
 		if (pTmpFrame) {
 			m_FormatConverter.Converting(pDataOut, pTmpFrame);
 			av_frame_free(&pTmpFrame);
 		} else {
-			m_FormatConverter.Converting(pDataOut, m_pFrame);
+			// frames from m_FramePool already have the output strides, copy the planes as they are
+			if (m_FramePool.IsDirect(m_pFrame, m_FormatConverter.GetOutPixFormat(), m_FormatConverter.GetDstStride(), m_FormatConverter.GetPlaneHeight())) {
+				nCopied = m_FramePool.CopyDirect(pDataOut, pOut->GetSize(), m_pFrame, m_FormatConverter.GetOutPixFormat(), m_FormatConverter.GetPlaneHeight());
+			}
+			if (nCopied) {
+				m_nDirectFrames++;
+			} else {
+				m_FormatConverter.Converting(pDataOut, m_pFrame);
+			}
 		}
+		m_nCopiedOut += nCopied ? nCopied : pOut->GetActualDataLength();
+		m_nOutputFrames++;
 
 #if defined(_DEBUG) && 0
 		static REFERENCE_TIME	rtLast = 0;
@@ -2486,6 +2559,9 @@ HRESULT CMPCVideoDecFilter::SoftwareDecode(IMediaSample* pIn, BYTE* pDataIn, int
 		hr = m_pOutput->Deliver(pOut);
 	}
 
+	av_buffer_unref(&pOutBuf);
+	av_buffer_unref(&pInBuf);
+
 	return hr;
 }
 
@@ -3403,6 +3479,14 @@ STDMETHODIMP_(CString) CMPCVideoDecFilter::GetInformation(MPCInfo index)
 	case INFO_GraphicsAdapter:
 		infostr = m_strDeviceDescription;
 		break;
+	case INFO_CopyStats:
+		if (m_nOutputFrames) {
+			infostr.Format(_T("in %.1f KB, out %.1f KB per frame, direct %d%%"),
+						   m_nCopiedIn / 1024.0 / m_nOutputFrames,
+						   m_nCopiedOut / 1024.0 / m_nOutputFrames,
+						   (int)(m_nDirectFrames * 100 / m_nOutputFrames));
+		}
+		break;
 	}
 
 	return infostr;
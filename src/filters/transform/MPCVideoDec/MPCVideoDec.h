@@ -29,6 +29,7 @@
 #include "MPCVideoDecSettingsWnd.h"
 #include "DXVADecoder.h"
 #include "FormatConverter.h"
+#include "FFBufferPool.h"
 #include "../../../apps/mplayerc/FilterEnum.h"
 
 #define MPCVideoDecName L"MPC Video Decoder"
@@ -109,10 +110,14 @@ protected:
 	BOOL									m_bIsEVO;
 
 	// Buffer management for truncated stream (store stream chunks & reference time sent by splitter)
-	BYTE*									m_pFFBuffer;
-	int										m_nFFBufferSize;
-	BYTE*									m_pFFBuffer2;
-	int										m_nFFBufferSize2;
+	CFFPacketPool							m_PacketPool;
+	CFFFramePool							m_FramePool;
+
+	// bytes copied on input and output, for the statistics
+	ULONGLONG								m_nCopiedIn;
+	ULONGLONG								m_nCopiedOut;
+	ULONGLONG								m_nOutputFrames;
+	ULONGLONG								m_nDirectFrames;
 
 	REFERENCE_TIME							m_rtLastStop;			// rtStop for last delivered frame
 	double									m_dRate;
@@ -162,6 +167,8 @@ protected:
 	void				BuildOutputFormat();
 
 	HRESULT				SoftwareDecode(IMediaSample* pIn, BYTE* pDataIn, int nSize, REFERENCE_TIME& rtStart, REFERENCE_TIME& rtStop);
+	bool				IsPaddedInput(IMediaSample* pIn, BYTE* pDataIn, int nSize);
+	static int			GetBuffer2(AVCodecContext* c, AVFrame* pic, int flags);
 	HRESULT				ChangeOutputMediaFormat(int nType);
 
 	HRESULT				ReopenVideo();
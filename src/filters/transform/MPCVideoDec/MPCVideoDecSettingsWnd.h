@@ -78,6 +78,8 @@ class __declspec(uuid("D5AA0389-D274-48e1-BF50-ACB05A56DDE0"))
 	CEdit		m_edtOutputFormat;
 	CStatic		m_txtGraphicsAdapter;
 	CEdit		m_edtGraphicsAdapter;
+	CStatic		m_txtCopyStats;
+	CEdit		m_edtCopyStats;
 
 	CButton		m_grpFmtConv;
 	CStatic		m_txtSwOutputFormats;
@@ -111,7 +113,7 @@ public:
 	bool OnApply();
 
 	static LPCTSTR GetWindowTitle() { return MAKEINTRESOURCE(IDS_FILTER_SETTINGS_CAPTION); }
-	static CSize GetWindowSize() { return CSize(645, 260); }
+	static CSize GetWindowSize() { return CSize(645, 276); }
 
 	DECLARE_MESSAGE_MAP()
 
@@ -21,7 +21,7 @@
 
 #pragma once
 
-typedef enum {DIAuto, DIWeave, DIBlend, DIBob, DIFieldShift, DIELA} ditype;
+typedef enum {DIAuto, DIWeave, DIBlend, DIBob, DIFieldShift, DIELA, DIYadif} ditype;
 
 interface __declspec(uuid("0ABEAA65-0317-47B9-AE1D-D9EA905AFD25"))
 IMpeg2DecFilter :
@@ -54,5 +54,8 @@ public IUnknown {
 	STDMETHOD(EnableReadARFromStream(bool fEnable)) = 0;
 	STDMETHOD_(bool, IsReadARFromStreamEnabled()) = 0;
 
+	STDMETHOD(SetThreadNumber(int nValue)) = 0;
+	STDMETHOD_(int, GetThreadNumber()) = 0;
+
 	STDMETHOD(Apply()) = 0;
 };
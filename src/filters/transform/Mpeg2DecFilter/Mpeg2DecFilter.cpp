@@ -52,6 +52,7 @@
 #define OPT_PlanarYUV       _T("PlanarYUV")
 #define OPT_Interlaced      _T("Interlaced")
 #define OPT_ReadStreamAR    _T("ReadARFromStream")
+#define OPT_ThreadNumber    _T("ThreadNumber")
 
 #define EPSILON 1e-4
 
@@ -247,6 +248,7 @@ CMpeg2DecFilter::CMpeg2DecFilter(LPUNKNOWN lpunk, HRESULT* phr)
 	EnablePlanarYUV(true);
 	EnableInterlaced(false);
 	EnableReadARFromStream(true);
+	SetThreadNumber(0);
 
 #ifdef REGISTER_FILTER
 	CRegKey key;
@@ -279,6 +281,9 @@ CMpeg2DecFilter::CMpeg2DecFilter(LPUNKNOWN lpunk, HRESULT* phr)
 		if (ERROR_SUCCESS == key.QueryDWORDValue(OPT_ReadStreamAR, dw)) {
 			EnableReadARFromStream(!!dw);
 		}
+		if (ERROR_SUCCESS == key.QueryDWORDValue(OPT_ThreadNumber, dw)) {
+			SetThreadNumber(dw);
+		}
 	}
 #else
 	DWORD dw;
@@ -300,6 +305,8 @@ CMpeg2DecFilter::CMpeg2DecFilter(LPUNKNOWN lpunk, HRESULT* phr)
 	EnableInterlaced(!!dw);
 	dw = AfxGetApp()->GetProfileInt(OPT_SECTION_MPEGDec, OPT_ReadStreamAR, m_bReadARFromStream);
 	EnableReadARFromStream(!!dw);
+	dw = AfxGetApp()->GetProfileInt(OPT_SECTION_MPEGDec, OPT_ThreadNumber, m_nThreadNumber);
+	SetThreadNumber(dw);
 
 #endif
 
@@ -327,6 +334,7 @@ STDMETHODIMP CMpeg2DecFilter::Apply()
 		key.SetDWORDValue(OPT_PlanarYUV, m_fPlanarYUV);
 		key.SetDWORDValue(OPT_Interlaced, m_fInterlaced);
 		key.SetDWORDValue(OPT_ReadStreamAR, m_bReadARFromStream);
+		key.SetDWORDValue(OPT_ThreadNumber, m_nThreadNumber);
 	}
 #else
 	AfxGetApp()->WriteProfileInt(OPT_SECTION_MPEGDec, OPT_DeintMethod, m_ditype);
@@ -338,6 +346,7 @@ STDMETHODIMP CMpeg2DecFilter::Apply()
 	AfxGetApp()->WriteProfileInt(OPT_SECTION_MPEGDec, OPT_PlanarYUV, m_fPlanarYUV);
 	AfxGetApp()->WriteProfileInt(OPT_SECTION_MPEGDec, OPT_Interlaced, m_fInterlaced);
 	AfxGetApp()->WriteProfileInt(OPT_SECTION_MPEGDec, OPT_ReadStreamAR, m_bReadARFromStream);
+	AfxGetApp()->WriteProfileInt(OPT_SECTION_MPEGDec, OPT_ThreadNumber, m_nThreadNumber);
 #endif
 
 	return S_OK;
@@ -425,6 +434,8 @@ void CMpeg2DecFilter::InputTypeChanged()
 
 	TRACE(_T("ResetMpeg2Decoder()\n"));
 
+	m_dec->m_held_fbuf = NULL;
+
 	for (int i = 0; i < _countof(m_dec->m_pictures); i++) {
 		m_dec->m_pictures[i].rtStart = m_dec->m_pictures[i].rtStop = INVALID_TIME+1;
 		m_dec->m_pictures[i].fDelivered = false;
@@ -483,7 +494,7 @@ void CMpeg2DecFilter::SetDeinterlaceMethod()
 	} else {
 		m_fb.di = GetDeinterlaceMethod();
 
-		if (m_fb.di == DIAuto || m_fb.di != DIWeave && m_fb.di != DIBlend && m_fb.di != DIBob && m_fb.di != DIFieldShift && m_fb.di != DIELA) {
+		if (m_fb.di == DIAuto || m_fb.di != DIWeave && m_fb.di != DIBlend && m_fb.di != DIBob && m_fb.di != DIFieldShift && m_fb.di != DIELA && m_fb.di != DIYadif) {
 			if (seqflags & SEQ_FLAG_PROGRESSIVE_SEQUENCE) {
 				m_fb.di = DIWeave;    // hurray!
 			} else if (m_fFilm) {
@@ -839,6 +850,19 @@ HRESULT CMpeg2DecFilter::DeliverNormal()
 		DeinterlaceELA(m_fb.buf[0], fbuf->buf[0], w, h, dpitch, spitch, tff);
 		DeinterlaceELA(m_fb.buf[1], fbuf->buf[1], w/2, h/2, dpitch/2, spitch/2, tff);
 		DeinterlaceELA(m_fb.buf[2], fbuf->buf[2], w/2, h/2, dpitch/2, spitch/2, tff);
+	} else if (m_fb.di == DIYadif) {
+		// the decoder keeps the previous frame for us instead of copying it out
+		mpeg2_fbuf_t* prev = m_dec->m_held_fbuf ? m_dec->m_held_fbuf : fbuf;
+
+		DeinterlaceYADIF(m_fb.buf[0], fbuf->buf[0], prev->buf[0], w, h, dpitch, spitch, tff);
+		DeinterlaceYADIF(m_fb.buf[1], fbuf->buf[1], prev->buf[1], w/2, h/2, dpitch/2, spitch/2, tff);
+		DeinterlaceYADIF(m_fb.buf[2], fbuf->buf[2], prev->buf[2], w/2, h/2, dpitch/2, spitch/2, tff);
+
+		m_dec->m_held_fbuf = fbuf;
+	}
+
+	if (m_fb.di != DIYadif) {
+		m_dec->m_held_fbuf = NULL;
 	}
 
 	// postproc
@@ -1089,6 +1113,15 @@ HRESULT CMpeg2DecFilter::StartStreaming()
 		return E_OUTOFMEMORY;
 	}
 
+	// 0 - a slice thread per processor, 1 - no slice threading
+	int nThreadNumber = GetThreadNumber();
+	if (!nThreadNumber) {
+		SYSTEM_INFO SystemInfo;
+		GetSystemInfo(&SystemInfo);
+		nThreadNumber = SystemInfo.dwNumberOfProcessors;
+	}
+	m_dec->mpeg2_threads(nThreadNumber);
+
 	InputTypeChanged();
 
 	//	g_clock = clock();
@@ -1375,6 +1408,19 @@ STDMETHODIMP_(bool) CMpeg2DecFilter::IsReadARFromStreamEnabled()
 	return m_bReadARFromStream;
 }
 
+STDMETHODIMP CMpeg2DecFilter::SetThreadNumber(int nValue)
+{
+	CAutoLock cAutoLock(&m_csProps);
+	m_nThreadNumber = max(0, min(nValue, 16));
+	return S_OK;
+}
+
+STDMETHODIMP_(int) CMpeg2DecFilter::GetThreadNumber()
+{
+	CAutoLock cAutoLock(&m_csProps);
+	return m_nThreadNumber;
+}
+
 //
 // CMpeg2DecInputPin
 //
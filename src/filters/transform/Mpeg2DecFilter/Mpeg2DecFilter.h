@@ -152,6 +152,7 @@ protected:
 	bool m_fPlanarYUV;
 	bool m_fInterlaced;
 	bool m_bReadARFromStream;
+	int m_nThreadNumber;
 
 	static void CalcBrCont(BYTE* YTbl, float bright, float cont);
 	static void CalcHueSat(BYTE* UTbl, BYTE* VTbl, float hue, float sat);
@@ -191,6 +192,8 @@ public:
 
 	STDMETHODIMP EnableReadARFromStream(bool fEnable);
 	STDMETHODIMP_(bool) IsReadARFromStreamEnabled();
+	STDMETHODIMP SetThreadNumber(int nValue);
+	STDMETHODIMP_(int) GetThreadNumber();
 };
 
 class CMpeg2DecInputPin : public CDeCSSInputPin
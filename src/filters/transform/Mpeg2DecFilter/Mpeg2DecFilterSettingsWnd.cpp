@@ -64,6 +64,7 @@ bool CMpeg2DecSettingsWnd::OnConnect(const CInterfaceList<IUnknown, &IID_IUnknow
 	m_planaryuv = m_pM2DF->IsPlanarYUVEnabled();
 	m_interlaced = m_pM2DF->IsInterlacedEnabled();
 	m_readARFromStream = m_pM2DF->IsReadARFromStreamEnabled();
+	m_threadnumber = m_pM2DF->GetThreadNumber();
 
 	return true;
 }
@@ -105,6 +106,7 @@ bool CMpeg2DecSettingsWnd::OnActivate()
 	m_ditype_combo.SetItemData(m_ditype_combo.AddString(_T("Bob")), (DWORD)DIBob);
 	m_ditype_combo.SetItemData(m_ditype_combo.AddString(_T("Field Shift")), (DWORD)DIFieldShift);
 	m_ditype_combo.SetItemData(m_ditype_combo.AddString(_T("ELA")), (DWORD)DIELA);
+	m_ditype_combo.SetItemData(m_ditype_combo.AddString(_T("Yadif")), (DWORD)DIYadif);
 	m_ditype_combo.SetCurSel(0);
 	for (int i = 0; i < m_ditype_combo.GetCount(); i++)
 		if ((int)m_ditype_combo.GetItemData(i) == m_ditype) {
@@ -113,6 +115,17 @@ bool CMpeg2DecSettingsWnd::OnActivate()
 	m_ditype_combo.EnableWindow(!IsDlgButtonChecked(m_interlaced_check.GetDlgCtrlID()));
 	p.y += h25;
 
+	m_threadnumber_static.Create(ResStr(IDS_MPEG2_THREADNUMBER), WS_VISIBLE | WS_CHILD, CRect(p, CSize(IPP_SCALE(150), m_fontheight)), this);
+	m_threadnumber_combo.Create(dwStyle | CBS_DROPDOWNLIST | WS_VSCROLL, CRect(p + CSize(IPP_SCALE(160), -4), CSize(IPP_SCALE(50), 200)), this, IDC_PP_COMBO2);
+	m_threadnumber_combo.AddString(_T("Auto"));
+	CString str;
+	for (int i = 1; i <= 16; i++) {
+		str.Format(_T("%d"), i);
+		m_threadnumber_combo.AddString(str);
+	}
+	m_threadnumber_combo.SetCurSel(m_threadnumber);
+	p.y += h25;
+
 	{
 		int h = max(21, m_fontheight); // special size for sliders
 		static const TCHAR* labels[] = {m_strBrightness, m_strContrast,	m_strHue, m_strSaturation};
@@ -167,6 +180,7 @@ void CMpeg2DecSettingsWnd::OnDeactivate()
 	m_interlaced = !!IsDlgButtonChecked(m_interlaced_check.GetDlgCtrlID());
 	m_forcedsubs = !!IsDlgButtonChecked(m_forcedsubs_check.GetDlgCtrlID());
 	m_readARFromStream = !!IsDlgButtonChecked(m_readARFromStream_check.GetDlgCtrlID());
+	m_threadnumber = m_threadnumber_combo.GetCurSel();
 }
 
 bool CMpeg2DecSettingsWnd::OnApply()
@@ -183,6 +197,7 @@ bool CMpeg2DecSettingsWnd::OnApply()
 		m_pM2DF->EnablePlanarYUV(m_planaryuv);
 		m_pM2DF->EnableInterlaced(m_interlaced);
 		m_pM2DF->EnableReadARFromStream(m_readARFromStream);
+		m_pM2DF->SetThreadNumber(m_threadnumber);
 		m_pM2DF->Apply();
 	}
 
@@ -36,6 +36,7 @@ class __declspec(uuid("E5FB6957-65E6-491B-BB37-B25C9FE3BEA7"))
 	bool m_interlaced;
 	bool m_forcedsubs;
 	bool m_readARFromStream;
+	int m_threadnumber;
 
 	enum {
 		IDC_PP_COMBO1 = 10000,
@@ -48,11 +49,14 @@ class __declspec(uuid("E5FB6957-65E6-491B-BB37-B25C9FE3BEA7"))
 		IDC_PP_CHECK3,
 		IDC_PP_CHECK4,
 		IDC_PP_BUTTON1,
-		IDC_PP_BUTTON2
+		IDC_PP_BUTTON2,
+		IDC_PP_COMBO2
 	};
 
 	CStatic m_ditype_static;
 	CComboBox m_ditype_combo;
+	CStatic m_threadnumber_static;
+	CComboBox m_threadnumber_combo;
 	CStatic m_procamp_static[4];
 	CSliderCtrl m_procamp_slider[4];
 	CStatic m_procamp_value[4];
@@ -76,7 +80,7 @@ public:
 	bool OnApply();
 
 	static LPCTSTR GetWindowTitle() { return MAKEINTRESOURCE(IDS_FILTER_SETTINGS_CAPTION); }
-	static CSize GetWindowSize() { return CSize(340, 296); }
+	static CSize GetWindowSize() { return CSize(340, 321); }
 
 	DECLARE_MESSAGE_MAP()
 
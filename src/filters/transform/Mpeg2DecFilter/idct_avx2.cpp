@@ -0,0 +1,242 @@
+/*
+ * (C) 2006-2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+
+#if _MSC_VER >= 1700 // no AVX2 intrinsics in VS2010
+
+#include <inttypes.h>
+#include <immintrin.h>
+#include "libmpeg2.h"
+#include "attributes.h"
+
+// The integer iDCT of libmpeg2 (idct_row/idct_col in libmpeg2.cpp) evaluated
+// on eight rows or columns at once with 32-bit lanes. Same arithmetic as the
+// C version, so the output is identical, but the coefficients are expected
+// in natural order like in the SSE2 iDCT.
+
+#define W1 2841 /* 2048 * sqrt (2) * cos (1 * pi / 16) */
+#define W2 2676 /* 2048 * sqrt (2) * cos (2 * pi / 16) */
+#define W3 2408 /* 2048 * sqrt (2) * cos (3 * pi / 16) */
+#define W5 1609 /* 2048 * sqrt (2) * cos (5 * pi / 16) */
+#define W6 1108 /* 2048 * sqrt (2) * cos (6 * pi / 16) */
+#define W7 565  /* 2048 * sqrt (2) * cos (7 * pi / 16) */
+
+#define BUTTERFLY(t0,t1,W0,W1,d0,d1)											\
+{																				\
+	__m256i tmp = _mm256_mullo_epi32(_mm256_set1_epi32(W0), _mm256_add_epi32(d0, d1));	\
+	t0 = _mm256_add_epi32(tmp, _mm256_mullo_epi32(_mm256_set1_epi32(W1 - W0), d1));		\
+	t1 = _mm256_sub_epi32(tmp, _mm256_mullo_epi32(_mm256_set1_epi32(W1 + W0), d0));		\
+}
+
+static __forceinline void transpose8x8_16(__m128i* r)
+{
+	__m128i t0 = _mm_unpacklo_epi16(r[0], r[1]);
+	__m128i t1 = _mm_unpackhi_epi16(r[0], r[1]);
+	__m128i t2 = _mm_unpacklo_epi16(r[2], r[3]);
+	__m128i t3 = _mm_unpackhi_epi16(r[2], r[3]);
+	__m128i t4 = _mm_unpacklo_epi16(r[4], r[5]);
+	__m128i t5 = _mm_unpackhi_epi16(r[4], r[5]);
+	__m128i t6 = _mm_unpacklo_epi16(r[6], r[7]);
+	__m128i t7 = _mm_unpackhi_epi16(r[6], r[7]);
+
+	__m128i u0 = _mm_unpacklo_epi32(t0, t2);
+	__m128i u1 = _mm_unpackhi_epi32(t0, t2);
+	__m128i u2 = _mm_unpacklo_epi32(t1, t3);
+	__m128i u3 = _mm_unpackhi_epi32(t1, t3);
+	__m128i u4 = _mm_unpacklo_epi32(t4, t6);
+	__m128i u5 = _mm_unpackhi_epi32(t4, t6);
+	__m128i u6 = _mm_unpacklo_epi32(t5, t7);
+	__m128i u7 = _mm_unpackhi_epi32(t5, t7);
+
+	r[0] = _mm_unpacklo_epi64(u0, u4);
+	r[1] = _mm_unpackhi_epi64(u0, u4);
+	r[2] = _mm_unpacklo_epi64(u1, u5);
+	r[3] = _mm_unpackhi_epi64(u1, u5);
+	r[4] = _mm_unpacklo_epi64(u2, u6);
+	r[5] = _mm_unpackhi_epi64(u2, u6);
+	r[6] = _mm_unpacklo_epi64(u3, u7);
+	r[7] = _mm_unpackhi_epi64(u3, u7);
+}
+
+static __forceinline __m128i pack_epi32(__m256i v)
+{
+	return _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+}
+
+// r[] holds the rows of the block; returns the rows of the transformed block
+
+static __forceinline void idct_avx2(const int16_t* block, __m128i* r)
+{
+	__m256i d[8], o[8];
+
+	for (int i = 0; i < 8; i++) {
+		r[i] = _mm_load_si128((const __m128i*)(block + 8 * i));
+	}
+
+	transpose8x8_16(r);
+
+	for (int i = 0; i < 8; i++) {
+		d[i] = _mm256_cvtepi16_epi32(r[i]);
+	}
+
+	// idct_row, lane n is row n
+
+	{
+		__m256i t0, t1, t2, t3;
+		__m256i a0, a1, a2, a3, b0, b1, b2, b3;
+
+		__m256i d0 = _mm256_add_epi32(_mm256_slli_epi32(d[0], 11), _mm256_set1_epi32(128));
+		__m256i d4 = _mm256_slli_epi32(d[4], 11);
+		t0 = _mm256_add_epi32(d0, d4);
+		t1 = _mm256_sub_epi32(d0, d4);
+		BUTTERFLY(t2, t3, W6, W2, d[6], d[2]);
+		a0 = _mm256_add_epi32(t0, t2);
+		a1 = _mm256_add_epi32(t1, t3);
+		a2 = _mm256_sub_epi32(t1, t3);
+		a3 = _mm256_sub_epi32(t0, t2);
+
+		BUTTERFLY(t0, t1, W7, W1, d[7], d[1]);
+		BUTTERFLY(t2, t3, W3, W5, d[3], d[5]);
+		b0 = _mm256_add_epi32(t0, t2);
+		b3 = _mm256_add_epi32(t1, t3);
+		t0 = _mm256_sub_epi32(t0, t2);
+		t1 = _mm256_sub_epi32(t1, t3);
+		b1 = _mm256_srai_epi32(_mm256_mullo_epi32(_mm256_add_epi32(t0, t1), _mm256_set1_epi32(181)), 8);
+		b2 = _mm256_srai_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(t0, t1), _mm256_set1_epi32(181)), 8);
+
+		o[0] = _mm256_srai_epi32(_mm256_add_epi32(a0, b0), 8);
+		o[1] = _mm256_srai_epi32(_mm256_add_epi32(a1, b1), 8);
+		o[2] = _mm256_srai_epi32(_mm256_add_epi32(a2, b2), 8);
+		o[3] = _mm256_srai_epi32(_mm256_add_epi32(a3, b3), 8);
+		o[4] = _mm256_srai_epi32(_mm256_sub_epi32(a3, b3), 8);
+		o[5] = _mm256_srai_epi32(_mm256_sub_epi32(a2, b2), 8);
+		o[6] = _mm256_srai_epi32(_mm256_sub_epi32(a1, b1), 8);
+		o[7] = _mm256_srai_epi32(_mm256_sub_epi32(a0, b0), 8);
+	}
+
+	// the C version stores the row results into the int16_t block, wrap the same way
+
+	for (int i = 0; i < 8; i++) {
+		r[i] = pack_epi32(_mm256_srai_epi32(_mm256_slli_epi32(o[i], 16), 16));
+	}
+
+	transpose8x8_16(r);
+
+	for (int i = 0; i < 8; i++) {
+		d[i] = _mm256_cvtepi16_epi32(r[i]);
+	}
+
+	// idct_col, lane n is column n
+
+	{
+		__m256i t0, t1, t2, t3;
+		__m256i a0, a1, a2, a3, b0, b1, b2, b3;
+
+		__m256i d0 = _mm256_add_epi32(_mm256_slli_epi32(d[0], 11), _mm256_set1_epi32(65536));
+		__m256i d4 = _mm256_slli_epi32(d[4], 11);
+		t0 = _mm256_add_epi32(d0, d4);
+		t1 = _mm256_sub_epi32(d0, d4);
+		BUTTERFLY(t2, t3, W6, W2, d[6], d[2]);
+		a0 = _mm256_add_epi32(t0, t2);
+		a1 = _mm256_add_epi32(t1, t3);
+		a2 = _mm256_sub_epi32(t1, t3);
+		a3 = _mm256_sub_epi32(t0, t2);
+
+		BUTTERFLY(t0, t1, W7, W1, d[7], d[1]);
+		BUTTERFLY(t2, t3, W3, W5, d[3], d[5]);
+		b0 = _mm256_add_epi32(t0, t2);
+		b3 = _mm256_add_epi32(t1, t3);
+		t0 = _mm256_srai_epi32(_mm256_sub_epi32(t0, t2), 8);
+		t1 = _mm256_srai_epi32(_mm256_sub_epi32(t1, t3), 8);
+		b1 = _mm256_mullo_epi32(_mm256_add_epi32(t0, t1), _mm256_set1_epi32(181));
+		b2 = _mm256_mullo_epi32(_mm256_sub_epi32(t0, t1), _mm256_set1_epi32(181));
+
+		r[0] = pack_epi32(_mm256_srai_epi32(_mm256_add_epi32(a0, b0), 17));
+		r[1] = pack_epi32(_mm256_srai_epi32(_mm256_add_epi32(a1, b1), 17));
+		r[2] = pack_epi32(_mm256_srai_epi32(_mm256_add_epi32(a2, b2), 17));
+		r[3] = pack_epi32(_mm256_srai_epi32(_mm256_add_epi32(a3, b3), 17));
+		r[4] = pack_epi32(_mm256_srai_epi32(_mm256_sub_epi32(a3, b3), 17));
+		r[5] = pack_epi32(_mm256_srai_epi32(_mm256_sub_epi32(a2, b2), 17));
+		r[6] = pack_epi32(_mm256_srai_epi32(_mm256_sub_epi32(a1, b1), 17));
+		r[7] = pack_epi32(_mm256_srai_epi32(_mm256_sub_epi32(a0, b0), 17));
+	}
+}
+
+static __forceinline void clear_block(int16_t* block)
+{
+	__m256i zero = _mm256_setzero_si256();
+	_mm256_storeu_si256((__m256i*)(block + 0), zero);
+	_mm256_storeu_si256((__m256i*)(block + 16), zero);
+	_mm256_storeu_si256((__m256i*)(block + 32), zero);
+	_mm256_storeu_si256((__m256i*)(block + 48), zero);
+}
+
+void mpeg2_idct_copy_avx2(int16_t* block, uint8_t* dest, const int stride)
+{
+	__m128i r[8];
+	idct_avx2(block, r);
+
+	for (int i = 0; i < 8; i += 2) {
+		__m128i p = _mm_packus_epi16(r[i], r[i + 1]);
+		_mm_storel_epi64((__m128i*)&dest[i * stride], p);
+		_mm_storel_epi64((__m128i*)&dest[(i + 1) * stride], _mm_srli_si128(p, 8));
+	}
+
+	clear_block(block);
+
+	_mm256_zeroupper();
+}
+
+void mpeg2_idct_add_avx2(const int last, int16_t* block, uint8_t* dest, const int stride)
+{
+	__m128i zero = _mm_setzero_si128();
+
+	if (last != 129 || (block[0] & 7) == 4) {
+		__m128i r[8];
+		idct_avx2(block, r);
+
+		for (int i = 0; i < 8; i += 2) {
+			__m128i q0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)&dest[i * stride]), zero);
+			__m128i q1 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)&dest[(i + 1) * stride]), zero);
+			__m128i p = _mm_packus_epi16(_mm_adds_epi16(r[i], q0), _mm_adds_epi16(r[i + 1], q1));
+			_mm_storel_epi64((__m128i*)&dest[i * stride], p);
+			_mm_storel_epi64((__m128i*)&dest[(i + 1) * stride], _mm_srli_si128(p, 8));
+		}
+
+		clear_block(block);
+
+		_mm256_zeroupper();
+	} else {
+		__m128i dc = _mm_set1_epi16((short)((block[0] + 4) >> 3));
+		block[0] = block[63] = 0;
+
+		for (int i = 0; i < 8; i++) {
+			__m128i q = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)&dest[i * stride]), zero);
+			_mm_storel_epi64((__m128i*)&dest[i * stride], _mm_packus_epi16(_mm_adds_epi16(q, dc), zero));
+		}
+	}
+}
+
+void mpeg2_idct_init_avx2()
+{
+}
+
+#endif
@@ -382,6 +382,20 @@ extern void mpeg2_idct_add_sse2(const int last, int16_t* block, uint8_t* dest, c
 
 extern mpeg2_mc_t mpeg2_mc_sse2;
 
+#if _MSC_VER >= 1700
+
+// idct (avx2)
+
+extern void mpeg2_idct_init_avx2();
+extern void mpeg2_idct_copy_avx2(int16_t* block, uint8_t* dest, const int stride);
+extern void mpeg2_idct_add_avx2(const int last, int16_t* block, uint8_t* dest, const int stride);
+
+// mc (avx2)
+
+extern mpeg2_mc_t mpeg2_mc_avx2;
+
+#endif
+
 // idct (c)
 
 static void mpeg2_idct_init_c();
@@ -421,6 +435,7 @@ CMpeg2Dec::CMpeg2Dec()
 	m_picture = NULL;
     memset(&m_fbuf, 0, sizeof(m_fbuf));
     memset(&m_fbuf_alloc, 0, sizeof(m_fbuf_alloc));
+	m_held_fbuf = NULL;
 
     m_buf_start = m_buf_end = NULL;
 
@@ -430,6 +445,9 @@ CMpeg2Dec::CMpeg2Dec()
     memset(&m_intra_quantizer_matrix, 0, sizeof(m_intra_quantizer_matrix));
     memset(&m_non_intra_quantizer_matrix, 0, sizeof(m_non_intra_quantizer_matrix));
 
+	m_threads = 1;
+	m_slice_workers = NULL;
+
 	//
 
 	mpeg2_init();
@@ -438,6 +456,7 @@ CMpeg2Dec::CMpeg2Dec()
 CMpeg2Dec::~CMpeg2Dec()
 {
 	mpeg2_close();
+	delete m_slice_workers;
 }
 
 void CMpeg2Dec::mpeg2_init()
@@ -456,6 +475,7 @@ void CMpeg2Dec::mpeg2_close()
 
 	mpeg2_header_state_init();
 	_aligned_free(m_chunk_buffer);
+	m_chunk_buffer = m_chunk_start = m_chunk_ptr = NULL;
 }
 
 //
@@ -645,18 +665,41 @@ mpeg2_state_t CMpeg2Dec::mpeg2_parse()
 				copied = copy_chunk(size_chunk);
 				if(!copied)
 				{
-					/* filled the chunk buffer without finding a start code */
 					m_bytes_since_pts += size_chunk;
+
+					if(m_slice_workers && m_chunk_start > m_chunk_buffer)
+					{
+						/* the queued slices fill the chunk buffer, decode them and continue
+						   the current slice at the start of the buffer */
+						m_chunk_ptr += size_chunk;
+						mpeg2_flush_slices();
+						continue;
+					}
+
+					/* filled the chunk buffer without finding a start code */
+					m_chunk_ptr = m_chunk_start;
 					m_action = &CMpeg2Dec::seek_chunk;
+					mpeg2_flush_slices();
 					return STATE_INVALID;
 				}
 			}
 
 			m_bytes_since_pts += copied;
 
-			m_decoder.mpeg2_slice(m_code, m_chunk_start);
-			m_code = m_buf_start[-1];
-			m_chunk_ptr = m_chunk_start;
+			if(m_slice_workers)
+			{
+				/* keep the slice in the chunk buffer until the picture is complete */
+				CMpeg2SliceWorkers::slice_t slice = {m_code, m_chunk_start};
+				m_slices.Add(slice);
+				m_code = m_buf_start[-1];
+				m_chunk_start = m_chunk_ptr;
+			}
+			else
+			{
+				m_decoder.mpeg2_slice(m_code, m_chunk_start);
+				m_code = m_buf_start[-1];
+				m_chunk_ptr = m_chunk_start;
+			}
 		}
 
 		if((unsigned)(m_code - 1) >= 0xb0 - 1)
@@ -665,6 +708,9 @@ mpeg2_state_t CMpeg2Dec::mpeg2_parse()
 			return STATE_BUFFER;
 	}
 
+	/* every slice of the picture has been seen, wait until they are all decoded */
+	mpeg2_flush_slices();
+
 	switch(m_code)
 	{
 	case 0x00:
@@ -714,6 +760,37 @@ void CMpeg2Dec::mpeg2_pts(uint32_t pts)
 	m_bytes_since_pts = 0;
 }
 
+void CMpeg2Dec::mpeg2_threads(int threads)
+{
+	threads = (threads < 1) ? 1 : (threads > MAX_THREADS) ? MAX_THREADS : threads;
+	if(threads == m_threads)
+		return;
+
+	mpeg2_flush_slices();
+
+	delete m_slice_workers;
+	m_slice_workers = (threads > 1) ? DNew CMpeg2SliceWorkers(threads) : NULL;
+	m_threads = threads;
+}
+
+void CMpeg2Dec::mpeg2_flush_slices()
+{
+	if(m_slices.GetCount())
+	{
+		m_slice_workers->Decode(&m_decoder, m_slices.GetData(), (int)m_slices.GetCount());
+		m_slices.RemoveAll();
+	}
+
+	if(m_slice_workers && m_chunk_start != m_chunk_buffer)
+	{
+		/* the queued slices are decoded, move the one being copied to the start of the buffer */
+		int len = m_chunk_ptr - m_chunk_start;
+		memmove(m_chunk_buffer, m_chunk_start, len);
+		m_chunk_start = m_chunk_buffer;
+		m_chunk_ptr = m_chunk_buffer + len;
+	}
+}
+
 //
 
 /* decode.c */
@@ -823,6 +900,9 @@ mpeg2_state_t CMpeg2Dec::mpeg2_parse_header()
 
 void CMpeg2Dec::mpeg2_header_state_init()
 {
+	/* the frame buffers queued slices point to are about to go away */
+	m_slices.RemoveAll();
+
     if(m_sequence.width != (unsigned)-1)
 	{
 		m_sequence.width = (unsigned)-1;
@@ -835,6 +915,7 @@ void CMpeg2Dec::mpeg2_header_state_init()
 	m_fbuf[0] = &m_fbuf_alloc[0];
 	m_fbuf[1] = &m_fbuf_alloc[1];
 	m_fbuf[2] = &m_fbuf_alloc[2];
+	m_held_fbuf = NULL;
 	m_first = true;
 	m_alloc_index = 0;
 	m_first_decode_slice = 1;
@@ -1022,7 +1103,7 @@ int CMpeg2Dec::mpeg2_header_picture()
 				m_info.m_discard_fbuf = m_fbuf[!low_delay + !NULL/*m_convert_start*/];
 		}
 
-		while(m_alloc_index < 3)
+		while(m_alloc_index < (int)_countof(m_fbuf_alloc))
 		{
 			mpeg2_fbuf_t* fbuf = &m_fbuf_alloc[m_alloc_index++];
 			fbuf->id = NULL;
@@ -1275,9 +1356,9 @@ mpeg2_state_t CMpeg2Dec::mpeg2_header_end()
 
 void CMpeg2Dec::mpeg2_set_fbuf(int coding_type)
 {
-    for(int i = 0; i < 3; i++)
+    for(int i = 0; i < (int)_countof(m_fbuf_alloc); i++)
 	{
-		if(m_fbuf[1] != &m_fbuf_alloc[i] && m_fbuf[2] != &m_fbuf_alloc[i])
+		if(m_fbuf[1] != &m_fbuf_alloc[i] && m_fbuf[2] != &m_fbuf_alloc[i] && m_held_fbuf != &m_fbuf_alloc[i])
 		{
 			m_fbuf[0] = &m_fbuf_alloc[i];
 			m_info.m_current_fbuf = m_fbuf[0];
@@ -1960,6 +2041,16 @@ CMpeg2Decoder::CMpeg2Decoder()
 
 	m_mpeg1 = 0;
 
+#if _MSC_VER >= 1700
+	if(g_cpuid.m_flags&CCpuID::avx2)
+	{
+		m_idct_init = mpeg2_idct_init_avx2;
+		m_idct_copy = mpeg2_idct_copy_avx2;
+		m_idct_add = mpeg2_idct_add_avx2;
+		m_mc = &mpeg2_mc_avx2;
+	}
+	else
+#endif
 	if(g_cpuid.m_flags&CCpuID::sse2)
 	{
 		m_idct_init = mpeg2_idct_init_sse2;
@@ -3711,6 +3802,175 @@ void CMpeg2Decoder::mpeg2_slice(int code, const uint8_t* buffer)
 #undef bits
 #undef bit_ptr
 
+static void copy_motion(CMpeg2Decoder::motion_t& dst, const CMpeg2Decoder::motion_t& src)
+{
+	memcpy(dst.ref, src.ref, sizeof(dst.ref));
+	memcpy(dst.pmv, src.pmv, sizeof(dst.pmv));
+	memcpy(dst.f_code, src.f_code, sizeof(dst.f_code));
+
+	/* ref2 points into the owner's ref table, rebase it onto ours */
+	for(int i = 0; i < 2; i++)
+		dst.ref2[i] = src.ref2[i] ? dst.ref[src.ref2[i] == src.ref[1]] : NULL;
+}
+
+void CMpeg2Decoder::mpeg2_copy_state(const CMpeg2Decoder& src)
+{
+	copy_motion(m_f_motion, src.m_f_motion);
+	copy_motion(m_b_motion, src.m_b_motion);
+
+	memcpy(m_picture_dest, src.m_picture_dest, sizeof(m_picture_dest));
+
+	m_stride = src.m_stride;
+	m_uv_stride = src.m_uv_stride;
+	m_limit_x = src.m_limit_x;
+	m_limit_y_16 = src.m_limit_y_16;
+	m_limit_y_8 = src.m_limit_y_8;
+	m_limit_y = src.m_limit_y;
+	m_dmv_offset = src.m_dmv_offset;
+
+	memcpy(m_intra_quantizer_matrix, src.m_intra_quantizer_matrix, sizeof(m_intra_quantizer_matrix));
+	memcpy(m_non_intra_quantizer_matrix, src.m_non_intra_quantizer_matrix, sizeof(m_non_intra_quantizer_matrix));
+
+	m_width = src.m_width;
+	m_height = src.m_height;
+	m_vertical_position_extension = src.m_vertical_position_extension;
+
+	m_coding_type = src.m_coding_type;
+
+	m_intra_dc_precision = src.m_intra_dc_precision;
+	m_picture_structure = src.m_picture_structure;
+	m_frame_pred_frame_dct = src.m_frame_pred_frame_dct;
+	m_concealment_motion_vectors = src.m_concealment_motion_vectors;
+	m_q_scale_type = src.m_q_scale_type;
+	m_intra_vlc_format = src.m_intra_vlc_format;
+	m_top_field_first = src.m_top_field_first;
+
+	m_scan = src.m_scan;
+
+	m_second_field = src.m_second_field;
+
+	m_mpeg1 = src.m_mpeg1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+
+CMpeg2SliceWorkers::CMpeg2SliceWorkers(int threads)
+{
+	m_slices = NULL;
+	m_nb_slices = 0;
+	m_rows = NULL;
+	m_nb_rows = m_rows_alloc = 0;
+	m_pending = m_next_row = 0;
+	m_exit = false;
+
+	m_hDone = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+	/* the calling thread decodes its share as well */
+	m_nb_workers = threads - 1;
+	m_workers = DNew worker_t[m_nb_workers];
+
+	for(int i = 0; i < m_nb_workers; i++)
+	{
+		DWORD ThreadId = 0;
+		m_workers[i].pool = this;
+		m_workers[i].hStart = CreateEvent(NULL, FALSE, FALSE, NULL);
+		m_workers[i].hThread = CreateThread(NULL, 0, ThreadProc, (LPVOID)&m_workers[i], 0, &ThreadId);
+	}
+}
+
+CMpeg2SliceWorkers::~CMpeg2SliceWorkers()
+{
+	m_exit = true;
+
+	for(int i = 0; i < m_nb_workers; i++)
+		SetEvent(m_workers[i].hStart);
+
+	for(int i = 0; i < m_nb_workers; i++)
+	{
+		WaitForSingleObject(m_workers[i].hThread, INFINITE);
+		CloseHandle(m_workers[i].hThread);
+		CloseHandle(m_workers[i].hStart);
+	}
+
+	delete [] m_workers;
+	free(m_rows);
+	CloseHandle(m_hDone);
+}
+
+DWORD WINAPI CMpeg2SliceWorkers::ThreadProc(LPVOID lpParameter)
+{
+	worker_t* worker = (worker_t*)lpParameter;
+	CMpeg2SliceWorkers* pool = worker->pool;
+
+	while(1)
+	{
+		WaitForSingleObject(worker->hStart, INFINITE);
+		if(pool->m_exit)
+			break;
+
+		pool->decode_rows(&worker->decoder);
+
+		if(!InterlockedDecrement(&pool->m_pending))
+			SetEvent(pool->m_hDone);
+	}
+
+	return 0;
+}
+
+void CMpeg2SliceWorkers::decode_rows(CMpeg2Decoder* decoder)
+{
+	int row;
+	while((row = InterlockedIncrement(&m_next_row) - 1) < m_nb_rows)
+	{
+		int end = (row + 1 < m_nb_rows) ? m_rows[row + 1] : m_nb_slices;
+		for(int i = m_rows[row]; i < end; i++)
+			decoder->mpeg2_slice(m_slices[i].code, m_slices[i].buffer);
+	}
+}
+
+void CMpeg2SliceWorkers::Decode(CMpeg2Decoder* decoder, const slice_t* slices, int count)
+{
+	/*
+	 * Slices sharing a start code (the same macroblock row) stay on one
+	 * thread in stream order, so overlapping slices of broken streams are
+	 * decoded exactly like the single threaded decoder would do it.
+	 */
+	if(m_rows_alloc < count)
+	{
+		m_rows = (int*)realloc(m_rows, count * sizeof(int));
+		m_rows_alloc = count;
+	}
+
+	m_nb_rows = 0;
+	for(int i = 0; i < count; i++)
+	{
+		if(!i || slices[i].code != slices[i - 1].code)
+			m_rows[m_nb_rows++] = i;
+	}
+
+	m_slices = slices;
+	m_nb_slices = count;
+	m_next_row = 0;
+
+	int workers = min(m_nb_workers, m_nb_rows - 1);
+	m_pending = workers;
+
+	for(int i = 0; i < workers; i++)
+	{
+		m_workers[i].decoder.mpeg2_copy_state(*decoder);
+		SetEvent(m_workers[i].hStart);
+	}
+
+	decode_rows(decoder);
+
+	if(workers > 0)
+		WaitForSingleObject(m_hDone, INFINITE);
+
+	m_slices = NULL;
+	m_nb_slices = 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
 
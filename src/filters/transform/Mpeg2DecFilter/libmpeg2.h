@@ -29,6 +29,7 @@
 #pragma warning(disable: 4005)
 #include <stdint.h>
 #pragma warning(pop)
+#include <atlcoll.h>
 
 #define MPEG2_VERSION(a,b,c) (((a)<<16)|((b)<<8)|(c))
 #define MPEG2_RELEASE MPEG2_VERSION (0, 3, 2)	/* 0.3.2 */
@@ -220,6 +221,7 @@ public:
 
 	void mpeg2_init_fbuf(uint8_t* current_fbuf[3], uint8_t* forward_fbuf[3], uint8_t* backward_fbuf[3]);
 	void mpeg2_slice(int code, const uint8_t* buffer);
+	void mpeg2_copy_state(const CMpeg2Decoder& src);
 
 	int16_t* m_DCTblock;
 
@@ -284,6 +286,46 @@ public:
     int m_mpeg1;
 };
 
+class CMpeg2SliceWorkers
+{
+public:
+	struct slice_t {
+		int code;
+		const uint8_t* buffer;
+	};
+
+private:
+	struct worker_t {
+		CMpeg2SliceWorkers* pool;
+		CMpeg2Decoder decoder;
+		HANDLE hThread;
+		HANDLE hStart;
+	};
+
+	worker_t* m_workers;
+	int m_nb_workers;
+	HANDLE m_hDone;
+	volatile LONG m_pending;
+	volatile LONG m_next_row;
+	bool m_exit;
+
+	/* slices of the current picture, grouped by macroblock row */
+	const slice_t* m_slices;
+	int m_nb_slices;
+	int* m_rows;
+	int m_nb_rows, m_rows_alloc;
+
+	void decode_rows(CMpeg2Decoder* decoder);
+	static DWORD WINAPI ThreadProc(LPVOID lpParameter);
+
+public:
+	CMpeg2SliceWorkers(int threads);
+	virtual ~CMpeg2SliceWorkers();
+
+	/* decodes all slices and returns when the whole picture is done */
+	void Decode(CMpeg2Decoder* decoder, const slice_t* slices, int count);
+};
+
 class CMpeg2Info
 {
 public:
@@ -334,6 +376,9 @@ public:
 
 	void mpeg2_pts(uint32_t pts);
 
+	void mpeg2_threads(int threads);
+	void mpeg2_flush_slices();
+
 	/* decode.c */
 	mpeg2_state_t mpeg2_seek_sequence();
 	mpeg2_state_t mpeg2_parse_header();
@@ -353,11 +398,17 @@ public:
 	void mpeg2_set_fbuf(int coding_type);
 
 	enum {BUFFER_SIZE = 1194 * 1024};
+	enum {MAX_THREADS = 16};
 
 
 	CMpeg2Decoder m_decoder;
     CMpeg2Info m_info;
 
+	/* slice threading: slices are queued in the chunk buffer and decoded once the picture is complete */
+	int m_threads;
+	CMpeg2SliceWorkers* m_slice_workers;
+	CAtlArray<CMpeg2SliceWorkers::slice_t> m_slices;
+
     uint32_t m_shift;
     int m_is_display_initialized;
 	mpeg2_state_t (CMpeg2Dec::* m_action)();
@@ -390,7 +441,8 @@ public:
     mpeg2_picture_t* m_picture;
     /*const*/ mpeg2_fbuf_t* m_fbuf[3];	/* 0: current fbuf, 1-2: prediction fbufs */
 
-	mpeg2_fbuf_t m_fbuf_alloc[3];
+	mpeg2_fbuf_t m_fbuf_alloc[4];
+	mpeg2_fbuf_t* m_held_fbuf;			/* displayed fbuf kept by the caller, not reused until released */
 
     uint8_t* m_buf_start;
     uint8_t* m_buf_end;
@@ -0,0 +1,171 @@
+/*
+ * (C) 2006-2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+
+#if _MSC_VER >= 1700 // no AVX2 intrinsics in VS2010
+
+#include <inttypes.h>
+#include <immintrin.h>
+#include "libmpeg2.h"
+#include "attributes.h"
+
+// 16 pixel wide blocks are done two rows per register, 8 pixel wide blocks
+// four rows. The xy predictor is computed with 16-bit sums, it matches the
+// C version exactly.
+
+static __forceinline __m256i load_16x2(const uint8_t* p, const int stride)
+{
+	return _mm256_inserti128_si256(
+		_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)p)),
+		_mm_loadu_si128((const __m128i*)(p + stride)), 1);
+}
+
+static __forceinline void store_16x2(uint8_t* p, const int stride, __m256i v)
+{
+	_mm_storeu_si128((__m128i*)p, _mm256_castsi256_si128(v));
+	_mm_storeu_si128((__m128i*)(p + stride), _mm256_extracti128_si256(v, 1));
+}
+
+static __forceinline __m256i load_8x4(const uint8_t* p, const int stride)
+{
+	__m128i r01 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)p), _mm_loadl_epi64((const __m128i*)(p + stride)));
+	__m128i r23 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(p + stride * 2)), _mm_loadl_epi64((const __m128i*)(p + stride * 3)));
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(r01), r23, 1);
+}
+
+static __forceinline void store_8x4(uint8_t* p, const int stride, __m256i v)
+{
+	__m128i r01 = _mm256_castsi256_si128(v);
+	__m128i r23 = _mm256_extracti128_si256(v, 1);
+	_mm_storel_epi64((__m128i*)p, r01);
+	_mm_storel_epi64((__m128i*)(p + stride), _mm_srli_si128(r01, 8));
+	_mm_storel_epi64((__m128i*)(p + stride * 2), r23);
+	_mm_storel_epi64((__m128i*)(p + stride * 3), _mm_srli_si128(r23, 8));
+}
+
+// horizontal sums of one 16 pixel row, or of two 8 pixel rows
+
+static __forceinline __m256i hsum_16(const uint8_t* p)
+{
+	return _mm256_add_epi16(
+		_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)p)),
+		_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p + 1))));
+}
+
+static __forceinline __m256i hsum_8x2(const uint8_t* p, const int stride)
+{
+	__m128i a = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)p), _mm_loadl_epi64((const __m128i*)(p + stride)));
+	__m128i b = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(p + 1)), _mm_loadl_epi64((const __m128i*)(p + stride + 1)));
+	return _mm256_add_epi16(_mm256_cvtepu8_epi16(a), _mm256_cvtepu8_epi16(b));
+}
+
+static __forceinline __m256i avg4_epi16(__m256i a, __m256i b)
+{
+	return _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(a, b), _mm256_set1_epi16(2)), 2);
+}
+
+// predictors, two 16 pixel rows or four 8 pixel rows
+
+struct predict_o {
+	static __forceinline __m256i p16(const uint8_t* ref, const int stride) {
+		return load_16x2(ref, stride);
+	}
+	static __forceinline __m256i p8(const uint8_t* ref, const int stride) {
+		return load_8x4(ref, stride);
+	}
+};
+
+struct predict_x {
+	static __forceinline __m256i p16(const uint8_t* ref, const int stride) {
+		return _mm256_avg_epu8(load_16x2(ref, stride), load_16x2(ref + 1, stride));
+	}
+	static __forceinline __m256i p8(const uint8_t* ref, const int stride) {
+		return _mm256_avg_epu8(load_8x4(ref, stride), load_8x4(ref + 1, stride));
+	}
+};
+
+struct predict_y {
+	static __forceinline __m256i p16(const uint8_t* ref, const int stride) {
+		return _mm256_avg_epu8(load_16x2(ref, stride), load_16x2(ref + stride, stride));
+	}
+	static __forceinline __m256i p8(const uint8_t* ref, const int stride) {
+		return _mm256_avg_epu8(load_8x4(ref, stride), load_8x4(ref + stride, stride));
+	}
+};
+
+struct predict_xy {
+	static __forceinline __m256i p16(const uint8_t* ref, const int stride) {
+		__m256i h0 = hsum_16(ref);
+		__m256i h1 = hsum_16(ref + stride);
+		__m256i h2 = hsum_16(ref + stride * 2);
+		__m256i v = _mm256_packus_epi16(avg4_epi16(h0, h1), avg4_epi16(h1, h2));
+		return _mm256_permute4x64_epi64(v, 0xd8);
+	}
+	static __forceinline __m256i p8(const uint8_t* ref, const int stride) {
+		__m256i h01 = hsum_8x2(ref, stride);
+		__m256i h12 = hsum_8x2(ref + stride, stride);
+		__m256i h23 = hsum_8x2(ref + stride * 2, stride);
+		__m256i h34 = hsum_8x2(ref + stride * 3, stride);
+		__m256i v = _mm256_packus_epi16(avg4_epi16(h01, h12), avg4_epi16(h23, h34));
+		return _mm256_permute4x64_epi64(v, 0xd8);
+	}
+};
+
+template<class predict, bool avg>
+static void MC_16_avx2(uint8_t* dest, const uint8_t* ref, const int stride, int height)
+{
+	for (; height > 0; height -= 2, ref += stride * 2, dest += stride * 2) {
+		__m256i v = predict::p16(ref, stride);
+		if (avg) {
+			v = _mm256_avg_epu8(v, load_16x2(dest, stride));
+		}
+		store_16x2(dest, stride, v);
+	}
+
+	_mm256_zeroupper();
+}
+
+template<class predict, bool avg>
+static void MC_8_avx2(uint8_t* dest, const uint8_t* ref, const int stride, int height)
+{
+	for (; height > 0; height -= 4, ref += stride * 4, dest += stride * 4) {
+		__m256i v = predict::p8(ref, stride);
+		if (avg) {
+			v = _mm256_avg_epu8(v, load_8x4(dest, stride));
+		}
+		store_8x4(dest, stride, v);
+	}
+
+	_mm256_zeroupper();
+}
+
+mpeg2_mc_t mpeg2_mc_avx2 = {
+	{
+		MC_16_avx2<predict_o, false>, MC_16_avx2<predict_x, false>, MC_16_avx2<predict_y, false>, MC_16_avx2<predict_xy, false>,
+		MC_8_avx2<predict_o, false>,  MC_8_avx2<predict_x, false>,  MC_8_avx2<predict_y, false>,  MC_8_avx2<predict_xy, false>
+	},
+	{
+		MC_16_avx2<predict_o, true>,  MC_16_avx2<predict_x, true>,  MC_16_avx2<predict_y, true>,  MC_16_avx2<predict_xy, true>,
+		MC_8_avx2<predict_o, true>,   MC_8_avx2<predict_x, true>,   MC_8_avx2<predict_y, true>,   MC_8_avx2<predict_xy, true>
+	}
+};
+
+#endif
@@ -14,6 +14,7 @@
 #define IDS_MPEG2_HUE                   7508
 #define IDS_MPEG2_SATURATION            7509
 #define IDS_MPEG2_READ_AR               7511
+#define IDS_MPEG2_THREADNUMBER          7512
 
 // Next default values for new objects
 // 